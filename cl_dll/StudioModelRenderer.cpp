@@ -21,6 +21,12 @@ Transparency code by Neil "Jed" Jedrzejewski
 #include <cstdio>
 #include <cstdlib>
 #include <cmath>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+
+#include <emmintrin.h>
 
 #include "GL/gl.h"
 #include "GL/glext.h"
@@ -47,10 +53,14 @@ Transparency code by Neil "Jed" Jedrzejewski
 #include "renderer/rendererdefs.h"
 #include "renderer/propmanager.h"
 #include "renderer/bsprenderer.h"
+#include "renderer/jobpool.h"
 #include "StudioModelRenderer.h"
+#include "GameStudioModelRenderer.h"
 #include "mathlib.h"
 
 #include "FranUtils/FranUtils_Maths.hpp"
+#include "perf_counter.h"
+#include "perf_trace.h"
 
 viewinfo_s g_viewinfo;
 
@@ -67,6 +77,240 @@ struct cl_stored_light
 
 std::vector<cl_stored_light> StoredLightBuffer;
 
+// Shadow volumes built last frame, reused while bones and light stay put
+struct cl_shadow_volume
+{
+	svdheader_t* header = nullptr;
+	svdsubmodel_t* submodel = nullptr;
+	Vector lightorigin = Vector(0, 0, 0);
+	int lastframe = 0;
+	std::vector<float> bones;
+	std::vector<Vector> verts;
+	std::vector<GLushort> indexes;
+};
+
+#define SHADOWVOLUME_CACHE_FRAMES 64
+
+std::unordered_map<int, cl_shadow_volume> ShadowVolumeCache;
+int ShadowVolumeCacheSweep = 0;
+
+// the Linux build is x87 only, so the shadow face pass asks
+// for SSE2 itself and only runs it if the CPU has it
+#if defined(__GNUC__)
+#define SHADOW_SSE2 __attribute__((target("sse2")))
+#else
+#define SHADOW_SSE2
+#endif
+
+/*
+====================
+ShadowHasSSE2
+
+====================
+*/
+static bool ShadowHasSSE2()
+{
+#if defined(__GNUC__)
+	static const bool bHasSSE2 = __builtin_cpu_supports("sse2") != 0;
+	return bHasSSE2;
+#else
+	return true; // MSVC builds target SSE2 already
+#endif
+}
+
+/*
+====================
+ShadowFacesFacingLight
+
+Flags the faces whose plane has the light on its front side
+====================
+*/
+static void ShadowFacesFacingLight(const Vector* pverts, const svdface_t* pfaces, int firstface, int numfaces, const Vector& vLight, bool* pfacing)
+{
+	float plane[4];
+
+	for (int i = firstface; i < numfaces; i++)
+	{
+		const Vector* pv1 = &pverts[pfaces[i].vertex0];
+		const Vector* pv2 = &pverts[pfaces[i].vertex1];
+		const Vector* pv3 = &pverts[pfaces[i].vertex2];
+
+		plane[0] = pv1->y * (pv2->z - pv3->z) + pv2->y * (pv3->z - pv1->z) + pv3->y * (pv1->z - pv2->z);
+		plane[1] = pv1->z * (pv2->x - pv3->x) + pv2->z * (pv3->x - pv1->x) + pv3->z * (pv1->x - pv2->x);
+		plane[2] = pv1->x * (pv2->y - pv3->y) + pv2->x * (pv3->y - pv1->y) + pv3->x * (pv1->y - pv2->y);
+		plane[3] = -(pv1->x * (pv2->y * pv3->z - pv3->y * pv2->z) + pv2->x * (pv3->y * pv1->z - pv1->y * pv3->z) + pv3->x * (pv1->y * pv2->z - pv2->y * pv1->z));
+
+		pfacing[i] = (DotProduct(plane, vLight) + plane[3]) > 0;
+	}
+}
+
+/*
+====================
+ShadowFacesFacingLightSSE2
+
+Same as ShadowFacesFacingLight, four faces at a time
+====================
+*/
+SHADOW_SSE2 static void ShadowFacesFacingLightSSE2(const Vector* pverts, const svdface_t* pfaces, int numfaces, const Vector& vLight, bool* pfacing)
+{
+	const __m128 lx = _mm_set1_ps(vLight.x);
+	const __m128 ly = _mm_set1_ps(vLight.y);
+	const __m128 lz = _mm_set1_ps(vLight.z);
+	const __m128 zero = _mm_setzero_ps();
+
+	int i = 0;
+	for (; i + 4 <= numfaces; i += 4)
+	{
+		const svdface_t* f = &pfaces[i];
+		const Vector *a0 = &pverts[f[0].vertex0], *a1 = &pverts[f[1].vertex0], *a2 = &pverts[f[2].vertex0], *a3 = &pverts[f[3].vertex0];
+		const Vector *b0 = &pverts[f[0].vertex1], *b1 = &pverts[f[1].vertex1], *b2 = &pverts[f[2].vertex1], *b3 = &pverts[f[3].vertex1];
+		const Vector *c0 = &pverts[f[0].vertex2], *c1 = &pverts[f[1].vertex2], *c2 = &pverts[f[2].vertex2], *c3 = &pverts[f[3].vertex2];
+
+		// Lane n holds face i + n
+		const __m128 x1 = _mm_set_ps(a3->x, a2->x, a1->x, a0->x), y1 = _mm_set_ps(a3->y, a2->y, a1->y, a0->y), z1 = _mm_set_ps(a3->z, a2->z, a1->z, a0->z);
+		const __m128 x2 = _mm_set_ps(b3->x, b2->x, b1->x, b0->x), y2 = _mm_set_ps(b3->y, b2->y, b1->y, b0->y), z2 = _mm_set_ps(b3->z, b2->z, b1->z, b0->z);
+		const __m128 x3 = _mm_set_ps(c3->x, c2->x, c1->x, c0->x), y3 = _mm_set_ps(c3->y, c2->y, c1->y, c0->y), z3 = _mm_set_ps(c3->z, c2->z, c1->z, c0->z);
+
+		const __m128 p0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y1, _mm_sub_ps(z2, z3)), _mm_mul_ps(y2, _mm_sub_ps(z3, z1))), _mm_mul_ps(y3, _mm_sub_ps(z1, z2)));
+		const __m128 p1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(z1, _mm_sub_ps(x2, x3)), _mm_mul_ps(z2, _mm_sub_ps(x3, x1))), _mm_mul_ps(z3, _mm_sub_ps(x1, x2)));
+		const __m128 p2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x1, _mm_sub_ps(y2, y3)), _mm_mul_ps(x2, _mm_sub_ps(y3, y1))), _mm_mul_ps(x3, _mm_sub_ps(y1, y2)));
+		const __m128 p3 = _mm_sub_ps(zero, _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(x1, _mm_sub_ps(_mm_mul_ps(y2, z3), _mm_mul_ps(y3, z2))),
+			_mm_mul_ps(x2, _mm_sub_ps(_mm_mul_ps(y3, z1), _mm_mul_ps(y1, z3)))),
+			_mm_mul_ps(x3, _mm_sub_ps(_mm_mul_ps(y1, z2), _mm_mul_ps(y2, z1)))));
+
+		const __m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, lx), _mm_mul_ps(p1, ly)), _mm_mul_ps(p2, lz)), p3);
+		const int mask = _mm_movemask_ps(_mm_cmpgt_ps(dist, zero));
+
+		pfacing[i] = (mask & 1) != 0;
+		pfacing[i + 1] = (mask & 2) != 0;
+		pfacing[i + 2] = (mask & 4) != 0;
+		pfacing[i + 3] = (mask & 8) != 0;
+	}
+
+	ShadowFacesFacingLight(pverts, pfaces, i, numfaces, vLight, pfacing);
+}
+
+// Animation values of one sequence blend decoded out of the run-length stream.
+// For every frame each channel holds the raw value at that frame and the one
+// the frame blends towards, picked exactly like the stream walk picks them.
+struct cl_anim_track
+{
+	mstudioseqdesc_t* seqdesc = nullptr;
+	int numbones = 0;
+	int numframes = 0;
+	std::atomic<int> lastframe = 0; // stamped by readers under the shared lock
+	std::vector<int> channels; // numbones * 6 starting offsets into values, -1 if the channel is not animated
+	std::vector<short> values; // numframes pairs per animated channel
+};
+
+std::unordered_map<mstudioanim_t*, cl_anim_track> AnimTrackCache;
+std::size_t AnimTrackCacheBytes = 0;
+std::shared_mutex AnimTrackCacheMutex; // the bone setup pre-pass looks tracks up from several threads, only decoding takes it exclusively
+
+// Everything the local bone pose of an entity is computed from, so the bone
+// setup pre-pass can compute it away from the renderer's draw state
+struct cl_pose_context
+{
+	cl_entity_t* entity = nullptr;
+	model_t* model = nullptr;
+	studiohdr_t* header = nullptr;
+	CStudioModelRenderer* renderer = nullptr; // loads demand-loaded sequence groups, null in the pre-pass
+	double cltime = 0;
+	int dointerp = 0;
+	std::size_t animcache = 0; // te_anim_cache_kb in bytes, 0 when the cache is off
+};
+
+// Poses blended into the first one, one set per thread
+struct cl_pose_scratch
+{
+	float pos2[MAXSTUDIOBONES][3];
+	vec4_t q2[MAXSTUDIOBONES];
+	float pos3[MAXSTUDIOBONES][3];
+	vec4_t q3[MAXSTUDIOBONES];
+	float pos4[MAXSTUDIOBONES][3];
+	vec4_t q4[MAXSTUDIOBONES];
+	float pos1b[MAXSTUDIOBONES][3];
+	vec4_t q1b[MAXSTUDIOBONES];
+};
+
+// Entity state a pre-pass pose was computed from, drawing only takes
+// the pose if none of it changed since
+struct cl_pose_inputs
+{
+	model_t* model;
+	double cltime;
+	int dointerp;
+	int sequence;
+	float frame;
+	float animtime;
+	float framerate;
+	float prevanimtime;
+	byte controller[4];
+	byte prevcontroller[4];
+	byte blending[2];
+	byte prevblending[2];
+	byte mouthopen;
+
+	// blend from the previous sequence
+	float sequencetime;
+	int prevsequence;
+	float prevframe;
+	byte prevseqblending[2];
+};
+
+// Local bone pose of one entity computed by the pre-pass
+struct cl_entity_pose
+{
+	cl_pose_context ctx;
+	cl_pose_inputs inputs;
+	double frame;
+	bool blendedprev;
+	float pos[MAXSTUDIOBONES][3];
+	vec4_t q[MAXSTUDIOBONES];
+};
+
+std::vector<cl_entity_pose> EntityPoses;
+std::vector<int> EntityPoseSlots; // EntityPoses index by entity index, -1 if not posed
+int EntityPoseCount = 0;
+int EntityPoseFrame = -1;
+
+extern CGameStudioModelRenderer g_StudioRenderer;
+
+/*
+====================
+StudioPoseContext
+
+Pose context of the entity the renderer is drawing
+====================
+*/
+static cl_pose_context StudioPoseContext(CStudioModelRenderer* pRenderer)
+{
+	cl_pose_context ctx;
+	ctx.entity = pRenderer->m_pCurrentEntity;
+	ctx.model = pRenderer->m_pRenderModel;
+	ctx.header = pRenderer->m_pStudioHeader;
+	ctx.renderer = pRenderer;
+	ctx.cltime = pRenderer->m_clTime;
+	ctx.dointerp = pRenderer->m_fDoInterp;
+
+	if (pRenderer->m_pCvarAnimCache->value > 0)
+		ctx.animcache = static_cast<std::size_t>(V_max(pRenderer->m_pCvarAnimCacheSize->value, 0.0f)) * 1024;
+
+	return ctx;
+}
+
+static void StudioAnimCacheBenchmarkCmd()
+{
+	if (gEngfuncs.Cmd_Argc() < 2)
+	{
+		gEngfuncs.Con_Printf("usage: te_anim_cache_benchmark <model> [poses per sequence]\n");
+		return;
+	}
+
+	g_StudioRenderer.StudioAnimCacheBenchmark(gEngfuncs.Cmd_Argv(1), gEngfuncs.Cmd_Argc() > 2 ? V_max(1, atoi(gEngfuncs.Cmd_Argv(2))) : 64);
+}
+
 //===========================================
 //	ARB SHADER
 //===========================================
@@ -1611,6 +1855,13 @@ void CStudioModelRenderer::Init()
 
 	m_pCvarRenderDistance = CVAR_CREATE("te_render_distance", "2000", FCVAR_ARCHIVE);
 
+	m_pCvarAnimCache = CVAR_CREATE("te_anim_cache", "1", FCVAR_ARCHIVE);
+	m_pCvarAnimCacheSize = CVAR_CREATE("te_anim_cache_kb", "16384", FCVAR_ARCHIVE);
+	gEngfuncs.pfnAddCommand("te_anim_cache_benchmark", StudioAnimCacheBenchmarkCmd);
+
+	m_pCvarBonePrepass = CVAR_CREATE("te_bone_prepass", "1", FCVAR_ARCHIVE);
+	gJobPool.SetNumWorkers(V_min((int)std::thread::hardware_concurrency() - 1, 7));
+
 	//
 	// Load ARB shaders
 	//
@@ -1873,6 +2124,14 @@ VidInit
 void CStudioModelRenderer::VidInit()
 {
 	StoredLightBuffer.clear();
+	ShadowVolumeCache.clear();
+	AnimTrackCache.clear();
+	AnimTrackCacheBytes = 0;
+
+	EntityPoses.clear();
+	EntityPoseSlots.clear();
+	EntityPoseCount = 0;
+	EntityPoseFrame = -1;
 
 	int iCurrentBinding;
 	glGetIntegerv(GL_TEXTURE_BINDING_2D, &iCurrentBinding);
@@ -1996,19 +2255,173 @@ CStudioModelRenderer::~CStudioModelRenderer()
 
 /*
 ====================
-StudioCalcBoneAdj
+StudioDecodeAnimValue
 
+Walks the run-length stream to frame k the same way StudioCalcBoneQuaterion
+and StudioCalcBonePosition do and returns the two raw values they would use.
+Positions only blend in some cases, v2 equals v1 when they don't.
 ====================
 */
-void CStudioModelRenderer::StudioCalcBoneAdj(float dadt, float* adj, const byte* pcontroller1, const byte* pcontroller2, byte mouthopen)
+static void StudioDecodeAnimValue(mstudioanimvalue_t* panimvalue, int k, bool rotation, short& v1, short& v2)
+{
+	// DEBUG
+	if (panimvalue->num.total < panimvalue->num.valid)
+		k = 0;
+	while (panimvalue->num.total <= k)
+	{
+		k -= panimvalue->num.total;
+		panimvalue += panimvalue->num.valid + 1;
+		// DEBUG
+		if (panimvalue->num.total < panimvalue->num.valid)
+			k = 0;
+	}
+
+	if (panimvalue->num.valid > k)
+	{
+		v1 = panimvalue[k + 1].value;
+
+		if (panimvalue->num.valid > k + 1)
+			v2 = panimvalue[k + 2].value;
+		else if (!rotation || panimvalue->num.total > k + 1)
+			v2 = v1;
+		else
+			v2 = panimvalue[panimvalue->num.valid + 2].value;
+	}
+	else
+	{
+		v1 = panimvalue[panimvalue->num.valid].value;
+
+		if (panimvalue->num.total > k + 1)
+			v2 = v1;
+		else
+			v2 = panimvalue[panimvalue->num.valid + 2].value;
+	}
+}
+
+/*
+====================
+StudioGetAnimTrack
+
+Returns the decoded values for the sequence blend starting at panim, decoding
+it on first use. Least recently used tracks are dropped to stay within
+te_anim_cache_kb, tracks used this frame are kept since the pre-pass may
+still be reading them. Returns nullptr when the track doesn't fit, the caller
+then walks the stream directly.
+====================
+*/
+static cl_anim_track* StudioGetAnimTrack(studiohdr_t* phdr, mstudioseqdesc_t* pseqdesc, mstudioanim_t* panim, std::size_t budget)
+{
+	{
+		std::shared_lock<std::shared_mutex> lock(AnimTrackCacheMutex);
+
+		auto it = AnimTrackCache.find(panim);
+
+		// stamping the frame under the shared lock keeps the track from being evicted while it's read
+		if (it != AnimTrackCache.end() && it->second.seqdesc == pseqdesc && it->second.numbones == phdr->numbones)
+		{
+			it->second.lastframe.store(gBSPRenderer.m_iFrameCount, std::memory_order_relaxed);
+			return &it->second;
+		}
+	}
+
+	std::unique_lock<std::shared_mutex> lock(AnimTrackCacheMutex);
+
+	// another worker may have decoded it in the meantime
+	auto it = AnimTrackCache.find(panim);
+
+	// sequence group data can be reloaded somewhere else, make sure the slot still matches
+	if (it != AnimTrackCache.end() && it->second.seqdesc == pseqdesc && it->second.numbones == phdr->numbones)
+	{
+		it->second.lastframe = gBSPRenderer.m_iFrameCount;
+		return &it->second;
+	}
+
+	int numframes = V_max(pseqdesc->numframes, 1);
+	int numchannels = 0;
+
+	for (int i = 0; i < phdr->numbones; i++)
+	{
+		for (int j = 0; j < 6; j++)
+		{
+			if (panim[i].offset[j] != 0)
+				numchannels++;
+		}
+	}
+
+	std::size_t bytes = sizeof(cl_anim_track) + phdr->numbones * 6 * sizeof(int) + numchannels * numframes * 2 * sizeof(short);
+
+	if (bytes > budget)
+		return nullptr;
+
+	if (it != AnimTrackCache.end())
+	{
+		AnimTrackCacheBytes -= sizeof(cl_anim_track) + it->second.channels.size() * sizeof(int) + it->second.values.size() * sizeof(short);
+		AnimTrackCache.erase(it);
+	}
+
+	// make room, oldest first
+	while (AnimTrackCacheBytes + bytes > budget)
+	{
+		auto oldest = AnimTrackCache.end();
+		for (auto jt = AnimTrackCache.begin(); jt != AnimTrackCache.end(); ++jt)
+		{
+			if (jt->second.lastframe != gBSPRenderer.m_iFrameCount && (oldest == AnimTrackCache.end() || jt->second.lastframe < oldest->second.lastframe))
+				oldest = jt;
+		}
+
+		if (oldest == AnimTrackCache.end())
+			return nullptr;
+
+		AnimTrackCacheBytes -= sizeof(cl_anim_track) + oldest->second.channels.size() * sizeof(int) + oldest->second.values.size() * sizeof(short);
+		AnimTrackCache.erase(oldest);
+	}
+
+	cl_anim_track& track = AnimTrackCache[panim];
+	track.seqdesc = pseqdesc;
+	track.numbones = phdr->numbones;
+	track.numframes = numframes;
+	track.lastframe = gBSPRenderer.m_iFrameCount;
+	track.channels.resize(phdr->numbones * 6);
+	track.values.resize(numchannels * numframes * 2);
+
+	int offset = 0;
+	for (int i = 0; i < phdr->numbones; i++)
+	{
+		for (int j = 0; j < 6; j++)
+		{
+			if (panim[i].offset[j] == 0)
+			{
+				track.channels[i * 6 + j] = -1;
+				continue;
+			}
+
+			mstudioanimvalue_t* panimvalue = (mstudioanimvalue_t*)((byte*)&panim[i] + panim[i].offset[j]);
+
+			track.channels[i * 6 + j] = offset;
+			for (int k = 0; k < numframes; k++, offset += 2)
+				StudioDecodeAnimValue(panimvalue, k, j >= 3, track.values[offset], track.values[offset + 1]);
+		}
+	}
+
+	AnimTrackCacheBytes += bytes;
+	return &track;
+}
+
+/*
+====================
+StudioPoseCalcBoneAdj
+
+====================
+*/
+static void StudioPoseCalcBoneAdj(const cl_pose_context& ctx, float dadt, float* adj, const byte* pcontroller1, const byte* pcontroller2, byte mouthopen)
 {
 	int i, j;
 	float value;
 	mstudiobonecontroller_t* pbonecontroller;
 
-	pbonecontroller = (mstudiobonecontroller_t*)((byte*)m_pStudioHeader + m_pStudioHeader->bonecontrollerindex);
+	pbonecontroller = (mstudiobonecontroller_t*)((byte*)ctx.header + ctx.header->bonecontrollerindex);
 
-	for (j = 0; j < m_pStudioHeader->numbonecontrollers; j++)
+	for (j = 0; j < ctx.header->numbonecontrollers; j++)
 	{
 		i = pbonecontroller[j].index;
 		if (i <= 3)
@@ -2037,7 +2450,7 @@ void CStudioModelRenderer::StudioCalcBoneAdj(float dadt, float* adj, const byte*
 					value = 1.0;
 				value = (1.0 - value) * pbonecontroller[j].start + value * pbonecontroller[j].end;
 			}
-			// Con_DPrintf( "%d %d %f : %f\n", m_pCurrentEntity->curstate.controller[j], m_pCurrentEntity->latched.prevcontroller[j], value, dadt );
+			// Con_DPrintf( "%d %d %f : %f\n", ctx.entity->curstate.controller[j], ctx.entity->latched.prevcontroller[j], value, dadt );
 		}
 		else
 		{
@@ -2063,14 +2476,25 @@ void CStudioModelRenderer::StudioCalcBoneAdj(float dadt, float* adj, const byte*
 	}
 }
 
+/*
+====================
+StudioCalcBoneAdj
+
+====================
+*/
+void CStudioModelRenderer::StudioCalcBoneAdj(float dadt, float* adj, const byte* pcontroller1, const byte* pcontroller2, byte mouthopen)
+{
+	StudioPoseCalcBoneAdj(StudioPoseContext(this), dadt, adj, pcontroller1, pcontroller2, mouthopen);
+}
+
 
 /*
 ====================
-StudioCalcBoneQuaterion
+StudioPoseCalcBoneQuaterion
 
 ====================
 */
-void CStudioModelRenderer::StudioCalcBoneQuaterion(int frame, float s, mstudiobone_t* pbone, mstudioanim_t* panim, float* adj, float* q)
+static void StudioPoseCalcBoneQuaterion(int frame, float s, mstudiobone_t* pbone, mstudioanim_t* panim, float* adj, float* q)
 {
 	int j, k;
 	vec4_t q1, q2;
@@ -2152,11 +2576,22 @@ void CStudioModelRenderer::StudioCalcBoneQuaterion(int frame, float s, mstudiobo
 
 /*
 ====================
-StudioCalcBonePosition
+StudioCalcBoneQuaterion
 
 ====================
 */
-void CStudioModelRenderer::StudioCalcBonePosition(int frame, float s, mstudiobone_t* pbone, mstudioanim_t* panim, float* adj, float* pos)
+void CStudioModelRenderer::StudioCalcBoneQuaterion(int frame, float s, mstudiobone_t* pbone, mstudioanim_t* panim, float* adj, float* q)
+{
+	StudioPoseCalcBoneQuaterion(frame, s, pbone, panim, adj, q);
+}
+
+/*
+====================
+StudioPoseCalcBonePosition
+
+====================
+*/
+static void StudioPoseCalcBonePosition(int frame, float s, mstudiobone_t* pbone, mstudioanim_t* panim, float* adj, float* pos)
 {
 	int j, k;
 	mstudioanimvalue_t* panimvalue;
@@ -2220,11 +2655,22 @@ void CStudioModelRenderer::StudioCalcBonePosition(int frame, float s, mstudiobon
 
 /*
 ====================
-StudioSlerpBones
+StudioCalcBonePosition
 
 ====================
 */
-void CStudioModelRenderer::StudioSlerpBones(vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s)
+void CStudioModelRenderer::StudioCalcBonePosition(int frame, float s, mstudiobone_t* pbone, mstudioanim_t* panim, float* adj, float* pos)
+{
+	StudioPoseCalcBonePosition(frame, s, pbone, panim, adj, pos);
+}
+
+/*
+====================
+StudioPoseSlerpBones
+
+====================
+*/
+static void StudioPoseSlerpBones(const cl_pose_context& ctx, vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s)
 {
 	int i;
 	vec4_t q3;
@@ -2237,7 +2683,7 @@ void CStudioModelRenderer::StudioSlerpBones(vec4_t q1[], float pos1[][3], vec4_t
 
 	s1 = 1.0 - s;
 
-	for (i = 0; i < m_pStudioHeader->numbones; i++)
+	for (i = 0; i < ctx.header->numbones; i++)
 	{
 		QuaternionSlerp(q1[i], q2[i], s, q3);
 		q1[i][0] = q3[0];
@@ -2250,6 +2696,17 @@ void CStudioModelRenderer::StudioSlerpBones(vec4_t q1[], float pos1[][3], vec4_t
 	}
 }
 
+/*
+====================
+StudioSlerpBones
+
+====================
+*/
+void CStudioModelRenderer::StudioSlerpBones(vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s)
+{
+	StudioPoseSlerpBones(StudioPoseContext(this), q1, pos1, q2, pos2, s);
+}
+
 /*
 ====================
 StudioGetAnim
@@ -2422,17 +2879,17 @@ void CStudioModelRenderer::StudioSetUpTransform(int trivial_accept)
 
 /*
 ====================
-StudioEstimateInterpolant
+StudioPoseEstimateInterpolant
 
 ====================
 */
-float CStudioModelRenderer::StudioEstimateInterpolant()
+static float StudioPoseEstimateInterpolant(const cl_pose_context& ctx)
 {
 	float dadt = 1.0;
 
-	if ((m_fDoInterp != 0) && (m_pCurrentEntity->curstate.animtime >= m_pCurrentEntity->latched.prevanimtime + 0.01))
+	if ((ctx.dointerp != 0) && (ctx.entity->curstate.animtime >= ctx.entity->latched.prevanimtime + 0.01))
 	{
-		dadt = (m_clTime - m_pCurrentEntity->curstate.animtime) / 0.1;
+		dadt = (ctx.cltime - ctx.entity->curstate.animtime) / 0.1;
 		if (dadt > 2.0)
 		{
 			dadt = 2.0;
@@ -2443,11 +2900,22 @@ float CStudioModelRenderer::StudioEstimateInterpolant()
 
 /*
 ====================
-StudioCalcRotations
+StudioEstimateInterpolant
 
 ====================
 */
-void CStudioModelRenderer::StudioCalcRotations(float pos[][3], vec4_t* q, mstudioseqdesc_t* pseqdesc, mstudioanim_t* panim, float f)
+float CStudioModelRenderer::StudioEstimateInterpolant()
+{
+	return StudioPoseEstimateInterpolant(StudioPoseContext(this));
+}
+
+/*
+====================
+StudioPoseCalcRotations
+
+====================
+*/
+static void StudioPoseCalcRotations(const cl_pose_context& ctx, float pos[][3], vec4_t* q, mstudioseqdesc_t* pseqdesc, mstudioanim_t* panim, float f)
 {
 	int i;
 	int frame;
@@ -2471,28 +2939,91 @@ void CStudioModelRenderer::StudioCalcRotations(float pos[][3], vec4_t* q, mstudi
 
 	frame = (int)f;
 
-	// Con_DPrintf("%d %.4f %.4f %.4f %.4f %d\n", m_pCurrentEntity->curstate.sequence, m_clTime, m_pCurrentEntity->animtime, m_pCurrentEntity->frame, f, frame );
+	// Con_DPrintf("%d %.4f %.4f %.4f %.4f %d\n", ctx.entity->curstate.sequence, ctx.cltime, ctx.entity->animtime, ctx.entity->frame, f, frame );
 
-	// Con_DPrintf( "%f %f %f\n", m_pCurrentEntity->angles[ROLL], m_pCurrentEntity->angles[PITCH], m_pCurrentEntity->angles[YAW] );
+	// Con_DPrintf( "%f %f %f\n", ctx.entity->angles[ROLL], ctx.entity->angles[PITCH], ctx.entity->angles[YAW] );
 
 	// Con_DPrintf("frame %d %d\n", frame1, frame2 );
 
 
-	dadt = StudioEstimateInterpolant();
+	dadt = StudioPoseEstimateInterpolant(ctx);
 	s = (f - frame);
 
 	// add in programtic controllers
-	pbone = (mstudiobone_t*)((byte*)m_pStudioHeader + m_pStudioHeader->boneindex);
+	pbone = (mstudiobone_t*)((byte*)ctx.header + ctx.header->boneindex);
+
+	StudioPoseCalcBoneAdj(ctx, dadt, adj, ctx.entity->curstate.controller, ctx.entity->latched.prevcontroller, ctx.entity->mouth.mouthopen);
+
+	cl_anim_track* ptrack = nullptr;
+	if (ctx.animcache > 0)
+		ptrack = StudioGetAnimTrack(ctx.header, pseqdesc, panim, ctx.animcache);
+
+	if (ptrack)
+	{
+		// same math as below, with the values looked up instead of walked to
+		for (i = 0; i < ctx.header->numbones; i++, pbone++)
+		{
+			const int* channels = &ptrack->channels[i * 6];
+			Vector angle1, angle2;
+
+			for (int j = 0; j < 3; j++)
+			{
+				if (channels[j + 3] < 0)
+				{
+					angle2[j] = angle1[j] = pbone->value[j + 3];
+				}
+				else
+				{
+					const short* values = &ptrack->values[channels[j + 3] + frame * 2];
+					angle1[j] = pbone->value[j + 3] + values[0] * pbone->scale[j + 3];
+					angle2[j] = pbone->value[j + 3] + values[1] * pbone->scale[j + 3];
+				}
+
+				if (pbone->bonecontroller[j + 3] != -1)
+				{
+					angle1[j] += adj[pbone->bonecontroller[j + 3]];
+					angle2[j] += adj[pbone->bonecontroller[j + 3]];
+				}
 
-	StudioCalcBoneAdj(dadt, adj, m_pCurrentEntity->curstate.controller, m_pCurrentEntity->latched.prevcontroller, m_pCurrentEntity->mouth.mouthopen);
+				pos[i][j] = pbone->value[j];
+				if (channels[j] >= 0)
+				{
+					const short* values = &ptrack->values[channels[j] + frame * 2];
+
+					if (values[0] != values[1])
+						pos[i][j] += (values[0] * (1.0 - s) + s * values[1]) * pbone->scale[j];
+					else
+						pos[i][j] += values[0] * pbone->scale[j];
+				}
+				if (pbone->bonecontroller[j] != -1)
+				{
+					pos[i][j] += adj[pbone->bonecontroller[j]];
+				}
+			}
 
-	for (i = 0; i < m_pStudioHeader->numbones; i++, pbone++, panim++)
+			if (!VectorCompare(angle1, angle2))
+			{
+				vec4_t q1, q2;
+				AngleQuaternion(angle1, q1);
+				AngleQuaternion(angle2, q2);
+				QuaternionSlerp(q1, q2, s, q[i]);
+			}
+			else
+			{
+				AngleQuaternion(angle1, q[i]);
+			}
+		}
+	}
+	else
 	{
-		StudioCalcBoneQuaterion(frame, s, pbone, panim, adj, q[i]);
+		for (i = 0; i < ctx.header->numbones; i++, pbone++, panim++)
+		{
+			StudioPoseCalcBoneQuaterion(frame, s, pbone, panim, adj, q[i]);
 
-		StudioCalcBonePosition(frame, s, pbone, panim, adj, pos[i]);
-		// if (0 && i == 0)
-		//	Con_DPrintf("%d %d %d %d\n", m_pCurrentEntity->curstate.sequence, frame, j, k );
+			StudioPoseCalcBonePosition(frame, s, pbone, panim, adj, pos[i]);
+			// if (0 && i == 0)
+			//	Con_DPrintf("%d %d %d %d\n", ctx.entity->curstate.sequence, frame, j, k );
+		}
 	}
 
 	if ((pseqdesc->motiontype & STUDIO_X) != 0)
@@ -2508,7 +3039,7 @@ void CStudioModelRenderer::StudioCalcRotations(float pos[][3], vec4_t* q, mstudi
 		pos[pseqdesc->motionbone][2] = 0.0;
 	}
 
-	s = 0 * ((1.0 - (f - (int)(f))) / (pseqdesc->numframes)) * m_pCurrentEntity->curstate.framerate;
+	s = 0 * ((1.0 - (f - (int)(f))) / (pseqdesc->numframes)) * ctx.entity->curstate.framerate;
 
 	if ((pseqdesc->motiontype & STUDIO_LX) != 0)
 	{
@@ -2524,6 +3055,103 @@ void CStudioModelRenderer::StudioCalcRotations(float pos[][3], vec4_t* q, mstudi
 	}
 }
 
+/*
+====================
+StudioCalcRotations
+
+====================
+*/
+void CStudioModelRenderer::StudioCalcRotations(float pos[][3], vec4_t* q, mstudioseqdesc_t* pseqdesc, mstudioanim_t* panim, float f)
+{
+	StudioPoseCalcRotations(StudioPoseContext(this), pos, q, pseqdesc, panim, f);
+}
+
+/*
+====================
+StudioAnimCacheBenchmark
+
+Poses every sequence of a model count times at spread out frames, walking
+the run-length stream and then through the decoded cache, and reports the
+time each took and the largest difference between the two poses.
+====================
+*/
+void CStudioModelRenderer::StudioAnimCacheBenchmark(const char* modelname, int count)
+{
+	model_t* pmodel = IEngineStudio.Mod_ForName(modelname, 0);
+
+	if (!pmodel || pmodel->type != mod_studio)
+	{
+		gEngfuncs.Con_Printf("te_anim_cache_benchmark: couldn't load %s\n", modelname);
+		return;
+	}
+
+	static float pos1[MAXSTUDIOBONES][3], pos2[MAXSTUDIOBONES][3];
+	static vec4_t q1[MAXSTUDIOBONES], q2[MAXSTUDIOBONES];
+
+	cl_entity_t bench;
+	memset(&bench, 0, sizeof(bench));
+	bench.model = pmodel;
+	bench.curstate.framerate = 1;
+
+	cl_entity_t* pSavedEntity = m_pCurrentEntity;
+	model_t* pSavedModel = m_pRenderModel;
+	studiohdr_t* pSavedHeader = m_pStudioHeader;
+	const float flSavedCache = m_pCvarAnimCache->value;
+
+	m_pCurrentEntity = &bench;
+	m_pRenderModel = pmodel;
+	m_pStudioHeader = (studiohdr_t*)IEngineStudio.Mod_Extradata(pmodel);
+
+	CPerformanceCounter timer;
+	double walkTime = 0, cachedTime = 0, maxError = 0;
+	int poses = 0, sequences = 0;
+
+	mstudioseqdesc_t* pseqdesc = (mstudioseqdesc_t*)((byte*)m_pStudioHeader + m_pStudioHeader->seqindex);
+	for (int i = 0; i < m_pStudioHeader->numseq; i++, pseqdesc++)
+	{
+		if (pseqdesc->numframes < 2)
+			continue;
+
+		mstudioanim_t* panim = StudioGetAnim(m_pRenderModel, pseqdesc);
+		sequences++;
+
+		// decode outside the timed loop, the cache is warm during play
+		m_pCvarAnimCache->value = 1;
+		StudioCalcRotations(pos2, q2, pseqdesc, panim, 0);
+
+		for (int e = 0; e < count; e++, poses++)
+		{
+			const float f = fmod(e * 7.37f, pseqdesc->numframes - 1);
+
+			m_pCvarAnimCache->value = 0;
+			double start = timer.GetCurTime();
+			StudioCalcRotations(pos1, q1, pseqdesc, panim, f);
+			walkTime += timer.GetCurTime() - start;
+
+			m_pCvarAnimCache->value = 1;
+			start = timer.GetCurTime();
+			StudioCalcRotations(pos2, q2, pseqdesc, panim, f);
+			cachedTime += timer.GetCurTime() - start;
+
+			for (int j = 0; j < m_pStudioHeader->numbones; j++)
+			{
+				for (int k = 0; k < 3; k++)
+					maxError = V_max(maxError, fabs(pos1[j][k] - pos2[j][k]));
+				for (int k = 0; k < 4; k++)
+					maxError = V_max(maxError, fabs(q1[j][k] - q2[j][k]));
+			}
+		}
+	}
+
+	m_pCvarAnimCache->value = flSavedCache;
+	m_pCurrentEntity = pSavedEntity;
+	m_pRenderModel = pSavedModel;
+	m_pStudioHeader = pSavedHeader;
+
+	gEngfuncs.Con_Printf("te_anim_cache_benchmark: %s, %d poses over %d sequences: walk %.3f ms, cached %.3f ms, max difference %g, cache %d KB\n",
+		modelname, poses, sequences, walkTime * 1000.0, cachedTime * 1000.0, maxError, static_cast<int>(AnimTrackCacheBytes / 1024));
+}
+
 /*
 ====================
 Studio_FxTransform
@@ -2585,23 +3213,23 @@ void CStudioModelRenderer::StudioFxTransform(cl_entity_t* ent, float transform[3
 
 /*
 ====================
-StudioEstimateFrame
+StudioPoseEstimateFrame
 
 ====================
 */
-float CStudioModelRenderer::StudioEstimateFrame(mstudioseqdesc_t* pseqdesc)
+static float StudioPoseEstimateFrame(const cl_pose_context& ctx, mstudioseqdesc_t* pseqdesc)
 {
 	double dfdt, f;
 
-	if (m_fDoInterp != 0)
+	if (ctx.dointerp != 0)
 	{
-		if (m_clTime < m_pCurrentEntity->curstate.animtime)
+		if (ctx.cltime < ctx.entity->curstate.animtime)
 		{
 			dfdt = 0;
 		}
 		else
 		{
-			dfdt = (m_clTime - m_pCurrentEntity->curstate.animtime) * m_pCurrentEntity->curstate.framerate * pseqdesc->fps;
+			dfdt = (ctx.cltime - ctx.entity->curstate.animtime) * ctx.entity->curstate.framerate * pseqdesc->fps;
 		}
 	}
 	else
@@ -2615,7 +3243,7 @@ float CStudioModelRenderer::StudioEstimateFrame(mstudioseqdesc_t* pseqdesc)
 	}
 	else
 	{
-		f = (m_pCurrentEntity->curstate.frame * (pseqdesc->numframes - 1)) / 256.0;
+		f = (ctx.entity->curstate.frame * (pseqdesc->numframes - 1)) / 256.0;
 	}
 
 	f += dfdt;
@@ -2647,119 +3275,356 @@ float CStudioModelRenderer::StudioEstimateFrame(mstudioseqdesc_t* pseqdesc)
 
 /*
 ====================
-StudioSetupBones
+StudioEstimateFrame
 
 ====================
 */
-void CStudioModelRenderer::StudioSetupBones()
+float CStudioModelRenderer::StudioEstimateFrame(mstudioseqdesc_t* pseqdesc)
 {
-	int i;
-	double f;
-
-	mstudiobone_t* pbones;
-	mstudioseqdesc_t* pseqdesc;
-	mstudioanim_t* panim;
-
-	static float pos[MAXSTUDIOBONES][3];
-	static vec4_t q[MAXSTUDIOBONES];
-	float bonematrix[3][4];
+	return StudioPoseEstimateFrame(StudioPoseContext(this), pseqdesc);
+}
 
-	static float pos2[MAXSTUDIOBONES][3];
-	static vec4_t q2[MAXSTUDIOBONES];
-	static float pos3[MAXSTUDIOBONES][3];
-	static vec4_t q3[MAXSTUDIOBONES];
-	static float pos4[MAXSTUDIOBONES][3];
-	static vec4_t q4[MAXSTUDIOBONES];
+/*
+====================
+StudioPoseGetAnim
 
-	if (m_pCurrentEntity->curstate.sequence >= m_pStudioHeader->numseq || m_pCurrentEntity->curstate.sequence < 0)
+====================
+*/
+static mstudioanim_t* StudioPoseGetAnim(const cl_pose_context& ctx, mstudioseqdesc_t* pseqdesc)
+{
+	if (pseqdesc->seqgroup == 0)
 	{
-		m_pCurrentEntity->curstate.sequence = 0;
+		mstudioseqgroup_t* pseqgroup = (mstudioseqgroup_t*)((byte*)ctx.header + ctx.header->seqgroupindex);
+		return (mstudioanim_t*)((byte*)ctx.header + pseqgroup->data + pseqdesc->animindex);
 	}
 
-	pseqdesc = (mstudioseqdesc_t*)((byte*)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pCurrentEntity->curstate.sequence;
+	// the pre-pass leaves out entities that need this
+	return ctx.renderer->StudioGetAnim(ctx.model, pseqdesc);
+}
 
-	f = StudioEstimateFrame(pseqdesc);
+/*
+====================
+StudioPoseBlendsPrevious
 
-	if (m_pCurrentEntity->latched.prevframe > f)
-	{
-		// Con_DPrintf("%f %f\n", m_pCurrentEntity->prevframe, f );
-	}
+Tells if the pose still blends from the previous sequence
+====================
+*/
+static bool StudioPoseBlendsPrevious(const cl_pose_context& ctx)
+{
+	return (ctx.dointerp != 0) &&
+		   (ctx.entity->latched.sequencetime != 0.0f) &&
+		   (ctx.entity->latched.sequencetime + 0.01f > ctx.cltime) &&
+		   (ctx.entity->latched.prevsequence < ctx.header->numseq);
+}
 
-	panim = StudioGetAnim(m_pRenderModel, pseqdesc);
-	StudioCalcRotations(pos, q, pseqdesc, panim, f);
+/*
+====================
+StudioPoseBlend
+
+Computes the local pose of the entity's sequence with its blends and the
+blend from the previous sequence. Doesn't touch the entity, blendedprev
+tells the caller whether latched.prevframe needs to be updated.
+====================
+*/
+static double StudioPoseBlend(const cl_pose_context& ctx, float pos[][3], vec4_t* q, cl_pose_scratch& scratch, bool& blendedprev)
+{
+	double f;
+
+	mstudioseqdesc_t* pseqdesc;
+	mstudioanim_t* panim;
+
+	pseqdesc = (mstudioseqdesc_t*)((byte*)ctx.header + ctx.header->seqindex) + ctx.entity->curstate.sequence;
+
+	f = StudioPoseEstimateFrame(ctx, pseqdesc);
+
+	panim = StudioPoseGetAnim(ctx, pseqdesc);
+	StudioPoseCalcRotations(ctx, pos, q, pseqdesc, panim, f);
 
 	if (pseqdesc->numblends > 1)
 	{
 		float s;
 		float dadt;
 
-		panim += m_pStudioHeader->numbones;
-		StudioCalcRotations(pos2, q2, pseqdesc, panim, f);
+		panim += ctx.header->numbones;
+		StudioPoseCalcRotations(ctx, scratch.pos2, scratch.q2, pseqdesc, panim, f);
 
-		dadt = StudioEstimateInterpolant();
-		s = (m_pCurrentEntity->curstate.blending[0] * dadt + m_pCurrentEntity->latched.prevblending[0] * (1.0 - dadt)) / 255.0;
+		dadt = StudioPoseEstimateInterpolant(ctx);
+		s = (ctx.entity->curstate.blending[0] * dadt + ctx.entity->latched.prevblending[0] * (1.0 - dadt)) / 255.0;
 
-		StudioSlerpBones(q, pos, q2, pos2, s);
+		StudioPoseSlerpBones(ctx, q, pos, scratch.q2, scratch.pos2, s);
 
 		if (pseqdesc->numblends == 4)
 		{
-			panim += m_pStudioHeader->numbones;
-			StudioCalcRotations(pos3, q3, pseqdesc, panim, f);
+			panim += ctx.header->numbones;
+			StudioPoseCalcRotations(ctx, scratch.pos3, scratch.q3, pseqdesc, panim, f);
 
-			panim += m_pStudioHeader->numbones;
-			StudioCalcRotations(pos4, q4, pseqdesc, panim, f);
+			panim += ctx.header->numbones;
+			StudioPoseCalcRotations(ctx, scratch.pos4, scratch.q4, pseqdesc, panim, f);
 
-			s = (m_pCurrentEntity->curstate.blending[0] * dadt + m_pCurrentEntity->latched.prevblending[0] * (1.0 - dadt)) / 255.0;
-			StudioSlerpBones(q3, pos3, q4, pos4, s);
+			s = (ctx.entity->curstate.blending[0] * dadt + ctx.entity->latched.prevblending[0] * (1.0 - dadt)) / 255.0;
+			StudioPoseSlerpBones(ctx, scratch.q3, scratch.pos3, scratch.q4, scratch.pos4, s);
 
-			s = (m_pCurrentEntity->curstate.blending[1] * dadt + m_pCurrentEntity->latched.prevblending[1] * (1.0 - dadt)) / 255.0;
-			StudioSlerpBones(q, pos, q3, pos3, s);
+			s = (ctx.entity->curstate.blending[1] * dadt + ctx.entity->latched.prevblending[1] * (1.0 - dadt)) / 255.0;
+			StudioPoseSlerpBones(ctx, q, pos, scratch.q3, scratch.pos3, s);
 		}
 	}
 
-	if ((m_fDoInterp != 0) &&
-		(m_pCurrentEntity->latched.sequencetime != 0.0f) &&
-		(m_pCurrentEntity->latched.sequencetime + 0.01f > m_clTime) &&
-		(m_pCurrentEntity->latched.prevsequence < m_pStudioHeader->numseq))
+	blendedprev = StudioPoseBlendsPrevious(ctx);
+
+	if (blendedprev)
 	{
 		// blend from last sequence
-		static float pos1b[MAXSTUDIOBONES][3];
-		static vec4_t q1b[MAXSTUDIOBONES];
 		float s;
 
-		pseqdesc = (mstudioseqdesc_t*)((byte*)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pCurrentEntity->latched.prevsequence;
-		panim = StudioGetAnim(m_pRenderModel, pseqdesc);
+		pseqdesc = (mstudioseqdesc_t*)((byte*)ctx.header + ctx.header->seqindex) + ctx.entity->latched.prevsequence;
+		panim = StudioPoseGetAnim(ctx, pseqdesc);
 		// clip prevframe
-		StudioCalcRotations(pos1b, q1b, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
+		StudioPoseCalcRotations(ctx, scratch.pos1b, scratch.q1b, pseqdesc, panim, ctx.entity->latched.prevframe);
 
 		if (pseqdesc->numblends > 1)
 		{
-			panim += m_pStudioHeader->numbones;
-			StudioCalcRotations(pos2, q2, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
+			panim += ctx.header->numbones;
+			StudioPoseCalcRotations(ctx, scratch.pos2, scratch.q2, pseqdesc, panim, ctx.entity->latched.prevframe);
 
-			s = (m_pCurrentEntity->latched.prevseqblending[0]) / 255.0;
-			StudioSlerpBones(q1b, pos1b, q2, pos2, s);
+			s = (ctx.entity->latched.prevseqblending[0]) / 255.0;
+			StudioPoseSlerpBones(ctx, scratch.q1b, scratch.pos1b, scratch.q2, scratch.pos2, s);
 
 			if (pseqdesc->numblends == 4)
 			{
-				panim += m_pStudioHeader->numbones;
-				StudioCalcRotations(pos3, q3, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
+				panim += ctx.header->numbones;
+				StudioPoseCalcRotations(ctx, scratch.pos3, scratch.q3, pseqdesc, panim, ctx.entity->latched.prevframe);
 
-				panim += m_pStudioHeader->numbones;
-				StudioCalcRotations(pos4, q4, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
+				panim += ctx.header->numbones;
+				StudioPoseCalcRotations(ctx, scratch.pos4, scratch.q4, pseqdesc, panim, ctx.entity->latched.prevframe);
 
-				s = (m_pCurrentEntity->latched.prevseqblending[0]) / 255.0;
-				StudioSlerpBones(q3, pos3, q4, pos4, s);
+				s = (ctx.entity->latched.prevseqblending[0]) / 255.0;
+				StudioPoseSlerpBones(ctx, scratch.q3, scratch.pos3, scratch.q4, scratch.pos4, s);
 
-				s = (m_pCurrentEntity->latched.prevseqblending[1]) / 255.0;
-				StudioSlerpBones(q1b, pos1b, q3, pos3, s);
+				s = (ctx.entity->latched.prevseqblending[1]) / 255.0;
+				StudioPoseSlerpBones(ctx, scratch.q1b, scratch.pos1b, scratch.q3, scratch.pos3, s);
 			}
 		}
 
-		s = 1.0 - (m_clTime - m_pCurrentEntity->latched.sequencetime) / 0.01f;
-		StudioSlerpBones(q, pos, q1b, pos1b, s);
+		s = 1.0 - (ctx.cltime - ctx.entity->latched.sequencetime) / 0.01f;
+		StudioPoseSlerpBones(ctx, q, pos, scratch.q1b, scratch.pos1b, s);
+	}
+
+	return f;
+}
+
+/*
+====================
+StudioPoseInputs
+
+====================
+*/
+static void StudioPoseInputs(const cl_pose_context& ctx, cl_pose_inputs& inputs)
+{
+	cl_entity_t* pEntity = ctx.entity;
+
+	memset(&inputs, 0, sizeof(inputs));
+	inputs.model = ctx.model;
+	inputs.cltime = ctx.cltime;
+	inputs.dointerp = ctx.dointerp;
+	inputs.sequence = pEntity->curstate.sequence;
+	inputs.frame = pEntity->curstate.frame;
+	inputs.animtime = pEntity->curstate.animtime;
+	inputs.framerate = pEntity->curstate.framerate;
+	inputs.prevanimtime = pEntity->latched.prevanimtime;
+	memcpy(inputs.controller, pEntity->curstate.controller, sizeof(inputs.controller));
+	memcpy(inputs.prevcontroller, pEntity->latched.prevcontroller, sizeof(inputs.prevcontroller));
+	memcpy(inputs.blending, pEntity->curstate.blending, sizeof(inputs.blending));
+	memcpy(inputs.prevblending, pEntity->latched.prevblending, sizeof(inputs.prevblending));
+	inputs.mouthopen = pEntity->mouth.mouthopen;
+
+	inputs.sequencetime = pEntity->latched.sequencetime;
+	inputs.prevsequence = pEntity->latched.prevsequence;
+
+	// only read while blending from the previous sequence
+	if (StudioPoseBlendsPrevious(ctx))
+	{
+		inputs.prevframe = pEntity->latched.prevframe;
+		memcpy(inputs.prevseqblending, pEntity->latched.prevseqblending, sizeof(inputs.prevseqblending));
+	}
+}
+
+/*
+====================
+StudioFindEntityPose
+
+Returns the pose the pre-pass computed for the entity, if it is still valid
+====================
+*/
+static cl_entity_pose* StudioFindEntityPose(const cl_pose_context& ctx)
+{
+	int index = ctx.entity->index;
+
+	if (index < 0 || index >= (int)EntityPoseSlots.size() || EntityPoseSlots[index] == -1)
+		return nullptr;
+
+	cl_entity_pose* ppose = &EntityPoses[EntityPoseSlots[index]];
+
+	if (ppose->ctx.entity != ctx.entity || ppose->ctx.header != ctx.header)
+		return nullptr;
+
+	cl_pose_inputs inputs;
+	StudioPoseInputs(ctx, inputs);
+
+	if (memcmp(&inputs, &ppose->inputs, sizeof(inputs)) != 0)
+		return nullptr;
+
+	return ppose;
+}
+
+/*
+====================
+StudioBonePrepassJob
+
+====================
+*/
+static void StudioBonePrepassJob(int iJob, void* pData)
+{
+	cl_entity_pose& pose = EntityPoses[iJob];
+	cl_pose_scratch scratch;
+
+	pose.frame = StudioPoseBlend(pose.ctx, pose.pos, pose.q, scratch, pose.blendedprev);
+}
+
+/*
+====================
+StudioBonePrepass
+
+Computes the local bone poses of the studio entities in view on the job
+pool before the first model of the frame is drawn, StudioSetupBones then
+only concatenates the matrices. Entities whose bones depend on the state of
+the draw call are left to it: players, bone merged attachments, the view
+model and sequences in demand-loaded groups.
+====================
+*/
+void CStudioModelRenderer::StudioBonePrepass()
+{
+	PERF_SCOPE("studio bone setup");
+
+	EntityPoseFrame = m_nFrameCount;
+
+	for (int i = 0; i < EntityPoseCount; i++)
+		EntityPoseSlots[EntityPoses[i].ctx.entity->index] = -1;
+
+	EntityPoseCount = 0;
+
+	if (m_pCvarBonePrepass->value <= 0)
+		return;
+
+	cl_entity_t* pViewModel = gEngfuncs.GetViewModel();
+	int iMaxClients = gEngfuncs.GetMaxClients();
+
+	for (int i = 0; i < gBSPRenderer.m_iNumRenderEntities; i++)
+	{
+		cl_entity_t* pEntity = gBSPRenderer.m_pRenderEntities[i];
+
+		if (pEntity->model == nullptr || pEntity->model->type != mod_studio)
+			continue;
+
+		if (pEntity == pViewModel || pEntity->player != 0 || (pEntity->index >= 1 && pEntity->index <= iMaxClients))
+			continue;
+
+		if (pEntity->curstate.renderfx == kRenderFxDeadPlayer || pEntity->curstate.movetype == MOVETYPE_FOLLOW)
+			continue;
+
+		if ((IsEntityTransparent(pEntity) != 0) && pEntity->curstate.renderamt == 0)
+			continue;
+
+		studiohdr_t* pHeader = (studiohdr_t*)IEngineStudio.Mod_Extradata(pEntity->model);
+
+		if (pHeader == nullptr || pHeader->numbodyparts == 0 || pHeader->numbones > MAXSTUDIOBONES)
+			continue;
+
+		if (pEntity->curstate.sequence < 0 || pEntity->curstate.sequence >= pHeader->numseq)
+			continue;
+
+		mstudioseqdesc_t* pseqdesc = (mstudioseqdesc_t*)((byte*)pHeader + pHeader->seqindex);
+
+		if (pseqdesc[pEntity->curstate.sequence].seqgroup != 0)
+			continue;
+
+		if (pEntity->latched.prevsequence >= 0 && pEntity->latched.prevsequence < pHeader->numseq && pseqdesc[pEntity->latched.prevsequence].seqgroup != 0)
+			continue;
+
+		// bone controllers can stretch the bounds, leave those to the draw call's own check
+		if (pHeader->numbonecontrollers == 0)
+		{
+			mstudioseqdesc_t* pcurseq = &pseqdesc[pEntity->curstate.sequence];
+			float flRadius = V_max(Vector(pcurseq->bbmin).Length(), Vector(pcurseq->bbmax).Length());
+			Vector vRadius(flRadius, flRadius, flRadius);
+
+			if (gHUD.viewFrustum.CullBox(pEntity->origin - vRadius, pEntity->origin + vRadius))
+				continue;
+		}
+
+		if (EntityPoseCount == (int)EntityPoses.size())
+			EntityPoses.emplace_back();
+
+		if (pEntity->index >= (int)EntityPoseSlots.size())
+			EntityPoseSlots.resize(pEntity->index + 1, -1);
+
+		cl_entity_pose& pose = EntityPoses[EntityPoseCount];
+		pose.ctx = StudioPoseContext(this);
+		pose.ctx.entity = pEntity;
+		pose.ctx.model = pEntity->model;
+		pose.ctx.header = pHeader;
+		pose.ctx.renderer = nullptr;
+		pose.ctx.dointerp = 1;
+		StudioPoseInputs(pose.ctx, pose.inputs);
+
+		EntityPoseSlots[pEntity->index] = EntityPoseCount++;
+	}
+
+	gJobPool.Run(EntityPoseCount, StudioBonePrepassJob, nullptr);
+}
+
+/*
+====================
+StudioSetupBones
+
+====================
+*/
+void CStudioModelRenderer::StudioSetupBones()
+{
+	int i;
+	double f;
+	bool blendedprev;
+
+	mstudiobone_t* pbones;
+	mstudioseqdesc_t* pseqdesc;
+	mstudioanim_t* panim;
+
+	static float pos[MAXSTUDIOBONES][3];
+	static vec4_t q[MAXSTUDIOBONES];
+	float bonematrix[3][4];
+
+	static cl_pose_scratch scratch;
+
+	if (m_pCurrentEntity->curstate.sequence >= m_pStudioHeader->numseq || m_pCurrentEntity->curstate.sequence < 0)
+	{
+		m_pCurrentEntity->curstate.sequence = 0;
+	}
+
+	cl_pose_context ctx = StudioPoseContext(this);
+	cl_entity_pose* ppose = StudioFindEntityPose(ctx);
+
+	if (ppose != nullptr)
+	{
+		memcpy(pos, ppose->pos, sizeof(pos[0]) * m_pStudioHeader->numbones);
+		memcpy(q, ppose->q, sizeof(q[0]) * m_pStudioHeader->numbones);
+		f = ppose->frame;
+		blendedprev = ppose->blendedprev;
 	}
 	else
+	{
+		f = StudioPoseBlend(ctx, pos, q, scratch, blendedprev);
+	}
+
+	if (!blendedprev)
 	{
 		// Con_DPrintf("prevframe = %4.2f\n", f);
 		m_pCurrentEntity->latched.prevframe = f;
@@ -2773,18 +3638,17 @@ void CStudioModelRenderer::StudioSetupBones()
 		pseqdesc = (mstudioseqdesc_t*)((byte*)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pPlayerInfo->gaitsequence;
 
 		panim = StudioGetAnim(m_pRenderModel, pseqdesc);
-		StudioCalcRotations(pos2, q2, pseqdesc, panim, m_pPlayerInfo->gaitframe);
+		StudioCalcRotations(scratch.pos2, scratch.q2, pseqdesc, panim, m_pPlayerInfo->gaitframe);
 
 		for (i = 0; i < m_pStudioHeader->numbones; i++)
 		{
 			if (strcmp(pbones[i].name, "Bip01 Spine") == 0)
 				break;
-			memcpy(pos[i], pos2[i], sizeof(pos[i]));
-			memcpy(q[i], q2[i], sizeof(q[i]));
+			memcpy(pos[i], scratch.pos2[i], sizeof(pos[i]));
+			memcpy(q[i], scratch.q2[i], sizeof(q[i]));
 		}
 	}
 
-
 	for (i = 0; i < m_pStudioHeader->numbones; i++)
 	{
 		QuaternionMatrix(q[i], bonematrix);
@@ -2919,6 +3783,10 @@ int CStudioModelRenderer::StudioDrawModel(int flags)
 	IEngineStudio.GetTimes(&m_nFrameCount, &m_clTime, &m_clOldTime);
 	IEngineStudio.GetViewInfo(m_vRenderOrigin, m_vUp, m_vRight, m_vNormal);
 
+	// first model this frame, pose everything in view at once
+	if (m_nFrameCount != EntityPoseFrame)
+		StudioBonePrepass();
+
 	if (m_pCurrentEntity->curstate.renderfx == kRenderFxDeadPlayer)
 	{
 		entity_state_t deadplayer;
@@ -6685,6 +7553,7 @@ void CStudioModelRenderer::StudioSetupModelSVD(int bodypart)
 	index = index % pbodypart->numsubmodels;
 
 	m_pSVDSubModel = (svdsubmodel_t*)((byte*)m_pSVDHeader + pbodypart->submodelindex) + index;
+	m_iSVDBodyPart = bodypart;
 }
 
 /*
@@ -6706,6 +7575,20 @@ void CStudioModelRenderer::StudioDrawShadow()
 	glEnable(GL_STENCIL_TEST);
 	glStencilFunc(GL_ALWAYS, 0, ~0);
 
+	// Drop volumes of entities that stopped casting shadows
+	if (gBSPRenderer.m_iFrameCount - ShadowVolumeCacheSweep > SHADOWVOLUME_CACHE_FRAMES || gBSPRenderer.m_iFrameCount < ShadowVolumeCacheSweep)
+	{
+		for (auto it = ShadowVolumeCache.begin(); it != ShadowVolumeCache.end();)
+		{
+			if (gBSPRenderer.m_iFrameCount - it->second.lastframe > SHADOWVOLUME_CACHE_FRAMES || gBSPRenderer.m_iFrameCount < it->second.lastframe)
+				it = ShadowVolumeCache.erase(it);
+			else
+				++it;
+		}
+
+		ShadowVolumeCacheSweep = gBSPRenderer.m_iFrameCount;
+	}
+
 	for (int i = 0; i < m_pStudioHeader->numbodyparts; i++)
 	{
 		StudioSetupModelSVD(i);
@@ -6729,9 +7612,8 @@ StudioDrawShadowVolume
 */
 void CStudioModelRenderer::StudioDrawShadowVolume()
 {
-	float plane[4];
 	Vector lightdir;
-	Vector *pv1, *pv2, *pv3;
+	int numIndexes = -1;
 
 	if (m_pSVDSubModel->numfaces == 0)
 		return;
@@ -6741,25 +7623,11 @@ void CStudioModelRenderer::StudioDrawShadowVolume()
 	Vector shadeVector;
 
 	// search for closest elight
-	mlight_t closest_elight;
-	for (int i = 0; i < MAXRENDERENTS; i++)
-	{
-		auto light = gBSPRenderer.m_pModelLights[i];
-		if (light.radius != 0.0f && !light.flashlight)
-		{
-			// start
-			if (closest_elight.radius == 0.0f)
-				closest_elight = light;
+	const mlight_t* closest_elight = gBSPRenderer.FindShadowLight(m_pCurrentEntity->curstate.origin, 500.0f);
 
-			// is this more closer to the entity?
-			if (Vector(light.origin - m_pCurrentEntity->curstate.origin).Length() < Vector(closest_elight.origin - m_pCurrentEntity->curstate.origin).Length())
-				closest_elight = light;
-		}
-	}
-
-	if (Vector(closest_elight.origin - m_pCurrentEntity->curstate.origin).Length() < 500.0f)
+	if (closest_elight)
 	{
-		m_vShadowLightOrigin = closest_elight.origin;
+		m_vShadowLightOrigin = closest_elight->origin;
 	}
 	else if (m_pCvarSkyVecX->value != 0 || m_pCvarSkyVecY->value != 0 || m_pCvarSkyVecZ->value != 0)
 	{
@@ -6780,37 +7648,62 @@ void CStudioModelRenderer::StudioDrawShadowVolume()
 		m_vShadowLightOrigin = m_pCurrentEntity->origin + shadeVector * 8196;
 	}
 
-	// Calculate vertex coords
-	for (int i = 0, j = 0; i < m_pSVDSubModel->numverts; i++, j += 2)
-	{
-		VectorTransform(psvdverts[i], (*m_pbonetransform)[pvertbone[i]], m_vertexTransform[j]);
+	// Reuse last frame's volume if neither the bones nor the light moved
+	cl_shadow_volume* pcache = nullptr;
+	int numbonefloats = m_pStudioHeader->numbones * 12;
 
-		VectorSubtract(m_vertexTransform[j], m_vShadowLightOrigin, lightdir);
-		VectorNormalizeFast(lightdir);
+	if (m_pCurrentEntity->index > 0)
+	{
+		pcache = &ShadowVolumeCache[m_pCurrentEntity->index * MAXSTUDIOBODYPARTS + m_iSVDBodyPart];
 
-		VectorMA(m_vertexTransform[j], 4096, lightdir, m_vertexTransform[j + 1]);
+		if (pcache->header == m_pSVDHeader && pcache->submodel == m_pSVDSubModel && pcache->lightorigin == m_vShadowLightOrigin && pcache->bones.size() == numbonefloats && !memcmp(pcache->bones.data(), (*m_pbonetransform), numbonefloats * sizeof(float)))
+		{
+			pcache->lastframe = gBSPRenderer.m_iFrameCount;
+			memcpy(m_vertexTransform, pcache->verts.data(), pcache->verts.size() * sizeof(Vector));
+			memcpy(m_shadowVolumeIndexes, pcache->indexes.data(), pcache->indexes.size() * sizeof(GLushort));
+			numIndexes = pcache->indexes.size();
+		}
+		else
+		{
+			pcache->header = m_pSVDHeader;
+			pcache->submodel = m_pSVDSubModel;
+			pcache->lightorigin = m_vShadowLightOrigin;
+			pcache->lastframe = gBSPRenderer.m_iFrameCount;
+			pcache->bones.assign((float*)(*m_pbonetransform), (float*)(*m_pbonetransform) + numbonefloats);
+			pcache->verts.clear();
+			pcache->indexes.clear();
+			numIndexes = -1;
+		}
 	}
 
-	// Process the faces
-	int numIndexes = 0;
-	svdface_t* pfaces = (svdface_t*)((byte*)m_pSVDHeader + m_pSVDSubModel->faceindex);
-
-	for (int i = 0; i < m_pSVDSubModel->numfaces; i++)
+	if (numIndexes == -1)
 	{
-		pv1 = &m_vertexTransform[pfaces[i].vertex0];
-		pv2 = &m_vertexTransform[pfaces[i].vertex1];
-		pv3 = &m_vertexTransform[pfaces[i].vertex2];
+		// Calculate vertex coords
+		for (int i = 0, j = 0; i < m_pSVDSubModel->numverts; i++, j += 2)
+		{
+			VectorTransform(psvdverts[i], (*m_pbonetransform)[pvertbone[i]], m_vertexTransform[j]);
 
-		plane[0] = pv1->y * (pv2->z - pv3->z) + pv2->y * (pv3->z - pv1->z) + pv3->y * (pv1->z - pv2->z);
-		plane[1] = pv1->z * (pv2->x - pv3->x) + pv2->z * (pv3->x - pv1->x) + pv3->z * (pv1->x - pv2->x);
-		plane[2] = pv1->x * (pv2->y - pv3->y) + pv2->x * (pv3->y - pv1->y) + pv3->x * (pv1->y - pv2->y);
-		plane[3] = -(pv1->x * (pv2->y * pv3->z - pv3->y * pv2->z) + pv2->x * (pv3->y * pv1->z - pv1->y * pv3->z) + pv3->x * (pv1->y * pv2->z - pv2->y * pv1->z));
+			VectorSubtract(m_vertexTransform[j], m_vShadowLightOrigin, lightdir);
+			VectorNormalizeFast(lightdir);
 
-		m_trianglesFacingLight[i] = (DotProduct(plane, m_vShadowLightOrigin) + plane[3]) > 0;
+			VectorMA(m_vertexTransform[j], 4096, lightdir, m_vertexTransform[j + 1]);
+		}
+
+		// Process the faces
+		svdface_t* pfaces = (svdface_t*)((byte*)m_pSVDHeader + m_pSVDSubModel->faceindex);
+
+		if (ShadowHasSSE2())
+			ShadowFacesFacingLightSSE2(m_vertexTransform, pfaces, m_pSVDSubModel->numfaces, m_vShadowLightOrigin, m_trianglesFacingLight);
+		else
+			ShadowFacesFacingLight(m_vertexTransform, pfaces, 0, m_pSVDSubModel->numfaces, m_vShadowLightOrigin, m_trianglesFacingLight);
 
-		// comment this 'if' block if you want to use z-pass method
-		if (m_trianglesFacingLight[i])
+		// Light facing caps, comment this loop if you want to use z-pass method
+		numIndexes = 0;
+		for (int i = 0; i < m_pSVDSubModel->numfaces; i++)
 		{
+			if (!m_trianglesFacingLight[i])
+				continue;
+
 			m_shadowVolumeIndexes[numIndexes] = pfaces[i].vertex0;
 			m_shadowVolumeIndexes[numIndexes + 1] = pfaces[i].vertex2;
 			m_shadowVolumeIndexes[numIndexes + 2] = pfaces[i].vertex1;
@@ -6821,34 +7714,31 @@ void CStudioModelRenderer::StudioDrawShadowVolume()
 
 			numIndexes += 6;
 		}
-	}
 
-	// Process the edges
-	svdedge_t* pedges = (svdedge_t*)((byte*)m_pSVDHeader + m_pSVDSubModel->edgeindex);
-	for (int i = 0; i < m_pSVDSubModel->numedges; i++)
-	{
-		if (m_trianglesFacingLight[pedges[i].face0])
+		// Process the edges, only silhouette edges have one face lit and the other not
+		svdedge_t* pedges = (svdedge_t*)((byte*)m_pSVDHeader + m_pSVDSubModel->edgeindex);
+		for (int i = 0; i < m_pSVDSubModel->numedges; i++)
 		{
-			if ((pedges[i].face1 != -1) && m_trianglesFacingLight[pedges[i].face1])
-				continue;
+			bool facing0 = m_trianglesFacingLight[pedges[i].face0];
+			bool facing1 = (pedges[i].face1 != -1) && m_trianglesFacingLight[pedges[i].face1];
 
-			m_shadowVolumeIndexes[numIndexes] = pedges[i].vertex0;
-			m_shadowVolumeIndexes[numIndexes + 1] = pedges[i].vertex1;
-		}
-		else
-		{
-			if ((pedges[i].face1 == -1) || !m_trianglesFacingLight[pedges[i].face1])
+			if (facing0 == facing1)
 				continue;
 
-			m_shadowVolumeIndexes[numIndexes] = pedges[i].vertex1;
-			m_shadowVolumeIndexes[numIndexes + 1] = pedges[i].vertex0;
+			m_shadowVolumeIndexes[numIndexes] = facing0 ? pedges[i].vertex0 : pedges[i].vertex1;
+			m_shadowVolumeIndexes[numIndexes + 1] = facing0 ? pedges[i].vertex1 : pedges[i].vertex0;
+			m_shadowVolumeIndexes[numIndexes + 2] = m_shadowVolumeIndexes[numIndexes] + 1;
+			m_shadowVolumeIndexes[numIndexes + 3] = m_shadowVolumeIndexes[numIndexes + 2];
+			m_shadowVolumeIndexes[numIndexes + 4] = m_shadowVolumeIndexes[numIndexes + 1];
+			m_shadowVolumeIndexes[numIndexes + 5] = m_shadowVolumeIndexes[numIndexes + 1] + 1;
+			numIndexes += 6;
 		}
 
-		m_shadowVolumeIndexes[numIndexes + 2] = m_shadowVolumeIndexes[numIndexes] + 1;
-		m_shadowVolumeIndexes[numIndexes + 3] = m_shadowVolumeIndexes[numIndexes + 2];
-		m_shadowVolumeIndexes[numIndexes + 4] = m_shadowVolumeIndexes[numIndexes + 1];
-		m_shadowVolumeIndexes[numIndexes + 5] = m_shadowVolumeIndexes[numIndexes + 1] + 1;
-		numIndexes += 6;
+		if (pcache)
+		{
+			pcache->verts.assign(m_vertexTransform, m_vertexTransform + m_pSVDSubModel->numverts * 2);
+			pcache->indexes.assign(m_shadowVolumeIndexes, m_shadowVolumeIndexes + numIndexes);
+		}
 	}
 
 	// draw back faces incrementing stencil values when z fails
@@ -353,6 +353,19 @@ public:
 	// Render distance
 	cvar_t* m_pCvarRenderDistance;
 
+	// Decoded animation cache and its size limit
+	cvar_t* m_pCvarAnimCache;
+	cvar_t* m_pCvarAnimCacheSize;
+
+	// Compute bone poses for the frame on the job pool?
+	cvar_t* m_pCvarBonePrepass;
+
+	// Poses the studio entities in view ahead of their draw calls
+	void StudioBonePrepass();
+
+	// Poses every sequence of a model with and without the animation cache
+	void StudioAnimCacheBenchmark(const char* modelname, int count);
+
 
 	// Array of transformed vertexes
 	Vector m_vertexTransform[MAXSTUDIOVERTS * 2];
@@ -365,6 +378,8 @@ private:
 	svdheader_t* m_pSVDHeader;
 	// Pointer to shadow volume submodel data
 	svdsubmodel_t* m_pSVDSubModel;
+	// Body part the shadow volume submodel belongs to
+	int m_iSVDBodyPart;
 
 	// Tells if a face is facing the light
 	bool m_trianglesFacingLight[MAXSTUDIOTRIANGLES];
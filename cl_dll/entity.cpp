@@ -21,6 +21,7 @@
 #include "studio.h"
 #include "StudioModelRenderer.h"
 #include "GameStudioModelRenderer.h"
+#include "perf_trace.h"
 
 extern CGameStudioModelRenderer g_StudioRenderer;
 int g_iFlashLight = 0;
@@ -489,7 +490,10 @@ void DLLEXPORT HUD_TempEntUpdate(
 	if (frametime > 0)
 	{
 		// Update particles
-		gParticleEngine.Update();
+		{
+			PERF_SCOPE("particle update");
+			gParticleEngine.Update();
+		}
 
 		// Decay lights here
 		gBSPRenderer.DecayLights();
@@ -0,0 +1,232 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: The world's entity lump, parsed once per map into key/value
+//			pairs and indexed by classname and targetname
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include <algorithm>
+
+#include "hud.h"
+#include "cl_util.h"
+#include "com_model.h"
+#include "entity_lump.h"
+
+CEntityLump gEntityLump;
+
+CEntityLump::CEntityLump()
+{
+	m_pWorld = nullptr;
+	m_pSource = nullptr;
+	m_bValid = false;
+}
+
+void CEntityLump::Clear()
+{
+	m_pWorld = nullptr;
+	m_pSource = nullptr;
+	m_MapName.clear();
+	m_bValid = false;
+
+	m_Strings.clear();
+	m_Pairs.clear();
+	m_Entities.clear();
+	m_Classnames.clear();
+	m_Targetnames.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Update: the engine keeps the entity string of the world for the whole map,
+// so it only has to be parsed again when the world model or the map changed.
+// A reload of the same map can reuse the addresses, the renderer clears the
+// lump on every map load for that.
+//-----------------------------------------------------------------------------
+bool CEntityLump::Update(struct model_s* pWorld)
+{
+	if (pWorld == nullptr || pWorld->entities == nullptr)
+	{
+		Clear();
+		return false;
+	}
+
+	const char* pData = pWorld->entities;
+
+	if (pWorld == m_pWorld && pData == m_pSource && m_MapName == pWorld->name)
+		return m_bValid;
+
+	Clear();
+	m_pWorld = pWorld;
+	m_pSource = pData;
+	m_MapName = pWorld->name;
+	m_bValid = Parse(pData);
+
+	return m_bValid;
+}
+
+static const char* SkipWhitespace(const char* data)
+{
+	while (true)
+	{
+		while ('\0' != *data && *data <= ' ')
+			data++;
+
+		// skip // comments like COM_Parse
+		if (data[0] == '/' && data[1] == '/')
+		{
+			while ('\0' != *data && *data != '\n')
+				data++;
+			continue;
+		}
+
+		return data;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// ReadToken: copies the quoted or bare token at data into the string pool and
+// returns its offset
+//-----------------------------------------------------------------------------
+int CEntityLump::ReadToken(const char*& data)
+{
+	const int offset = (int)m_Strings.size();
+
+	if (*data == '\"')
+	{
+		data++;
+		while ('\0' != *data && *data != '\"')
+			m_Strings.push_back(*data++);
+
+		if (*data == '\"')
+			data++;
+	}
+	else
+	{
+		while (*data > ' ' && *data != '{' && *data != '}' && *data != '\"')
+			m_Strings.push_back(*data++);
+	}
+
+	m_Strings.push_back('\0');
+	return offset;
+}
+
+bool CEntityLump::Parse(const char* data)
+{
+	while (true)
+	{
+		data = SkipWhitespace(data);
+
+		if ('\0' == *data)
+			break;
+
+		if (*data != '{')
+		{
+			gEngfuncs.Con_DPrintf("CEntityLump::Parse: expected {\n");
+			return false;
+		}
+
+		data++;
+
+		lumpentity_t entity;
+		entity.firstPair = (int)m_Pairs.size();
+
+		while (true)
+		{
+			data = SkipWhitespace(data);
+
+			if (*data == '}')
+			{
+				data++;
+				break; // finish parsing this entity
+			}
+
+			if ('\0' == *data)
+			{
+				gEngfuncs.Con_DPrintf("CEntityLump::Parse: EOF without closing brace\n");
+				return false;
+			}
+
+			lumppair_t pair;
+			pair.key = ReadToken(data);
+
+			// another hack to fix keynames with trailing spaces
+			int end = (int)m_Strings.size() - 1;
+			while (end > pair.key && m_Strings[end - 1] == ' ')
+				m_Strings[--end] = '\0';
+
+			data = SkipWhitespace(data);
+
+			if ('\0' == *data)
+			{
+				gEngfuncs.Con_DPrintf("CEntityLump::Parse: EOF without closing brace\n");
+				return false;
+			}
+
+			if (*data == '}')
+			{
+				gEngfuncs.Con_DPrintf("CEntityLump::Parse: closing brace without data\n");
+				return false;
+			}
+
+			pair.value = ReadToken(data);
+			m_Pairs.push_back(pair);
+		}
+
+		entity.numPairs = (int)m_Pairs.size() - entity.firstPair;
+		m_Entities.push_back(entity);
+	}
+
+	// entities are visited in order, so the index lists stay sorted
+	for (int i = 0; i < NumEntities(); i++)
+	{
+		const char* pValue = ValueForKey(i, "classname");
+		if (pValue != nullptr)
+			m_Classnames[pValue].push_back(i);
+
+		pValue = ValueForKey(i, "targetname");
+		if (pValue != nullptr)
+			m_Targetnames[pValue].push_back(i);
+	}
+
+	return true;
+}
+
+const char* CEntityLump::ValueForKey(int entity, const char* key) const
+{
+	const lumpentity_t& ent = m_Entities[entity];
+
+	for (int i = ent.numPairs - 1; i >= 0; i--)
+	{
+		const lumppair_t& pair = m_Pairs[ent.firstPair + i];
+
+		if (0 == strcmp(&m_Strings[pair.key], key))
+			return &m_Strings[pair.value];
+	}
+
+	return nullptr;
+}
+
+int CEntityLump::FindNext(const lumpindex_t& index, const char* name, int start)
+{
+	auto it = index.find(name);
+
+	if (it == index.end())
+		return -1;
+
+	auto next = std::upper_bound(it->second.begin(), it->second.end(), start);
+
+	if (next == it->second.end())
+		return -1;
+
+	return *next;
+}
+
+int CEntityLump::FindByClassname(const char* classname, int start) const
+{
+	return FindNext(m_Classnames, classname, start);
+}
+
+int CEntityLump::FindByTargetname(const char* targetname, int start) const
+{
+	return FindNext(m_Targetnames, targetname, start);
+}
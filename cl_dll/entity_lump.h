@@ -0,0 +1,76 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: The world's entity lump, parsed once per map into key/value
+//			pairs and indexed by classname and targetname
+//
+// $NoKeywords: $
+//=============================================================================
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct model_s;
+
+class CEntityLump
+{
+public:
+	CEntityLump();
+
+	// Parses the entity string of pWorld unless it's the map already held.
+	// Returns false if there is no entity data or it's corrupt.
+	bool Update(struct model_s* pWorld);
+
+	// Forgets the map, the next Update parses again. Called on map load.
+	void Clear();
+
+	int NumEntities() const { return (int)m_Entities.size(); }
+
+	// Last value given for key, like the engine, nullptr if there is none
+	const char* ValueForKey(int entity, const char* key) const;
+
+	// Pairs of an entity in the order they appear in the lump
+	int NumPairs(int entity) const { return m_Entities[entity].numPairs; }
+	const char* Key(int entity, int pair) const { return &m_Strings[m_Pairs[m_Entities[entity].firstPair + pair].key]; }
+	const char* Value(int entity, int pair) const { return &m_Strings[m_Pairs[m_Entities[entity].firstPair + pair].value]; }
+
+	// Next entity after start with this classname/targetname, -1 if there are no more
+	int FindByClassname(const char* classname, int start = -1) const;
+	int FindByTargetname(const char* targetname, int start = -1) const;
+
+private:
+	struct lumppair_t
+	{
+		int key; // offsets into m_Strings
+		int value;
+	};
+
+	struct lumpentity_t
+	{
+		int firstPair;
+		int numPairs;
+	};
+
+	typedef std::unordered_map<std::string, std::vector<int>> lumpindex_t;
+
+	bool Parse(const char* data);
+	int ReadToken(const char*& data);
+	static int FindNext(const lumpindex_t& index, const char* name, int start);
+
+	// map the lump was parsed from, only compared against
+	struct model_s* m_pWorld;
+	const char* m_pSource;
+	std::string m_MapName;
+	bool m_bValid;
+
+	std::vector<char> m_Strings;
+	std::vector<lumppair_t> m_Pairs;
+	std::vector<lumpentity_t> m_Entities;
+
+	lumpindex_t m_Classnames;
+	lumpindex_t m_Targetnames;
+};
+
+extern CEntityLump gEntityLump;
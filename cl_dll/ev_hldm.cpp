@@ -38,6 +38,7 @@
 #include "in_defs.h"
 
 #include <string.h>
+#include <unordered_map>
 
 #include "r_studioint.h"
 #include "com_model.h"
@@ -75,23 +76,86 @@ static inline bool EV_HLDM_IsBSPModel(physent_t* pe)
 	return pe != nullptr && (pe->solid == SOLID_BSP || pe->movetype == MOVETYPE_PUSHSTEP);
 }
 
+// material of the surface an impact trace hit. Resolved on first use and
+// shared by the strike sound and the decal, so an impact traces the
+// texture under it once
+struct impactsurface_t
+{
+	bool bResolved;
+	const char* pTextureName; // as EV_TraceTexture returned it, nullptr if none
+	char chTextureType;
+};
+
+struct texturematerial_t
+{
+	char szName[16]; // to tell a reused name pointer from the one cached
+	char chTextureType;
+};
+
+#define MAX_TEXTURE_MATERIALS 4096
+
+// material types by the texture names EV_TraceTexture hands out, which
+// point into the loaded models and stay put for the map
+static std::unordered_map<const char*, texturematerial_t> g_TextureMaterials;
+
+static char EV_HLDM_TextureMaterial(const char* pTextureName)
+{
+	auto it = g_TextureMaterials.find(pTextureName);
+
+	if (it != g_TextureMaterials.end() && strncmp(it->second.szName, pTextureName, sizeof(it->second.szName)) == 0)
+		return it->second.chTextureType;
+
+	char szbuffer[64];
+	const char* pName = pTextureName;
+
+	// strip leading '-0' or '+0~' or '{' or '!'
+	if (*pName == '-' || *pName == '+')
+	{
+		pName += 2;
+	}
+
+	if (*pName == '{' || *pName == '!' || *pName == '~' || *pName == ' ')
+	{
+		pName++;
+	}
+
+	// '}}'
+	strncpy(szbuffer, pName, sizeof(szbuffer) - 1);
+	szbuffer[CBTEXTURENAMEMAX - 1] = 0;
+
+	if (g_TextureMaterials.size() >= MAX_TEXTURE_MATERIALS)
+		g_TextureMaterials.clear();
+
+	texturematerial_t& material = g_TextureMaterials[pTextureName];
+	strncpy(material.szName, pTextureName, sizeof(material.szName));
+	material.chTextureType = PM_FindTextureType(szbuffer);
+
+	return material.chTextureType;
+}
+
+static void EV_HLDM_ResolveSurface(pmtrace_t* ptr, float* vecSrc, float* vecEnd, impactsurface_t* pSurface)
+{
+	if (pSurface->bResolved)
+		return;
+
+	pSurface->bResolved = true;
+
+	// get texture from entity or world (world is ent(0))
+	pSurface->pTextureName = gEngfuncs.pEventAPI->EV_TraceTexture(ptr->ent, vecSrc, vecEnd);
+	pSurface->chTextureType = pSurface->pTextureName != nullptr ? EV_HLDM_TextureMaterial(pSurface->pTextureName) : 0;
+}
+
 // RENDERERS START
-char* EV_HLDM_HDDecal(pmtrace_t* ptr, physent_t* pe, float* vecSrc, float* vecEnd)
+static char* EV_HLDM_HDDecal(pmtrace_t* ptr, physent_t* pe, float* vecSrc, float* vecEnd, impactsurface_t* pSurface)
 {
 	if (gEngfuncs.PM_PointContents(ptr->endpos, nullptr) == CONTENT_SKY)
 		return nullptr;
 
 	// hit the world, try to play sound based on texture material type
 	char chTextureType = 0;
-	int entity;
-	char* pStart;
-	char* pTextureName;
-	char texname[64];
-	char szbuffer[64];
+	const char* pStart = nullptr;
 	static char decalname[32];
 
-	entity = gEngfuncs.pEventAPI->EV_IndexFromTrace(ptr);
-
 	if ((pe != nullptr) && pe->solid == SOLID_BSP)
 	{
 		// Nothing
@@ -102,33 +166,12 @@ char* EV_HLDM_HDDecal(pmtrace_t* ptr, physent_t* pe, float* vecSrc, float* vecEn
 		}
 		else
 		{
+			EV_HLDM_ResolveSurface(ptr, vecSrc, vecEnd, pSurface);
+			pStart = pSurface->pTextureName;
 
-			// get texture from entity or world (world is ent(0))
-			pTextureName = (char*)gEngfuncs.pEventAPI->EV_TraceTexture(ptr->ent, vecSrc, vecEnd);
-			pStart = pTextureName;
-
-			if ((pTextureName != nullptr) && (strcmp("black", pTextureName) != 0))
+			if ((pStart != nullptr) && (strcmp("black", pStart) != 0))
 			{
-				strcpy(texname, pTextureName);
-				pTextureName = texname;
-
-				// strip leading '-0' or '+0~' or '{' or '!'
-				if (*pTextureName == '-' || *pTextureName == '+')
-				{
-					pTextureName += 2;
-				}
-
-				if (*pTextureName == '{' || *pTextureName == '!' || *pTextureName == '~' || *pTextureName == ' ')
-				{
-					pTextureName++;
-				}
-
-				// '}}'
-				strcpy(szbuffer, pTextureName);
-				szbuffer[CBTEXTURENAMEMAX - 1] = 0;
-
-				// get texture type
-				chTextureType = PM_FindTextureType(szbuffer);
+				chTextureType = pSurface->chTextureType;
 			}
 			else
 			{
@@ -137,7 +180,7 @@ char* EV_HLDM_HDDecal(pmtrace_t* ptr, physent_t* pe, float* vecSrc, float* vecEn
 		}
 	}
 
-	if (pStart[0] == '{')
+	if (pStart != nullptr && pStart[0] == '{')
 		return nullptr;
 
 	cl_entity_t* pHit = gEngfuncs.GetEntityByIndex(gEngfuncs.pEventAPI->EV_IndexFromTrace(ptr));
@@ -261,7 +304,7 @@ char* EV_HLDM_HDDecal(pmtrace_t* ptr, physent_t* pe, float* vecSrc, float* vecEn
 // play a strike sound based on the texture that was hit by the attack traceline.  VecSrc/VecEnd are the
 // original traceline endpoints used by the attacker, iBulletType is the type of bullet that hit the texture.
 // returns volume of strike instrument (crowbar) to play
-float EV_HLDM_PlayTextureSound(int idx, pmtrace_t* ptr, float* vecSrc, float* vecEnd, int iBulletType)
+static float EV_HLDM_PlaySurfaceSound(int idx, pmtrace_t* ptr, float* vecSrc, float* vecEnd, impactsurface_t* pSurface, int iBulletType)
 {
 	// hit the world, try to play sound based on texture material type
 	char chTextureType = CHAR_TEX_CONCRETE;
@@ -272,9 +315,6 @@ float EV_HLDM_PlayTextureSound(int idx, pmtrace_t* ptr, float* vecSrc, float* ve
 	int cnt;
 	float fattn = ATTN_NORM;
 	int entity;
-	char* pTextureName;
-	char texname[64];
-	char szbuffer[64];
 
 	entity = gEngfuncs.pEventAPI->EV_IndexFromTrace(ptr);
 
@@ -286,32 +326,8 @@ float EV_HLDM_PlayTextureSound(int idx, pmtrace_t* ptr, float* vecSrc, float* ve
 	// Player
 	if (entity == 0)
 	{
-		// get texture from entity or world (world is ent(0))
-		pTextureName = (char*)gEngfuncs.pEventAPI->EV_TraceTexture(ptr->ent, vecSrc, vecEnd);
-
-		if (pTextureName != nullptr)
-		{
-			strcpy(texname, pTextureName);
-			pTextureName = texname;
-
-			// strip leading '-0' or '+0~' or '{' or '!'
-			if (*pTextureName == '-' || *pTextureName == '+')
-			{
-				pTextureName += 2;
-			}
-
-			if (*pTextureName == '{' || *pTextureName == '!' || *pTextureName == '~' || *pTextureName == ' ')
-			{
-				pTextureName++;
-			}
-
-			// '}}'
-			strcpy(szbuffer, pTextureName);
-			szbuffer[CBTEXTURENAMEMAX - 1] = 0;
-
-			// get texture type
-			chTextureType = PM_FindTextureType(szbuffer);
-		}
+		EV_HLDM_ResolveSurface(ptr, vecSrc, vecEnd, pSurface);
+		chTextureType = pSurface->chTextureType;
 	}
 	else
 	{
@@ -419,6 +435,13 @@ float EV_HLDM_PlayTextureSound(int idx, pmtrace_t* ptr, float* vecSrc, float* ve
 	return fvolbar;
 }
 
+float EV_HLDM_PlayTextureSound(int idx, pmtrace_t* ptr, float* vecSrc, float* vecEnd, int iBulletType)
+{
+	impactsurface_t surface = {};
+
+	return EV_HLDM_PlaySurfaceSound(idx, ptr, vecSrc, vecEnd, &surface, iBulletType);
+}
+
 char* EV_HLDM_DamageDecal(physent_t* pe)
 {
 	static char decalname[32];
@@ -493,7 +516,7 @@ void EV_HLDM_GunshotDecalTrace(pmtrace_t* pTrace, char* decalName)
 }
 
 //RENDERERS START
-void EV_HLDM_DecalGunshot(pmtrace_t* pTrace, int iBulletType, float* vecSrc, float* vecEnd)
+static void EV_HLDM_SurfaceDecalGunshot(pmtrace_t* pTrace, int iBulletType, float* vecSrc, float* vecEnd, impactsurface_t* pSurface)
 {
 	physent_t* pe;
 
@@ -511,11 +534,18 @@ void EV_HLDM_DecalGunshot(pmtrace_t* pTrace, int iBulletType, float* vecSrc, flo
 		case BULLET_PLAYER_357:
 		default:
 			// smoke and decal
-			EV_HLDM_GunshotDecalTrace(pTrace, EV_HLDM_HDDecal(pTrace, pe, vecSrc, vecEnd));
+			EV_HLDM_GunshotDecalTrace(pTrace, EV_HLDM_HDDecal(pTrace, pe, vecSrc, vecEnd, pSurface));
 			break;
 		}
 	}
 }
+
+void EV_HLDM_DecalGunshot(pmtrace_t* pTrace, int iBulletType, float* vecSrc, float* vecEnd)
+{
+	impactsurface_t surface = {};
+
+	EV_HLDM_SurfaceDecalGunshot(pTrace, iBulletType, vecSrc, vecEnd, &surface);
+}
 //RENDERERS END
 
 void EV_HLDM_CheckTracer(int idx, float* vecSrc, float* end, float* forward, float* right, int iBulletType, int iTracerFreq, int* tracerCount)
@@ -625,36 +655,38 @@ void EV_HLDM_FireBullets(int idx, float* forward, float* right, float* up, int c
 		// do damage, paint decals
 		if (tr.fraction != 1.0)
 		{
+			impactsurface_t surface = {};
+
 			switch (iBulletType)
 			{
 			default:
 			case BULLET_PLAYER_9MM:
 
-				EV_HLDM_PlayTextureSound(idx, &tr, vecSrc, vecEnd, iBulletType);
+				EV_HLDM_PlaySurfaceSound(idx, &tr, vecSrc, vecEnd, &surface, iBulletType);
 //RENDERERS START
-				EV_HLDM_DecalGunshot(&tr, iBulletType, vecSrc, vecEnd);
+				EV_HLDM_SurfaceDecalGunshot(&tr, iBulletType, vecSrc, vecEnd, &surface);
 //RENDERERS END
 
 				break;
 			case BULLET_PLAYER_MP5:
 
-				EV_HLDM_PlayTextureSound(idx, &tr, vecSrc, vecEnd, iBulletType);
+				EV_HLDM_PlaySurfaceSound(idx, &tr, vecSrc, vecEnd, &surface, iBulletType);
 //RENDERERS START
-				EV_HLDM_DecalGunshot(&tr, iBulletType, vecSrc, vecEnd);
+				EV_HLDM_SurfaceDecalGunshot(&tr, iBulletType, vecSrc, vecEnd, &surface);
 //RENDERERS END
 				break;
 			case BULLET_PLAYER_BUCKSHOT:
 
 //RENDERERS START
-				EV_HLDM_DecalGunshot(&tr, iBulletType, vecSrc, vecEnd);
+				EV_HLDM_SurfaceDecalGunshot(&tr, iBulletType, vecSrc, vecEnd, &surface);
 //RENDERERS END
 
 				break;
 			case BULLET_PLAYER_357:
 
-				EV_HLDM_PlayTextureSound(idx, &tr, vecSrc, vecEnd, iBulletType);
+				EV_HLDM_PlaySurfaceSound(idx, &tr, vecSrc, vecEnd, &surface, iBulletType);
 //RENDERERS START
-				EV_HLDM_DecalGunshot(&tr, iBulletType, vecSrc, vecEnd);
+				EV_HLDM_SurfaceDecalGunshot(&tr, iBulletType, vecSrc, vecEnd, &surface);
 //RENDERERS END
 
 				break;
@@ -517,11 +517,110 @@ void HUD_SetLastOrg()
 	}
 }
 
+/*
+=====================
+HUD_LoadWeaponData
+
+Copy the predicted state of a weapon slot into its weapon object
+=====================
+*/
+static void HUD_LoadWeaponData(CBasePlayerWeapon* pCurrent, const weapon_data_t* pfrom, const local_state_s* from)
+{
+	pCurrent->m_fInReload = 0 != pfrom->m_fInReload;
+	pCurrent->m_fInSpecialReload = pfrom->m_fInSpecialReload;
+	//		pCurrent->m_flPumpTime			= pfrom->m_flPumpTime;
+	pCurrent->m_iClip = pfrom->m_iClip;
+	pCurrent->m_flNextPrimaryAttack = pfrom->m_flNextPrimaryAttack;
+	pCurrent->m_flNextSecondaryAttack = pfrom->m_flNextSecondaryAttack;
+	pCurrent->m_flTimeWeaponIdle = pfrom->m_flTimeWeaponIdle;
+	pCurrent->pev->fuser1 = pfrom->fuser1;
+	pCurrent->m_flStartThrow = pfrom->fuser2;
+	pCurrent->m_flReleaseThrow = pfrom->fuser3;
+	pCurrent->m_chargeReady = pfrom->iuser1;
+	pCurrent->m_fInAttack = pfrom->iuser2;
+	pCurrent->m_fireState = pfrom->iuser3;
+
+	pCurrent->m_iSecondaryAmmoType = (int)from->client.vuser3[2];
+	pCurrent->m_iPrimaryAmmoType = (int)from->client.vuser4[0];
+
+	pCurrent->SetWeaponData(*pfrom);
+}
+
+/*
+=====================
+HUD_DecrementWeaponData
+
+Run the timers of a weapon slot down by the command's msec, like the server does in post think
+=====================
+*/
+static void HUD_DecrementWeaponData(weapon_data_t* pto, const usercmd_t* cmd)
+{
+	// Decrement weapon counters, server does this at same time ( during post think, after doing everything else )
+	pto->m_flNextReload -= cmd->msec / 1000.0;
+	pto->m_fNextAimBonus -= cmd->msec / 1000.0;
+	pto->m_flNextPrimaryAttack -= cmd->msec / 1000.0;
+	pto->m_flNextSecondaryAttack -= cmd->msec / 1000.0;
+	pto->m_flTimeWeaponIdle -= cmd->msec / 1000.0;
+	pto->fuser1 -= cmd->msec / 1000.0;
+}
+
+/*
+=====================
+HUD_ClampWeaponData
+
+=====================
+*/
+static void HUD_ClampWeaponData(weapon_data_t* pto)
+{
+	/*		if ( pto->m_flPumpTime != -9999 )
+	{
+		pto->m_flPumpTime -= cmd->msec / 1000.0;
+		if ( pto->m_flPumpTime < -0.001 )
+			pto->m_flPumpTime = -0.001;
+	}*/
+
+	if (pto->m_fNextAimBonus < -1.0)
+	{
+		pto->m_fNextAimBonus = -1.0;
+	}
+
+	if (pto->m_flNextPrimaryAttack < -1.0)
+	{
+		pto->m_flNextPrimaryAttack = -1.0;
+	}
+
+	if (pto->m_flNextSecondaryAttack < -0.001)
+	{
+		pto->m_flNextSecondaryAttack = -0.001;
+	}
+
+	if (pto->m_flTimeWeaponIdle < -0.001)
+	{
+		pto->m_flTimeWeaponIdle = -0.001;
+	}
+
+	if (pto->m_flNextReload < -0.001)
+	{
+		pto->m_flNextReload = -0.001;
+	}
+
+	if (pto->fuser1 < -0.001)
+	{
+		pto->fuser1 = -0.001;
+	}
+}
+
 /*
 =====================
 HUD_WeaponsPostThink
 
 Run Weapon firing code on client
+
+Only the weapons that run code this command (the current one and the one
+being switched to) have the predicted state copied into their objects and
+back out. Every other slot stays stale and has its weapon_data_t carried
+straight from "from" to "to", which is all the round trip through an idle
+weapon ever amounted to.
 =====================
 */
 void HUD_WeaponsPostThink(local_state_s* from, local_state_s* to, usercmd_t* cmd, double time, unsigned int random_seed)
@@ -532,6 +631,7 @@ void HUD_WeaponsPostThink(local_state_s* from, local_state_s* to, usercmd_t* cmd
 	CBasePlayerWeapon* pCurrent;
 	weapon_data_t nulldata, *pfrom, *pto;
 	static int lasthealth;
+	bool weaponStale[MAX_WEAPONS];
 
 	memset(&nulldata, 0, sizeof(nulldata));
 
@@ -628,37 +728,15 @@ void HUD_WeaponsPostThink(local_state_s* from, local_state_s* to, usercmd_t* cmd
 	if (pWeapon == nullptr)
 		return;
 
+	// Every other weapon is stale until it's needed
 	for (i = 0; i < MAX_WEAPONS; i++)
-	{
-		pCurrent = g_pWpns[i];
-		if (pCurrent == nullptr)
-		{
-			continue;
-		}
+		weaponStale[i] = g_pWpns[i] != nullptr;
 
-		pfrom = &from->weapondata[i];
-
-		pCurrent->m_fInReload = 0 != pfrom->m_fInReload;
-		pCurrent->m_fInSpecialReload = pfrom->m_fInSpecialReload;
-		//		pCurrent->m_flPumpTime			= pfrom->m_flPumpTime;
-		pCurrent->m_iClip = pfrom->m_iClip;
-		pCurrent->m_flNextPrimaryAttack = pfrom->m_flNextPrimaryAttack;
-		pCurrent->m_flNextSecondaryAttack = pfrom->m_flNextSecondaryAttack;
-		pCurrent->m_flTimeWeaponIdle = pfrom->m_flTimeWeaponIdle;
-		pCurrent->pev->fuser1 = pfrom->fuser1;
-		pCurrent->m_flStartThrow = pfrom->fuser2;
-		pCurrent->m_flReleaseThrow = pfrom->fuser3;
-		pCurrent->m_chargeReady = pfrom->iuser1;
-		pCurrent->m_fInAttack = pfrom->iuser2;
-		pCurrent->m_fireState = pfrom->iuser3;
-
-		pCurrent->m_iSecondaryAmmoType = (int)from->client.vuser3[2];
-		pCurrent->m_iPrimaryAmmoType = (int)from->client.vuser4[0];
-		player.m_rgAmmo[pCurrent->m_iPrimaryAmmoType] = (int)from->client.vuser4[1];
-		player.m_rgAmmo[pCurrent->m_iSecondaryAmmoType] = (int)from->client.vuser4[2];
-
-		pCurrent->SetWeaponData(*pfrom);
-	}
+	HUD_LoadWeaponData(pWeapon, &from->weapondata[pWeapon->m_iId], from);
+	weaponStale[pWeapon->m_iId] = false;
+
+	player.m_rgAmmo[pWeapon->m_iPrimaryAmmoType] = (int)from->client.vuser4[1];
+	player.m_rgAmmo[pWeapon->m_iSecondaryAmmoType] = (int)from->client.vuser4[2];
 
 	// For random weapon events, use this seed to seed random # generator
 	player.random_seed = random_seed;
@@ -739,6 +817,12 @@ void HUD_WeaponsPostThink(local_state_s* from, local_state_s* to, usercmd_t* cmd
 			CBasePlayerWeapon* pNew = g_pWpns[cmd->weaponselect];
 			if ((pNew != nullptr) && (pNew != pWeapon))
 			{
+				if (weaponStale[cmd->weaponselect])
+				{
+					HUD_LoadWeaponData(pNew, &from->weapondata[cmd->weaponselect], from);
+					weaponStale[cmd->weaponselect] = false;
+				}
+
 				// Put away old weapon
 				if (player.m_pActiveItem != nullptr)
 					player.m_pActiveItem->Holster();
@@ -807,6 +891,29 @@ void HUD_WeaponsPostThink(local_state_s* from, local_state_s* to, usercmd_t* cmd
 			continue;
 		}
 
+		if (weaponStale[i])
+		{
+			// Same as loading it into the weapon and reading it straight back
+			pfrom = &from->weapondata[i];
+
+			pto->m_fInReload = static_cast<int>(0 != pfrom->m_fInReload);
+			pto->m_fInSpecialReload = pfrom->m_fInSpecialReload;
+			pto->m_iClip = pfrom->m_iClip;
+			pto->m_flNextPrimaryAttack = pfrom->m_flNextPrimaryAttack;
+			pto->m_flNextSecondaryAttack = pfrom->m_flNextSecondaryAttack;
+			pto->m_flTimeWeaponIdle = pfrom->m_flTimeWeaponIdle;
+			pto->fuser1 = pfrom->fuser1;
+			pto->fuser2 = pfrom->fuser2;
+			pto->fuser3 = pfrom->fuser3;
+			pto->iuser1 = pfrom->iuser1;
+			pto->iuser2 = pfrom->iuser2;
+			pto->iuser3 = pfrom->iuser3;
+
+			HUD_DecrementWeaponData(pto, cmd);
+			HUD_ClampWeaponData(pto);
+			continue;
+		}
+
 		pto->m_fInReload = static_cast<int>(pCurrent->m_fInReload);
 		pto->m_fInSpecialReload = pCurrent->m_fInSpecialReload;
 		//		pto->m_flPumpTime				= pCurrent->m_flPumpTime;
@@ -821,61 +928,21 @@ void HUD_WeaponsPostThink(local_state_s* from, local_state_s* to, usercmd_t* cmd
 		pto->iuser2 = pCurrent->m_fInAttack;
 		pto->iuser3 = pCurrent->m_fireState;
 
-		// Decrement weapon counters, server does this at same time ( during post think, after doing everything else )
-		pto->m_flNextReload -= cmd->msec / 1000.0;
-		pto->m_fNextAimBonus -= cmd->msec / 1000.0;
-		pto->m_flNextPrimaryAttack -= cmd->msec / 1000.0;
-		pto->m_flNextSecondaryAttack -= cmd->msec / 1000.0;
-		pto->m_flTimeWeaponIdle -= cmd->msec / 1000.0;
-		pto->fuser1 -= cmd->msec / 1000.0;
-
-		to->client.vuser3[2] = pCurrent->m_iSecondaryAmmoType;
-		to->client.vuser4[0] = pCurrent->m_iPrimaryAmmoType;
-		to->client.vuser4[1] = player.m_rgAmmo[pCurrent->m_iPrimaryAmmoType];
-		to->client.vuser4[2] = player.m_rgAmmo[pCurrent->m_iSecondaryAmmoType];
+		HUD_DecrementWeaponData(pto, cmd);
 
 		pCurrent->DecrementTimers();
 
 		pCurrent->GetWeaponData(*pto);
 
-		/*		if ( pto->m_flPumpTime != -9999 )
-		{
-			pto->m_flPumpTime -= cmd->msec / 1000.0;
-			if ( pto->m_flPumpTime < -0.001 )
-				pto->m_flPumpTime = -0.001;
-		}*/
-
-		if (pto->m_fNextAimBonus < -1.0)
-		{
-			pto->m_fNextAimBonus = -1.0;
-		}
-
-		if (pto->m_flNextPrimaryAttack < -1.0)
-		{
-			pto->m_flNextPrimaryAttack = -1.0;
-		}
-
-		if (pto->m_flNextSecondaryAttack < -0.001)
-		{
-			pto->m_flNextSecondaryAttack = -0.001;
-		}
-
-		if (pto->m_flTimeWeaponIdle < -0.001)
-		{
-			pto->m_flTimeWeaponIdle = -0.001;
-		}
-
-		if (pto->m_flNextReload < -0.001)
-		{
-			pto->m_flNextReload = -0.001;
-		}
-
-		if (pto->fuser1 < -0.001)
-		{
-			pto->fuser1 = -0.001;
-		}
+		HUD_ClampWeaponData(pto);
 	}
 
+	// Every weapon was given the same ammo types from the state
+	to->client.vuser3[2] = pWeapon->m_iSecondaryAmmoType;
+	to->client.vuser4[0] = pWeapon->m_iPrimaryAmmoType;
+	to->client.vuser4[1] = player.m_rgAmmo[pWeapon->m_iPrimaryAmmoType];
+	to->client.vuser4[2] = player.m_rgAmmo[pWeapon->m_iSecondaryAmmoType];
+
 	// m_flNextAttack is now part of the weapons, but is part of the player instead
 	to->client.m_flNextAttack -= cmd->msec / 1000.0;
 	if (to->client.m_flNextAttack < -0.001)
@@ -25,6 +25,7 @@
 #include "event_api.h"
 #include "studio_util.h"
 #include "screenfade.h"
+#include "entity_lump.h"
 
 
 #pragma warning(disable : 4244)
@@ -234,126 +235,60 @@ void UTIL_StringToVector(float* pVector, const char* pString)
 
 bool UTIL_FindEntityInMap(const char* name, float* origin, float* angle)
 {
-	int n;
-	bool found = false;
-	char keyname[256];
-	char token[1024];
-
 	cl_entity_t* pEnt = gEngfuncs.GetEntityByIndex(0); // get world model
 
 	if (pEnt == nullptr)
 		return false;
 
-	if (pEnt->model == nullptr)
+	// the lump is only parsed again when the map changed
+	if (!gEntityLump.Update(pEnt->model))
 		return false;
 
-	char* data = pEnt->model->entities;
-
-	while (data != nullptr)
-	{
-		data = gEngfuncs.COM_ParseFile(data, token);
+	int entity = gEntityLump.FindByClassname(name);
 
-		if ((token[0] == '}') || (token[0] == 0))
-			break;
-
-		if (data == nullptr)
-		{
-			gEngfuncs.Con_DPrintf("UTIL_FindEntityInMap: EOF without closing brace\n");
-			return false;
-		}
-
-		if (token[0] != '{')
-		{
-			gEngfuncs.Con_DPrintf("UTIL_FindEntityInMap: expected {\n");
-			return false;
-		}
+	if (entity == -1)
+		return false; // we search all entities, but didn't found the correct
 
-		// we parse the first { now parse entities properties
+	for (int i = 0; i < gEntityLump.NumPairs(entity); i++)
+	{
+		const char* keyname = gEntityLump.Key(entity, i);
+		const char* token = gEntityLump.Value(entity, i);
 
-		while (true)
+		if (0 == strcmp(keyname, "angle"))
 		{
-			// parse key
-			data = gEngfuncs.COM_ParseFile(data, token);
-			if (token[0] == '}')
-				break; // finish parsing this entity
-
-			if (data == nullptr)
-			{
-				gEngfuncs.Con_DPrintf("UTIL_FindEntityInMap: EOF without closing brace\n");
-				return false;
-			}
-
-			strcpy(keyname, token);
-
-			// another hack to fix keynames with trailing spaces
-			n = strlen(keyname);
-			while (0 != n && keyname[n - 1] == ' ')
-			{
-				keyname[n - 1] = 0;
-				n--;
-			}
-
-			// parse value
-			data = gEngfuncs.COM_ParseFile(data, token);
-			if (data == nullptr)
-			{
-				gEngfuncs.Con_DPrintf("UTIL_FindEntityInMap: EOF without closing brace\n");
-				return false;
-			}
+			float y = atof(token);
 
-			if (token[0] == '}')
+			if (y >= 0)
 			{
-				gEngfuncs.Con_DPrintf("UTIL_FindEntityInMap: closing brace without data");
-				return false;
+				angle[0] = 0.0f;
+				angle[1] = y;
 			}
-
-			if (0 == strcmp(keyname, "classname"))
+			else if ((int)y == -1)
 			{
-				if (0 == strcmp(token, name))
-				{
-					found = true; // thats our entity
-				}
+				angle[0] = -90.0f;
+				angle[1] = 0.0f;
 			}
-
-			if (0 == strcmp(keyname, "angle"))
+			else
 			{
-				float y = atof(token);
-
-				if (y >= 0)
-				{
-					angle[0] = 0.0f;
-					angle[1] = y;
-				}
-				else if ((int)y == -1)
-				{
-					angle[0] = -90.0f;
-					angle[1] = 0.0f;
-				}
-				else
-				{
-					angle[0] = 90.0f;
-					angle[1] = 0.0f;
-				}
-
-				angle[2] = 0.0f;
+				angle[0] = 90.0f;
+				angle[1] = 0.0f;
 			}
 
-			if (0 == strcmp(keyname, "angles"))
-			{
-				UTIL_StringToVector(angle, token);
-			}
+			angle[2] = 0.0f;
+		}
 
-			if (0 == strcmp(keyname, "origin"))
-			{
-				UTIL_StringToVector(origin, token);
-			}
-		} // while (1)
+		if (0 == strcmp(keyname, "angles"))
+		{
+			UTIL_StringToVector(angle, token);
+		}
 
-		if (found)
-			return true;
+		if (0 == strcmp(keyname, "origin"))
+		{
+			UTIL_StringToVector(origin, token);
+		}
 	}
 
-	return false; // we search all entities, but didn't found the correct
+	return true;
 }
 
 //-----------------------------------------------------------------------------
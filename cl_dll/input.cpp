@@ -20,6 +20,7 @@
 
 #include "vgui_TeamFortressViewport.h"
 #include "filesystem_utils.h"
+#include "renderer/jobpool.h"
 
 
 extern bool g_iAlive;
@@ -1061,6 +1062,7 @@ void DLLEXPORT HUD_Shutdown()
 
 	ShutdownInput();
 
+	gJobPool.Shutdown();
 
 	FileSystem_FreeFileSystem();
 }
@@ -47,6 +47,7 @@ Extended and/or recoded by Andrew Lucas
 
 #include "StudioModelRenderer.h"
 #include "GameStudioModelRenderer.h"
+#include "perf_trace.h"
 extern CGameStudioModelRenderer g_StudioRenderer;
 
 extern "C" 
@@ -204,6 +205,8 @@ void CBSPRenderer::Init()
 		gEngfuncs.pfnClientCmd("quit\n");
 	}
 
+	m_iShadowGridNumLights = -1;
+
 	glGetIntegerv(GL_MAX_TEXTURE_UNITS_ARB, &m_iTUSupport);
 	if (m_iTUSupport < 3)
 	{
@@ -349,9 +352,12 @@ void CBSPRenderer::Init()
 	gEngfuncs.pfnAddCommand("te_dump", RenderersDumpInfo);
 	gEngfuncs.pfnAddCommand("te_detail_auto", GenDetail);
 	gEngfuncs.pfnAddCommand("te_exportworld", ExportWorld);
+	gEngfuncs.pfnAddCommand("te_cullbench", R_CullBench);
+	gEngfuncs.pfnAddCommand("te_perftrace_dump", R_PerfTraceDump);
 
 	m_pCvarDrawWorld = CVAR_CREATE("te_world", "1", 0);
 	m_pCvarSpeeds = CVAR_CREATE("te_speeds", "0", 0);
+	m_pCvarPerfTrace = CVAR_CREATE("te_perftrace", "0", 0);
 	m_pCvarDetailTextures = CVAR_CREATE("te_detail", "1", 0);
 	m_pCvarWorldShaders = CVAR_CREATE("te_world_shaders", "1", FCVAR_ARCHIVE);
 	m_pCvarWireFrame = CVAR_CREATE("te_wireframe", "0", 0);
@@ -587,6 +593,7 @@ void CBSPRenderer::GetRenderEnts()
 	// Clear counters
 	m_iNumRenderEntities = NULL;
 	m_iNumModelLights = NULL;
+	m_iShadowGridNumLights = -1;
 
 	cl_entity_t* pPlayer = gEngfuncs.GetLocalPlayer();
 	cl_entity_t* pView = gEngfuncs.GetViewModel();
@@ -794,6 +801,94 @@ void CBSPRenderer::GetRenderEnts()
 	}
 }
 
+/*
+====================
+ShadowLightGridBucket
+
+====================
+*/
+inline int ShadowLightGridBucket(int x, int y, int z)
+{
+	return (((unsigned int)x * 73856093u) ^ ((unsigned int)y * 19349663u) ^ ((unsigned int)z * 83492791u)) & (SHADOWLIGHT_GRID_BUCKETS - 1);
+}
+
+/*
+====================
+BuildShadowLightGrid
+
+====================
+*/
+void CBSPRenderer::BuildShadowLightGrid()
+{
+	for (int i = 0; i < SHADOWLIGHT_GRID_BUCKETS; i++)
+		m_iShadowGridHeads[i] = -1;
+
+	// Insert backwards so each bucket lists its lights in index order
+	for (int i = m_iNumModelLights - 1; i >= 0; i--)
+	{
+		mlight_t* mlight = &m_pModelLights[i];
+		if (mlight->radius == 0.0f || mlight->flashlight)
+			continue;
+
+		int bucket = ShadowLightGridBucket(
+			floor(mlight->origin.x / SHADOWLIGHT_GRID_CELL),
+			floor(mlight->origin.y / SHADOWLIGHT_GRID_CELL),
+			floor(mlight->origin.z / SHADOWLIGHT_GRID_CELL));
+
+		m_iShadowGridNext[i] = m_iShadowGridHeads[bucket];
+		m_iShadowGridHeads[bucket] = i;
+	}
+
+	m_iShadowGridNumLights = m_iNumModelLights;
+}
+
+/*
+====================
+FindShadowLight
+
+Closest non-flashlight model light within radius, or nullptr
+====================
+*/
+const mlight_t* CBSPRenderer::FindShadowLight(const Vector& origin, float radius)
+{
+	// Lights get appended during the frame, rebuild if there are new ones
+	if (m_iShadowGridNumLights != m_iNumModelLights)
+		BuildShadowLightGrid();
+
+	int cx = floor(origin.x / SHADOWLIGHT_GRID_CELL);
+	int cy = floor(origin.y / SHADOWLIGHT_GRID_CELL);
+	int cz = floor(origin.z / SHADOWLIGHT_GRID_CELL);
+
+	int best = -1;
+	float bestDist = radius * radius;
+
+	for (int x = cx - 1; x <= cx + 1; x++)
+	{
+		for (int y = cy - 1; y <= cy + 1; y++)
+		{
+			for (int z = cz - 1; z <= cz + 1; z++)
+			{
+				for (int i = m_iShadowGridHeads[ShadowLightGridBucket(x, y, z)]; i != -1; i = m_iShadowGridNext[i])
+				{
+					float dist = (m_pModelLights[i].origin - origin).LengthSquared();
+
+					// Ties go to the earlier light, same as a linear search would
+					if (dist < bestDist || (dist == bestDist && best != -1 && i < best))
+					{
+						bestDist = dist;
+						best = i;
+					}
+				}
+			}
+		}
+	}
+
+	if (best == -1)
+		return nullptr;
+
+	return &m_pModelLights[best];
+}
+
 /*
 ====================
 AddEntity
@@ -1153,6 +1248,7 @@ void CBSPRenderer::ClearDetailObjects()
 	}
 
 	memset(m_pDetailObjects, 0, sizeof(m_pDetailObjects));
+	m_DetailBounds.Clear();
 	m_iNumDetailObjects = NULL;
 	m_iNumDetailSurfaces = NULL;
 }
@@ -1341,6 +1437,8 @@ void CBSPRenderer::LoadDetailFile()
 
 		memcpy(m_pDetailObjects[i].leafnums, pTemp.leafnums, sizeof(short) * MAX_ENT_LEAFS);
 		m_pDetailObjects[i].numleafs = pTemp.num_leafs;
+
+		m_DetailBounds.AddBox(m_pDetailObjects[i].mins, m_pDetailObjects[i].maxs);
 	}
 }
 
@@ -2220,7 +2318,11 @@ void CBSPRenderer::DrawWorld()
 
 	EnableVertexArray();
 	PrepareRenderer();
-	RecursiveWorldNode(m_pWorld->nodes);
+
+	{
+		PERF_SCOPE("world traversal");
+		RecursiveWorldNode(m_pWorld->nodes);
+	}
 
 	// Draw all static entities
 	for (int i = 0; i < m_iNumRenderEntities; i++)
@@ -2272,6 +2374,8 @@ void CBSPRenderer::DrawDetails()
 	if (m_iNumDetailObjects == 0)
 		return;
 
+	gHUD.viewFrustum.CullBoxes(m_DetailBounds, m_pDetailCulled);
+
 	VectorCopy(m_vRenderOrigin, m_vVecToEyes);
 	m_pCurrentEntity = gEngfuncs.GetEntityByIndex(0);
 
@@ -2286,7 +2390,7 @@ void CBSPRenderer::DrawDetails()
 		if (j == pCurObject->numleafs)
 			continue;
 
-		if (gHUD.viewFrustum.CullBox(pCurObject->mins, pCurObject->maxs))
+		if (m_pDetailCulled[i] != 0)
 			continue;
 
 		if (!m_bShaderSupport || m_pCvarWorldShaders->value < 1)
@@ -6217,6 +6321,8 @@ void CBSPRenderer::DrawDetailsSolid()
 	if (m_iNumDetailObjects == 0)
 		return;
 
+	gHUD.viewFrustum.CullBoxes(m_DetailBounds, m_pDetailCulled);
+
 	detailobject_t* pCurObject = m_pDetailObjects;
 	for (int i = 0; i < m_iNumDetailObjects; i++, pCurObject++)
 	{
@@ -6228,7 +6334,7 @@ void CBSPRenderer::DrawDetailsSolid()
 		if (j == pCurObject->numleafs)
 			continue;
 
-		if (gHUD.viewFrustum.CullBox(pCurObject->mins, pCurObject->maxs))
+		if (m_pDetailCulled[i] != 0)
 			continue;
 
 		if (pCurObject->rendermode == kRenderTransAlpha)
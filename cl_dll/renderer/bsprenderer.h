@@ -72,6 +72,8 @@ public:
 	void DecayLights();
 	bool HasDynLights();
 	void GetAdditionalLights();
+	void BuildShadowLightGrid();
+	const mlight_t* FindShadowLight(const Vector& origin, float radius);
 	cl_dlight_t* CL_AllocDLight(int key);
 	int MsgDynLight(const char* pszName, int iSize, void* pbuf);
 
@@ -230,6 +232,7 @@ public:
 	Vector m_vCurSpotForward;
 
 	cvar_t* m_pCvarSpeeds;
+	cvar_t* m_pCvarPerfTrace;
 	cvar_t* m_pCvarDetailTextures;
 	cvar_t* m_pCvarDynamic;
 	cvar_t* m_pCvarDrawWorld;
@@ -254,6 +257,11 @@ public:
 	mlight_t m_pModelLights[MAXRENDERENTS];
 	int m_iNumModelLights;
 
+	// Model lights bucketed by position, for shadow light lookups
+	int m_iShadowGridHeads[SHADOWLIGHT_GRID_BUCKETS];
+	int m_iShadowGridNext[MAXRENDERENTS];
+	int m_iShadowGridNumLights;
+
 	lightstyle_t m_pLightStyles[MAX_LIGHTSTYLES];
 	int m_iLightStyleValue[MAX_LIGHTSTYLES];
 
@@ -276,6 +284,10 @@ public:
 
 	detailobject_t m_pDetailObjects[MAX_MAP_DETAILOBJECTS];
 	int m_iNumDetailObjects;
+
+	// Detail object bounds for batched view culling.
+	cullboxes_t m_DetailBounds;
+	byte m_pDetailCulled[MAX_MAP_DETAILOBJECTS];
 	int m_iNumDetailSurfaces;
 
 	int m_iAtten3DPoint;
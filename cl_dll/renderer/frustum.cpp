@@ -22,6 +22,16 @@
 #include <memory.h>
 #include <math.h>
 
+#include <emmintrin.h>
+
+// the Linux build is x87 only, so the batch culling code asks
+// for SSE2 itself and only runs if the CPU has it
+#if defined(__GNUC__)
+#define CULL_SSE2 __attribute__((target("sse2")))
+#else
+#define CULL_SSE2
+#endif
+
 #ifndef M_PI
 #define M_PI 3.14159265358979323846 // matches value in gcc v2 math.h
 #endif
@@ -252,6 +262,169 @@ bool FrustumCheck::CullBox(Vector vMins, Vector vMaxs)
 	return false;
 }
 
+/*
+=====================
+cullboxes_t
+
+=====================
+*/
+void cullboxes_t::Clear()
+{
+	for (int i = 0; i < 3; i++)
+	{
+		mins[i].clear();
+		maxs[i].clear();
+	}
+}
+
+void cullboxes_t::AddBox(const Vector& vMins, const Vector& vMaxs)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		mins[i].push_back(vMins[i]);
+		maxs[i].push_back(vMaxs[i]);
+	}
+}
+
+/*
+=====================
+CullHasSSE2
+
+=====================
+*/
+static bool CullHasSSE2()
+{
+#if defined(__GNUC__)
+	static const bool bHasSSE2 = __builtin_cpu_supports("sse2") != 0;
+	return bHasSSE2;
+#else
+	return true; // MSVC builds target SSE2 already
+#endif
+}
+
+/*
+=====================
+CullBoxOutsideBox
+
+Lanes of the four boxes that are entirely outside of vMins/vMaxs
+=====================
+*/
+CULL_SSE2 static inline __m128 CullBoxOutsideBox(const Vector& vMins, const Vector& vMaxs, const __m128* pBoxMins, const __m128* pBoxMaxs)
+{
+	__m128 outside = _mm_setzero_ps();
+
+	for (int j = 0; j < 3; j++)
+	{
+		outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_set1_ps(vMins[j]), pBoxMaxs[j]));
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_set1_ps(vMaxs[j]), pBoxMins[j]));
+	}
+
+	return outside;
+}
+
+/*
+=====================
+CullBoxesSSE2
+
+Does four boxes at a time and returns how many it did,
+the rest are left for CullBox
+=====================
+*/
+CULL_SSE2 int FrustumCheck::CullBoxesSSE2(const cullboxes_t& boxes, byte* pCulled)
+{
+	const int iNumBoxes = boxes.NumBoxes() & ~3;
+
+	// the far clip plane goes first, like in CullBox
+	Q_mplane_t* pPlanes[5];
+	int iNumPlanes = 0;
+
+	if (m_iFarClip == FARCLIP_DEPTH)
+		pPlanes[iNumPlanes++] = &m_sFrustum[4];
+
+	for (int i = 0; i < 4; i++)
+		pPlanes[iNumPlanes++] = &m_sFrustum[i];
+
+	for (int i = 0; i < iNumBoxes; i += 4)
+	{
+		__m128 boxmins[3], boxmaxs[3];
+		for (int j = 0; j < 3; j++)
+		{
+			boxmins[j] = _mm_loadu_ps(&boxes.mins[j][i]);
+			boxmaxs[j] = _mm_loadu_ps(&boxes.maxs[j][i]);
+		}
+
+		__m128 culled = _mm_setzero_ps();
+
+		if (m_bExtraCull)
+			culled = CullBoxOutsideBox(m_vExtraCullMins, m_vExtraCullMaxs, boxmins, boxmaxs);
+
+		if (m_iFarClip == FARCLIP_RADIAL)
+			culled = _mm_or_ps(culled, CullBoxOutsideBox(m_vCullBoxMins, m_vCullBoxMaxs, boxmins, boxmaxs));
+
+		for (int k = 0; k < iNumPlanes; k++)
+		{
+			// all four are gone already
+			if (_mm_movemask_ps(culled) == 0xF)
+				break;
+
+			Q_mplane_t* p = pPlanes[k];
+
+			// the signbits pick the farthest (dist1) and nearest (dist2)
+			// corners along the normal, same as Q_BoxOnPlaneSide
+			__m128 dist1 = _mm_setzero_ps();
+			__m128 dist2 = _mm_setzero_ps();
+			for (int j = 0; j < 3; j++)
+			{
+				__m128 normal = _mm_set1_ps(p->vNormal[j]);
+
+				if ((p->signbits & (1 << j)) != 0)
+				{
+					dist1 = _mm_add_ps(dist1, _mm_mul_ps(normal, boxmins[j]));
+					dist2 = _mm_add_ps(dist2, _mm_mul_ps(normal, boxmaxs[j]));
+				}
+				else
+				{
+					dist1 = _mm_add_ps(dist1, _mm_mul_ps(normal, boxmaxs[j]));
+					dist2 = _mm_add_ps(dist2, _mm_mul_ps(normal, boxmins[j]));
+				}
+			}
+
+			// Q_BoxOnPlaneSide returning 2
+			__m128 dist = _mm_set1_ps(p->flDist);
+			culled = _mm_or_ps(culled, _mm_and_ps(_mm_cmplt_ps(dist1, dist), _mm_cmplt_ps(dist2, dist)));
+		}
+
+		int mask = _mm_movemask_ps(culled);
+		pCulled[i] = mask & 1;
+		pCulled[i + 1] = (mask >> 1) & 1;
+		pCulled[i + 2] = (mask >> 2) & 1;
+		pCulled[i + 3] = (mask >> 3) & 1;
+	}
+
+	return iNumBoxes;
+}
+
+/*
+=====================
+CullBoxes
+
+=====================
+*/
+void FrustumCheck::CullBoxes(const cullboxes_t& boxes, byte* pCulled)
+{
+	int i = 0;
+
+	if (CullHasSSE2())
+		i = CullBoxesSSE2(boxes, pCulled);
+
+	for (; i < boxes.NumBoxes(); i++)
+	{
+		Vector vMins(boxes.mins[0][i], boxes.mins[1][i], boxes.mins[2][i]);
+		Vector vMaxs(boxes.maxs[0][i], boxes.maxs[1][i], boxes.maxs[2][i]);
+		pCulled[i] = CullBox(vMins, vMaxs) ? 1 : 0;
+	}
+}
+
 /*
 =====================
 Q_AngleVectors
@@ -18,6 +18,8 @@
 #include "parsemsg.h"
 #include "cvardef.h"
 
+#include <vector>
+
 #define PITCH 0
 #define YAW 1
 #define ROLL 2
@@ -37,6 +39,23 @@ typedef struct Q_mplane_s
 	byte pad[2];
 } Q_mplane_t;
 
+/*
+===============
+cullboxes_t
+
+Bounds for FrustumCheck::CullBoxes, one array per axis
+===============
+*/
+struct cullboxes_t
+{
+	std::vector<float> mins[3];
+	std::vector<float> maxs[3];
+
+	void Clear();
+	void AddBox(const Vector& vMins, const Vector& vMaxs);
+	int NumBoxes() const { return (int)mins[0].size(); }
+};
+
 /*
 ===============
 CFrustum
@@ -51,6 +70,9 @@ public:
 	bool RadialCullBox(Vector vMins, Vector vMaxs);
 	bool ExtraCullBox(Vector vMins, Vector vMaxs);
 
+	// Sets pCulled[i] to what CullBox would return for box i
+	void CullBoxes(const cullboxes_t& boxes, byte* pCulled);
+
 	void SetExtraCullBox(Vector vMins, Vector vMaxs);
 	void DisableExtraCullBox();
 
@@ -62,6 +84,8 @@ public:
 	void Q_CrossProduct(Vector v1, Vector v2, Vector cross);
 
 private:
+	int CullBoxesSSE2(const cullboxes_t& boxes, byte* pCulled);
+
 	Q_mplane_t m_sFrustum[5];
 	int m_iFarClip;
 
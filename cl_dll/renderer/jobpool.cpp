@@ -0,0 +1,172 @@
+/*
+Trinity Rendering Engine - Copyright Andrew Lucas 2009-2012
+FranBase Modbase - Copyright FranticDreamer 2020-2025
+
+The Trinity Engine is free software, distributed in the hope th-
+at it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE. See the GNU Lesser General Public License for more det-
+ails.
+
+Job pool
+Runs batches of independent jobs on a few worker threads
+*/
+
+#include "jobpool.h"
+
+CJobPool gJobPool;
+
+/*
+====================
+CJobPool
+
+====================
+*/
+CJobPool::CJobPool()
+{
+	m_iNumWorkers = 0;
+	m_pfnJob = nullptr;
+	m_pData = nullptr;
+	m_iNumJobs = 0;
+	m_iNextJob = 0;
+	m_iBatch = 0;
+	m_iBusyWorkers = 0;
+	m_bQuit = false;
+}
+
+/*
+====================
+~CJobPool
+
+====================
+*/
+CJobPool::~CJobPool()
+{
+	Shutdown();
+}
+
+/*
+====================
+SetNumWorkers
+
+Takes effect on the next batch
+====================
+*/
+void CJobPool::SetNumWorkers(int iNumWorkers)
+{
+	if (iNumWorkers < 0)
+		iNumWorkers = 0;
+
+	if (iNumWorkers == m_iNumWorkers)
+		return;
+
+	Shutdown();
+	m_iNumWorkers = iNumWorkers;
+}
+
+/*
+====================
+Shutdown
+
+====================
+*/
+void CJobPool::Shutdown()
+{
+	if (m_Threads.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_bQuit = true;
+	}
+	m_WakeCond.notify_all();
+
+	for (auto& thread : m_Threads)
+		thread.join();
+
+	m_Threads.clear();
+	m_bQuit = false;
+}
+
+/*
+====================
+RunJobs
+
+====================
+*/
+void CJobPool::RunJobs()
+{
+	for (int i = m_iNextJob++; i < m_iNumJobs; i = m_iNextJob++)
+		m_pfnJob(i, m_pData);
+}
+
+/*
+====================
+WorkerThread
+
+Sleeps until a batch newer than iBatch is started
+====================
+*/
+void CJobPool::WorkerThread(unsigned int iBatch)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	while (true)
+	{
+		m_WakeCond.wait(lock, [&]
+			{ return m_bQuit || m_iBatch != iBatch; });
+
+		if (m_bQuit)
+			return;
+
+		iBatch = m_iBatch;
+
+		lock.unlock();
+		RunJobs();
+		lock.lock();
+
+		if (--m_iBusyWorkers == 0)
+			m_DoneCond.notify_one();
+	}
+}
+
+/*
+====================
+Run
+
+====================
+*/
+void CJobPool::Run(int iNumJobs, pfnJob_t pfnJob, void* pData)
+{
+	if (iNumJobs <= 0)
+		return;
+
+	// not worth waking anyone up
+	if (m_iNumWorkers == 0 || iNumJobs == 1)
+	{
+		for (int i = 0; i < iNumJobs; i++)
+			pfnJob(i, pData);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	while ((int)m_Threads.size() < m_iNumWorkers)
+		m_Threads.emplace_back(&CJobPool::WorkerThread, this, m_iBatch);
+
+	m_pfnJob = pfnJob;
+	m_pData = pData;
+	m_iNumJobs = iNumJobs;
+	m_iNextJob = 0;
+	m_iBusyWorkers = (int)m_Threads.size();
+	m_iBatch++;
+
+	lock.unlock();
+	m_WakeCond.notify_all();
+
+	RunJobs();
+
+	lock.lock();
+	m_DoneCond.wait(lock, [&]
+		{ return m_iBusyWorkers == 0; });
+}
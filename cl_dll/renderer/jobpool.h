@@ -0,0 +1,73 @@
+/*
+Trinity Rendering Engine - Copyright Andrew Lucas 2009-2012
+FranBase Modbase - Copyright FranticDreamer 2020-2025
+
+The Trinity Engine is free software, distributed in the hope th-
+at it will be useful, but WITHOUT ANY WARRANTY; without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE. See the GNU Lesser General Public License for more det-
+ails.
+
+Job pool
+Runs batches of independent jobs on a few worker threads
+*/
+
+#ifndef JOBPOOL_H
+#define JOBPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+====================
+CJobPool
+
+Workers are started on the first batch and sleep between batches.
+The calling thread takes jobs as well and Run returns once all are done.
+====================
+*/
+class CJobPool
+{
+public:
+	typedef void (*pfnJob_t)(int iJob, void* pData);
+
+	CJobPool();
+	~CJobPool();
+
+	// Number of worker threads to use, not counting the caller
+	void SetNumWorkers(int iNumWorkers);
+	int GetNumWorkers() const { return m_iNumWorkers; }
+
+	// Calls pfnJob for every index below iNumJobs and waits for them
+	void Run(int iNumJobs, pfnJob_t pfnJob, void* pData);
+
+	// Stops and joins the worker threads, needs to happen before the dll unloads
+	void Shutdown();
+
+private:
+	void WorkerThread(unsigned int iBatch);
+	void RunJobs();
+
+	std::vector<std::thread> m_Threads;
+	int m_iNumWorkers;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_WakeCond;
+	std::condition_variable m_DoneCond;
+
+	pfnJob_t m_pfnJob;
+	void* m_pData;
+	int m_iNumJobs;
+	std::atomic<int> m_iNextJob;
+
+	unsigned int m_iBatch; // bumped for every batch, wakes the workers
+	int m_iBusyWorkers;
+	bool m_bQuit;
+};
+
+extern CJobPool gJobPool;
+
+#endif // JOBPOOL_H
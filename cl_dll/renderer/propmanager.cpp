@@ -33,6 +33,7 @@ Transparency code by Neil "Jed" Jedrzejewski
 
 #include "propmanager.h"
 #include "bsprenderer.h"
+#include "entity_lump.h"
 
 #include "r_efx.h"
 #include "r_studioint.h"
@@ -121,12 +122,6 @@ void CPropManager::Reset()
 
 	ClearEntityData();
 
-	if (m_pEntData != nullptr)
-	{
-		m_pEntData = nullptr;
-		m_iEntDataSize = NULL;
-	}
-
 	if (m_pVertexData != nullptr)
 	{
 		delete[] m_pVertexData;
@@ -217,9 +212,8 @@ void CPropManager::GenerateEntityList()
 		exit(-1);
 	}
 
-	// world model already adds pointer to ent data
-	m_iEntDataSize = strlen(pWorld->entities);
-	m_pEntData = pWorld->entities;
+	// a new map, even the same one reloaded, gets its lump parsed again
+	gEntityLump.Clear();
 
 	ParseEntities();
 	LoadEntVars();
@@ -269,51 +263,24 @@ ParseEntities
 */
 void CPropManager::ParseEntities()
 {
-	// Entity parser done by me, parses nicely, no errors detected ever.
-	char* pCurText = m_pEntData;
-	while ((pCurText != nullptr) && pCurText - m_pEntData < m_iEntDataSize)
+	// The lump is tokenized once per map and shared with the rest of the
+	// client, the epairs are built from it in lump order so the last value
+	// of a key ends up at the head of the list.
+	if (!gEntityLump.Update(IEngineStudio.GetModelByIndex(1)))
 	{
-		if (m_iNumBSPEntities == MAXRENDERENTS)
-			break;
-
-		while (true)
-		{
-			if (pCurText[0] == '{')
-				break;
-
-			if (pCurText - m_pEntData >= m_iEntDataSize)
-				break;
-
-			pCurText++;
-		}
+		gEngfuncs.Con_Printf("BSP LOADER ERROR :: Entity data is corrupt!\n");
+		m_bAvailable = false;
+		return;
+	}
 
-		if (pCurText - m_pEntData >= m_iEntDataSize)
-			break;
+	m_iNumBSPEntities = V_min(gEntityLump.NumEntities(), MAXRENDERENTS);
 
-		entity_t* pEntity = &m_pBSPEntities[m_iNumBSPEntities];
-		m_iNumBSPEntities++;
+	for (int i = 0; i < m_iNumBSPEntities; i++)
+	{
+		entity_t* pEntity = &m_pBSPEntities[i];
 
-		while (true)
+		for (int j = 0; j < gEntityLump.NumPairs(i); j++)
 		{
-			// skip to next token
-			while (true)
-			{
-				if (pCurText[0] == '}')
-					break;
-
-				if (pCurText[0] == '"')
-				{
-					pCurText++;
-					break;
-				}
-
-				pCurText++;
-			}
-
-			// end of ent
-			if (pCurText[0] == '}')
-				break;
-
 			epair_t* pEPair = new epair_t;
 			memset(pEPair, 0, sizeof(epair_t));
 
@@ -322,75 +289,19 @@ void CPropManager::ParseEntities()
 
 			pEntity->epairs = pEPair;
 
-			int iLength = 0;
-			char* pTemp = pCurText;
-			while (true)
-			{
-				if (pTemp[0] == '"')
-					break;
-
-				if (pCurText[0] == '}')
-				{
-					gEngfuncs.Con_Printf("BSP LOADER ERROR :: Entity data is corrupt!\n");
-					m_bAvailable = false;
-					return;
-				}
-
-				iLength++;
-				pTemp++;
-			}
-
-			pEPair->key = new char[iLength + 1];
-			pEPair->key[iLength] = NULL; // terminator
+			const char* pKey = gEntityLump.Key(i, j);
+			pEPair->key = new char[strlen(pKey) + 1];
+			strcpy(pEPair->key, pKey);
 
-			memcpy(pEPair->key, pCurText, sizeof(char) * iLength);
-			pCurText += iLength + 1;
-
-			// skip to next token
-			while (true)
-			{
-				if (pCurText[0] == '}')
-				{
-					gEngfuncs.Con_Printf("BSP LOADER ERROR :: Entity data is corrupt!\n");
-					m_bAvailable = false;
-					return;
-				}
-
-				if (pCurText[0] == '"')
-				{
-					pCurText++;
-					break;
-				}
-
-				pCurText++;
-			}
-
-			iLength = 0;
-			pTemp = pCurText;
-			while (true)
-			{
-				if (pCurText[0] == '}')
-				{
-					gEngfuncs.Con_Printf("BSP LOADER ERROR :: Entity data is corrupt!\n");
-					m_bAvailable = false;
-					return;
-				}
-
-				if (pTemp[0] == '"')
-					break;
-
-				iLength++;
-				pTemp++;
-			}
-
-			pEPair->value = new char[iLength + 1];
-			pEPair->value[iLength] = NULL;
-
-			memcpy(pEPair->value, pCurText, sizeof(char) * iLength);
-			pCurText += iLength + 1;
+			const char* pValue = gEntityLump.Value(i, j);
+			pEPair->value = new char[strlen(pValue) + 1];
+			strcpy(pEPair->value, pValue);
 		}
 	}
 
+	if (m_iNumBSPEntities == 0)
+		return;
+
 	// Get sky name for bsp renderer
 	char* szSky = ValueForKey(&m_pBSPEntities[0], "skyname");
 
@@ -606,34 +517,26 @@ void CPropManager::LoadEntVars()
 				char szLightTarget[32];
 				strcpy(szLightTarget, pValue);
 
-				int j = 0;
-				for (; j < m_iNumBSPEntities; j++)
+				int j = gEntityLump.FindByTargetname(szLightTarget);
+				for (; j != -1; j = gEntityLump.FindByTargetname(szLightTarget, j))
 				{
-					pValue = ValueForKey(&m_pBSPEntities[j], "classname");
+					pValue = gEntityLump.ValueForKey(j, "classname");
 
-					if (strcmp(pValue, "info_light_origin") != 0)
+					if (pValue == nullptr || strcmp(pValue, "info_light_origin") != 0)
 						continue;
 
-					pValue = ValueForKey(&m_pBSPEntities[j], "targetname");
-
+					pValue = gEntityLump.ValueForKey(j, "origin");
 					if (pValue != nullptr)
 					{
-						if (strcmp(pValue, szLightTarget) == 0)
-						{
-							pValue = ValueForKey(&m_pBSPEntities[j], "origin");
-							if (pValue != nullptr)
-							{
-								sscanf(pValue, "%f %f %f", &m_pCurrentExtraData->lightorigin[0],
-									&m_pCurrentExtraData->lightorigin[1],
-									&m_pCurrentExtraData->lightorigin[2]);
-
-								break;
-							}
-						}
+						sscanf(pValue, "%f %f %f", &m_pCurrentExtraData->lightorigin[0],
+							&m_pCurrentExtraData->lightorigin[1],
+							&m_pCurrentExtraData->lightorigin[2]);
+
+						break;
 					}
 				}
 
-				if (j == m_iNumBSPEntities)
+				if (j == -1)
 				{
 					m_pCurrentExtraData->lightorigin = m_pEntities[m_iNumEntities].origin;
 				}
@@ -891,23 +794,15 @@ bool CPropManager::SetupCable(cabledata_t* cable, entity_t* entity)
 
 	strcpy(sz, pValue);
 
-	for (int i = 0; i < m_iNumBSPEntities; i++)
+	for (int i = gEntityLump.FindByTargetname(sz); i != -1; i = gEntityLump.FindByTargetname(sz, i))
 	{
-		pValue = ValueForKey(&m_pBSPEntities[i], "targetname");
+		const char* pOrigin = gEntityLump.ValueForKey(i, "origin");
 
-		if (pValue == nullptr)
-			continue;
-
-		if (strcmp(pValue, sz) == 0)
-		{
-			pValue = ValueForKey(&m_pBSPEntities[i], "origin");
-
-			if (pValue == nullptr)
-				return false;
+		if (pOrigin == nullptr)
+			return false;
 
-			// Copy origin over
-			sscanf(pValue, "%f %f %f", &vposition2[0], &vposition2[1], &vposition2[2]);
-		}
+		// Copy origin over
+		sscanf(pOrigin, "%f %f %f", &vposition2[0], &vposition2[1], &vposition2[2]);
 	}
 
 	// Get our falling depth
@@ -58,9 +58,6 @@ public:
 	char* ValueForKey(entity_t* ent, const char* key);
 
 public:
-	int m_iEntDataSize;
-	char* m_pEntData;
-
 	bool m_bAvailable;
 
 	// Entity list extracted from BSP.
@@ -27,8 +27,11 @@ Written by Andrew Lucas, Richard Rohac, BUzer, Laurie, Botman and Id Software
 #include "cl_util.h"
 #include "com_model.h"
 #include <string.h>
+#include <vector>
+#include <chrono>
 #include "triangleapi.h"
 #include "event_api.h"
+#include "perf_trace.h"
 
 #include "rendererdefs.h"
 #include "bsprenderer.h"
@@ -839,19 +842,57 @@ void SV_FindTouchedLeafs(entextradata_t* ent, mnode_t* node)
 
 /*
 ===================
-Mod_DecompressVis
+PVS row cache
+
+Decompressed PVS rows of the most recently asked for
+leafs. A frame asks for the same few rows over and over:
+the view, every mirror and water pass putting the world
+back, each spotlight. Rows are 16 byte aligned and padded
+with zeros to a whole number of 128 leafs, so they can be
+read as words of any size. A row stays put until
+PVS_CACHE_ROWS other rows have been asked for, so callers
+can hold on to a few at once.
 ===================
 */
+#define PVS_CACHE_ROWS 32
+
+struct alignas(16) pvsblock_t
+{
+	byte bits[16];
+};
 
-byte* Mod_DecompressVis(byte* in, model_t* model)
+struct pvsrow_t
+{
+	int leaf;
+	unsigned int lastUse;
+};
+
+static pvsrow_t g_PVSRows[PVS_CACHE_ROWS];
+static std::vector<pvsblock_t> g_PVSRowData;
+static int g_iPVSRowBlocks;
+static unsigned int g_iPVSUse;
+
+// world the rows were decompressed from
+static model_t* g_pPVSModel;
+static mleaf_t* g_pPVSLeafs;
+static byte* g_pPVSVisData;
+static int g_iPVSNumLeafs;
+
+/*
+===================
+Mod_DecompressVis
+===================
+*/
+static void Mod_DecompressVis(byte* in, model_t* model, byte* decompressed)
 {
-	static byte decompressed[MAX_MAP_LEAFS / 8];
 	int c;
 	byte* out;
 	int row;
+	byte* end;
 
 	row = (model->numleafs + 7) >> 3;
 	out = decompressed;
+	end = decompressed + g_iPVSRowBlocks * sizeof(pvsblock_t);
 
 	if (in == nullptr)
 	{ // no vis info, so make all visible
@@ -860,7 +901,7 @@ byte* Mod_DecompressVis(byte* in, model_t* model)
 			*out++ = 0xff;
 			row--;
 		}
-		return decompressed;
+		return;
 	}
 
 	do
@@ -873,22 +914,65 @@ byte* Mod_DecompressVis(byte* in, model_t* model)
 
 		c = in[1];
 		in += 2;
-		while (c != 0)
+		while (c != 0 && out < end)
 		{
 			*out++ = 0;
 			c--;
 		}
 	} while (out - decompressed < row);
+}
+
+static void Mod_ResetPVSCache(model_t* model)
+{
+	g_pPVSModel = model;
+	g_pPVSLeafs = model->leafs;
+	g_pPVSVisData = model->visdata;
+	g_iPVSNumLeafs = model->numleafs;
 
-	return decompressed;
+	g_iPVSRowBlocks = (model->numleafs + 127) >> 7;
+	g_PVSRowData.assign(PVS_CACHE_ROWS * g_iPVSRowBlocks, pvsblock_t{});
+
+	for (int i = 0; i < PVS_CACHE_ROWS; i++)
+	{
+		g_PVSRows[i].leaf = -1;
+		g_PVSRows[i].lastUse = 0;
+	}
 }
 
 byte* Mod_LeafPVS(mleaf_t* leaf, model_t* model)
 {
+	if (model != g_pPVSModel || model->leafs != g_pPVSLeafs || model->visdata != g_pPVSVisData || model->numleafs != g_iPVSNumLeafs)
+		Mod_ResetPVSCache(model);
+
+	const int leafnum = leaf - model->leafs;
+	int oldest = 0;
+
+	g_iPVSUse++;
+
+	for (int i = 0; i < PVS_CACHE_ROWS; i++)
+	{
+		if (g_PVSRows[i].leaf == leafnum)
+		{
+			g_PVSRows[i].lastUse = g_iPVSUse;
+			return g_PVSRowData[i * g_iPVSRowBlocks].bits;
+		}
+
+		if (g_PVSRows[i].lastUse < g_PVSRows[oldest].lastUse)
+			oldest = i;
+	}
+
+	byte* row = g_PVSRowData[oldest * g_iPVSRowBlocks].bits;
+	memset(row, 0, g_iPVSRowBlocks * sizeof(pvsblock_t));
+
 	if (leaf == model->leafs)
-		return Mod_DecompressVis(nullptr, model);
+		Mod_DecompressVis(nullptr, model, row);
+	else
+		Mod_DecompressVis(leaf->compressed_vis, model, row);
+
+	g_PVSRows[oldest].leaf = leafnum;
+	g_PVSRows[oldest].lastUse = g_iPVSUse;
 
-	return Mod_DecompressVis(leaf->compressed_vis, model);
+	return row;
 }
 
 /*
@@ -899,12 +983,19 @@ R_MarkLeaves
 void R_MarkLeaves(mleaf_t* pLeaf)
 {
 	model_t* pWorld = IEngineStudio.GetModelByIndex(1);
-	byte* vis = Mod_LeafPVS(pLeaf, pWorld);
+	const unsigned int* vis = (const unsigned int*)Mod_LeafPVS(pLeaf, pWorld);
+	const int numwords = (pWorld->numleafs + 31) >> 5;
 
-	for (int i = 0; i < pWorld->numleafs; i++)
+	// rows are padded to whole words, skip the empty ones
+	for (int w = 0; w < numwords; w++)
 	{
-		if ((vis[i >> 3] & (1 << (i & 7))) != 0)
+		unsigned int bits = vis[w];
+
+		for (int i = w << 5; bits != 0 && i < pWorld->numleafs; i++, bits >>= 1)
 		{
+			if ((bits & 1) == 0)
+				continue;
+
 			mnode_t* node = (mnode_t*)&pWorld->leafs[i + 1];
 			do
 			{
@@ -969,6 +1060,9 @@ R_CalcRefDef
 */
 void R_CalcRefDef(ref_params_t* pparams)
 {
+	// Takes effect from here on, the rest of this frame included
+	g_PerfTrace.SetEnabled(gBSPRenderer.m_pCvarPerfTrace->value > 0);
+
 	// Set this at start
 	RenderFog();
 
@@ -976,13 +1070,22 @@ void R_CalcRefDef(ref_params_t* pparams)
 	gBSPRenderer.SetupPreFrame(pparams);
 
 	// Render shadow maps into depth images
-	gBSPRenderer.DrawShadowPasses();
+	{
+		PERF_SCOPE("shadow passes");
+		gBSPRenderer.DrawShadowPasses();
+	}
 
 	// Render water shader perspectives
-	gWaterShader.DrawWaterPasses(pparams);
+	{
+		PERF_SCOPE("water passes");
+		gWaterShader.DrawWaterPasses(pparams);
+	}
 
 	// Render mirror perspectives
-	gMirrorManager.DrawMirrorPasses(pparams);
+	{
+		PERF_SCOPE("mirror passes");
+		gMirrorManager.DrawMirrorPasses(pparams);
+	}
 
 	// Set up basic rendering
 	gBSPRenderer.RendererRefDef(pparams);
@@ -1081,6 +1184,95 @@ void RenderersDumpInfo()
 		gEngfuncs.Con_Printf("Radial fog not supported.\n");
 }
 
+/*
+====================
+R_CullBench
+
+Times CullBox against CullBoxes on the world leafs and detail
+objects with the current view frustum
+====================
+*/
+void R_CullBench()
+{
+	model_t* pWorld = IEngineStudio.GetModelByIndex(1);
+	if (pWorld == nullptr)
+		return;
+
+	int iIterations = 1000;
+	if (gEngfuncs.Cmd_Argc() > 1)
+		iIterations = V_max(atoi(gEngfuncs.Cmd_Argv(1)), 1);
+
+	cullboxes_t boxes;
+	for (int i = 1; i <= pWorld->numleafs; i++)
+	{
+		mleaf_t* pLeaf = &pWorld->leafs[i];
+		boxes.AddBox(Vector(pLeaf->minmaxs[0], pLeaf->minmaxs[1], pLeaf->minmaxs[2]), Vector(pLeaf->minmaxs[3], pLeaf->minmaxs[4], pLeaf->minmaxs[5]));
+	}
+
+	for (int i = 0; i < gBSPRenderer.m_iNumDetailObjects; i++)
+		boxes.AddBox(gBSPRenderer.m_pDetailObjects[i].mins, gBSPRenderer.m_pDetailObjects[i].maxs);
+
+	const int iNumBoxes = boxes.NumBoxes();
+	if (iNumBoxes == 0)
+		return;
+
+	std::vector<Vector> mins(iNumBoxes), maxs(iNumBoxes);
+	for (int i = 0; i < iNumBoxes; i++)
+	{
+		mins[i] = Vector(boxes.mins[0][i], boxes.mins[1][i], boxes.mins[2][i]);
+		maxs[i] = Vector(boxes.maxs[0][i], boxes.maxs[1][i], boxes.maxs[2][i]);
+	}
+
+	std::vector<byte> scalar(iNumBoxes), batch(iNumBoxes);
+	FrustumCheck& frustum = gHUD.viewFrustum;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int n = 0; n < iIterations; n++)
+	{
+		for (int i = 0; i < iNumBoxes; i++)
+			scalar[i] = frustum.CullBox(mins[i], maxs[i]) ? 1 : 0;
+	}
+	auto middle = std::chrono::steady_clock::now();
+	for (int n = 0; n < iIterations; n++)
+		frustum.CullBoxes(boxes, batch.data());
+	auto end = std::chrono::steady_clock::now();
+
+	int iCulled = 0, iDiffer = 0;
+	for (int i = 0; i < iNumBoxes; i++)
+	{
+		iCulled += scalar[i];
+		if (scalar[i] != batch[i])
+			iDiffer++;
+	}
+
+	double flScalar = std::chrono::duration<double, std::micro>(middle - start).count() / iIterations;
+	double flBatch = std::chrono::duration<double, std::micro>(end - middle).count() / iIterations;
+
+	gEngfuncs.Con_Printf("%i boxes, %i culled, %i iterations\n", iNumBoxes, iCulled, iIterations);
+	gEngfuncs.Con_Printf("CullBox: %.2f us, CullBoxes: %.2f us (%.2fx)\n", flScalar, flBatch, flBatch > 0 ? flScalar / flBatch : 0.0);
+
+	if (iDiffer != 0)
+		gEngfuncs.Con_Printf("%i boxes differ between CullBox and CullBoxes\n", iDiffer);
+}
+
+/*
+====================
+R_PerfTraceDump
+
+Writes what te_perftrace recorded as Chrome trace-event JSON
+====================
+*/
+void R_PerfTraceDump()
+{
+	const char* pszFileName = gEngfuncs.Cmd_Argc() > 1 ? gEngfuncs.Cmd_Argv(1) : "perftrace_client.json";
+	int iCount = g_PerfTrace.Dump(pszFileName, "client");
+
+	if (iCount < 0)
+		gEngfuncs.Con_Printf("Couldn't write %s\n", pszFileName);
+	else
+		gEngfuncs.Con_Printf("Wrote %i zones to %s\n", iCount, pszFileName);
+}
+
 void GenDetail()
 {
 	char szLevelName[64];
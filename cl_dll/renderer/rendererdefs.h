@@ -268,6 +268,8 @@ struct cl_particle_t
 #define MAX_STYLESTRING 64
 #define MAX_DYNLIGHTS 64
 #define MAX_MAP_DETAILOBJECTS 512
+#define SHADOWLIGHT_GRID_BUCKETS 256
+#define SHADOWLIGHT_GRID_CELL 512.0f // must be at least the largest search radius
 #define MAX_DETAIL_TEXTURES 1024
 #define MAX_MAP_LEAFS 65534
 #define DEPTHMAP_RESOLUTION 256
@@ -761,12 +763,14 @@ extern std::string FilenameFromPath(const std::string& inputPath);
 
 extern void MyLookAt(GLdouble eyex, GLdouble eyey, GLdouble eyez, GLdouble centerx, GLdouble centery, GLdouble centerz, GLdouble upx, GLdouble upy, GLdouble upz);
 extern mleaf_t* Mod_PointInLeaf(Vector p, model_t* model);
-extern byte* Mod_LeafPVS(mleaf_t* leaf, model_t* model);
+extern byte* Mod_LeafPVS(mleaf_t* leaf, model_t* model); // cached row, 16 byte aligned and zero padded
 extern void R_MarkLeaves(mleaf_t* pLeaf);
 
 extern void HUD_PrintSpeeds();
 extern void RenderersDumpInfo();
 extern void GenDetail();
+extern void R_CullBench();
+extern void R_PerfTraceDump();
 extern void SetupFlashlight(Vector origin, Vector angles, float time, float frametime);
 extern void ExportWorld();
 
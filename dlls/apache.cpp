@@ -126,6 +126,7 @@ void CApache::Spawn()
 
 	pev->flags |= FL_MONSTER;
 	pev->takedamage = DAMAGE_AIM;
+	UTIL_AutoaimTakeDamageChanged(edict());
 	if (pev->health == 0)
 		pev->health = gSkillData.apacheHealth;
 	pev->max_health = pev->health;
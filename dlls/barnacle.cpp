@@ -113,6 +113,7 @@ void CBarnacle::Spawn()
 	pev->solid = SOLID_SLIDEBOX;
 	pev->movetype = MOVETYPE_NONE;
 	pev->takedamage = DAMAGE_AIM;
+	UTIL_AutoaimTakeDamageChanged(edict());
 	m_bloodColor = BLOOD_COLOR_RED;
 	pev->effects = EF_INVLIGHT; // take light from the ceiling
 	pev->health = 25;
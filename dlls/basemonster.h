@@ -216,6 +216,7 @@ public:
 	bool PopEnemy();
 
 	bool FGetNodeRoute(Vector vecDest);
+	bool FGetNavMeshRoute(const Vector& vecDest);
 
 	inline void TaskComplete()
 	{
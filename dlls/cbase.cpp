@@ -18,6 +18,7 @@
 #include "monsters.h"
 #include "saverestore.h"
 #include "client.h"
+#include "perf_trace.h"
 #include "decals.h"
 #include "gamerules.h"
 #include "game.h"
@@ -76,7 +77,7 @@ static DLL_FUNCTIONS gFunctionTable =
 
 		Sys_Error, //pfnSys_Error				Called when engine has encountered an error
 
-		PM_Move,			//pfnPM_Move
+		ServerPM_Move,		//pfnPM_Move
 		PM_Init,			//pfnPM_Init				Server version of player movement initialization
 		PM_FindTextureType, //pfnPM_FindTextureType
 
@@ -171,6 +172,9 @@ int DispatchSpawn(edict_t* pent)
 		//		pEntity->InitMoveWith(); //LRC
 		pEntity->Spawn();
 
+		if (!FStringNull(pEntity->pev->targetname))
+			UTIL_LocusTargetnamesChanged();
+
 		// Try to get the pointer again, in case the spawn function deleted the entity.
 		// UNDONE: Spawn() should really return a code to ask that the entity be deleted, but
 		// that would touch too much code for me to do that right now.
@@ -215,6 +219,11 @@ void DispatchKeyValue(edict_t* pentKeyvalue, KeyValueData* pkvd)
 
 	EntvarsKeyvalue(VARS(pentKeyvalue), pkvd);
 
+	if (0 != pkvd->fHandled && FStrEq(pkvd->szKeyName, "targetname"))
+		UTIL_LocusTargetnamesChanged();
+	else if (0 != pkvd->fHandled && FStrEq(pkvd->szKeyName, "takedamage"))
+		UTIL_AutoaimTakeDamageChanged(pentKeyvalue);
+
 	// If the key was an entity variable, or there's no class set yet, don't look for the object, it may
 	// not exist yet.
 	if (0 != pkvd->fHandled || pkvd->szClassName == nullptr)
@@ -238,7 +247,10 @@ void DispatchTouch(edict_t* pentTouched, edict_t* pentOther)
 	CBaseEntity* pOther = (CBaseEntity*)GET_PRIVATE(pentOther);
 
 	if ((pEntity != nullptr) && (pOther != nullptr) && ((pEntity->pev->flags | pOther->pev->flags) & FL_KILLME) == 0)
+	{
+		PERF_SCOPE(pEntity->pev->solid == SOLID_TRIGGER ? "trigger touch" : nullptr);
 		pEntity->Touch(pOther);
+	}
 }
 
 
@@ -261,6 +273,7 @@ void DispatchThink(edict_t* pent)
 			ALERT(at_error, "Dormant entity %s is thinking!!\n", STRING(pEntity->pev->classname));
 
 		//if (pEntity->pev->classname) ALERT(at_console, "DispatchThink %s\n", STRING(pEntity->pev->targetname));
+		PERF_SCOPE(FBitSet(pEntity->pev->flags, FL_MONSTER) ? "monster think" : nullptr);
 		pEntity->Think();
 	}
 }
@@ -864,6 +877,8 @@ bool CBaseEntity::Restore(CRestore& restore)
 	if (status)
 		status = restore.ReadFields("BASE", this, m_SaveData, std::size(m_SaveData));
 
+	UTIL_AutoaimTakeDamageChanged(edict());
+
 	if (pev->modelindex != 0 && !FStringNull(pev->model))
 	{
 		Vector mins, maxs;
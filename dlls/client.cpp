@@ -42,6 +42,8 @@
 #include "soundent.h"
 #include "gamerules.h"
 #include "game.h"
+#include "fullpack.h"
+#include "perf_trace.h"
 #include "customentity.h"
 #include "weapons.h"
 #include "weaponinfo.h"
@@ -1204,6 +1206,22 @@ void InitMapLoadingUtils()
 		{ g_MapsToLoad.clear(); });
 }
 
+static void PerfTraceDump()
+{
+	const char* fileName = CMD_ARGC() > 1 ? CMD_ARGV(1) : "perftrace_server.json";
+	const int count = g_PerfTrace.Dump(fileName, "server");
+
+	if (count < 0)
+		ALERT(at_console, "Couldn't write %s\n", fileName);
+	else
+		ALERT(at_console, "Wrote %d zones to %s\n", count, fileName);
+}
+
+void InitPerfTrace()
+{
+	g_engfuncs.pfnAddServerCommand("sv_perftrace_dump", &PerfTraceDump);
+}
+
 static bool g_LastAllowBunnyHoppingState = false;
 
 //
@@ -1211,6 +1229,9 @@ static bool g_LastAllowBunnyHoppingState = false;
 //
 void StartFrame()
 {
+	g_PerfTrace.SetEnabled(sv_perftrace.value != 0);
+	PERF_SCOPE("StartFrame");
+
 	if (g_pGameRules != nullptr)
 		g_pGameRules->Think();
 
@@ -1528,6 +1549,7 @@ void SetupVisibility(edict_t* pViewEntity, edict_t* pClient, unsigned char** pvs
 	{
 		*pvs = nullptr; // the spectator proxy sees
 		*pas = nullptr; // and hears everything
+		g_FullPackCache.BeginClient(pClient, nullptr);
 		return;
 	}
 
@@ -1539,6 +1561,8 @@ void SetupVisibility(edict_t* pViewEntity, edict_t* pClient, unsigned char** pvs
 
 	*pvs = ENGINE_SET_PVS((float*)&org);
 	*pas = ENGINE_SET_PAS((float*)&org);
+
+	g_FullPackCache.BeginClient(pClient, *pvs);
 }
 
 #include "entity_state.h"
@@ -1567,10 +1591,6 @@ int AddToFullPack(struct entity_state_s* state, int e, edict_t* ent, edict_t* ho
 		return 0;
 	}
 
-	int i;
-
-	auto entity = reinterpret_cast<CBaseEntity*>(GET_PRIVATE(ent));
-
 	// don't send if flagged for NODRAW and it's not the host getting the message
 	if ((ent->v.effects & EF_NODRAW) != 0 &&
 		(ent != host))
@@ -1591,7 +1611,7 @@ int AddToFullPack(struct entity_state_s* state, int e, edict_t* ent, edict_t* ho
 // RENDERERS START
 	if (ent != host && ent->v.renderfx != 70)
 	{
-		if (!ENGINE_CHECK_VISIBILITY((const struct edict_s*)ent, pSet))
+		if (!g_FullPackCache.CheckVisibility(ent, e, pSet))
 		{
 			return 0;
 		}
@@ -1628,6 +1648,22 @@ int AddToFullPack(struct entity_state_s* state, int e, edict_t* ent, edict_t* ho
 		UTIL_UnsetGroupTrace();
 	}
 
+	g_FullPackCache.CopyState(state, e, ent, player);
+
+	return 1;
+}
+
+/*
+FillEntityState
+
+Fills in the state sent for ent, which is the same for every client
+*/
+void FillEntityState(struct entity_state_s* state, int e, edict_t* ent, int player)
+{
+	int i;
+
+	auto entity = reinterpret_cast<CBaseEntity*>(GET_PRIVATE(ent));
+
 	memset(state, 0, sizeof(*state));
 
 	// Assign index so we can track this entity from frame to frame and
@@ -1764,8 +1800,6 @@ int AddToFullPack(struct entity_state_s* state, int e, edict_t* ent, edict_t* ho
 		state->eflags |= EFLAG_FLESH_SOUND;
 	else
 		state->eflags &= ~EFLAG_FLESH_SOUND;
-
-	return 1;
 }
 
 /*
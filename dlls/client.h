@@ -25,6 +25,7 @@ extern void ClientUserInfoChanged(edict_t* pEntity, char* infobuffer);
 extern void ServerActivate(edict_t* pEdictList, int edictCount, int clientMax);
 extern void ServerDeactivate();
 void InitMapLoadingUtils();
+void InitPerfTrace();
 extern void StartFrame();
 extern void PlayerPostThink(edict_t* pEntity);
 extern void PlayerPreThink(edict_t* pEntity);
@@ -45,6 +46,7 @@ extern void Sys_Error(const char* error_string);
 extern void SetupVisibility(edict_t* pViewEntity, edict_t* pClient, unsigned char** pvs, unsigned char** pas);
 extern void UpdateClientData(const struct edict_s* ent, int sendweapons, struct clientdata_s* cd);
 extern int AddToFullPack(struct entity_state_s* state, int e, edict_t* ent, edict_t* host, int hostflags, int player, unsigned char* pSet);
+extern void FillEntityState(struct entity_state_s* state, int e, edict_t* ent, int player);
 extern void CreateBaseline(int player, int eindex, struct entity_state_s* baseline, struct edict_s* entity, int playermodelindex, Vector* player_mins, Vector* player_maxs);
 extern void RegisterEncoders();
 
@@ -53,6 +55,8 @@ extern int GetWeaponData(struct edict_s* player, struct weapon_data_s* info);
 extern void CmdStart(const edict_t* player, const struct usercmd_s* cmd, unsigned int random_seed);
 extern void CmdEnd(const edict_t* player);
 
+extern void ServerPM_Move(struct playermove_s* ppmove, qboolean server);
+
 extern int ConnectionlessPacket(const struct netadr_s* net_from, const char* args, char* response_buffer, int* response_buffer_size);
 
 extern int GetHullBounds(int hullnumber, float* mins, float* maxs);
@@ -2164,6 +2164,7 @@ void CGibShooter::ShootThink()
 		if (pGib != nullptr)
 		{
 			pGib->pev->targetname = m_iszTargetname;
+			UTIL_LocusTargetnamesChanged();
 			//			pGib->pev->velocity = vecShootDir * flGibVelocity;
 
 			if ((pev->spawnflags & SF_GIBSHOOTER_DEBUG) != 0)
@@ -0,0 +1,129 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+//=========================================================
+// fullpack.cpp - per frame work behind AddToFullPack
+//=========================================================
+
+#include <cstring>
+
+#include "extdll.h"
+#include "util.h"
+#include "client.h"
+#include "game.h"
+#include "fullpack.h"
+
+CFullPackCache g_FullPackCache;
+
+enum
+{
+	FULLPACK_ASK_ENGINE = 0, // not classified, ENGINE_CHECK_VISIBILITY decides
+	FULLPACK_VISIBLE,
+	FULLPACK_HIDDEN
+};
+
+//=========================================================
+// LeafVisible - the engine's test for entities that touch
+// few enough leafs to list them in leafnums
+//=========================================================
+static bool LeafVisible(const edict_t* ent, const unsigned char* pSet)
+{
+	for (int i = 0; i < ent->num_leafs; i++)
+	{
+		const int leaf = ent->leafnums[i];
+
+		if ((pSet[leaf >> 3] & (1 << (leaf & 7))) != 0)
+			return true;
+	}
+
+	return false;
+}
+
+//=========================================================
+// BeginClient - called from SetupVisibility before the
+// engine packs the entities for pClient
+//=========================================================
+void CFullPackCache::BeginClient(edict_t* pClient, unsigned char* pvs)
+{
+	const int client = ENTINDEX(pClient);
+
+	// the engine sets up the clients in order, once a frame
+	if (client <= m_iLastClient || gpGlobals->time != m_flPassTime)
+	{
+		m_iPass++;
+		m_flPassTime = gpGlobals->time;
+	}
+
+	m_iLastClient = client;
+	m_pClassifiedSet = nullptr;
+
+	if (pvs == nullptr || sv_fullpackcache.value == 0)
+		return;
+
+	const int count = gpGlobals->maxEntities;
+
+	if ((int)m_Visibility.size() < count)
+		m_Visibility.resize(count);
+
+	edict_t* pEdict = g_engfuncs.pfnPEntityOfEntIndex(0);
+	for (int e = 0; e < count; e++, pEdict++)
+	{
+		// entities without a model are never sent, and the ones touching too
+		// many leafs need the engine to walk the tree from their headnode
+		if (0 != pEdict->free || 0 == pEdict->v.modelindex || pEdict->headnode != -1 || pEdict->num_leafs > MAX_ENT_LEAFS)
+			m_Visibility[e] = FULLPACK_ASK_ENGINE;
+		else
+			m_Visibility[e] = LeafVisible(pEdict, pvs) ? FULLPACK_VISIBLE : FULLPACK_HIDDEN;
+	}
+
+	m_pClassifiedSet = pvs;
+}
+
+//=========================================================
+// CheckVisibility - ENGINE_CHECK_VISIBILITY, answered from
+// the classification when pSet is the set it was made with
+//=========================================================
+bool CFullPackCache::CheckVisibility(edict_t* ent, int e, unsigned char* pSet)
+{
+	if (pSet == nullptr || pSet != m_pClassifiedSet || e >= (int)m_Visibility.size() || m_Visibility[e] == FULLPACK_ASK_ENGINE)
+		return 0 != ENGINE_CHECK_VISIBILITY(ent, pSet);
+
+	return m_Visibility[e] == FULLPACK_VISIBLE;
+}
+
+//=========================================================
+// CopyState - fills state the way AddToFullPack always has,
+// from the copy made the first time e was packed this pass
+//=========================================================
+void CFullPackCache::CopyState(entity_state_t* state, int e, edict_t* ent, int player)
+{
+	if (sv_fullpackcache.value == 0 || e >= gpGlobals->maxEntities)
+	{
+		FillEntityState(state, e, ent, player);
+		return;
+	}
+
+	if ((int)m_States.size() < gpGlobals->maxEntities)
+		m_States.resize(gpGlobals->maxEntities);
+
+	cachedstate_t& cached = m_States[e];
+
+	if (cached.pass != m_iPass)
+	{
+		FillEntityState(&cached.state, e, ent, player);
+		cached.pass = m_iPass;
+	}
+
+	memcpy(state, &cached.state, sizeof(*state));
+}
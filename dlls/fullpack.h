@@ -0,0 +1,53 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+
+#include <vector>
+
+#include "entity_state.h"
+
+//=========================================================
+// CFullPackCache - the engine calls AddToFullPack for every
+// entity once per client, but most of an entity's state is
+// the same for all of them. The state is filled in the first
+// time an entity is packed in a frame and copied out after
+// that. SetupVisibility classifies the entities against the
+// client's PVS in one pass over the edicts.
+//=========================================================
+class CFullPackCache
+{
+public:
+	void BeginClient(edict_t* pClient, unsigned char* pvs);
+	bool CheckVisibility(edict_t* ent, int e, unsigned char* pSet);
+	void CopyState(entity_state_t* state, int e, edict_t* ent, int player);
+
+private:
+	struct cachedstate_t
+	{
+		int pass; // state is only good for this pass over the clients
+		entity_state_t state;
+	};
+
+	int m_iPass = 0;
+	int m_iLastClient = 0;
+	float m_flPassTime = -1;
+
+	unsigned char* m_pClassifiedSet = nullptr;
+	std::vector<unsigned char> m_Visibility; // FULLPACK_* for each edict
+	std::vector<cachedstate_t> m_States;
+};
+
+extern CFullPackCache g_FullPackCache;
@@ -945,7 +945,10 @@ void CBreakable::Die()
 
 	// If I'm getting removed, don't fire something that could fire myself
 	if (m_iRespawnTime == 0)
+	{
 		pev->targetname = 0;
+		UTIL_LocusTargetnamesChanged();
+	}
 
 	pev->solid = SOLID_NOT;
 	pev->effects |= EF_NODRAW;
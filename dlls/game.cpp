@@ -17,6 +17,7 @@
 #include "util.h"
 #include "client.h"
 #include "game.h"
+#include "saverestore.h"
 #include "filesystem_utils.h"
 
 cvar_t displaysoundlist = {"displaysoundlist", "0"};
@@ -66,6 +67,18 @@ cvar_t mp_chattime = {"mp_chattime", "10", FCVAR_SERVER};
 
 cvar_t sv_allowbunnyhopping = {"sv_allowbunnyhopping", "0", FCVAR_SERVER};
 
+cvar_t monster_navmesh = {"monster_navmesh", "0", FCVAR_SERVER}; // route monsters over maps/<map>.nav when present
+
+cvar_t sv_pmrecord = {"sv_pmrecord", ""}; // record the first player's movement to this file for utils/pmreplay
+
+cvar_t sv_fullpackcache = {"sv_fullpackcache", "1", FCVAR_SERVER}; // fill entity states once per frame instead of once per client
+
+cvar_t sv_aimregistry = {"sv_aimregistry", "1", FCVAR_SERVER}; // autoaim picks from a registry of aimable entities, culled by view cone
+
+cvar_t sv_pathtables = {"sv_pathtables", "1", FCVAR_SERVER}; // trains skip along path_tracks with cached segment lengths
+
+cvar_t sv_perftrace = {"sv_perftrace", "0"}; // record frame stage timings for sv_perftrace_dump
+
 //CVARS FOR SKILL LEVEL SETTINGS
 // Agrunt
 cvar_t sk_agrunt_health1 = {"sk_agrunt_health1", "0"};
@@ -557,6 +570,18 @@ void GameDLLInit()
 
 	CVAR_REGISTER(&sv_allowbunnyhopping);
 
+	CVAR_REGISTER(&monster_navmesh);
+
+	CVAR_REGISTER(&sv_pmrecord);
+
+	CVAR_REGISTER(&sv_fullpackcache);
+
+	CVAR_REGISTER(&sv_aimregistry);
+
+	CVAR_REGISTER(&sv_pathtables);
+
+	CVAR_REGISTER(&sv_perftrace);
+
 	// REGISTER CVARS FOR SKILL LEVEL STUFF
 	// Agrunt
 	CVAR_REGISTER(&sk_agrunt_health1); // {"sk_agrunt_health1","0"};
@@ -966,6 +991,8 @@ void GameDLLInit()
 	CVAR_REGISTER(&sv_pushable_fixed_tick_fudge);
 
 	InitMapLoadingUtils();
+	InitSaveRestoreBenchmark();
+	InitPerfTrace();
 
 	SERVER_COMMAND("exec skill.cfg\n");
 }
@@ -43,6 +43,17 @@ extern cvar_t mp_chattime;
 
 extern cvar_t sv_allowbunnyhopping;
 
+extern cvar_t monster_navmesh;
+
+extern cvar_t sv_pmrecord;
+
+extern cvar_t sv_fullpackcache;
+
+extern cvar_t sv_aimregistry;
+
+extern cvar_t sv_pathtables;
+extern cvar_t sv_perftrace;
+
 extern cvar_t sv_busters;
 
 // Engine Cvars
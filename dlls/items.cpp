@@ -95,6 +95,7 @@ void CWorldItem::Spawn()
 		pEntity->pev->target = pev->target;
 		pEntity->pev->targetname = pev->targetname;
 		pEntity->pev->spawnflags = pev->spawnflags;
+		UTIL_LocusTargetnamesChanged();
 	}
 
 	REMOVE_ENTITY(edict());
@@ -6,6 +6,10 @@
 // Spirit of Half-Life's particle system uses "locus triggers" to tell
 // entities where to perform their actions.
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "extdll.h"
 #include "util.h"
 #include "cbase.h"
@@ -35,17 +39,151 @@ public:
 };
 
 
+//=============================================
+// Compiled locus expressions
+//=============================================
+
+// Locus keyvalues ("1 2 3", "calc_foo(*locus)", "0..1" and so on) are compiled
+// into a small expression tree the first time they're evaluated. The tree is
+// cached against the string it came from, so subsequent evaluations are just a
+// walk of the tree, with plain targetname references already resolved.
+
+enum locuskind_e
+{
+	LKIND_POSITION = 0,
+	LKIND_VELOCITY,
+	LKIND_PYR,
+	LKIND_NUMBER,
+	LKIND_NUMBER_NONRANDOM,
+	LKIND_PARAMETER,
+};
+
+enum locusop_e
+{
+	LOP_CONSTANT = 0, // flValue
+	LOP_SWIZZLE,	  // flValue * swizzleBasis[iComponent]
+	LOP_PITCH,		  // flValue * pitch of swizzleBasis
+	LOP_YAW,		  // flValue * yaw of swizzleBasis
+	LOP_LENGTH,		  // flValue * length of swizzleBasis
+	LOP_RANGE,		  // random number between pChild[0] and pChild[1]
+	LOP_COMPONENTS,	  // vector built from pChild[0..5]; iComponent is the number of components
+	LOP_ORIGIN,		  // origin of the calling entity
+	LOP_ZERO,		  // 0 0 0
+	LOP_BASIS,		  // the swizzle basis itself
+	LOP_REFERENCE,	  // ask the entity named szName, with an optional "(param)" in pParam
+};
+
+#define LOCUS_MAX_COMPONENTS 6
+#define LOCUS_MAX_CACHED 4096
+
+struct locusnode_t
+{
+	~locusnode_t()
+	{
+		for (int i = 0; i < LOCUS_MAX_COMPONENTS; i++)
+			delete pChild[i];
+		delete pParam;
+	}
+
+	locusop_e op;
+	locuskind_e kind; // for LOP_REFERENCE, which Calc function to call
+	int iComponent;
+	float flValue;
+	locusnode_t* pChild[LOCUS_MAX_COMPONENTS];
+	locusnode_t* pParam;
+
+	// LOP_REFERENCE only
+	std::string name;
+	bool fIsLocus;	 // "*locus"
+	bool fIsDynamic; // aliases and group references have to be followed every time
+	bool fHadTarget;
+	int iTargetSerial;
+	EHANDLE hTarget;
+};
+
+// bumped whenever an entity's targetname might have changed, so that resolved references get looked up again.
+static int g_iLocusTargetSerial = 1;
+
+struct locuscachekey_t
+{
+	const char* szText;
+	int iFlags;
+
+	bool operator==(const locuscachekey_t& other) const { return szText == other.szText && iFlags == other.iFlags; }
+};
+
+struct locuscachekeyhash_t
+{
+	std::size_t operator()(const locuscachekey_t& key) const { return std::hash<const char*>()(key.szText) ^ key.iFlags; }
+};
+
+struct locuscacheentry_t
+{
+	std::string source; // the text this was compiled from; strings like cvar values can change under the same pointer
+	locusnode_t* pRoot;
+};
+
+static std::unordered_map<locuscachekey_t, locuscacheentry_t, locuscachekeyhash_t> g_LocusCache;
+
+// Calc entities evaluate other locus strings from inside an evaluation, so trees that
+// get replaced while that's going on can't be freed until we're back at the top.
+static std::vector<locusnode_t*> g_LocusRetired;
+static int g_iLocusEvalDepth = 0;
+
+static void LocusFreeRetired()
+{
+	for (locusnode_t* pNode : g_LocusRetired)
+		delete pNode;
+
+	g_LocusRetired.clear();
+}
+
+void UTIL_FlushLocusCache()
+{
+	for (auto& entry : g_LocusCache)
+		delete entry.second.pRoot;
+
+	g_LocusCache.clear();
+	LocusFreeRetired();
+	g_iLocusTargetSerial++;
+}
+
+void UTIL_LocusTargetnamesChanged()
+{
+	g_iLocusTargetSerial++;
+}
+
+static locusnode_t* LocusNewNode(locusop_e op)
+{
+	locusnode_t* pNode = new locusnode_t();
+	pNode->op = op;
+	return pNode;
+}
+
+static locusnode_t* LocusCompile(locuskind_e kind, const char* szText, bool fSwizzle, bool isPYR);
+
+static locusnode_t* LocusCompileReference(locuskind_e kind, const char* szName, locusnode_t* pParam)
+{
+	locusnode_t* pNode = LocusNewNode(LOP_REFERENCE);
+	pNode->kind = kind;
+	pNode->name = szName;
+	pNode->pParam = pParam;
+	pNode->fIsLocus = FStrEq(szName, "*locus");
+	pNode->fIsDynamic = szName[0] == 0 || szName[0] == '*' || strchr(szName, '.') != nullptr;
+	return pNode;
+}
+
 //LRC 1.8
 // randomized vectors can be written in two ways:
 // '0 0 0 .. 1 1 1' or '0..1 0..1 0..1'.
 // the former is a lerp based on a single random choice (e.g. 0.42 0.42 0.42),
 // the latter is three random choices (e.g. 0.42 0.73 0.11).
-bool TryParseVectorComponentwise(CBaseEntity* pLocus, const char* szText, Vector* OUTresult, Vector* swizzleBasis = nullptr, bool isPYR = false)
+static locusnode_t* LocusCompileComponentwise(const char* szText, bool fSwizzle, bool isPYR)
 {
 	int nextComponentNameStart = 0;
 	int nextVectorComponent = 0;
-	float vecResult[6] = {0, 0, 0, 0, 0, 0};
 	int inBrackets = 0;
+	locusnode_t* pNode = LocusNewNode(LOP_COMPONENTS);
 
 	for (int i = 0; szText[i] != 0; i++)
 	{
@@ -60,12 +198,9 @@ bool TryParseVectorComponentwise(CBaseEntity* pLocus, const char* szText, Vector
 		else if (inBrackets == 0 && (szText[i] == ' ' || szText[i] == '\t' || szText[i] == ','))
 		{
 			// Ah, it's a vector.
-			char szComponentName[128];
-
-			strncpy(szComponentName, &szText[nextComponentNameStart], i);
-			szComponentName[i - nextComponentNameStart] = 0;
+			std::string componentName(&szText[nextComponentNameStart], i - nextComponentNameStart);
 
-			if (strcmp(szComponentName, "..") == 0)
+			if (componentName == "..")
 			{
 				if (nextVectorComponent > 3)
 				{
@@ -78,15 +213,13 @@ bool TryParseVectorComponentwise(CBaseEntity* pLocus, const char* szText, Vector
 			}
 			else
 			{
-				bool Handled = false;
-
-				if (nextVectorComponent >= 6)
+				if (nextVectorComponent >= LOCUS_MAX_COMPONENTS)
 				{
 					ALERT(at_error, "LV \"%s\" has too many vector components\n", szText);
 				}
 				else
 				{
-					vecResult[nextVectorComponent] = CalcLocus_Number(pLocus, szComponentName, swizzleBasis, isPYR);
+					pNode->pChild[nextVectorComponent] = LocusCompile(LKIND_NUMBER, componentName.c_str(), fSwizzle, isPYR);
 				}
 				nextVectorComponent++;
 			}
@@ -99,38 +232,30 @@ bool TryParseVectorComponentwise(CBaseEntity* pLocus, const char* szText, Vector
 		}
 	}
 
-	if (nextVectorComponent > 0)
+	if (nextVectorComponent == 0)
 	{
-		if (nextVectorComponent >= 6)
-		{
-			ALERT(at_error, "LV \"%s\" has too many vector components\n", szText);
-		}
-		vecResult[nextVectorComponent] = CalcLocus_Number(pLocus, &szText[nextComponentNameStart], swizzleBasis, isPYR);
-
-		if (nextVectorComponent >= 3)
-		{
-			// random lerp, but all three components use the same amount
-			float lerpfactor = RANDOM_FLOAT(0, 1);
-			OUTresult->x = UTIL_Lerp(lerpfactor, vecResult[0], vecResult[3]);
-			OUTresult->y = UTIL_Lerp(lerpfactor, vecResult[1], vecResult[4]);
-			OUTresult->z = UTIL_Lerp(lerpfactor, vecResult[2], vecResult[5]);
-		}
-		else
-		{
-			OUTresult->x = vecResult[0];
-			OUTresult->y = vecResult[1];
-			OUTresult->z = vecResult[2];
-		}
+		delete pNode;
+		return nullptr;
+	}
 
-		return true;
+	if (nextVectorComponent >= LOCUS_MAX_COMPONENTS)
+	{
+		ALERT(at_error, "LV \"%s\" has too many vector components\n", szText);
 	}
-	return false;
+	else
+	{
+		pNode->pChild[nextVectorComponent] = LocusCompile(LKIND_NUMBER, &szText[nextComponentNameStart], fSwizzle, isPYR);
+	}
+
+	pNode->iComponent = nextVectorComponent;
+	return pNode;
 }
 
-bool TryParseLocusBrackets(CBaseEntity* pLocus, const char* szText, char* OUTszPreBracket, char* OUTszPostBracket, Vector* swizzleBasis = nullptr, bool isPYR = false)
+// splits "name(param)" into its two halves
+static bool LocusSplitBrackets(const char* szText, std::string& preBracket, std::string& postBracket)
 {
 	int numBrackets = 0;
-	int bracketStartIdx;
+	int bracketStartIdx = 0;
 
 	for (int i = 0; szText[i] != 0; i++)
 	{
@@ -139,9 +264,7 @@ bool TryParseLocusBrackets(CBaseEntity* pLocus, const char* szText, char* OUTszP
 			numBrackets++;
 			if (numBrackets == 1)
 			{
-				strncpy(OUTszPreBracket, szText, i);
-				OUTszPreBracket[i] = 0;
-
+				preBracket.assign(szText, i);
 				bracketStartIdx = i + 1;
 			}
 		}
@@ -154,8 +277,7 @@ bool TryParseLocusBrackets(CBaseEntity* pLocus, const char* szText, char* OUTszP
 			}
 			else if (numBrackets == 0)
 			{
-				strncpy(OUTszPostBracket, &szText[bracketStartIdx], i - bracketStartIdx);
-				OUTszPostBracket[i - bracketStartIdx] = 0;
+				postBracket.assign(&szText[bracketStartIdx], i - bracketStartIdx);
 				return true;
 			}
 		}
@@ -163,7 +285,8 @@ bool TryParseLocusBrackets(CBaseEntity* pLocus, const char* szText, char* OUTszP
 	return false;
 }
 
-bool TryParseLocusNumber(const char* szText, float* OUTnumber, Vector* swizzleBasis, bool isPYR)
+// literal numbers, and the swizzle names "x", "PITCH" etc. Returns null if szText isn't one of those.
+static locusnode_t* LocusCompileLiteral(const char* szText, bool fSwizzle, bool isPYR)
 {
 	float factor = 1;
 	if (szText[0] == '-')
@@ -172,278 +295,479 @@ bool TryParseLocusNumber(const char* szText, float* OUTnumber, Vector* swizzleBa
 		szText++;
 	}
 
-	if (swizzleBasis != nullptr)
+	locusnode_t* pNode = nullptr;
+
+	if (fSwizzle)
 	{
-		if (szText[1] == 0)
+		if (szText[0] != 0 && szText[1] == 0)
 		{
 			// if we're swizzling a vector, handle the special "x" "y" and "z" strings
+			int component = -1;
 			switch (szText[0])
 			{
 			case 'x':
 			case 'X':
-				if (isPYR)
-					break;
-
-				*OUTnumber = factor * swizzleBasis->x;
-				return true;
+				if (!isPYR)
+					component = 0;
+				break;
 
 			case 'y':
 			case 'Y':
-				*OUTnumber = factor * swizzleBasis->y;
-				return true;
+				component = 1;
+				break;
 
 			case 'z':
 			case 'Z':
-				if (isPYR)
-					break;
-
-				*OUTnumber = factor * swizzleBasis->z;
-				return true;
+				if (!isPYR)
+					component = 2;
+				break;
 
 			case 'p':
 			case 'P':
-				if (!isPYR)
-					break;
-
-				*OUTnumber = factor * swizzleBasis->x;
-				return true;
+				if (isPYR)
+					component = 0;
+				break;
 
 			case 'r':
 			case 'R':
-				if (!isPYR)
-					break;
+				if (isPYR)
+					component = 2;
+				break;
+			}
 
-				*OUTnumber = factor * swizzleBasis->z;
-				return true;
+			if (component != -1)
+			{
+				pNode = LocusNewNode(LOP_SWIZZLE);
+				pNode->iComponent = component;
 			}
 		}
 		// also allow these useful properties
 		else if (!isPYR)
 		{
 			if (FStrEq(szText, "PITCH"))
-			{
-				Vector ang = UTIL_VecToAngles(*swizzleBasis);
-				*OUTnumber = factor * ang.x;
-				return true;
-			}
+				pNode = LocusNewNode(LOP_PITCH);
 			else if (FStrEq(szText, "YAW"))
-			{
-				Vector ang = UTIL_VecToAngles(*swizzleBasis);
-				*OUTnumber = factor * ang.y;
-				return true;
-			}
+				pNode = LocusNewNode(LOP_YAW);
 			else if (FStrEq(szText, "LENGTH"))
-			{
-				*OUTnumber = factor * swizzleBasis->Length();
-				return true;
-			}
+				pNode = LocusNewNode(LOP_LENGTH);
+		}
+
+		if (pNode != nullptr)
+		{
+			pNode->flValue = factor;
+			return pNode;
 		}
 	}
 
 	if (*szText >= '0' && *szText <= '9')
 	{ // assume it's a float
-		*OUTnumber = factor * atof(szText);
-		return true;
+		pNode = LocusNewNode(LOP_CONSTANT);
+		pNode->flValue = factor * atof(szText);
+		return pNode;
 	}
 
-	return false;
+	return nullptr;
 }
 
+static locusnode_t* LocusCompileNonRandom(const char* szText, bool fSwizzle, bool isPYR)
+{
+	locusnode_t* pNode = LocusCompileLiteral(szText, fSwizzle, isPYR);
+	if (pNode != nullptr)
+		return pNode;
 
+	std::string preBracket, postBracket;
+	if (LocusSplitBrackets(szText, preBracket, postBracket))
+		return LocusCompileReference(LKIND_NUMBER, preBracket.c_str(), LocusCompile(LKIND_PARAMETER, postBracket.c_str(), fSwizzle, isPYR));
 
-CBaseEntity* CalcLocusParameter(CBaseEntity* pLocus, const char* szParamName, Vector* swizzleBasis, bool isPYR)
+	return LocusCompileReference(LKIND_NUMBER, szText, nullptr);
+}
+
+static locusnode_t* LocusCompile(locuskind_e kind, const char* szText, bool fSwizzle, bool isPYR)
+{
+	locusnode_t* pNode;
+	std::string preBracket, postBracket;
+
+	switch (kind)
+	{
+	case LKIND_POSITION:
+		// blank = the entity's own origin
+		if (szText[0] == 0)
+			return LocusNewNode(LOP_ORIGIN);
+
+		if ((pNode = LocusCompileComponentwise(szText, false, false)) != nullptr)
+			return pNode;
+
+		if (LocusSplitBrackets(szText, preBracket, postBracket))
+			return LocusCompileReference(kind, preBracket.c_str(), LocusCompile(LKIND_PARAMETER, postBracket.c_str(), false, false));
+
+		return LocusCompileReference(kind, szText, nullptr);
+
+	case LKIND_VELOCITY:
+		// blank = 0 0 0
+		if (szText[0] == 0)
+			return LocusNewNode(LOP_ZERO);
+
+		if (fSwizzle && FStrEq(szText, "X Y Z"))
+			return LocusNewNode(LOP_BASIS);
+
+		if ((pNode = LocusCompileComponentwise(szText, fSwizzle, false)) != nullptr)
+			return pNode;
+
+		if (LocusSplitBrackets(szText, preBracket, postBracket))
+			return LocusCompileReference(kind, preBracket.c_str(), LocusCompile(LKIND_PARAMETER, postBracket.c_str(), fSwizzle, false));
+
+		return LocusCompileReference(kind, szText, nullptr);
+
+	case LKIND_PYR:
+		if (fSwizzle && FStrEq(szText, "P Y R"))
+			return LocusNewNode(LOP_BASIS);
+
+		if ((pNode = LocusCompileComponentwise(szText, fSwizzle, true)) != nullptr)
+			return pNode;
+
+		return LocusCompileReference(kind, szText, nullptr);
+
+	case LKIND_NUMBER:
+		// blank = 0
+		if (szText[0] == 0)
+			return LocusNewNode(LOP_CONSTANT);
+
+		//LRC 1.8 - randomized ratios
+		for (int i = 0; szText[i] != 0; i++)
+		{
+			if (szText[i] == '.' && szText[i + 1] == '.')
+			{
+				// found a '..': it's a random value from a range
+				std::string componentName(szText, i);
+
+				pNode = LocusNewNode(LOP_RANGE);
+				pNode->pChild[0] = LocusCompileNonRandom(componentName.c_str(), fSwizzle, isPYR);
+				pNode->pChild[1] = LocusCompileNonRandom(&szText[i + 2], fSwizzle, isPYR);
+				return pNode;
+			}
+		}
+
+		return LocusCompileNonRandom(szText, fSwizzle, isPYR);
+
+	case LKIND_NUMBER_NONRANDOM:
+		return LocusCompileNonRandom(szText, fSwizzle, isPYR);
+
+	case LKIND_PARAMETER:
+		if ((pNode = LocusCompileComponentwise(szText, fSwizzle, isPYR)) != nullptr)
+			return pNode;
+
+		if ((pNode = LocusCompileLiteral(szText, fSwizzle, isPYR)) != nullptr)
+			return pNode;
+
+		return LocusCompileReference(kind, szText, nullptr);
+	}
+
+	return nullptr;
+}
+
+static locusnode_t* LocusLookup(locuskind_e kind, const char* szText, Vector* swizzleBasis, bool isPYR)
+{
+	const bool fSwizzle = swizzleBasis != nullptr;
+	const locuscachekey_t key = {szText, kind | (fSwizzle ? 8 : 0) | (isPYR ? 16 : 0)};
+
+	if (g_iLocusEvalDepth == 0 && !g_LocusRetired.empty())
+		LocusFreeRetired();
+
+	auto it = g_LocusCache.find(key);
+	if (it != g_LocusCache.end())
+	{
+		if (it->second.source == szText)
+			return it->second.pRoot;
+
+		// same buffer, different text; compile it again
+		g_LocusRetired.push_back(it->second.pRoot);
+		g_LocusCache.erase(it);
+	}
+
+	if (g_LocusCache.size() >= LOCUS_MAX_CACHED)
+	{
+		for (auto& entry : g_LocusCache)
+			g_LocusRetired.push_back(entry.second.pRoot);
+
+		g_LocusCache.clear();
+	}
+
+	locuscacheentry_t& entry = g_LocusCache[key];
+	entry.source = szText;
+	entry.pRoot = LocusCompile(kind, szText, fSwizzle, isPYR);
+	return entry.pRoot;
+}
+
+static CBaseEntity* LocusResolve(locusnode_t* pNode, CBaseEntity* pLocus)
+{
+	if (pNode->fIsLocus)
+		return pLocus;
+
+	if (pNode->fIsDynamic)
+		return UTIL_FindEntityByTargetname(nullptr, pNode->name.c_str(), pLocus);
+
+	// look the name up again if targetnames have changed, or if the entity we found has gone away
+	if (pNode->iTargetSerial != g_iLocusTargetSerial || (pNode->fHadTarget && pNode->hTarget == nullptr))
+	{
+		pNode->hTarget = UTIL_FindEntityByTargetname(nullptr, pNode->name.c_str());
+		pNode->fHadTarget = pNode->hTarget != nullptr;
+		pNode->iTargetSerial = g_iLocusTargetSerial;
+	}
+
+	return pNode->hTarget;
+}
+
+static bool LocusEvalNumber(locusnode_t* pNode, CBaseEntity* pLocus, float* OUTresult, Vector* swizzleBasis);
+
+static bool LocusEvalComponentwise(locusnode_t* pNode, CBaseEntity* pLocus, Vector* OUTresult, Vector* swizzleBasis)
 {
-	Vector tryVectorResult;
-	float tryNumberResult;
+	float vecResult[LOCUS_MAX_COMPONENTS] = {0, 0, 0, 0, 0, 0};
 
-	if (TryParseVectorComponentwise(pLocus, szParamName, &tryVectorResult, swizzleBasis, isPYR))
+	for (int i = 0; i < LOCUS_MAX_COMPONENTS; i++)
+	{
+		if (pNode->pChild[i] != nullptr && !LocusEvalNumber(pNode->pChild[i], pLocus, &vecResult[i], swizzleBasis))
+			vecResult[i] = 0;
+	}
+
+	if (pNode->iComponent >= 3)
+	{
+		// random lerp, but all three components use the same amount
+		float lerpfactor = RANDOM_FLOAT(0, 1);
+		OUTresult->x = UTIL_Lerp(lerpfactor, vecResult[0], vecResult[3]);
+		OUTresult->y = UTIL_Lerp(lerpfactor, vecResult[1], vecResult[4]);
+		OUTresult->z = UTIL_Lerp(lerpfactor, vecResult[2], vecResult[5]);
+	}
+	else
+	{
+		OUTresult->x = vecResult[0];
+		OUTresult->y = vecResult[1];
+		OUTresult->z = vecResult[2];
+	}
+
+	return true;
+}
+
+static CBaseEntity* LocusEvalParameter(locusnode_t* pNode, CBaseEntity* pLocus, Vector* swizzleBasis)
+{
+	if (pNode->op == LOP_COMPONENTS)
 	{
 		// passing a componentwise vector as a locus; make a temporary reference point
+		Vector vecResult;
+		LocusEvalComponentwise(pNode, pLocus, &vecResult, swizzleBasis);
+
 		CMark* pMark = GetClassPtr((CMark*)nullptr);
 		pMark->pev->classname = MAKE_STRING("mark");
-		pMark->pev->origin = tryVectorResult;
-		pMark->pev->movedir = tryVectorResult;
+		pMark->pev->origin = vecResult;
+		pMark->pev->movedir = vecResult;
 		pMark->pev->frags = 0;
 		pMark->SetNextThink(0.1f);
 
 		return pMark;
 	}
-	else if (TryParseLocusNumber(szParamName, &tryNumberResult, swizzleBasis, isPYR))
+	else if (pNode->op != LOP_REFERENCE)
 	{
 		// passing a literal number as a locus; make a temporary reference point
+		float flResult;
+		LocusEvalNumber(pNode, pLocus, &flResult, swizzleBasis);
+
 		CMark* pMark = GetClassPtr((CMark*)nullptr);
 		pMark->pev->classname = MAKE_STRING("mark");
 		pMark->pev->origin = g_vecZero;
 		pMark->pev->movedir = g_vecZero;
-		pMark->pev->frags = tryNumberResult;
+		pMark->pev->frags = flResult;
 		pMark->SetNextThink(0.1f);
 
 		return pMark;
 	}
 	else
 	{
-		return UTIL_FindEntityByTargetname(nullptr, szParamName, pLocus);
+		return LocusResolve(pNode, pLocus);
 	}
 }
 
-bool TryCalcLocus_Position(CBaseEntity* pEntity, CBaseEntity* pLocus, const char* szText, Vector* OUTresult)
+static bool LocusEvalNumber(locusnode_t* pNode, CBaseEntity* pLocus, float* OUTresult, Vector* swizzleBasis)
 {
-	// blank = 0 0 0
-	if (szText[0] == 0)
+	switch (pNode->op)
 	{
-		*OUTresult = pEntity->pev->origin;
+	case LOP_CONSTANT:
+		*OUTresult = pNode->flValue;
 		return true;
-	}
 
-	//LRC 1.8
-	if (TryParseVectorComponentwise(pLocus, szText, OUTresult))
+	case LOP_SWIZZLE:
+		if (pNode->iComponent == 0)
+			*OUTresult = pNode->flValue * swizzleBasis->x;
+		else if (pNode->iComponent == 1)
+			*OUTresult = pNode->flValue * swizzleBasis->y;
+		else
+			*OUTresult = pNode->flValue * swizzleBasis->z;
+		return true;
+
+	case LOP_PITCH:
+		*OUTresult = pNode->flValue * UTIL_VecToAngles(*swizzleBasis).x;
+		return true;
+
+	case LOP_YAW:
+		*OUTresult = pNode->flValue * UTIL_VecToAngles(*swizzleBasis).y;
+		return true;
+
+	case LOP_LENGTH:
+		*OUTresult = pNode->flValue * swizzleBasis->Length();
+		return true;
+
+	case LOP_RANGE:
 	{
+		float A, B;
+		bool bA = LocusEvalNumber(pNode->pChild[0], pLocus, &A, swizzleBasis);
+		bool bB = LocusEvalNumber(pNode->pChild[1], pLocus, &B, swizzleBasis);
+
+		if (bA && bB)
+			*OUTresult = RANDOM_FLOAT(A, B);
+		else if (bA)
+			*OUTresult = A;
+		else if (bB)
+			*OUTresult = B;
+		else
+			return false;
+
 		return true;
 	}
 
-	char szPreBracket[128];
-	char szPostBracket[128];
-	if (TryParseLocusBrackets(pLocus, szText, szPreBracket, szPostBracket))
+	case LOP_REFERENCE:
 	{
-		pLocus = CalcLocusParameter(pLocus, szPostBracket);
-		szText = szPreBracket;
-	}
+		if (pNode->pParam != nullptr)
+			pLocus = LocusEvalParameter(pNode->pParam, pLocus, swizzleBasis);
 
-	CBaseEntity* pCalc = UTIL_FindEntityByTargetname(nullptr, szText, pLocus);
+		CBaseEntity* pCalc = LocusResolve(pNode, pLocus);
 
-	if (pCalc != nullptr)
-	{
-		return pCalc->CalcPosition(pLocus, OUTresult);
+		if (pCalc != nullptr)
+			return pCalc->CalcNumber(pLocus, OUTresult);
+
+		ALERT(at_debug, "Bad or missing [LR] value \"%s\"\n", pNode->name.c_str());
+		return false;
 	}
 
-	ALERT(at_debug, "%s \"%s\" has bad or missing calc_position value \"%s\"\n", STRING(pEntity->pev->classname), STRING(pEntity->pev->targetname), szText);
-	return false;
+	default:
+		return false;
+	}
 }
 
-bool TryCalcLocus_Velocity(CBaseEntity* pEntity, CBaseEntity* pLocus, const char* szText, Vector* OUTresult, Vector* swizzleBasis)
+static bool LocusEvalVector(locusnode_t* pNode, CBaseEntity* pEntity, CBaseEntity* pLocus, Vector* OUTresult, Vector* swizzleBasis)
 {
-	// blank = 0 0 0
-	if (szText[0] == 0)
+	switch (pNode->op)
 	{
+	case LOP_ORIGIN:
+		*OUTresult = pEntity->pev->origin;
+		return true;
+
+	case LOP_ZERO:
 		*OUTresult = g_vecZero;
 		return true;
-	}
 
-	if ((swizzleBasis != nullptr) && FStrEq(szText, "X Y Z"))
-	{
-		// optimization: parse the default swizzle nice and fast
+	case LOP_BASIS:
+		// optimization: the default swizzle
 		*OUTresult = *swizzleBasis;
 		return true;
-	}
 
-	if (TryParseVectorComponentwise(pLocus, szText, OUTresult, swizzleBasis))
-	{
-		return true;
-	}
+	case LOP_COMPONENTS:
+		return LocusEvalComponentwise(pNode, pLocus, OUTresult, swizzleBasis);
 
-	char szPreBracket[128];
-	char szPostBracket[128];
-	if (TryParseLocusBrackets(pLocus, szText, szPreBracket, szPostBracket, swizzleBasis))
+	case LOP_REFERENCE:
 	{
-		pLocus = CalcLocusParameter(pLocus, szPostBracket, swizzleBasis);
-		szText = szPreBracket;
-	}
+		if (pNode->pParam != nullptr)
+			pLocus = LocusEvalParameter(pNode->pParam, pLocus, swizzleBasis);
 
-	CBaseEntity* pCalc = UTIL_FindEntityByTargetname(nullptr, szText, pLocus);
+		CBaseEntity* pCalc = LocusResolve(pNode, pLocus);
 
-	if (pCalc != nullptr)
-		return pCalc->CalcVelocity(pLocus, OUTresult);
+		switch (pNode->kind)
+		{
+		case LKIND_POSITION:
+			if (pCalc != nullptr)
+				return pCalc->CalcPosition(pLocus, OUTresult);
 
-	ALERT(at_debug, "%s \"%s\" has bad or missing LV value \"%s\"\n", STRING(pEntity->pev->classname), STRING(pEntity->pev->targetname), szText);
-	return false;
-}
+			ALERT(at_debug, "%s \"%s\" has bad or missing calc_position value \"%s\"\n", STRING(pEntity->pev->classname), STRING(pEntity->pev->targetname), pNode->name.c_str());
+			return false;
 
-//LRC 1.8 - for parsing the new [PYR] fields
-bool TryCalcLocus_PYR(CBaseEntity* pEntity, CBaseEntity* pLocus, const char* szText, Vector* OUTresult, Vector* swizzleBasis)
-{
-	if ((swizzleBasis != nullptr) && FStrEq(szText, "P Y R"))
-	{
-		// optimization: parse the default swizzle nice and fast
-		*OUTresult = *swizzleBasis;
-		return true;
+		case LKIND_VELOCITY:
+			if (pCalc != nullptr)
+				return pCalc->CalcVelocity(pLocus, OUTresult);
+
+			ALERT(at_debug, "%s \"%s\" has bad or missing LV value \"%s\"\n", STRING(pEntity->pev->classname), STRING(pEntity->pev->targetname), pNode->name.c_str());
+			return false;
+
+		case LKIND_PYR:
+			if (pCalc != nullptr)
+				return pCalc->CalcPYR(pLocus, OUTresult);
+
+			ALERT(at_error, "%s \"%s\" has bad or missing PYR value \"%s\"\n", STRING(pEntity->pev->classname), STRING(pEntity->pev->targetname), pNode->name.c_str());
+			return false;
+
+		default:
+			return false;
+		}
 	}
 
-	if (TryParseVectorComponentwise(pLocus, szText, OUTresult, swizzleBasis, true))
-	{
-		return true;
+	default:
+		return false;
 	}
+}
 
-	CBaseEntity* pCalc = UTIL_FindEntityByTargetname(nullptr, szText, pLocus);
+CBaseEntity* CalcLocusParameter(CBaseEntity* pLocus, const char* szParamName, Vector* swizzleBasis, bool isPYR)
+{
+	locusnode_t* pNode = LocusLookup(LKIND_PARAMETER, szParamName, swizzleBasis, isPYR);
 
-	if (pCalc != nullptr)
-		return pCalc->CalcPYR(pLocus, OUTresult);
+	g_iLocusEvalDepth++;
+	CBaseEntity* pResult = LocusEvalParameter(pNode, pLocus, swizzleBasis);
+	g_iLocusEvalDepth--;
 
-	ALERT(at_error, "%s \"%s\" has bad or missing PYR value \"%s\"\n", STRING(pEntity->pev->classname), STRING(pEntity->pev->targetname), szText);
-	return false;
+	return pResult;
 }
 
-bool TryCalcLocus_Number(CBaseEntity* pLocus, const char* szText, float* OUTresult, Vector* swizzleBasis, bool isPYR)
+static bool LocusCalcVector(locuskind_e kind, CBaseEntity* pEntity, CBaseEntity* pLocus, const char* szText, Vector* OUTresult, Vector* swizzleBasis)
 {
-	// blank = 0
-	if (szText[0] == 0)
-	{
-		*OUTresult = 0;
-		return true;
-	}
+	locusnode_t* pNode = LocusLookup(kind, szText, swizzleBasis, kind == LKIND_PYR);
 
-	//LRC 1.8 - randomized ratios
-	for (int i = 0; szText[i] != 0; i++)
-	{
-		if (szText[i] == '.' && szText[i + 1] == '.')
-		{
-			// found a '..': it's a random value from a range
-			char szComponentName[128];
-			strncpy(szComponentName, szText, i);
-			szComponentName[i] = 0;
-
-			float A, B;
-			bool bA = TryCalcLocus_NumberNonRandom(pLocus, szComponentName, &A, swizzleBasis, isPYR);
-			bool bB = TryCalcLocus_NumberNonRandom(pLocus, &szText[i + 2], &B, swizzleBasis, isPYR);
-
-			if (bA && bB)
-				*OUTresult = RANDOM_FLOAT(A, B);
-			else if (bA)
-				*OUTresult = A;
-			else if (bB)
-				*OUTresult = B;
-			else
-				return false;
+	g_iLocusEvalDepth++;
+	bool bResult = LocusEvalVector(pNode, pEntity, pLocus, OUTresult, swizzleBasis);
+	g_iLocusEvalDepth--;
 
-			return true;
-		}
-	}
+	return bResult;
+}
 
-	return TryCalcLocus_NumberNonRandom(pLocus, szText, OUTresult, swizzleBasis, isPYR);
+static bool LocusCalcNumber(locuskind_e kind, CBaseEntity* pLocus, const char* szText, float* OUTresult, Vector* swizzleBasis, bool isPYR)
+{
+	locusnode_t* pNode = LocusLookup(kind, szText, swizzleBasis, isPYR);
+
+	g_iLocusEvalDepth++;
+	bool bResult = LocusEvalNumber(pNode, pLocus, OUTresult, swizzleBasis);
+	g_iLocusEvalDepth--;
+
+	return bResult;
 }
 
-bool TryCalcLocus_NumberNonRandom(CBaseEntity* pLocus, const char* szText, float* OUTresult, Vector* swizzleBasis, bool isPYR)
+bool TryCalcLocus_Position(CBaseEntity* pEntity, CBaseEntity* pLocus, const char* szText, Vector* OUTresult)
 {
-	if (TryParseLocusNumber(szText, OUTresult, swizzleBasis, isPYR))
-	{
-		return true;
-	}
+	return LocusCalcVector(LKIND_POSITION, pEntity, pLocus, szText, OUTresult, nullptr);
+}
 
-	char szPreBracket[128];
-	char szPostBracket[128];
-	if (TryParseLocusBrackets(pLocus, szText, szPreBracket, szPostBracket, swizzleBasis, isPYR))
-	{
-		pLocus = CalcLocusParameter(pLocus, szPostBracket, swizzleBasis, isPYR);
-		szText = szPreBracket;
-	}
+bool TryCalcLocus_Velocity(CBaseEntity* pEntity, CBaseEntity* pLocus, const char* szText, Vector* OUTresult, Vector* swizzleBasis)
+{
+	return LocusCalcVector(LKIND_VELOCITY, pEntity, pLocus, szText, OUTresult, swizzleBasis);
+}
 
-	CBaseEntity* pCalc = UTIL_FindEntityByTargetname(nullptr, szText, pLocus);
+//LRC 1.8 - for parsing the new [PYR] fields
+bool TryCalcLocus_PYR(CBaseEntity* pEntity, CBaseEntity* pLocus, const char* szText, Vector* OUTresult, Vector* swizzleBasis)
+{
+	return LocusCalcVector(LKIND_PYR, pEntity, pLocus, szText, OUTresult, swizzleBasis);
+}
 
-	if (pCalc != nullptr)
-		return pCalc->CalcNumber(pLocus, OUTresult);
+bool TryCalcLocus_Number(CBaseEntity* pLocus, const char* szText, float* OUTresult, Vector* swizzleBasis, bool isPYR)
+{
+	return LocusCalcNumber(LKIND_NUMBER, pLocus, szText, OUTresult, swizzleBasis, isPYR);
+}
 
-	ALERT(at_debug, "Bad or missing [LR] value \"%s\"\n", szText);
-	return false;
-	//	return 0; // we need some signal for "fail". NaN, maybe?
+bool TryCalcLocus_NumberNonRandom(CBaseEntity* pLocus, const char* szText, float* OUTresult, Vector* swizzleBasis, bool isPYR)
+{
+	return LocusCalcNumber(LKIND_NUMBER_NONRANDOM, pLocus, szText, OUTresult, swizzleBasis, isPYR);
 }
 
 //=============================================
@@ -690,6 +1014,7 @@ void CLocusBeam::Use(CBaseEntity* pActivator, CBaseEntity* pCaller, USE_TYPE use
 		pBeam->SetNextThink(m_fDuration);
 	}
 	pBeam->pev->targetname = m_iszTargetName;
+	UTIL_LocusTargetnamesChanged();
 
 	if (pev->target != 0u)
 	{
@@ -1784,6 +2109,7 @@ void CLocusVariable::Use(CBaseEntity* pActivator, CBaseEntity* pCaller, USE_TYPE
 		pMark->pev->frags = fRatio;
 		pMark->pev->targetname = m_iszTargetName;
 		pMark->SetNextThink(m_fDuration);
+		UTIL_LocusTargetnamesChanged();
 
 		FireTargets(STRING(m_iszFireOnSpawn), pMark, this, USE_TOGGLE, 0);
 	}
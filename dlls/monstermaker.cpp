@@ -338,6 +338,7 @@ CBaseMonster* CMonsterMaker::MakeMonster()
 	{
 		// if I have a netname (overloaded), give the child monster that name as a targetname
 		pevCreate->targetname = pev->netname;
+		UTIL_LocusTargetnamesChanged();
 	}
 
 	m_cLiveChildren++; // count this monster
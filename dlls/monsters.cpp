@@ -24,6 +24,8 @@
 #include "util.h"
 #include "cbase.h"
 #include "nodes.h"
+#include "navmesh.h"
+#include "game.h"
 #include "monsters.h"
 #include "animation.h"
 #include "saverestore.h"
@@ -2013,6 +2015,7 @@ void CBaseMonster::MonsterInit()
 	// Set fields common to all monsters
 	pev->effects = 0;
 	pev->takedamage = DAMAGE_AIM;
+	UTIL_AutoaimTakeDamageChanged(edict());
 	pev->ideal_yaw = pev->angles.y;
 	pev->max_health = pev->health;
 	pev->deadflag = DEAD_NO;
@@ -2787,6 +2790,9 @@ bool CBaseMonster::FGetNodeRoute(Vector vecDest)
 	int i;
 	int iNumToCopy;
 
+	if (FGetNavMeshRoute(vecDest))
+		return true;
+
 	iSrcNode = WorldGraph.FindNearestNode(pev->origin, this);
 	iDestNode = WorldGraph.FindNearestNode(vecDest, this);
 
@@ -2859,6 +2865,47 @@ bool CBaseMonster::FGetNodeRoute(Vector vecDest)
 	return true;
 }
 
+//=========================================================
+// FGetNavMeshRoute - same as FGetNodeRoute, but the route
+// goes over the map's navigation mesh. Only used for
+// walking monsters that fit the player sized areas the
+// mesh is generated for.
+//=========================================================
+bool CBaseMonster::FGetNavMeshRoute(const Vector& vecDest)
+{
+	Vector vecWaypoints[ROUTE_SIZE];
+	int iResult;
+	int i;
+
+	if (monster_navmesh.value == 0 || !WorldNavMesh.IsLoaded())
+		return false;
+
+	if ((pev->flags & (FL_FLY | FL_SWIM)) != 0 || pev->size.x > 32 || pev->size.z > 72)
+		return false;
+
+	iResult = WorldNavMesh.FindPath(pev->origin, vecDest, m_afCapability, pev->size.x * 0.5, vecWaypoints, ROUTE_SIZE);
+
+	if (iResult < 0)
+	{
+		ALERT(at_aiconsole, "No navigation mesh path for %s!\n", STRING(pev->classname));
+		return false;
+	}
+
+	for (i = 0; i < iResult; i++)
+	{
+		m_Route[i].vecLocation = vecWaypoints[i];
+		m_Route[i].iType = bits_MF_TO_NODE;
+	}
+
+	if (iResult < ROUTE_SIZE)
+	{
+		m_Route[iResult].vecLocation = vecDest;
+		m_Route[iResult].iType |= bits_MF_IS_GOAL;
+	}
+
+	return true;
+}
+
 //=========================================================
 // FindHintNode
 //=========================================================
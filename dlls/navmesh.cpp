@@ -0,0 +1,618 @@
+//=========================================================
+// navmesh.cpp - navigation mesh routing for monsters.
+//
+// The loader follows LoadNavigationMap() / CNavArea::Load()
+// in game_shared/bot/nav_file.cpp, the grid follows
+// CNavAreaGrid and the search follows NavAreaBuildPath() with
+// ShortestPathCost. Only what monster routing needs is kept:
+// hiding spots, encounter paths and places are skipped.
+//=========================================================
+
+#include <algorithm>
+#include <queue>
+#include <string>
+#include <unordered_map>
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "navmesh.h"
+#include "filesystem_utils.h"
+
+CNavMesh WorldNavMesh;
+
+#define NAVMESH_CROUCH_PENALTY 20.0f
+#define NAVMESH_JUMP_PENALTY 5.0f
+#define NAVMESH_STEP_HEIGHT 18.0f
+#define NAVMESH_HALF_HUMAN_HEIGHT 36.0f
+#define NAVMESH_NEAREST_CELLS 3 // how many grid cells out GetNearestArea looks
+
+//=========================================================
+// CNavMeshArea
+//=========================================================
+float CNavMeshArea::GetZ(float x, float y) const
+{
+	float dx = m_vecHi.x - m_vecLo.x;
+	float dy = m_vecHi.y - m_vecLo.y;
+
+	// guard against division by zero due to degenerate areas
+	if (dx == 0.0f || dy == 0.0f)
+		return m_flNEZ;
+
+	float u = std::clamp((x - m_vecLo.x) / dx, 0.0f, 1.0f);
+	float v = std::clamp((y - m_vecLo.y) / dy, 0.0f, 1.0f);
+
+	float northZ = m_vecLo.z + u * (m_flNEZ - m_vecLo.z);
+	float southZ = m_flSWZ + u * (m_vecHi.z - m_flSWZ);
+
+	return northZ + v * (southZ - northZ);
+}
+
+bool CNavMeshArea::IsOverlapping(float x, float y) const
+{
+	return x >= m_vecLo.x && x <= m_vecHi.x && y >= m_vecLo.y && y <= m_vecHi.y;
+}
+
+void CNavMeshArea::GetClosestPoint(const Vector& vecPos, Vector& vecClose) const
+{
+	vecClose.x = std::clamp(vecPos.x, m_vecLo.x, m_vecHi.x);
+	vecClose.y = std::clamp(vecPos.y, m_vecLo.y, m_vecHi.y);
+	vecClose.z = GetZ(vecClose.x, vecClose.y);
+}
+
+//=========================================================
+// CNavMesh
+//=========================================================
+CNavMesh::CNavMesh()
+{
+	m_flGridMinX = m_flGridMinY = 0;
+	m_iGridSizeX = m_iGridSizeY = 0;
+	m_iSearchMarker = 0;
+}
+
+void CNavMesh::Clear()
+{
+	m_Areas.clear();
+	m_Connects.clear();
+	m_GridCellStart.clear();
+	m_GridAreas.clear();
+	m_SearchMarker.clear();
+	m_SearchClosed.clear();
+	m_SearchCost.clear();
+	m_SearchParent.clear();
+	m_SearchParentDir.clear();
+	m_PathAreas.clear();
+	m_iGridSizeX = m_iGridSizeY = 0;
+	m_iSearchMarker = 0;
+}
+
+//=========================================================
+// Load - reads maps/<mapname>.nav, if there is one.
+//=========================================================
+bool CNavMesh::Load(const char* szMapName)
+{
+	Clear();
+
+	const std::string fileName{std::string{"maps/"} + szMapName + ".nav"};
+	const auto buffer = FileSystem_LoadFileIntoBuffer(fileName.c_str(), FileContentFormat::Binary);
+
+	if (buffer.empty())
+		return false;
+
+	if (!ParseFile(reinterpret_cast<const byte*>(buffer.data()), static_cast<int>(buffer.size()), szMapName))
+	{
+		ALERT(at_error, "Invalid navigation file %s\n", fileName.c_str());
+		Clear();
+		return false;
+	}
+
+	BuildGrid();
+
+	const std::size_t count = m_Areas.size();
+	m_SearchMarker.assign(count, 0);
+	m_SearchClosed.assign(count, false);
+	m_SearchCost.assign(count, 0.0f);
+	m_SearchParent.assign(count, -1);
+	m_SearchParentDir.assign(count, 0);
+
+	ALERT(at_aiconsole, "Loaded %s, %d areas\n", fileName.c_str(), static_cast<int>(count));
+	return true;
+}
+
+//=========================================================
+// Bounds checked reader over the file buffer
+//=========================================================
+class CNavMeshReader
+{
+public:
+	CNavMeshReader(const byte* pData, int iLength) : m_pData(pData), m_iLength(iLength), m_iPos(0), m_fOverflow(false) {}
+
+	bool Read(void* pDest, int iSize)
+	{
+		if (m_fOverflow || m_iPos + iSize > m_iLength)
+		{
+			m_fOverflow = true;
+			return false;
+		}
+
+		memcpy(pDest, m_pData + m_iPos, iSize);
+		m_iPos += iSize;
+		return true;
+	}
+
+	bool Skip(int iSize)
+	{
+		if (m_fOverflow || m_iPos + iSize > m_iLength)
+		{
+			m_fOverflow = true;
+			return false;
+		}
+
+		m_iPos += iSize;
+		return true;
+	}
+
+private:
+	const byte* m_pData;
+	int m_iLength;
+	int m_iPos;
+	bool m_fOverflow;
+};
+
+bool CNavMesh::ParseFile(const byte* pData, int iLength, const char* szMapName)
+{
+	CNavMeshReader file(pData, iLength);
+
+	unsigned int magic = 0;
+	if (!file.Read(&magic, sizeof(magic)) || magic != NAVMESH_MAGIC_NUMBER)
+		return false;
+
+	unsigned int version = 0;
+	if (!file.Read(&version, sizeof(version)) || version > NAVMESH_MAX_VERSION)
+		return false;
+
+	if (version >= 4)
+	{
+		// size of the bsp the mesh was generated from
+		unsigned int saveBspSize = 0;
+		if (!file.Read(&saveBspSize, sizeof(saveBspSize)))
+			return false;
+
+		const std::string bspName{std::string{"maps/"} + szMapName + ".bsp"};
+		if (static_cast<unsigned int>(g_engfuncs.pfnGetFileSize(bspName.c_str())) != saveBspSize)
+			ALERT(at_console, "Navigation file for %s is from a different version of the map\n", szMapName);
+	}
+
+	// place directory
+	if (version >= 5)
+	{
+		unsigned short count = 0;
+		if (!file.Read(&count, sizeof(count)))
+			return false;
+
+		for (int i = 0; i < count; i++)
+		{
+			unsigned short len = 0;
+			if (!file.Read(&len, sizeof(len)) || !file.Skip(len))
+				return false;
+		}
+	}
+
+	// every area takes well over a byte, so a count past the length is garbage
+	unsigned int count = 0;
+	if (!file.Read(&count, sizeof(count)) || count > static_cast<unsigned int>(iLength))
+		return false;
+
+	std::vector<unsigned int> connectIDs;
+	std::unordered_map<unsigned int, int> areaIndex;
+
+	m_Areas.resize(count);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		CNavMeshArea& area = m_Areas[i];
+
+		unsigned char attributes = 0;
+		float extent[6] = {};
+
+		if (!file.Read(&area.m_iID, sizeof(unsigned int)) || !file.Read(&attributes, sizeof(unsigned char)) || !file.Read(extent, sizeof(extent)) || !file.Read(&area.m_flNEZ, sizeof(float)) || !file.Read(&area.m_flSWZ, sizeof(float)))
+			return false;
+
+		area.m_afAttributes = attributes;
+		area.m_vecLo = Vector(extent[0], extent[1], extent[2]);
+		area.m_vecHi = Vector(extent[3], extent[4], extent[5]);
+		area.m_vecCenter = (area.m_vecLo + area.m_vecHi) * 0.5;
+		areaIndex[area.m_iID] = i;
+
+		// connections, in the order NORTH, EAST, SOUTH, WEST
+		for (int d = 0; d < NAVDIR_COUNT; d++)
+		{
+			unsigned int connectCount = 0;
+			if (!file.Read(&connectCount, sizeof(connectCount)))
+				return false;
+
+			area.m_iFirstConnect[d] = connectIDs.size();
+			for (unsigned int c = 0; c < connectCount; c++)
+			{
+				unsigned int id = 0;
+				if (!file.Read(&id, sizeof(id)))
+					return false;
+				connectIDs.push_back(id);
+			}
+		}
+		area.m_iFirstConnect[NAVDIR_COUNT] = connectIDs.size();
+
+		// hiding spots: version 1 stores positions, later ones id + position + flags
+		unsigned char hidingSpotCount = 0;
+		if (!file.Read(&hidingSpotCount, sizeof(hidingSpotCount)) || !file.Skip(hidingSpotCount * (version == 1 ? 12 : 17)))
+			return false;
+
+		// approach areas: here, prev + how, next + how
+		unsigned char approachCount = 0;
+		if (!file.Read(&approachCount, sizeof(approachCount)) || !file.Skip(approachCount * 14))
+			return false;
+
+		// encounter paths
+		unsigned int encounterCount = 0;
+		if (!file.Read(&encounterCount, sizeof(encounterCount)))
+			return false;
+
+		for (unsigned int e = 0; e < encounterCount; e++)
+		{
+			unsigned char spotCount = 0;
+
+			if (version < 3)
+			{
+				if (!file.Skip(8 + 24) || !file.Read(&spotCount, sizeof(spotCount)) || !file.Skip(spotCount * 16))
+					return false;
+			}
+			else
+			{
+				if (!file.Skip(10) || !file.Read(&spotCount, sizeof(spotCount)) || !file.Skip(spotCount * 5))
+					return false;
+			}
+		}
+
+		// place entry
+		if (version >= 5 && !file.Skip(sizeof(unsigned short)))
+			return false;
+	}
+
+	// turn connection ids into indices, dropping links to areas that don't exist
+	m_Connects.reserve(connectIDs.size());
+
+	for (auto& area : m_Areas)
+	{
+		int end[NAVDIR_COUNT + 1];
+
+		for (int d = 0; d <= NAVDIR_COUNT; d++)
+			end[d] = area.m_iFirstConnect[d];
+
+		for (int d = 0; d < NAVDIR_COUNT; d++)
+		{
+			area.m_iFirstConnect[d] = m_Connects.size();
+
+			for (int c = end[d]; c < end[d + 1]; c++)
+			{
+				auto it = areaIndex.find(connectIDs[c]);
+				if (it != areaIndex.end())
+					m_Connects.push_back(it->second);
+			}
+		}
+		area.m_iFirstConnect[NAVDIR_COUNT] = m_Connects.size();
+	}
+
+	return true;
+}
+
+//=========================================================
+// BuildGrid - buckets the areas by XY, see CNavAreaGrid
+//=========================================================
+int CNavMesh::GridX(float x) const
+{
+	return std::clamp(static_cast<int>((x - m_flGridMinX) / NAVMESH_CELL_SIZE), 0, m_iGridSizeX - 1);
+}
+
+int CNavMesh::GridY(float y) const
+{
+	return std::clamp(static_cast<int>((y - m_flGridMinY) / NAVMESH_CELL_SIZE), 0, m_iGridSizeY - 1);
+}
+
+void CNavMesh::BuildGrid()
+{
+	float maxX, maxY;
+
+	m_flGridMinX = m_flGridMinY = 9999999.0f;
+	maxX = maxY = -9999999.0f;
+
+	for (const auto& area : m_Areas)
+	{
+		m_flGridMinX = std::min(m_flGridMinX, area.m_vecLo.x);
+		m_flGridMinY = std::min(m_flGridMinY, area.m_vecLo.y);
+		maxX = std::max(maxX, area.m_vecHi.x);
+		maxY = std::max(maxY, area.m_vecHi.y);
+	}
+
+	m_iGridSizeX = static_cast<int>((maxX - m_flGridMinX) / NAVMESH_CELL_SIZE) + 1;
+	m_iGridSizeY = static_cast<int>((maxY - m_flGridMinY) / NAVMESH_CELL_SIZE) + 1;
+
+	// count, then fill, so every cell is a slice of one flat array
+	const int cells = m_iGridSizeX * m_iGridSizeY;
+	m_GridCellStart.assign(cells + 1, 0);
+
+	for (const auto& area : m_Areas)
+	{
+		for (int y = GridY(area.m_vecLo.y); y <= GridY(area.m_vecHi.y); y++)
+			for (int x = GridX(area.m_vecLo.x); x <= GridX(area.m_vecHi.x); x++)
+				m_GridCellStart[x + y * m_iGridSizeX + 1]++;
+	}
+
+	for (int i = 0; i < cells; i++)
+		m_GridCellStart[i + 1] += m_GridCellStart[i];
+
+	std::vector<int> fill(m_GridCellStart.begin(), m_GridCellStart.end() - 1);
+	m_GridAreas.resize(m_GridCellStart[cells]);
+
+	for (int i = 0; i < static_cast<int>(m_Areas.size()); i++)
+	{
+		const CNavMeshArea& area = m_Areas[i];
+
+		for (int y = GridY(area.m_vecLo.y); y <= GridY(area.m_vecHi.y); y++)
+			for (int x = GridX(area.m_vecLo.x); x <= GridX(area.m_vecHi.x); x++)
+				m_GridAreas[fill[x + y * m_iGridSizeX]++] = i;
+	}
+}
+
+//=========================================================
+// GetArea
+//=========================================================
+int CNavMesh::GetArea(const Vector& vecPos, float flBeneathLimit) const
+{
+	if (!IsLoaded())
+		return -1;
+
+	const int cell = GridX(vecPos.x) + GridY(vecPos.y) * m_iGridSizeX;
+	const float testZ = vecPos.z + 5;
+
+	int use = -1;
+	float useZ = -99999999.9f;
+
+	for (int i = m_GridCellStart[cell]; i < m_GridCellStart[cell + 1]; i++)
+	{
+		const CNavMeshArea& area = m_Areas[m_GridAreas[i]];
+
+		if (!area.IsOverlapping(vecPos.x, vecPos.y))
+			continue;
+
+		float z = area.GetZ(vecPos.x, vecPos.y);
+
+		// above us, or too far below
+		if (z > testZ || z < vecPos.z - flBeneathLimit)
+			continue;
+
+		if (z > useZ)
+		{
+			use = m_GridAreas[i];
+			useZ = z;
+		}
+	}
+
+	return use;
+}
+
+//=========================================================
+// GetNearestArea - unlike CNavAreaGrid::GetNearestNavArea
+// this only walks the grid cells around the position
+// instead of every area on the map.
+//=========================================================
+int CNavMesh::GetNearestArea(const Vector& vecPos) const
+{
+	int close = GetArea(vecPos);
+	if (close != -1)
+		return close;
+
+	if (!IsLoaded())
+		return -1;
+
+	const Vector source = vecPos + Vector(0, 0, NAVMESH_HALF_HUMAN_HEIGHT);
+	const int cx = GridX(vecPos.x);
+	const int cy = GridY(vecPos.y);
+	float closeDistSq = 99999999.9f;
+
+	for (int y = std::max(cy - NAVMESH_NEAREST_CELLS, 0); y <= std::min(cy + NAVMESH_NEAREST_CELLS, m_iGridSizeY - 1); y++)
+	{
+		for (int x = std::max(cx - NAVMESH_NEAREST_CELLS, 0); x <= std::min(cx + NAVMESH_NEAREST_CELLS, m_iGridSizeX - 1); x++)
+		{
+			const int cell = x + y * m_iGridSizeX;
+
+			for (int i = m_GridCellStart[cell]; i < m_GridCellStart[cell + 1]; i++)
+			{
+				if (m_GridAreas[i] == close)
+					continue;
+
+				Vector areaPos;
+				m_Areas[m_GridAreas[i]].GetClosestPoint(source, areaPos);
+
+				float distSq = (areaPos - source).LengthSquared();
+				if (distSq >= closeDistSq)
+					continue;
+
+				// check LOS to area
+				TraceResult tr;
+				UTIL_TraceLine(source, areaPos + Vector(0, 0, NAVMESH_HALF_HUMAN_HEIGHT), ignore_monsters, ignore_glass, nullptr, &tr);
+				if (tr.flFraction != 1.0f)
+					continue;
+
+				closeDistSq = distSq;
+				close = m_GridAreas[i];
+			}
+		}
+	}
+
+	return close;
+}
+
+//=========================================================
+// ComputePortal - the point on the edge shared by two
+// areas where a path coming from vecPrev should cross.
+//=========================================================
+bool CNavMesh::ComputePortal(int iFrom, int iTo, int iDir, float flHalfWidth, const Vector& vecPrev, Vector& vecPortal) const
+{
+	const CNavMeshArea& from = m_Areas[iFrom];
+	const CNavMeshArea& to = m_Areas[iTo];
+	float lo, hi;
+
+	if (iDir == NAVDIR_NORTH || iDir == NAVDIR_SOUTH)
+	{
+		vecPortal.y = (iDir == NAVDIR_NORTH) ? from.m_vecLo.y : from.m_vecHi.y;
+		lo = std::max(from.m_vecLo.x, to.m_vecLo.x);
+		hi = std::min(from.m_vecHi.x, to.m_vecHi.x);
+	}
+	else
+	{
+		vecPortal.x = (iDir == NAVDIR_WEST) ? from.m_vecLo.x : from.m_vecHi.x;
+		lo = std::max(from.m_vecLo.y, to.m_vecLo.y);
+		hi = std::min(from.m_vecHi.y, to.m_vecHi.y);
+	}
+
+	if (lo > hi)
+		return false;
+
+	// keep the hull inside the portal, or go through the middle if it's too narrow
+	float cross;
+	if (hi - lo > 2 * flHalfWidth)
+		cross = std::clamp((iDir == NAVDIR_NORTH || iDir == NAVDIR_SOUTH) ? vecPrev.x : vecPrev.y, lo + flHalfWidth, hi - flHalfWidth);
+	else
+		cross = (lo + hi) * 0.5f;
+
+	if (iDir == NAVDIR_NORTH || iDir == NAVDIR_SOUTH)
+		vecPortal.x = cross;
+	else
+		vecPortal.y = cross;
+
+	vecPortal.z = to.GetZ(vecPortal.x, vecPortal.y);
+	return true;
+}
+
+//=========================================================
+// FindPath - A* over the areas, see NavAreaBuildPath()
+//=========================================================
+int CNavMesh::FindPath(const Vector& vecStart, const Vector& vecGoal, int afCapability, float flHalfWidth, Vector* pWaypoints, int iMaxWaypoints)
+{
+	const int startArea = GetNearestArea(vecStart);
+	const int goalArea = GetNearestArea(vecGoal);
+
+	if (startArea == -1 || goalArea == -1)
+		return -1;
+
+	if (startArea == goalArea)
+		return 0;
+
+	// fresh marker invalidates the bookkeeping of the previous search
+	if (++m_iSearchMarker == 0)
+	{
+		std::fill(m_SearchMarker.begin(), m_SearchMarker.end(), 0);
+		m_iSearchMarker = 1;
+	}
+
+	typedef std::pair<float, int> openentry_t; // total cost, area
+	std::priority_queue<openentry_t, std::vector<openentry_t>, std::greater<openentry_t>> openList;
+
+	m_SearchMarker[startArea] = m_iSearchMarker;
+	m_SearchClosed[startArea] = false;
+	m_SearchCost[startArea] = 0;
+	m_SearchParent[startArea] = -1;
+	openList.push(openentry_t((m_Areas[startArea].m_vecCenter - vecGoal).Length(), startArea));
+
+	bool found = false;
+
+	while (!openList.empty())
+	{
+		const int current = openList.top().second;
+		openList.pop();
+
+		// stale entry, the area was reached cheaper since it was pushed
+		if (m_SearchClosed[current])
+			continue;
+
+		m_SearchClosed[current] = true;
+
+		if (current == goalArea)
+		{
+			found = true;
+			break;
+		}
+
+		const CNavMeshArea& area = m_Areas[current];
+
+		for (int d = 0; d < NAVDIR_COUNT; d++)
+		{
+			for (int c = area.m_iFirstConnect[d]; c < area.m_iFirstConnect[d + 1]; c++)
+			{
+				const int next = m_Connects[c];
+				const CNavMeshArea& nextArea = m_Areas[next];
+
+				if (m_SearchMarker[next] == m_iSearchMarker && m_SearchClosed[next])
+					continue;
+
+				// see ShortestPathCost
+				const float dist = (nextArea.m_vecCenter - area.m_vecCenter).Length();
+				float cost = m_SearchCost[current] + dist;
+
+				if ((nextArea.m_afAttributes & bits_NAVAREA_CROUCH) != 0)
+				{
+					if ((afCapability & bits_CAP_DUCK) == 0)
+						continue;
+					cost += NAVMESH_CROUCH_PENALTY * dist;
+				}
+
+				if ((nextArea.m_afAttributes & bits_NAVAREA_JUMP) != 0)
+				{
+					if ((afCapability & bits_CAP_JUMP) == 0)
+						continue;
+					cost += NAVMESH_JUMP_PENALTY * dist;
+				}
+
+				// monsters don't step up anything a player would have to jump for
+				if ((afCapability & bits_CAP_JUMP) == 0 && nextArea.m_vecCenter.z - area.m_vecCenter.z > NAVMESH_STEP_HEIGHT && nextArea.GetZ(area.m_vecCenter.x, area.m_vecCenter.y) - area.GetZ(nextArea.m_vecCenter.x, nextArea.m_vecCenter.y) > NAVMESH_STEP_HEIGHT)
+					continue;
+
+				if (m_SearchMarker[next] == m_iSearchMarker && cost >= m_SearchCost[next])
+					continue;
+
+				m_SearchMarker[next] = m_iSearchMarker;
+				m_SearchClosed[next] = false;
+				m_SearchCost[next] = cost;
+				m_SearchParent[next] = current;
+				m_SearchParentDir[next] = d;
+				openList.push(openentry_t(cost + (nextArea.m_vecCenter - vecGoal).Length(), next));
+			}
+		}
+	}
+
+	if (!found)
+		return -1;
+
+	// walk back from the goal, then put the areas in travel order
+	m_PathAreas.clear();
+	for (int area = goalArea; area != -1; area = m_SearchParent[area])
+		m_PathAreas.push_back(area);
+
+	std::reverse(m_PathAreas.begin(), m_PathAreas.end());
+
+	// one waypoint per portal crossed
+	int numWaypoints = 0;
+	Vector prev = vecStart;
+
+	for (std::size_t i = 1; i < m_PathAreas.size() && numWaypoints < iMaxWaypoints; i++)
+	{
+		Vector portal;
+		if (!ComputePortal(m_PathAreas[i - 1], m_PathAreas[i], m_SearchParentDir[m_PathAreas[i]], flHalfWidth, prev, portal))
+			portal = m_Areas[m_PathAreas[i]].m_vecCenter;
+
+		pWaypoints[numWaypoints++] = portal;
+		prev = portal;
+	}
+
+	return numWaypoints;
+}
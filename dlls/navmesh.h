@@ -0,0 +1,106 @@
+//=========================================================
+// navmesh.h - navigation mesh routing for monsters.
+//
+// Reads the .nav files written by the bot navigation code
+// in game_shared/bot (same format, versions 1-5) and offers
+// area lookups through a uniform grid plus an A* search over
+// the area connections, as an alternative to the node graph.
+//=========================================================
+
+#pragma once
+
+#include <vector>
+
+#define NAVMESH_MAGIC_NUMBER 0xFEEDFACE // matches NAV_MAGIC_NUMBER in game_shared/bot/nav.h
+#define NAVMESH_MAX_VERSION 5
+#define NAVMESH_CELL_SIZE 300.0f
+
+#define bits_NAVAREA_CROUCH (1 << 0) // must crouch to use this area
+#define bits_NAVAREA_JUMP (1 << 1)	 // must jump to traverse this area
+
+enum navdir_e
+{
+	NAVDIR_NORTH = 0,
+	NAVDIR_EAST,
+	NAVDIR_SOUTH,
+	NAVDIR_WEST,
+
+	NAVDIR_COUNT
+};
+
+//=========================================================
+// A rectangular walkable area. Corners are lo (north-west)
+// and hi (south-east); the other two corners only store Z.
+//=========================================================
+class CNavMeshArea
+{
+public:
+	unsigned int m_iID;
+	int m_afAttributes;
+	Vector m_vecLo;
+	Vector m_vecHi;
+	Vector m_vecCenter;
+	float m_flNEZ;
+	float m_flSWZ;
+
+	// connections to adjacent areas are m_iFirstConnect[dir] up to m_iFirstConnect[dir + 1]
+	int m_iFirstConnect[NAVDIR_COUNT + 1];
+
+	float GetZ(float x, float y) const;
+	bool IsOverlapping(float x, float y) const;
+	void GetClosestPoint(const Vector& vecPos, Vector& vecClose) const;
+};
+
+//=========================================================
+// CNavMesh
+//=========================================================
+class CNavMesh
+{
+public:
+	CNavMesh();
+
+	bool Load(const char* szMapName);
+	void Clear();
+
+	bool IsLoaded() const { return !m_Areas.empty(); }
+
+	// area whose extent contains vecPos and is the highest one not above it
+	int GetArea(const Vector& vecPos, float flBeneathLimit = 120.0f) const;
+	// like GetArea, but falls back to the closest visible area nearby
+	int GetNearestArea(const Vector& vecPos) const;
+
+	// writes up to iMaxWaypoints points where the path from vecStart to vecGoal crosses
+	// from one area into the next. Returns how many were written (0 when both lie in
+	// the same area), or -1 if there is no path. flHalfWidth keeps the points away
+	// from the edges of the portals.
+	int FindPath(const Vector& vecStart, const Vector& vecGoal, int afCapability, float flHalfWidth, Vector* pWaypoints, int iMaxWaypoints);
+
+private:
+	bool ParseFile(const byte* pData, int iLength, const char* szMapName);
+	void BuildGrid();
+	int GridX(float x) const;
+	int GridY(float y) const;
+	bool ComputePortal(int iFrom, int iTo, int iDir, float flHalfWidth, const Vector& vecPrev, Vector& vecPortal) const;
+
+	std::vector<CNavMeshArea> m_Areas;
+	std::vector<int> m_Connects; // indices into m_Areas
+
+	// uniform grid over the XY extent of the mesh, each cell lists the areas overlapping it
+	std::vector<int> m_GridCellStart;
+	std::vector<int> m_GridAreas;
+	float m_flGridMinX;
+	float m_flGridMinY;
+	int m_iGridSizeX;
+	int m_iGridSizeY;
+
+	// A* bookkeeping, valid for an area when its marker matches m_iSearchMarker
+	std::vector<unsigned int> m_SearchMarker;
+	std::vector<bool> m_SearchClosed;
+	std::vector<float> m_SearchCost;
+	std::vector<int> m_SearchParent;
+	std::vector<int> m_SearchParentDir;
+	std::vector<int> m_PathAreas;
+	unsigned int m_iSearchMarker;
+};
+
+extern CNavMesh WorldNavMesh;
@@ -292,6 +292,7 @@ void CNihilanth::Spawn()
 
 	pev->flags |= FL_MONSTER | FL_FLY;
 	pev->takedamage = DAMAGE_AIM;
+	UTIL_AutoaimTakeDamageChanged(edict());
 	if (pev->health == 0)
 		pev->health = gSkillData.nihilanthHealth;
 	pev->view_ofs = Vector(0, 0, 300);
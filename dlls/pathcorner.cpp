@@ -16,11 +16,15 @@
 // ========================== PATH_CORNER ===========================
 //
 
+#include <unordered_map>
+#include <vector>
+
 #include "extdll.h"
 #include "util.h"
 #include "cbase.h"
 #include "trains.h"
 #include "saverestore.h"
+#include "game.h"
 
 class CPathCorner : public CPointEntity
 {
@@ -190,6 +194,8 @@ void CPathTrack::Use(CBaseEntity* pActivator, CBaseEntity* pCaller, USE_TYPE use
 				ClearBits(pev->spawnflags, SF_PATH_DISABLED);
 		}
 	}
+
+	PathsChanged();
 }
 
 
@@ -242,6 +248,8 @@ void CPathTrack::Activate()
 	if (!FStringNull(pev->targetname)) // Link to next, and back-link
 		Link();
 
+	PathsChanged();
+
 	CPointEntity::Activate();
 }
 
@@ -295,8 +303,189 @@ void CPathTrack::SetPrevious(CPathTrack* pprev)
 }
 
 
+#define PATH_FORWARD 0
+#define PATH_BACKWARD 1
+
+//=========================================================
+// Arc length tables
+//
+// A table lists the path_tracks met going one way from a
+// node, up to the end of the path or a node that already
+// sits in another table (a loop closing or two paths
+// joining), with the length of the segment entering each.
+// They are built the first time LookAhead passes through a
+// node and thrown away whenever PathsChanged, so they follow
+// the path_tracks as they are toggled and switched over.
+// LookAhead uses them to cross whole segments without
+// following the links or taking a square root, subtracting
+// the same float lengths the walk would, and walks the last
+// one as before.
+//=========================================================
+struct pathtable_t
+{
+	std::vector<CPathTrack*> nodes;
+	std::vector<float> length;	  // of the segment entering each node, as the walk computes it
+	std::vector<int> zeroStop;	  // first node after this one entered through a zero length segment
+	std::vector<int> disabledStop; // first node after this one that is disabled
+	bool moving;				  // some node moves with another entity, walk it instead
+};
+
+//=========================================================
+// The path_tracks Nearest visits from a node, with their
+// origins side by side. Also dropped when PathsChanged.
+//=========================================================
+struct pathchain_t
+{
+	std::vector<CPathTrack*> nodes;
+	std::vector<Vector> origins;
+	bool bad; // the chain never ends or comes back, Nearest reports it
+};
+
+static std::vector<pathtable_t> g_PathTables;
+static std::unordered_map<CPathTrack*, pathchain_t> g_PathChains;
+static int g_iPathSerial = 1;
+
+void CPathTrack::PathsChanged()
+{
+	g_iPathSerial++;
+	g_PathTables.clear();
+	g_PathChains.clear();
+}
+
+static CPathTrack* PathStep(CPathTrack* pnode, int dir)
+{
+	return dir == PATH_FORWARD ? pnode->GetNext() : pnode->GetPrevious();
+}
+
+static void BuildPathTable(CPathTrack* pstart, int dir)
+{
+	const int table = g_PathTables.size();
+	g_PathTables.emplace_back();
+
+	pathtable_t& t = g_PathTables.back();
+	std::vector<bool> zero;
+
+	t.moving = false;
+
+	for (CPathTrack* pnode = pstart; pnode != nullptr && pnode->m_iTableSerial[dir] != g_iPathSerial; pnode = PathStep(pnode, dir))
+	{
+		pnode->m_iTableSerial[dir] = g_iPathSerial;
+		pnode->m_iTable[dir] = table;
+		pnode->m_iTableIndex[dir] = t.nodes.size();
+
+		if (t.nodes.empty())
+		{
+			t.length.push_back(0);
+			zero.push_back(false);
+		}
+		else
+		{
+			// same float length the walk computes
+			const float length = (pnode->pev->origin - t.nodes.back()->pev->origin).Length();
+			t.length.push_back(length);
+			zero.push_back(0 == length);
+		}
+
+		if (pnode->m_pMoveWith != nullptr)
+			t.moving = true;
+
+		t.nodes.push_back(pnode);
+	}
+
+	const int count = t.nodes.size();
+	t.zeroStop.resize(count);
+	t.disabledStop.resize(count);
+	t.zeroStop[count - 1] = count;
+	t.disabledStop[count - 1] = count;
+
+	for (int i = count - 2; i >= 0; i--)
+	{
+		t.zeroStop[i] = zero[i + 1] ? i + 1 : t.zeroStop[i + 1];
+		t.disabledStop[i] = FBitSet(t.nodes[i + 1]->pev->spawnflags, SF_PATH_DISABLED) ? i + 1 : t.disabledStop[i + 1];
+	}
+}
+
+//=========================================================
+// SkipPath - moves from pnode, which the walk stands on,
+// over every whole segment it would cross anyway: each
+// longer than zero, ending at a node that is there (and
+// enabled when moving), and no longer than what is left
+// of dist once the ones before it are taken off.
+//=========================================================
+static CPathTrack* SkipPath(CPathTrack* pnode, int dir, float& dist, bool move, Vector& currentPos)
+{
+	if (pnode->m_iTableSerial[dir] != g_iPathSerial)
+		BuildPathTable(pnode, dir);
+
+	const pathtable_t& t = g_PathTables[pnode->m_iTable[dir]];
+	const int i = pnode->m_iTableIndex[dir];
+
+	if (t.moving)
+		return pnode;
+
+	const int last = V_min(t.zeroStop[i], move ? t.disabledStop[i] : (int)t.nodes.size()) - 1;
+
+	if (last <= i)
+		return pnode;
+
+	// the first segment longer than what is left stops the skip, the walk moves into it
+	int k = i;
+	while (k < last && t.length[k + 1] <= dist)
+	{
+		dist -= t.length[k + 1];
+		k++;
+	}
+
+	if (k == i)
+		return pnode;
+
+	currentPos = t.nodes[k]->pev->origin;
+	return t.nodes[k];
+}
+
+//=========================================================
+// NearestChain - the chain Nearest walks from pstart, made
+// the first time it is asked for. Null when a node moves
+// with another entity, Nearest walks those as before.
+//=========================================================
+static const pathchain_t* NearestChain(CPathTrack* pstart)
+{
+	auto it = g_PathChains.find(pstart);
+	if (it != g_PathChains.end())
+		return &it->second;
+
+	pathchain_t chain;
+	chain.bad = false;
+
+	for (CPathTrack* pnode = pstart; pnode != nullptr; pnode = pnode->GetNext())
+	{
+		// origins that follow another entity can't be kept
+		if (pnode->m_pMoveWith != nullptr)
+			return nullptr;
+
+		if (chain.nodes.size() > 9999)
+		{
+			chain.bad = true;
+			break;
+		}
+
+		chain.nodes.push_back(pnode);
+		chain.origins.push_back(pnode->pev->origin);
+
+		if (pnode->GetNext() == pstart)
+			break;
+	}
+
+	return &g_PathChains.emplace(pstart, std::move(chain)).first->second;
+}
+
 // Assumes this is ALWAYS enabled
 CPathTrack* CPathTrack::LookAhead(Vector* origin, float dist, bool move)
+{
+	return LookAheadWalk(origin, dist, move, sv_pathtables.value != 0);
+}
+
+CPathTrack* CPathTrack::LookAheadWalk(Vector* origin, float dist, bool move, bool useTables)
 {
 	CPathTrack* pcurrent;
 	float originalDist = dist;
@@ -330,6 +519,10 @@ CPathTrack* CPathTrack::LookAhead(Vector* origin, float dist, bool move)
 			{
 				dist -= length;
 				currentPos = pcurrent->pev->origin;
+
+				if (useTables && dist > 0)
+					pcurrent = SkipPath(pcurrent, PATH_BACKWARD, dist, move, currentPos);
+
 				*origin = currentPos;
 				if (ValidPath(pcurrent->GetPrevious(), move) == nullptr) // If there is no previous node, or it's disabled, return now.
 					return nullptr;
@@ -368,6 +561,10 @@ CPathTrack* CPathTrack::LookAhead(Vector* origin, float dist, bool move)
 				dist -= length;
 				currentPos = pcurrent->GetNext()->pev->origin;
 				pcurrent = pcurrent->GetNext();
+
+				if (useTables && dist > 0)
+					pcurrent = SkipPath(pcurrent, PATH_FORWARD, dist, move, currentPos);
+
 				*origin = currentPos;
 			}
 		}
@@ -391,6 +588,31 @@ CPathTrack* CPathTrack::Nearest(Vector origin)
 	delta.z = 0;
 	minDist = delta.Length();
 	pnearest = this;
+
+	const pathchain_t* pchain = sv_pathtables.value != 0 ? NearestChain(this) : nullptr;
+	if (pchain != nullptr)
+	{
+		if (pchain->bad)
+		{
+			ALERT(at_error, "Bad sequence of path_tracks from %s", STRING(pev->targetname));
+			return nullptr;
+		}
+
+		// the same nodes in the same order as the walk below
+		for (std::size_t i = 1; i < pchain->nodes.size(); i++)
+		{
+			delta = origin - pchain->origins[i];
+			delta.z = 0;
+			dist = delta.Length();
+			if (dist < minDist)
+			{
+				minDist = dist;
+				pnearest = pchain->nodes[i];
+			}
+		}
+		return pnearest;
+	}
+
 	ppath = GetNext();
 
 	// Hey, I could use the old 2 racing pointers solution to this, but I'm lazy :)
@@ -2631,6 +2631,8 @@ void CFuncTrackChange::UpdateAutoTargets(int toggleState)
 	else
 		SetBits(m_trackBottom->pev->spawnflags, SF_PATH_DISABLED);
 
+	CPathTrack::PathsChanged();
+
 	UpdateTrain(pev->origin); //fix now is func_trackchange BUG. G-Cont
 }
 
@@ -2737,12 +2739,16 @@ void CFuncTrackAuto::UpdateAutoTargets(int toggleState)
 	if (pTarget != nullptr)
 	{
 		ClearBits(pTarget->pev->spawnflags, SF_PATH_DISABLED);
+		CPathTrack::PathsChanged();
 		if (m_code == TRAIN_FOLLOWING && (m_train != nullptr) && m_train->pev->speed == 0)
 			m_train->Use(this, this, USE_ON, 0);
 	}
 
 	if (pNextTarget != nullptr)
+	{
 		SetBits(pNextTarget->pev->spawnflags, SF_PATH_DISABLED);
+		CPathTrack::PathsChanged();
+	}
 }
 
 
@@ -2970,6 +2976,7 @@ void CGunTarget::Use(CBaseEntity* pActivator, CBaseEntity* pCaller, USE_TYPE use
 	else
 	{
 		pev->takedamage = DAMAGE_AIM;
+		UTIL_AutoaimTakeDamageChanged(edict());
 		m_hTargetEnt = GetNextTarget();
 		if (m_hTargetEnt == nullptr)
 			return;
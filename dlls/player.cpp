@@ -26,6 +26,8 @@
 
 #include <limits>
 #include <algorithm>
+#include <set>
+#include <vector>
 
 #include "extdll.h"
 #include "util.h"
@@ -3170,6 +3172,7 @@ void CBasePlayer::Spawn()
 	pev->health = 100;
 	pev->armorvalue = 0;
 	pev->takedamage = DAMAGE_AIM;
+	UTIL_AutoaimTakeDamageChanged(edict());
 	pev->solid = SOLID_SLIDEBOX;
 	pev->movetype = MOVETYPE_WALK;
 	pev->max_health = pev->health;
@@ -4949,10 +4952,188 @@ Vector CBasePlayer::GetAutoaimVector(float flDelta)
 }
 
 
-Vector CBasePlayer::AutoaimDeflection(Vector& vecSrc, float flDist, float flDelta)
+//=========================================================
+// CAutoaimRegistry
+//
+// The DAMAGE_AIM entities autoaim picks from, by edict
+// index so they are tried in the order a full scan would.
+// Entities are added when their takedamage becomes
+// DAMAGE_AIM (see UTIL_AutoaimTakeDamageChanged), and
+// dropped by the next query once they are freed or their
+// takedamage has changed to something else. The world
+// clears it when a map starts.
+//=========================================================
+class CAutoaimRegistry
+{
+public:
+	void Clear();
+	void Add(edict_t* pEdict);
+	const std::vector<edict_t*>& Candidates();
+
+private:
+	std::set<int> m_Entries;
+	std::vector<edict_t*> m_Candidates;
+};
+
+static CAutoaimRegistry g_AutoaimRegistry;
+
+void CAutoaimRegistry::Clear()
+{
+	m_Entries.clear();
+	m_Candidates.clear();
+}
+
+void CAutoaimRegistry::Add(edict_t* pEdict)
+{
+	const int index = ENTINDEX(pEdict);
+
+	if (index > 0)
+		m_Entries.insert(index);
+}
+
+const std::vector<edict_t*>& CAutoaimRegistry::Candidates()
+{
+	m_Candidates.clear();
+
+	for (auto it = m_Entries.begin(); it != m_Entries.end();)
+	{
+		edict_t* pEdict = INDEXENT(*it);
+
+		if (pEdict == nullptr || 0 != pEdict->free || pEdict->v.takedamage != DAMAGE_AIM)
+		{
+			it = m_Entries.erase(it);
+			continue;
+		}
+
+		m_Candidates.push_back(pEdict);
+		++it;
+	}
+
+	return m_Candidates;
+}
+
+void UTIL_AutoaimTakeDamageChanged(edict_t* pEdict)
+{
+	if (pEdict->v.takedamage == DAMAGE_AIM)
+		g_AutoaimRegistry.Add(pEdict);
+}
+
+void UTIL_FlushAutoaimRegistry()
+{
+	g_AutoaimRegistry.Clear();
+}
+
+//=========================================================
+// AutoaimCulled - true when no point near pEdict can pass
+// the cone test in AutoaimTarget. BodyTarget stays within
+// the bounds, or within 1.1 times view_ofs of the center or
+// origin, so a sphere around those covers it and the
+// virtual calls and trace can be skipped. Players are
+// never culled, their BodyTarget takes a random number.
+//=========================================================
+static bool AutoaimCulled(edict_t* pEdict, const Vector& vecSrc, float flDist, float bestdot)
+{
+	if ((pEdict->v.flags & FL_CLIENT) != 0)
+		return false;
+
+	const Vector center = (pEdict->v.absmin + pEdict->v.absmax) * 0.5;
+	const float flViewOfs = pEdict->v.view_ofs.Length() * 1.1;
+	const float flRadius = V_max((pEdict->v.absmax - center).Length(), (pEdict->v.origin - center).Length() + flViewOfs) + 1;
+
+	const Vector delta = center - vecSrc;
+	const float flLength = delta.Length();
+
+	if (flLength <= flRadius)
+		return false;
+
+	// all of it behind the player
+	if (DotProduct(delta, gpGlobals->v_forward) < -flRadius)
+		return true;
+
+	const float flRight = V_max(0.0f, fabs(DotProduct(delta, gpGlobals->v_right)) - flRadius);
+	const float flUp = V_max(0.0f, fabs(DotProduct(delta, gpGlobals->v_up)) - flRadius);
+
+	float dot = (flRight + flUp * 0.5) / (flLength + flRadius);
+	dot *= 1.0 + 0.2 * ((flLength - flRadius) / flDist);
+
+	return dot > bestdot;
+}
+
+//=========================================================
+// AutoaimTarget - tests one entity for autoaim, taking it
+// as the new best target when it is closer to the crosshair
+// than bestdot
+//=========================================================
+bool CBasePlayer::AutoaimTarget(edict_t* pEdict, const Vector& vecSrc, float flDist, float& bestdot, Vector& bestdir)
 {
-	edict_t* pEdict = UTIL_GetEntityList() + 1;
 	CBaseEntity* pEntity;
+	Vector center;
+	Vector dir;
+	float dot;
+	TraceResult tr;
+
+	if (0 != pEdict->free) // Not in use
+		return false;
+
+	if (pEdict->v.takedamage != DAMAGE_AIM)
+		return false;
+	if (pEdict == edict())
+		return false;
+	//		if (pev->team > 0 && pEdict->v.team == pev->team)
+	//			return false;	// don't aim at teammate
+	if (!g_pGameRules->ShouldAutoAim(this, pEdict))
+		return false;
+
+	pEntity = Instance(pEdict);
+	if (pEntity == nullptr)
+		return false;
+
+	if (!pEntity->IsAlive())
+		return false;
+
+	// don't look through water
+	if ((pev->waterlevel != 3 && pEntity->pev->waterlevel == 3) || (pev->waterlevel == 3 && pEntity->pev->waterlevel == 0))
+		return false;
+
+	center = pEntity->BodyTarget(vecSrc);
+
+	dir = (center - vecSrc).Normalize();
+
+	// make sure it's in front of the player
+	if (DotProduct(dir, gpGlobals->v_forward) < 0)
+		return false;
+
+	dot = fabs(DotProduct(dir, gpGlobals->v_right)) + fabs(DotProduct(dir, gpGlobals->v_up)) * 0.5;
+
+	// tweek for distance
+	dot *= 1.0 + 0.2 * ((center - vecSrc).Length() / flDist);
+
+	if (dot > bestdot)
+		return false; // to far to turn
+
+	UTIL_TraceLine(vecSrc, center, dont_ignore_monsters, edict(), &tr);
+	if (tr.flFraction != 1.0 && tr.pHit != pEdict)
+	{
+		// ALERT( at_console, "hit %s, can't see %s\n", STRING( tr.pHit->v.classname ), STRING( pEdict->v.classname ) );
+		return false;
+	}
+
+	// don't shoot at friends
+	if (IRelationship(pEntity) < 0)
+	{
+		if (!pEntity->IsPlayer() && !g_pGameRules->IsDeathmatch())
+			// ALERT( at_console, "friend\n");
+			return false;
+	}
+
+	// can shoot at this one
+	bestdot = dot;
+	bestdir = dir;
+	return true;
+}
+
+Vector CBasePlayer::AutoaimDeflection(Vector& vecSrc, float flDist, float flDelta)
+{
 	float bestdot;
 	Vector bestdir;
 	edict_t* bestent;
@@ -4988,70 +5169,26 @@ Vector CBasePlayer::AutoaimDeflection(Vector& vecSrc, float flDist, float flDelt
 		}
 	}
 
-	for (int i = 1; i < gpGlobals->maxEntities; i++, pEdict++)
+	if (sv_aimregistry.value != 0)
 	{
-		Vector center;
-		Vector dir;
-		float dot;
-
-		if (0 != pEdict->free) // Not in use
-			continue;
-
-		if (pEdict->v.takedamage != DAMAGE_AIM)
-			continue;
-		if (pEdict == edict())
-			continue;
-		//		if (pev->team > 0 && pEdict->v.team == pev->team)
-		//			continue;	// don't aim at teammate
-		if (!g_pGameRules->ShouldAutoAim(this, pEdict))
-			continue;
-
-		pEntity = Instance(pEdict);
-		if (pEntity == nullptr)
-			continue;
-
-		if (!pEntity->IsAlive())
-			continue;
-
-		// don't look through water
-		if ((pev->waterlevel != 3 && pEntity->pev->waterlevel == 3) || (pev->waterlevel == 3 && pEntity->pev->waterlevel == 0))
-			continue;
-
-		center = pEntity->BodyTarget(vecSrc);
-
-		dir = (center - vecSrc).Normalize();
-
-		// make sure it's in front of the player
-		if (DotProduct(dir, gpGlobals->v_forward) < 0)
-			continue;
-
-		dot = fabs(DotProduct(dir, gpGlobals->v_right)) + fabs(DotProduct(dir, gpGlobals->v_up)) * 0.5;
-
-		// tweek for distance
-		dot *= 1.0 + 0.2 * ((center - vecSrc).Length() / flDist);
-
-		if (dot > bestdot)
-			continue; // to far to turn
-
-		UTIL_TraceLine(vecSrc, center, dont_ignore_monsters, edict(), &tr);
-		if (tr.flFraction != 1.0 && tr.pHit != pEdict)
+		for (edict_t* pEdict : g_AutoaimRegistry.Candidates())
 		{
-			// ALERT( at_console, "hit %s, can't see %s\n", STRING( tr.pHit->v.classname ), STRING( pEdict->v.classname ) );
-			continue;
+			if (AutoaimCulled(pEdict, vecSrc, flDist, bestdot))
+				continue;
+
+			if (AutoaimTarget(pEdict, vecSrc, flDist, bestdot, bestdir))
+				bestent = pEdict;
 		}
+	}
+	else
+	{
+		edict_t* pEdict = UTIL_GetEntityList() + 1;
 
-		// don't shoot at friends
-		if (IRelationship(pEntity) < 0)
+		for (int i = 1; i < gpGlobals->maxEntities; i++, pEdict++)
 		{
-			if (!pEntity->IsPlayer() && !g_pGameRules->IsDeathmatch())
-				// ALERT( at_console, "friend\n");
-				continue;
+			if (AutoaimTarget(pEdict, vecSrc, flDist, bestdot, bestdir))
+				bestent = pEdict;
 		}
-
-		// can shoot at this one
-		bestdot = dot;
-		bestent = pEdict;
-		bestdir = dir;
 	}
 
 	if (bestent != nullptr)
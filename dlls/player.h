@@ -333,6 +333,7 @@ public:
 	void ResetAutoaim();
 	Vector GetAutoaimVector(float flDelta);
 	Vector AutoaimDeflection(Vector& vecSrc, float flDist, float flDelta);
+	bool AutoaimTarget(edict_t* pEdict, const Vector& vecSrc, float flDist, float& bestdot, Vector& bestdir);
 
 	void ForceClientDllUpdate(); // Forces all client .dll specific data to be resent to client.
 
@@ -0,0 +1,141 @@
+/***
+*
+*	Copyright (c) 1996-2001, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+//=========================================================
+// pmrecord.cpp - records the first player's usercmds in the
+// stream format read by utils/pmreplay while sv_pmrecord
+// names a file.
+//=========================================================
+
+#include <cstdio>
+#include <string>
+
+#include "extdll.h"
+#include "util.h"
+#include "client.h"
+#include "game.h"
+#include "pm_defs.h"
+#include "pm_movevars.h"
+#include "pm_shared.h"
+
+#define PMRECORD_VERSION 1 // keep in sync with PMREPLAY_VERSION
+
+static FILE* g_pRecordFile = nullptr;
+static std::string g_RecordName;
+static std::string g_RecordMap;
+
+static void PM_WriteRecordHeader(const playermove_t* ppmove)
+{
+	const movevars_t* mv = ppmove->movevars;
+
+	fprintf(g_pRecordFile, "pmreplay %d\n", PMRECORD_VERSION);
+	fprintf(g_pRecordFile, "map %s\n", STRING(gpGlobals->mapname));
+
+	fprintf(g_pRecordFile, "movevar gravity %.9g\nmovevar stopspeed %.9g\nmovevar maxspeed %.9g\nmovevar spectatormaxspeed %.9g\n", mv->gravity, mv->stopspeed, mv->maxspeed, mv->spectatormaxspeed);
+	fprintf(g_pRecordFile, "movevar accelerate %.9g\nmovevar airaccelerate %.9g\nmovevar wateraccelerate %.9g\n", mv->accelerate, mv->airaccelerate, mv->wateraccelerate);
+	fprintf(g_pRecordFile, "movevar friction %.9g\nmovevar edgefriction %.9g\nmovevar waterfriction %.9g\nmovevar entgravity %.9g\n", mv->friction, mv->edgefriction, mv->waterfriction, mv->entgravity);
+	fprintf(g_pRecordFile, "movevar bounce %.9g\nmovevar stepsize %.9g\nmovevar maxvelocity %.9g\nmovevar zmax %.9g\n", mv->bounce, mv->stepsize, mv->maxvelocity, mv->zmax);
+	fprintf(g_pRecordFile, "movevar waveHeight %.9g\nmovevar rollangle %.9g\nmovevar rollspeed %.9g\nmovevar footsteps %d\n", mv->waveHeight, mv->rollangle, mv->rollspeed, mv->footsteps);
+
+	if ('\0' != ppmove->physinfo[0])
+		fprintf(g_pRecordFile, "physinfo %s\n", ppmove->physinfo);
+
+	fprintf(g_pRecordFile, "state origin %.9g %.9g %.9g\n", ppmove->origin.x, ppmove->origin.y, ppmove->origin.z);
+	fprintf(g_pRecordFile, "state velocity %.9g %.9g %.9g\n", ppmove->velocity.x, ppmove->velocity.y, ppmove->velocity.z);
+	fprintf(g_pRecordFile, "state basevelocity %.9g %.9g %.9g\n", ppmove->basevelocity.x, ppmove->basevelocity.y, ppmove->basevelocity.z);
+	fprintf(g_pRecordFile, "state view_ofs %.9g %.9g %.9g\n", ppmove->view_ofs.x, ppmove->view_ofs.y, ppmove->view_ofs.z);
+	fprintf(g_pRecordFile, "state punchangle %.9g %.9g %.9g\n", ppmove->punchangle.x, ppmove->punchangle.y, ppmove->punchangle.z);
+	fprintf(g_pRecordFile, "state duck_time %.9g\nstate in_duck %d\n", ppmove->flDuckTime, ppmove->bInDuck);
+	fprintf(g_pRecordFile, "state step_sound_time %d\nstate step_left %d\n", ppmove->flTimeStepSound, ppmove->iStepLeft);
+	fprintf(g_pRecordFile, "state fall_velocity %.9g\nstate swim_time %.9g\n", ppmove->flFallVelocity, ppmove->flSwimTime);
+	fprintf(g_pRecordFile, "state flags %d\nstate usehull %d\n", ppmove->flags, ppmove->usehull);
+	fprintf(g_pRecordFile, "state gravity %.9g\nstate friction %.9g\n", ppmove->gravity, ppmove->friction);
+	fprintf(g_pRecordFile, "state oldbuttons %d\nstate waterjump_time %.9g\n", ppmove->oldbuttons, ppmove->waterjumptime);
+	fprintf(g_pRecordFile, "state movetype %d\nstate waterlevel %d\nstate watertype %d\n", ppmove->movetype, ppmove->waterlevel, ppmove->watertype);
+	fprintf(g_pRecordFile, "state clientmaxspeed %.9g\n", ppmove->clientmaxspeed);
+}
+
+static void PM_StopRecording()
+{
+	fclose(g_pRecordFile);
+	g_pRecordFile = nullptr;
+	ALERT(at_console, "Stopped recording player movement to %s\n", g_RecordName.c_str());
+
+	// so setting the same name again starts a new recording
+	g_RecordName.clear();
+}
+
+static void PM_UpdateRecordFile(const playermove_t* ppmove)
+{
+	// a stream covers one map, set sv_pmrecord again to record the next one
+	if (g_pRecordFile && g_RecordMap != STRING(gpGlobals->mapname))
+	{
+		PM_StopRecording();
+		CVAR_SET_STRING("sv_pmrecord", "");
+		return;
+	}
+
+	if (g_RecordName == sv_pmrecord.string)
+		return;
+
+	if (g_pRecordFile)
+		PM_StopRecording();
+
+	g_RecordName = sv_pmrecord.string;
+
+	if (g_RecordName.empty())
+		return;
+
+	g_pRecordFile = fopen(g_RecordName.c_str(), "w");
+
+	if (!g_pRecordFile)
+	{
+		ALERT(at_console, "Couldn't open %s for recording\n", g_RecordName.c_str());
+		return;
+	}
+
+	g_RecordMap = STRING(gpGlobals->mapname);
+	ALERT(at_console, "Recording player movement to %s\n", g_RecordName.c_str());
+	PM_WriteRecordHeader(ppmove);
+}
+
+//=========================================================
+// ServerPM_Move - runs the shared movement code for the
+// engine, writing the command and where it ended up when
+// recording
+//=========================================================
+void ServerPM_Move(struct playermove_s* ppmove, qboolean server)
+{
+	if (0 == server || 0 != ppmove->player_index || (!g_pRecordFile && '\0' == sv_pmrecord.string[0]))
+	{
+		PM_Move(ppmove, server);
+		return;
+	}
+
+	PM_UpdateRecordFile(ppmove);
+
+	if (!g_pRecordFile)
+	{
+		PM_Move(ppmove, server);
+		return;
+	}
+
+	const usercmd_t& cmd = ppmove->cmd;
+
+	fprintf(g_pRecordFile, "cmd %d %.9g %.9g %.9g %.9g %.9g %.9g %d %d\n", cmd.msec, cmd.viewangles.x, cmd.viewangles.y, cmd.viewangles.z, cmd.forwardmove, cmd.sidemove, cmd.upmove, cmd.buttons, cmd.impulse);
+
+	PM_Move(ppmove, server);
+
+	fprintf(g_pRecordFile, "pos %.9g %.9g %.9g\n", ppmove->origin.x, ppmove->origin.y, ppmove->origin.z);
+}
@@ -35,6 +35,8 @@ public:
 	edict_t* EntityFromIndex(int entityIndex);
 
 	unsigned short TokenHash(const char* pszToken);
+	// Same as TokenHash, but skips the lookup if cachedToken already names pszToken in this table
+	unsigned short CachedTokenHash(const char* pszToken, unsigned short& cachedToken);
 
 	const SAVERESTOREDATA& GetData() const { return m_data; }
 
@@ -92,6 +94,7 @@ private:
 	void BufferString(char* pdata, int len);
 	void BufferData(const char* pdata, int size);
 	void BufferHeader(const char* pname, int size);
+	void BufferHeader(unsigned short token, int size);
 };
 
 typedef struct
@@ -118,6 +121,7 @@ public:
 	void PrecacheMode(bool mode) { m_precache = mode; }
 
 private:
+	void ReadFieldData(void* pBaseData, TYPEDESCRIPTION* pField, void* pData);
 	char* BufferPointer();
 	void BufferReadBytes(char* pOutput, int size);
 	void BufferSkipBytes(int bytes);
@@ -132,6 +136,9 @@ private:
 
 #define MAX_ENTITYARRAY 64
 
+// Registers sv_saverestore_benchmark, which times saving and restoring the current level
+void InitSaveRestoreBenchmark();
+
 //#define std::size(p)		(sizeof(p)/sizeof(p[0]))
 
 #define IMPLEMENT_SAVERESTORE(derivedClass, baseClass)                                                                \
@@ -1279,6 +1279,7 @@ void CFurniture::Spawn()
 	pev->solid = SOLID_BBOX;
 	pev->health = 80000;
 	pev->takedamage = DAMAGE_AIM;
+	UTIL_AutoaimTakeDamageChanged(edict());
 	pev->effects = 0;
 	pev->yaw_speed = 0;
 	pev->sequence = 0;
@@ -120,6 +120,7 @@ void CSqueakGrenade::Spawn()
 
 	pev->flags |= FL_MONSTER;
 	pev->takedamage = DAMAGE_AIM;
+	UTIL_AutoaimTakeDamageChanged(edict());
 	if (pev->health == 0)
 		pev->health = gSkillData.snarkHealth;
 	pev->gravity = 0.5;
@@ -30,9 +30,11 @@
 #include "nodes.h"
 #include "doors.h"
 #include "movewith.h"
+#include "trains.h"
 #include "player.h"
 #include "locus.h"
 #include "UserMessages.h"
+#include "perf_trace.h"
 
 #define ACCELTIMEINCREMENT 0.1 //AJH for acceleration/deceleration time steps
 
@@ -99,6 +101,10 @@ void CBaseEntity::UpdateOnRemove()
 	int i;
 	CBaseEntity* pTemp;
 
+	// the path tables and chains point at path_tracks
+	if (FClassnameIs(pev, "path_track"))
+		CPathTrack::PathsChanged();
+
 	if (g_pWorld == nullptr)
 	{
 		ALERT(at_debug, "UpdateOnRemove has no AssistList!\n");
@@ -265,6 +271,8 @@ void CBaseEntity::SUB_UseTargets(CBaseEntity* pActivator, USE_TYPE useType, floa
 
 void FireTargets(const char* targetName, CBaseEntity* pActivator, CBaseEntity* pCaller, USE_TYPE useType, float value)
 {
+	PERF_SCOPE("FireTargets");
+
 	const char* inputTargetName = targetName;
 	CBaseEntity* inputActivator = pActivator;
 	CBaseEntity* pTarget = nullptr;
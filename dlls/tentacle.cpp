@@ -263,6 +263,7 @@ void CTentacle::Spawn()
 	UTIL_SetSize(pev, Vector(-32, -32, 0), Vector(32, 32, 64));
 
 	pev->takedamage = DAMAGE_AIM;
+	UTIL_AutoaimTakeDamageChanged(edict());
 	pev->flags |= FL_MONSTER;
 
 	m_bloodColor = BLOOD_COLOR_GREEN;
@@ -72,8 +72,12 @@ public:
 	static CPathTrack* Instance(edict_t* pent);
 
 	CPathTrack* LookAhead(Vector* origin, float dist, bool move);
+	CPathTrack* LookAheadWalk(Vector* origin, float dist, bool move, bool useTables);
 	CPathTrack* Nearest(Vector origin);
 
+	// path_tracks were toggled, switched over or removed, so the arc length tables go
+	static void PathsChanged();
+
 	CPathTrack* GetNext();
 	CPathTrack* GetPrevious();
 
@@ -90,6 +94,11 @@ public:
 	CPathTrack* m_pnext;
 	CPathTrack* m_pprevious;
 	CPathTrack* m_paltpath;
+
+	// where this node sits in the arc length tables, by direction. Not saved
+	int m_iTableSerial[2];
+	int m_iTable[2];
+	int m_iTableIndex[2];
 };
 
 class CTrainSequence;
@@ -920,6 +920,7 @@ CMultiManager* CMultiManager::Clone()
 	edict_t* pEdict = pMulti->pev->pContainingEntity;
 	memcpy(pMulti->pev, pev, sizeof(*pev));
 	pMulti->pev->pContainingEntity = pEdict;
+	UTIL_LocusTargetnamesChanged(); // the clone shares our targetname
 
 	pMulti->pev->spawnflags |= SF_MULTIMAN_CLONE;
 	pMulti->m_cTargets = m_cTargets;
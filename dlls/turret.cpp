@@ -264,6 +264,7 @@ void CBaseTurret::Spawn()
 	pev->frame = 0;
 	pev->solid = SOLID_SLIDEBOX;
 	pev->takedamage = DAMAGE_AIM;
+	UTIL_AutoaimTakeDamageChanged(edict());
 
 	SetBits(pev->flags, FL_MONSTER);
 	SetUse(&CBaseTurret::TurretUse);
@@ -21,6 +21,8 @@
 */
 
 #include <algorithm>
+#include <unordered_map>
+#include <vector>
 
 #include "extdll.h"
 #include "util.h"
@@ -35,6 +37,7 @@
 #include "UserMessages.h"
 #include "movewith.h"
 #include "locus.h"
+#include "perf_counter.h"
 
 float UTIL_WeaponTimeBase()
 {
@@ -2021,6 +2024,7 @@ void UTIL_Remove(CBaseEntity* pEntity)
 	pEntity->UpdateOnRemove();
 	pEntity->pev->flags |= FL_KILLME;
 	pEntity->pev->targetname = 0;
+	UTIL_LocusTargetnamesChanged();
 }
 
 
@@ -2168,6 +2172,129 @@ static int gSizes[FIELD_TYPECOUNT] =
 };
 
 
+// Layout of a TYPEDESCRIPTION array, worked out the first time the array is saved or
+// restored. Field sizes are fixed for the life of the dll; tokens are indices into
+// whichever token table was last used, and are checked before they're trusted.
+struct savefieldschema_t
+{
+	std::vector<int> byteSizes;			// fieldSize * gSizes[fieldType]
+	std::vector<unsigned short> tokens; // cached TokenHash() of each fieldName
+	bool duplicateNames = false;		// restore has to search by name, the match depends on where it starts
+
+	// Field each slot of the token table being restored was found to name, -1 until then
+	int restoreSession = 0;
+	std::vector<short> restoreFields;
+};
+
+static std::unordered_map<const TYPEDESCRIPTION*, savefieldschema_t> g_SaveFieldSchemas;
+
+static savefieldschema_t& GetSaveFieldSchema(const TYPEDESCRIPTION* pFields, int fieldCount)
+{
+	savefieldschema_t& schema = g_SaveFieldSchemas[pFields];
+
+	if (static_cast<int>(schema.byteSizes.size()) != fieldCount)
+	{
+		schema.byteSizes.resize(fieldCount);
+		schema.tokens.assign(fieldCount, USHRT_MAX);
+
+		for (int i = 0; i < fieldCount; i++)
+			schema.byteSizes[i] = pFields[i].fieldSize * gSizes[pFields[i].fieldType];
+
+		schema.duplicateNames = false;
+		for (int i = 0; i < fieldCount && !schema.duplicateNames; i++)
+		{
+			for (int j = i + 1; j < fieldCount; j++)
+			{
+				if (pFields[i].fieldName != nullptr && pFields[j].fieldName != nullptr && !stricmp(pFields[i].fieldName, pFields[j].fieldName))
+				{
+					schema.duplicateNames = true;
+					break;
+				}
+			}
+		}
+
+		schema.restoreSession = 0;
+		schema.restoreFields.clear();
+	}
+
+	return schema;
+}
+
+// Finds the field called pName, starting the search at startField. Returns -1 if there is none.
+static int FindFieldByName(TYPEDESCRIPTION* pFields, int fieldCount, int startField, const char* pName)
+{
+	for (int i = 0; i < fieldCount; i++)
+	{
+		const int fieldNumber = (i + startField) % fieldCount;
+		if ((pFields[fieldNumber].fieldName != nullptr) && !stricmp(pFields[fieldNumber].fieldName, pName))
+			return fieldNumber;
+	}
+
+	return -1;
+}
+
+// Token table whose slots the schemas' restoreFields currently describe
+static struct
+{
+	char** pTokens;
+	char* pBaseData;
+	int tokenCount;
+	float time;
+	int session;
+} g_RestoreTokens;
+
+// Resolves the field a saved token names through the schema. The name is only searched for
+// the first time a class sees a token slot, after that it's a lookup by index. A later save
+// can look like the same table and hash its names into other slots, so a hit is only taken
+// when the field still has the token's name.
+static int FindRestoreField(const SAVERESTOREDATA& data, savefieldschema_t& schema, TYPEDESCRIPTION* pFields, int fieldCount, int startField, unsigned short token)
+{
+	if (schema.duplicateNames || token >= data.tokenCount)
+		return FindFieldByName(pFields, fieldCount, startField, data.pTokens[token]);
+
+	// A new table means a new save or transition is being read
+	if (g_RestoreTokens.pTokens != data.pTokens || g_RestoreTokens.pBaseData != data.pBaseData || g_RestoreTokens.tokenCount != data.tokenCount || g_RestoreTokens.time != data.time)
+	{
+		g_RestoreTokens.pTokens = data.pTokens;
+		g_RestoreTokens.pBaseData = data.pBaseData;
+		g_RestoreTokens.tokenCount = data.tokenCount;
+		g_RestoreTokens.time = data.time;
+		g_RestoreTokens.session++;
+	}
+
+	if (schema.restoreSession != g_RestoreTokens.session)
+	{
+		schema.restoreSession = g_RestoreTokens.session;
+		schema.restoreFields.assign(data.tokenCount, -1);
+	}
+
+	short& field = schema.restoreFields[token];
+
+	if (field >= 0 && !stricmp(pFields[field].fieldName, data.pTokens[token]))
+		return field;
+
+	// names the class doesn't have are searched again, they may be a field in another save
+	field = FindFieldByName(pFields, fieldCount, startField, data.pTokens[token]);
+	return field;
+}
+
+// Field types whose saved form is just their bytes in memory
+static bool IsPlainSaveField(int fieldType)
+{
+	switch (fieldType)
+	{
+	case FIELD_FLOAT:
+	case FIELD_INTEGER:
+	case FIELD_INT64:
+	case FIELD_SHORT:
+	case FIELD_CHARACTER:
+	case FIELD_VECTOR:
+		return true;
+	default:
+		return false;
+	}
+}
+
 // Base class includes common SAVERESTOREDATA pointer, and manages the entity table
 CSaveRestoreBuffer::CSaveRestoreBuffer(SAVERESTOREDATA& data)
 	: m_data(data)
@@ -2332,6 +2459,21 @@ unsigned short CSaveRestoreBuffer::TokenHash(const char* pszToken)
 	return 0;
 }
 
+unsigned short CSaveRestoreBuffer::CachedTokenHash(const char* pszToken, unsigned short& cachedToken)
+{
+	// A name is only ever stored in one slot of the table, so if the cached slot holds it,
+	// that's the slot TokenHash would have found.
+	if (cachedToken < m_data.tokenCount && nullptr != m_data.pTokens)
+	{
+		const char* pszCached = m_data.pTokens[cachedToken];
+		if (pszCached == pszToken || (pszCached != nullptr && strcmp(pszCached, pszToken) == 0))
+			return cachedToken;
+	}
+
+	cachedToken = TokenHash(pszToken);
+	return cachedToken;
+}
+
 void CSave::WriteData(const char* pname, int size, const char* pdata)
 {
 	BufferField(pname, size, pdata);
@@ -2534,48 +2676,74 @@ bool CSave::WriteEntVars(const char* pname, entvars_t* pev)
 
 bool CSave::WriteFields(const char* cname, const char* pname, void* pBaseData, TYPEDESCRIPTION* pFields, int fieldCount)
 {
-	int i, j, actualCount, emptyCount;
+	int i, j, actualCount;
 	TYPEDESCRIPTION* pTest;
 	int entityArray[MAX_ENTITYARRAY];
 	byte boolArray[MAX_ENTITYARRAY];
+	static std::vector<byte> fieldEmpty; // WriteFields never recurses, so this can be shared
+
+	savefieldschema_t& schema = GetSaveFieldSchema(pFields, fieldCount);
 
-	// Precalculate the number of empty fields
-	emptyCount = 0;
+	// Precalculate the number of empty fields, and remember which ones they were
+	fieldEmpty.resize(fieldCount);
+	actualCount = 0;
 	for (i = 0; i < fieldCount; i++)
 	{
-		void* pOutputData;
-		pOutputData = ((char*)pBaseData + pFields[i].fieldOffset);
-		if (DataEmpty((const char*)pOutputData, pFields[i].fieldSize * gSizes[pFields[i].fieldType]))
-			emptyCount++;
+		fieldEmpty[i] = DataEmpty((const char*)pBaseData + pFields[i].fieldOffset, schema.byteSizes[i]) ? 1 : 0;
+		if (0 == fieldEmpty[i])
+			actualCount++;
 	}
 
 	// Empty fields will not be written, write out the actual number of fields to be written
-	actualCount = fieldCount - emptyCount;
 	WriteInt(pname, &actualCount, 1);
 
 	for (i = 0; i < fieldCount; i++)
 	{
+		if (0 != fieldEmpty[i])
+			continue;
+
 		void* pOutputData;
 		pTest = &pFields[i];
 		pOutputData = ((char*)pBaseData + pTest->fieldOffset);
 
-		// UNDONE: Must we do this twice?
-		if (DataEmpty((const char*)pOutputData, pTest->fieldSize * gSizes[pTest->fieldType]))
+		const unsigned short token = CachedTokenHash(pTest->fieldName, schema.tokens[i]);
+
+		// Plain data goes out as one block
+		if (IsPlainSaveField(pTest->fieldType))
+		{
+			BufferHeader(token, schema.byteSizes[i]);
+			BufferData((const char*)pOutputData, schema.byteSizes[i]);
 			continue;
+		}
 
 		switch (pTest->fieldType)
 		{
-		case FIELD_FLOAT:
-			WriteFloat(pTest->fieldName, (float*)pOutputData, pTest->fieldSize);
-			break;
 		case FIELD_TIME:
-			WriteTime(pTest->fieldName, (float*)pOutputData, pTest->fieldSize);
+			BufferHeader(token, sizeof(float) * pTest->fieldSize);
+			for (j = 0; j < pTest->fieldSize; j++)
+			{
+				// Always encode time as a delta from the current time so it can be re-based if loaded in a new level
+				// Times of 0 are never written to the file, so they will be restored as 0, not a relative time
+				float tmp = ((float*)pOutputData)[j] - m_data.time;
+				BufferData((const char*)&tmp, sizeof(float));
+			}
 			break;
 		case FIELD_MODELNAME:
 		case FIELD_SOUNDNAME:
 		case FIELD_STRING:
-			WriteString(pTest->fieldName, (int*)pOutputData, pTest->fieldSize);
-			break;
+		{
+			int size = 0;
+			for (j = 0; j < pTest->fieldSize; j++)
+				size += strlen(STRING(((int*)pOutputData)[j])) + 1;
+
+			BufferHeader(token, size);
+			for (j = 0; j < pTest->fieldSize; j++)
+			{
+				const char* pString = STRING(((int*)pOutputData)[j]);
+				BufferData(pString, strlen(pString) + 1);
+			}
+		}
+		break;
 		case FIELD_CLASSPTR:
 		case FIELD_EVARS:
 		case FIELD_EDICT:
@@ -2604,13 +2772,20 @@ bool CSave::WriteFields(const char* cname, const char* pname, void* pBaseData, T
 					break;
 				}
 			}
-			WriteInt(pTest->fieldName, entityArray, pTest->fieldSize);
+			BufferHeader(token, sizeof(int) * pTest->fieldSize);
+			BufferData((const char*)entityArray, sizeof(int) * pTest->fieldSize);
 			break;
 		case FIELD_POSITION_VECTOR:
-			WritePositionVector(pTest->fieldName, (float*)pOutputData, pTest->fieldSize);
-			break;
-		case FIELD_VECTOR:
-			WriteVector(pTest->fieldName, (float*)pOutputData, pTest->fieldSize);
+			BufferHeader(token, sizeof(float) * 3 * pTest->fieldSize);
+			for (j = 0; j < pTest->fieldSize; j++)
+			{
+				Vector tmp(((float*)pOutputData) + j * 3);
+
+				if (0 != m_data.fUseLandmark)
+					tmp = tmp - m_data.vecLandmarkOffset;
+
+				BufferData((const char*)&tmp.x, sizeof(float) * 3);
+			}
 			break;
 
 		case FIELD_BOOLEAN:
@@ -2622,29 +2797,15 @@ bool CSave::WriteFields(const char* cname, const char* pname, void* pBaseData, T
 				boolArray[j] = ((bool*)pOutputData)[j] ? 1 : 0;
 			}
 
-			WriteData(pTest->fieldName, pTest->fieldSize, (char*)boolArray);
+			BufferHeader(token, pTest->fieldSize);
+			BufferData((const char*)boolArray, pTest->fieldSize);
 		}
 		break;
 
-		case FIELD_INTEGER:
-			WriteInt(pTest->fieldName, (int*)pOutputData, pTest->fieldSize);
-			break;
-
-		case FIELD_INT64:
-			WriteData(pTest->fieldName, sizeof(std::uint64_t) * pTest->fieldSize, ((char*)pOutputData));
-			break;
-
-		case FIELD_SHORT:
-			WriteData(pTest->fieldName, 2 * pTest->fieldSize, ((char*)pOutputData));
-			break;
-
-		case FIELD_CHARACTER:
-			WriteData(pTest->fieldName, pTest->fieldSize, ((char*)pOutputData));
-			break;
-
 		// For now, just write the address out, we're not going to change memory while doing this yet!
 		case FIELD_POINTER:
-			WriteInt(pTest->fieldName, (int*)(char*)pOutputData, pTest->fieldSize);
+			BufferHeader(token, sizeof(int) * pTest->fieldSize);
+			BufferData((const char*)pOutputData, sizeof(int) * pTest->fieldSize);
 			break;
 
 		case FIELD_FUNCTION:
@@ -2688,7 +2849,13 @@ void CSave::BufferField(const char* pname, int size, const char* pdata)
 
 void CSave::BufferHeader(const char* pname, int size)
 {
-	short hashvalue = TokenHash(pname);
+	BufferHeader(TokenHash(pname), size);
+}
+
+
+void CSave::BufferHeader(unsigned short token, int size)
+{
+	short hashvalue = token;
 	if (size > 1 << (sizeof(short) * 8))
 		ALERT(at_error, "CSave::BufferHeader() size parameter exceeds 'short'!\n");
 	BufferData((const char*)&size, sizeof(short));
@@ -2720,8 +2887,24 @@ void CSave::BufferData(const char* pdata, int size)
 
 int CRestore::ReadField(void* pBaseData, TYPEDESCRIPTION* pFields, int fieldCount, int startField, int size, char* pName, void* pData)
 {
-	int i, j, stringCount, fieldNumber, entityIndex;
-	TYPEDESCRIPTION* pTest;
+	const int fieldNumber = FindFieldByName(pFields, fieldCount, startField, pName);
+
+	if (fieldNumber != -1)
+		ReadFieldData(pBaseData, &pFields[fieldNumber], pData);
+#if 0
+	else
+	{
+		ALERT( at_debug, "Skipping global field %s\n", pName );
+	}
+#endif
+
+	return fieldNumber;
+}
+
+
+void CRestore::ReadFieldData(void* pBaseData, TYPEDESCRIPTION* pTest, void* pData)
+{
+	int j, stringCount, entityIndex;
 	float timeData;
 	Vector position;
 	edict_t* pent;
@@ -2732,167 +2915,155 @@ int CRestore::ReadField(void* pBaseData, TYPEDESCRIPTION* pFields, int fieldCoun
 	if (0 != m_data.fUseLandmark)
 		position = m_data.vecLandmarkOffset;
 
-	for (i = 0; i < fieldCount; i++)
+	if ((!m_global || (pTest->flags & FTYPEDESC_GLOBAL) == 0) && IsPlainSaveField(pTest->fieldType))
 	{
-		fieldNumber = (i + startField) % fieldCount;
-		pTest = &pFields[fieldNumber];
-		if ((pTest->fieldName != nullptr) && !stricmp(pTest->fieldName, pName))
+		// Plain data comes back as one block
+		memcpy((char*)pBaseData + pTest->fieldOffset, pData, pTest->fieldSize * gSizes[pTest->fieldType]);
+	}
+	else if (!m_global || (pTest->flags & FTYPEDESC_GLOBAL) == 0)
+	{
+		for (j = 0; j < pTest->fieldSize; j++)
 		{
-			if (!m_global || (pTest->flags & FTYPEDESC_GLOBAL) == 0)
+			void* pOutputData = ((char*)pBaseData + pTest->fieldOffset + (j * gSizes[pTest->fieldType]));
+			void* pInputData = (char*)pData + j * gSizes[pTest->fieldType];
+
+			switch (pTest->fieldType)
 			{
-				for (j = 0; j < pTest->fieldSize; j++)
+			case FIELD_TIME:
+				timeData = *(float*)pInputData;
+				// Re-base time variables
+				timeData += m_data.time;
+				*((float*)pOutputData) = timeData;
+				break;
+			case FIELD_FLOAT:
+				*((float*)pOutputData) = *(float*)pInputData;
+				break;
+			case FIELD_MODELNAME:
+			case FIELD_SOUNDNAME:
+			case FIELD_STRING:
+				// Skip over j strings
+				pString = (char*)pData;
+				for (stringCount = 0; stringCount < j; stringCount++)
 				{
-					void* pOutputData = ((char*)pBaseData + pTest->fieldOffset + (j * gSizes[pTest->fieldType]));
-					void* pInputData = (char*)pData + j * gSizes[pTest->fieldType];
-
-					switch (pTest->fieldType)
-					{
-					case FIELD_TIME:
-						timeData = *(float*)pInputData;
-						// Re-base time variables
-						timeData += m_data.time;
-						*((float*)pOutputData) = timeData;
-						break;
-					case FIELD_FLOAT:
-						*((float*)pOutputData) = *(float*)pInputData;
-						break;
-					case FIELD_MODELNAME:
-					case FIELD_SOUNDNAME:
-					case FIELD_STRING:
-						// Skip over j strings
-						pString = (char*)pData;
-						for (stringCount = 0; stringCount < j; stringCount++)
-						{
-							while ('\0' != *pString)
-								pString++;
-							pString++;
-						}
-						pInputData = pString;
-						if (strlen((char*)pInputData) == 0)
-							*((int*)pOutputData) = 0;
-						else
-						{
-							int string;
+					while ('\0' != *pString)
+						pString++;
+					pString++;
+				}
+				pInputData = pString;
+				if (strlen((char*)pInputData) == 0)
+					*((int*)pOutputData) = 0;
+				else
+				{
+					int string;
 
-							string = ALLOC_STRING((char*)pInputData);
+					string = ALLOC_STRING((char*)pInputData);
 
-							*((int*)pOutputData) = string;
+					*((int*)pOutputData) = string;
 
-							if (!FStringNull(string) && m_precache)
-							{
-								if (pTest->fieldType == FIELD_MODELNAME)
-									PRECACHE_MODEL((char*)STRING(string));
-								else if (pTest->fieldType == FIELD_SOUNDNAME)
-									PRECACHE_SOUND((char*)STRING(string));
-							}
-						}
-						break;
-					case FIELD_EVARS:
-						entityIndex = *(int*)pInputData;
-						pent = EntityFromIndex(entityIndex);
-						if (pent != nullptr)
-							*((entvars_t**)pOutputData) = VARS(pent);
-						else
-							*((entvars_t**)pOutputData) = nullptr;
-						break;
-					case FIELD_CLASSPTR:
-						entityIndex = *(int*)pInputData;
-						pent = EntityFromIndex(entityIndex);
-						if (pent != nullptr)
-							*((CBaseEntity**)pOutputData) = CBaseEntity::Instance(pent);
-						else
-						{
-							*((CBaseEntity**)pOutputData) = nullptr;
-							if (entityIndex != -1)
-								ALERT(at_console, "## Restore: invalid entitynum %d\n", entityIndex);
-						}
-						break;
-					case FIELD_EDICT:
-						entityIndex = *(int*)pInputData;
-						pent = EntityFromIndex(entityIndex);
-						*((edict_t**)pOutputData) = pent;
-						break;
-					case FIELD_EHANDLE:
-						// Input and Output sizes are different!
-						pInputData = (char*)pData + j * sizeof(int);
-						entityIndex = *(int*)pInputData;
-						pent = EntityFromIndex(entityIndex);
-						if (pent != nullptr)
-							*((EHANDLE*)pOutputData) = CBaseEntity::Instance(pent);
-						else
-							*((EHANDLE*)pOutputData) = nullptr;
-						break;
-					case FIELD_ENTITY:
-						entityIndex = *(int*)pInputData;
-						pent = EntityFromIndex(entityIndex);
-						if (pent != nullptr)
-							*((EOFFSET*)pOutputData) = OFFSET(pent);
-						else
-							*((EOFFSET*)pOutputData) = 0;
-						break;
-					case FIELD_VECTOR:
-						((float*)pOutputData)[0] = ((float*)pInputData)[0];
-						((float*)pOutputData)[1] = ((float*)pInputData)[1];
-						((float*)pOutputData)[2] = ((float*)pInputData)[2];
-						break;
-					case FIELD_POSITION_VECTOR:
-						((float*)pOutputData)[0] = ((float*)pInputData)[0] + position.x;
-						((float*)pOutputData)[1] = ((float*)pInputData)[1] + position.y;
-						((float*)pOutputData)[2] = ((float*)pInputData)[2] + position.z;
-						break;
-
-					case FIELD_BOOLEAN:
+					if (!FStringNull(string) && m_precache)
 					{
-						// Input and Output sizes are different!
-						pOutputData = (char*)pOutputData + j * (sizeof(bool) - gSizes[pTest->fieldType]);
-						const bool value = *((byte*)pInputData) != 0;
-
-						*((bool*)pOutputData) = value;
-					}
-					break;
-
-					case FIELD_INTEGER:
-						*((int*)pOutputData) = *(int*)pInputData;
-						break;
-
-					case FIELD_INT64:
-						*((std::uint64_t*)pOutputData) = *(std::uint64_t*)pInputData;
-						break;
-
-					case FIELD_SHORT:
-						*((short*)pOutputData) = *(short*)pInputData;
-						break;
-
-					case FIELD_CHARACTER:
-						*((char*)pOutputData) = *(char*)pInputData;
-						break;
-
-					case FIELD_POINTER:
-						*((int*)pOutputData) = *(int*)pInputData;
-						break;
-					case FIELD_FUNCTION:
-						if (strlen((char*)pInputData) == 0)
-							*((int*)pOutputData) = 0;
-						else
-							*((int*)pOutputData) = FUNCTION_FROM_NAME((char*)pInputData);
-						break;
-
-					default:
-						ALERT(at_error, "Bad field type\n");
+						if (pTest->fieldType == FIELD_MODELNAME)
+							PRECACHE_MODEL((char*)STRING(string));
+						else if (pTest->fieldType == FIELD_SOUNDNAME)
+							PRECACHE_SOUND((char*)STRING(string));
 					}
 				}
-			}
-#if 0
-			else
+				break;
+			case FIELD_EVARS:
+				entityIndex = *(int*)pInputData;
+				pent = EntityFromIndex(entityIndex);
+				if (pent != nullptr)
+					*((entvars_t**)pOutputData) = VARS(pent);
+				else
+					*((entvars_t**)pOutputData) = nullptr;
+				break;
+			case FIELD_CLASSPTR:
+				entityIndex = *(int*)pInputData;
+				pent = EntityFromIndex(entityIndex);
+				if (pent != nullptr)
+					*((CBaseEntity**)pOutputData) = CBaseEntity::Instance(pent);
+				else
+				{
+					*((CBaseEntity**)pOutputData) = nullptr;
+					if (entityIndex != -1)
+						ALERT(at_console, "## Restore: invalid entitynum %d\n", entityIndex);
+				}
+				break;
+			case FIELD_EDICT:
+				entityIndex = *(int*)pInputData;
+				pent = EntityFromIndex(entityIndex);
+				*((edict_t**)pOutputData) = pent;
+				break;
+			case FIELD_EHANDLE:
+				// Input and Output sizes are different!
+				pInputData = (char*)pData + j * sizeof(int);
+				entityIndex = *(int*)pInputData;
+				pent = EntityFromIndex(entityIndex);
+				if (pent != nullptr)
+					*((EHANDLE*)pOutputData) = CBaseEntity::Instance(pent);
+				else
+					*((EHANDLE*)pOutputData) = nullptr;
+				break;
+			case FIELD_ENTITY:
+				entityIndex = *(int*)pInputData;
+				pent = EntityFromIndex(entityIndex);
+				if (pent != nullptr)
+					*((EOFFSET*)pOutputData) = OFFSET(pent);
+				else
+					*((EOFFSET*)pOutputData) = 0;
+				break;
+			case FIELD_VECTOR:
+				((float*)pOutputData)[0] = ((float*)pInputData)[0];
+				((float*)pOutputData)[1] = ((float*)pInputData)[1];
+				((float*)pOutputData)[2] = ((float*)pInputData)[2];
+				break;
+			case FIELD_POSITION_VECTOR:
+				((float*)pOutputData)[0] = ((float*)pInputData)[0] + position.x;
+				((float*)pOutputData)[1] = ((float*)pInputData)[1] + position.y;
+				((float*)pOutputData)[2] = ((float*)pInputData)[2] + position.z;
+				break;
+
+			case FIELD_BOOLEAN:
 			{
-				ALERT( at_debug, "Skipping global field %s\n", pName );
+				// Input and Output sizes are different!
+				pOutputData = (char*)pOutputData + j * (sizeof(bool) - gSizes[pTest->fieldType]);
+				const bool value = *((byte*)pInputData) != 0;
+
+				*((bool*)pOutputData) = value;
+			}
+			break;
+
+			case FIELD_INTEGER:
+				*((int*)pOutputData) = *(int*)pInputData;
+				break;
+
+			case FIELD_INT64:
+				*((std::uint64_t*)pOutputData) = *(std::uint64_t*)pInputData;
+				break;
+
+			case FIELD_SHORT:
+				*((short*)pOutputData) = *(short*)pInputData;
+				break;
+
+			case FIELD_CHARACTER:
+				*((char*)pOutputData) = *(char*)pInputData;
+				break;
+
+			case FIELD_POINTER:
+				*((int*)pOutputData) = *(int*)pInputData;
+				break;
+			case FIELD_FUNCTION:
+				if (strlen((char*)pInputData) == 0)
+					*((int*)pOutputData) = 0;
+				else
+					*((int*)pOutputData) = FUNCTION_FROM_NAME((char*)pInputData);
+				break;
+
+			default:
+				ALERT(at_error, "Bad field type\n");
 			}
-#endif
-			return fieldNumber;
 		}
 	}
-
-	return -1;
 }
 
 
@@ -2926,18 +3097,22 @@ bool CRestore::ReadFields(const char* pname, void* pBaseData, TYPEDESCRIPTION* p
 
 	lastField = 0; // Make searches faster, most data is read/written in the same order
 
+	savefieldschema_t& schema = GetSaveFieldSchema(pFields, fieldCount);
+
 	// Clear out base data
 	for (i = 0; i < fieldCount; i++)
 	{
 		// Don't clear global fields
 		if (!m_global || (pFields[i].flags & FTYPEDESC_GLOBAL) == 0)
-			memset(((char*)pBaseData + pFields[i].fieldOffset), 0, pFields[i].fieldSize * gSizes[pFields[i].fieldType]);
+			memset(((char*)pBaseData + pFields[i].fieldOffset), 0, schema.byteSizes[i]);
 	}
 
 	for (i = 0; i < fileCount; i++)
 	{
 		BufferReadHeader(&header);
-		lastField = ReadField(pBaseData, pFields, fieldCount, lastField, header.size, m_data.pTokens[header.token], header.pData);
+		lastField = FindRestoreField(m_data, schema, pFields, fieldCount, lastField, header.token);
+		if (lastField != -1)
+			ReadFieldData(pBaseData, &pFields[lastField], header.pData);
 		lastField++;
 	}
 
@@ -3051,6 +3226,148 @@ bool CRestore::BufferCheckZString(const char* string)
 	return false;
 }
 
+// Saves every entity in the level into a scratch buffer the given number of times,
+// then restores each one into a scratch copy of its class and checks that saving the
+// copy gives the same bytes. The live entities are only ever saved, never restored.
+static void SaveRestoreBenchmark()
+{
+	if (g_pWorld == nullptr)
+	{
+		g_engfuncs.pfnServerPrint("sv_saverestore_benchmark: no level loaded\n");
+		return;
+	}
+
+	const int iterations = CMD_ARGC() > 1 ? V_max(1, atoi(CMD_ARGV(1))) : 100;
+	const int tableCount = gpGlobals->maxEntities;
+
+	std::vector<ENTITYTABLE> table(tableCount);
+	std::vector<char*> tokens(0xfff);
+	std::vector<char> buffer(0x1000000);
+	std::vector<char> firstPass;
+
+	for (int i = 0; i < tableCount; i++)
+	{
+		table[i].id = i;
+		table[i].pent = INDEXENT(i);
+	}
+
+	SAVERESTOREDATA data = {};
+	data.bufferSize = buffer.size();
+	data.tokenCount = tokens.size();
+	data.pTokens = tokens.data();
+	data.tableCount = tableCount;
+	data.pTable = table.data();
+	data.time = gpGlobals->time;
+
+	auto saveAll = [&]()
+	{
+		data.pBaseData = data.pCurrentData = buffer.data();
+		data.size = 0;
+
+		for (int i = 0; i < tableCount; i++)
+		{
+			ENTITYTABLE* pTable = &table[i];
+			CBaseEntity* pEntity = (pTable->pent != nullptr && 0 == pTable->pent->free) ? CBaseEntity::Instance(pTable->pent) : nullptr;
+
+			pTable->location = data.size;
+			pTable->size = 0;
+
+			if (pEntity == nullptr || (pEntity->ObjectCaps() & FCAP_DONT_SAVE) != 0)
+				continue;
+
+			data.currentIndex = i;
+			CSave saveHelper(data);
+			pEntity->Save(saveHelper);
+			pTable->size = data.size - pTable->location;
+		}
+	};
+
+	CPerformanceCounter timer;
+
+	double start = timer.GetCurTime();
+	for (int n = 0; n < iterations; n++)
+		saveAll();
+	const double saveTime = (timer.GetCurTime() - start) / iterations;
+
+	firstPass.assign(buffer.begin(), buffer.begin() + data.size);
+
+	double restoreTime = 0;
+	int restored = 0, skipped = 0, differs = 0;
+
+	// One edict is reused for every copy; freed edicts can't be reallocated in the same frame
+	edict_t* pentCopy = CREATE_ENTITY();
+
+	for (int i = 0; i < tableCount; i++)
+	{
+		ENTITYTABLE* pTable = &table[i];
+		if (0 == pTable->size)
+			continue;
+
+		CBaseEntity* pEntity = CBaseEntity::Instance(pTable->pent);
+
+		// The world and players restore global state along with their fields
+		if (0 == i || pEntity->IsPlayer() || FStringNull(pEntity->pev->classname))
+		{
+			skipped++;
+			continue;
+		}
+
+		// Same lookup the engine does for CREATE_NAMED_ENTITY, minus the edict allocation
+		auto factory = reinterpret_cast<void (*)(entvars_t*)>(static_cast<std::uintptr_t>(FUNCTION_FROM_NAME(STRING(pEntity->pev->classname))));
+
+		if (factory == nullptr)
+		{
+			skipped++;
+			continue;
+		}
+
+		FREE_PRIVATE(pentCopy);
+		memset(&pentCopy->v, 0, sizeof(pentCopy->v));
+		pentCopy->v.pContainingEntity = pentCopy;
+		factory(&pentCopy->v);
+
+		CBaseEntity* pCopy = static_cast<CBaseEntity*>(GET_PRIVATE(pentCopy));
+
+		if (pCopy == nullptr)
+		{
+			skipped++;
+			continue;
+		}
+
+		data.currentIndex = i;
+		data.size = pTable->location;
+		data.pCurrentData = data.pBaseData + pTable->location;
+
+		start = timer.GetCurTime();
+		CRestore restoreHelper(data);
+		restoreHelper.PrecacheMode(false);
+		pCopy->Restore(restoreHelper);
+		restoreTime += timer.GetCurTime() - start;
+
+		// Save the copy in the live entity's place, past the end of the first pass
+		data.size = firstPass.size();
+		data.pCurrentData = data.pBaseData + data.size;
+
+		CSave saveHelper(data);
+		pCopy->Save(saveHelper);
+
+		if (data.size - static_cast<int>(firstPass.size()) != pTable->size || 0 != memcmp(firstPass.data() + pTable->location, buffer.data() + firstPass.size(), pTable->size))
+			differs++;
+
+		restored++;
+	}
+
+	REMOVE_ENTITY(pentCopy);
+
+	g_engfuncs.pfnServerPrint(UTIL_VarArgs("save: %.3f ms (%d bytes, avg of %d), restore: %.3f ms (%d entities, %d skipped), round trip %s (%d differ)\n",
+		saveTime * 1000.0, static_cast<int>(firstPass.size()), iterations, restoreTime * 1000.0, restored, skipped, 0 == differs ? "matches" : "DIFFERS", differs));
+}
+
+void InitSaveRestoreBenchmark()
+{
+	g_engfuncs.pfnAddServerCommand("sv_saverestore_benchmark", &SaveRestoreBenchmark);
+}
+
 // RENDERERS START
 void UTIL_CustomDecal(TraceResult* pTrace, const char* name, int persistent)
 {
@@ -244,6 +244,16 @@ class CBaseMutableAlias;
 extern void UTIL_AddToAliasList(CBaseMutableAlias* pAlias);
 extern void UTIL_FlushAliases();
 
+// locus strings are compiled on first use and cached (see locus.cpp). Call this
+// whenever an entity's targetname changes, so cached references are looked up again.
+extern void UTIL_LocusTargetnamesChanged();
+extern void UTIL_FlushLocusCache();
+
+// autoaim picks from a registry of DAMAGE_AIM entities (see player.cpp). Call this
+// whenever an entity's takedamage may have become DAMAGE_AIM.
+extern void UTIL_AutoaimTakeDamageChanged(edict_t* pEdict);
+extern void UTIL_FlushAutoaimRegistry();
+
 extern CBaseEntity* UTIL_FindEntityInSphere(CBaseEntity* pStartEntity, const Vector& vecCenter, float flRadius);
 extern CBaseEntity* UTIL_FindEntityByString(CBaseEntity* pStartEntity, const char* szKeyword, const char* szValue);
 extern CBaseEntity* UTIL_FindEntityByClassname(CBaseEntity* pStartEntity, const char* szName);
@@ -24,6 +24,7 @@
 #include "util.h"
 #include "cbase.h"
 #include "nodes.h"
+#include "navmesh.h"
 #include "soundent.h"
 #include "client.h"
 #include "decals.h"
@@ -521,6 +522,12 @@ void CWorld::Precache()
 	m_pFirstAlias = nullptr;
 	//	ALERT(at_console, "Clearing AssistList\n");
 
+	// string and entity tables are about to be rebuilt, compiled locus strings refer to both
+	UTIL_FlushLocusCache();
+
+	// entity indices from the last map mean nothing now
+	UTIL_FlushAutoaimRegistry();
+
 	g_pLastSpawn = nullptr;
 
 #if 1
@@ -650,6 +657,9 @@ void CWorld::Precache()
 		}
 	}
 
+	// optional navigation mesh, used instead of the graph when monster_navmesh is set
+	WorldNavMesh.Load(STRING(gpGlobals->mapname));
+
 	if (pev->speed > 0)
 		CVAR_SET_FLOAT("sv_zmax", pev->speed);
 	else
@@ -117,8 +117,8 @@ bool FileSystem_LoadFileSystem()
 {
 	if (nullptr != g_pFileSystem)
 	{
-		//Already loaded.
-		return true;
+		//Already loaded, or handed to us by a host that has its own filesystem.
+		return !g_ModDirectory.empty() || FileSystem_InitializeGameDirectory();
 	}
 
 	// Determine which filesystem to use.
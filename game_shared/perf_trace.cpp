@@ -0,0 +1,77 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#include <string>
+
+#include "perf_trace.h"
+#include "filesystem_utils.h"
+
+CPerfTrace g_PerfTrace;
+
+void CPerfTrace::SetEnabled(bool bEnabled)
+{
+	if (bEnabled == m_bEnabled)
+		return;
+
+	// start every capture from a clean buffer
+	if (bEnabled)
+		Clear();
+
+	m_bEnabled = bEnabled;
+}
+
+void CPerfTrace::AddZone(const char* pszName, double flStart, double flEnd)
+{
+	perfzone_t& zone = m_Zones[m_iNumZones & (PERF_TRACE_ZONES - 1)];
+	zone.name = pszName;
+	zone.start = flStart;
+	zone.end = flEnd;
+	m_iNumZones++;
+}
+
+void CPerfTrace::Clear()
+{
+	m_iNumZones = 0;
+}
+
+int CPerfTrace::Dump(const char* pszFileName, const char* pszProcess)
+{
+	const unsigned int iCount = m_iNumZones < PERF_TRACE_ZONES ? m_iNumZones : PERF_TRACE_ZONES;
+	const unsigned int iFirst = m_iNumZones - iCount;
+
+	std::string json;
+	json.reserve(64 + iCount * 80);
+
+	char szLine[256];
+	snprintf(szLine, sizeof(szLine), "{\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"%s\"}}", pszProcess);
+	json += szLine;
+
+	// timestamps are in microseconds
+	for (unsigned int i = iFirst; i != m_iNumZones; i++)
+	{
+		const perfzone_t& zone = m_Zones[i & (PERF_TRACE_ZONES - 1)];
+
+		snprintf(szLine, sizeof(szLine), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+			zone.name, zone.start * 1000000.0, (zone.end - zone.start) * 1000000.0);
+		json += szLine;
+	}
+
+	json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	if (!FileSystem_WriteTextToFile(pszFileName, json.c_str()))
+		return -1;
+
+	return (int)iCount;
+}
@@ -0,0 +1,90 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+
+#include "perf_counter.h"
+
+#define PERF_TRACE_ZONES 65536 // power of two
+
+/**
+*	@brief Ring buffer of timed zones for attributing frame hitches.
+*	Zones are only recorded while enabled, the oldest ones are overwritten once the buffer is full.
+*	Only meant to be used from the main thread.
+*/
+class CPerfTrace
+{
+public:
+	bool IsEnabled() const { return m_bEnabled; }
+	void SetEnabled(bool bEnabled);
+
+	double Now() { return m_Counter.GetCurTime(); }
+	void AddZone(const char* pszName, double flStart, double flEnd);
+
+	/**
+	*	@brief Writes the recorded zones as Chrome trace-event JSON (chrome://tracing, Perfetto).
+	*	@param pszProcess Name the zones are grouped under in the viewer.
+	*	@return Number of zones written, -1 if the file couldn't be written.
+	*/
+	int Dump(const char* pszFileName, const char* pszProcess);
+	void Clear();
+
+private:
+	struct perfzone_t
+	{
+		const char* name; // string literal, never freed
+		double start;
+		double end;
+	};
+
+	CPerformanceCounter m_Counter;
+	bool m_bEnabled = false;
+
+	perfzone_t m_Zones[PERF_TRACE_ZONES];
+	unsigned int m_iNumZones = 0; // total ever added since Clear
+};
+
+extern CPerfTrace g_PerfTrace;
+
+/**
+*	@brief Times the enclosing scope into g_PerfTrace. A null name disables it.
+*/
+class CPerfScope
+{
+public:
+	CPerfScope(const char* pszName)
+		: m_pszName(g_PerfTrace.IsEnabled() ? pszName : nullptr)
+	{
+		if (m_pszName)
+			m_flStart = g_PerfTrace.Now();
+	}
+
+	~CPerfScope()
+	{
+		if (m_pszName)
+			g_PerfTrace.AddZone(m_pszName, m_flStart, g_PerfTrace.Now());
+	}
+
+	CPerfScope(const CPerfScope&) = delete;
+	CPerfScope& operator=(const CPerfScope&) = delete;
+
+private:
+	const char* m_pszName;
+	double m_flStart = 0;
+};
+
+#define PERF_SCOPE_NAME2(line) perfScope##line
+#define PERF_SCOPE_NAME(line) PERF_SCOPE_NAME2(line)
+#define PERF_SCOPE(name) CPerfScope PERF_SCOPE_NAME(__LINE__)(name)
@@ -41,7 +41,7 @@ void main(int argc, char** argv)
 			size = 0;
 		printf("%s: %i\n", source, size);
 
-		LoadBSPFile(source);
+		MapBSPFile(source);
 		PrintBSPFileSizes();
 		printf("---------------------\n");
 	}
@@ -13,68 +13,128 @@
 #include "bspfile.h"
 #include "scriplib.h"
 
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 //=============================================================================
 
+// the lumps point at their fixed size storage, or into the mapped file
+// after MapBSPFile
+
+static dmodel_t dmodels_storage[MAX_MAP_MODELS];
+static byte dvisdata_storage[MAX_MAP_VISIBILITY];
+static byte dlightdata_storage[MAX_MAP_LIGHTING];
+static byte dtexdata_storage[MAX_MAP_MIPTEX];
+static char dentdata_storage[MAX_MAP_ENTSTRING];
+static dleaf_t dleafs_storage[MAX_MAP_LEAFS];
+static dplane_t dplanes_storage[MAX_MAP_PLANES];
+static dvertex_t dvertexes_storage[MAX_MAP_VERTS];
+static dnode_t dnodes_storage[MAX_MAP_NODES];
+static texinfo_t texinfo_storage[MAX_MAP_TEXINFO];
+static dface_t dfaces_storage[MAX_MAP_FACES];
+static dclipnode_t dclipnodes_storage[MAX_MAP_CLIPNODES];
+static dedge_t dedges_storage[MAX_MAP_EDGES];
+static unsigned short dmarksurfaces_storage[MAX_MAP_MARKSURFACES];
+static int dsurfedges_storage[MAX_MAP_SURFEDGES];
+
 int nummodels;
-dmodel_t dmodels[MAX_MAP_MODELS];
+dmodel_t* dmodels = dmodels_storage;
 int dmodels_checksum;
 
 int visdatasize;
-byte dvisdata[MAX_MAP_VISIBILITY];
+byte* dvisdata = dvisdata_storage;
 int dvisdata_checksum;
 
 int lightdatasize;
-byte dlightdata[MAX_MAP_LIGHTING];
+byte* dlightdata = dlightdata_storage;
 int dlightdata_checksum;
 
 int texdatasize;
-byte dtexdata[MAX_MAP_MIPTEX]; // (dmiptexlump_t)
+byte* dtexdata = dtexdata_storage; // (dmiptexlump_t)
 int dtexdata_checksum;
 
 int entdatasize;
-char dentdata[MAX_MAP_ENTSTRING];
+char* dentdata = dentdata_storage;
 int dentdata_checksum;
 
 int numleafs;
-dleaf_t dleafs[MAX_MAP_LEAFS];
+dleaf_t* dleafs = dleafs_storage;
 int dleafs_checksum;
 
 int numplanes;
-dplane_t dplanes[MAX_MAP_PLANES];
+dplane_t* dplanes = dplanes_storage;
 int dplanes_checksum;
 
 int numvertexes;
-dvertex_t dvertexes[MAX_MAP_VERTS];
+dvertex_t* dvertexes = dvertexes_storage;
 int dvertexes_checksum;
 
 int numnodes;
-dnode_t dnodes[MAX_MAP_NODES];
+dnode_t* dnodes = dnodes_storage;
 int dnodes_checksum;
 
 int numtexinfo;
-texinfo_t texinfo[MAX_MAP_TEXINFO];
+texinfo_t* texinfo = texinfo_storage;
 int texinfo_checksum;
 
 int numfaces;
-dface_t dfaces[MAX_MAP_FACES];
+dface_t* dfaces = dfaces_storage;
 int dfaces_checksum;
 
 int numclipnodes;
-dclipnode_t dclipnodes[MAX_MAP_CLIPNODES];
+dclipnode_t* dclipnodes = dclipnodes_storage;
 int dclipnodes_checksum;
 
 int numedges;
-dedge_t dedges[MAX_MAP_EDGES];
+dedge_t* dedges = dedges_storage;
 int dedges_checksum;
 
 int nummarksurfaces;
-unsigned short dmarksurfaces[MAX_MAP_MARKSURFACES];
+unsigned short* dmarksurfaces = dmarksurfaces_storage;
 int dmarksurfaces_checksum;
 
 int numsurfedges;
-int dsurfedges[MAX_MAP_SURFEDGES];
+int* dsurfedges = dsurfedges_storage;
 int dsurfedges_checksum;
 
+typedef struct
+{
+	void** data;  // the lump pointer the tools use
+	void* storage;
+	int* count;
+	int size; // of one element
+	int maxcount;
+} bsplump_t;
+
+// indexed by LUMP_*
+static bsplump_t bsplumps[HEADER_LUMPS] =
+	{
+		{(void**)&dentdata, dentdata_storage, &entdatasize, 1, MAX_MAP_ENTSTRING},
+		{(void**)&dplanes, dplanes_storage, &numplanes, sizeof(dplane_t), MAX_MAP_PLANES},
+		{(void**)&dtexdata, dtexdata_storage, &texdatasize, 1, MAX_MAP_MIPTEX},
+		{(void**)&dvertexes, dvertexes_storage, &numvertexes, sizeof(dvertex_t), MAX_MAP_VERTS},
+		{(void**)&dvisdata, dvisdata_storage, &visdatasize, 1, MAX_MAP_VISIBILITY},
+		{(void**)&dnodes, dnodes_storage, &numnodes, sizeof(dnode_t), MAX_MAP_NODES},
+		{(void**)&texinfo, texinfo_storage, &numtexinfo, sizeof(texinfo_t), MAX_MAP_TEXINFO},
+		{(void**)&dfaces, dfaces_storage, &numfaces, sizeof(dface_t), MAX_MAP_FACES},
+		{(void**)&dlightdata, dlightdata_storage, &lightdatasize, 1, MAX_MAP_LIGHTING},
+		{(void**)&dclipnodes, dclipnodes_storage, &numclipnodes, sizeof(dclipnode_t), MAX_MAP_CLIPNODES},
+		{(void**)&dleafs, dleafs_storage, &numleafs, sizeof(dleaf_t), MAX_MAP_LEAFS},
+		{(void**)&dmarksurfaces, dmarksurfaces_storage, &nummarksurfaces, sizeof(unsigned short), MAX_MAP_MARKSURFACES},
+		{(void**)&dedges, dedges_storage, &numedges, sizeof(dedge_t), MAX_MAP_EDGES},
+		{(void**)&dsurfedges, dsurfedges_storage, &numsurfedges, sizeof(int), MAX_MAP_SURFEDGES},
+		{(void**)&dmodels, dmodels_storage, &nummodels, sizeof(dmodel_t), MAX_MAP_MODELS},
+};
+
+static byte* bspmapping;
+static int bspmappingsize;
+
 int num_entities;
 entity_t entities[MAX_MAP_ENTITIES];
 
@@ -327,6 +387,64 @@ void SwapBSPFile(qboolean todisk)
 
 dheader_t* header;
 
+/*
+=============
+ChecksumBSPFile
+=============
+*/
+static void ChecksumBSPFile(void)
+{
+	int length;
+
+	dmodels_checksum = FastChecksum(dmodels, nummodels * sizeof(dmodels[0]));
+	dvertexes_checksum = FastChecksum(dvertexes, numvertexes * sizeof(dvertexes[0]));
+	dplanes_checksum = FastChecksum(dplanes, numplanes * sizeof(dplanes[0]));
+	dleafs_checksum = FastChecksum(dleafs, numleafs * sizeof(dleafs[0]));
+	dnodes_checksum = FastChecksum(dnodes, numnodes * sizeof(dnodes[0]));
+	texinfo_checksum = FastChecksum(texinfo, numtexinfo * sizeof(texinfo[0]));
+	dclipnodes_checksum = FastChecksum(dclipnodes, numclipnodes * sizeof(dclipnodes[0]));
+	dfaces_checksum = FastChecksum(dfaces, numfaces * sizeof(dfaces[0]));
+	dmarksurfaces_checksum = FastChecksum(dmarksurfaces, nummarksurfaces * sizeof(dmarksurfaces[0]));
+	dsurfedges_checksum = FastChecksum(dsurfedges, numsurfedges * sizeof(dsurfedges[0]));
+	dedges_checksum = FastChecksum(dedges, numedges * sizeof(dedges[0]));
+
+	// this has always covered numedges bytes of the zeroed storage, keep that
+	// without reading past a mapped lump so incremental qrad files stay valid
+	length = numedges < texdatasize ? numedges : texdatasize;
+	dtexdata_checksum = FastChecksum(dtexdata, length);
+	dtexdata_checksum = _rotl(dtexdata_checksum, 4 * ((numedges - length) & 7));
+
+	dvisdata_checksum = FastChecksum(dvisdata, visdatasize * sizeof(dvisdata[0]));
+	dlightdata_checksum = FastChecksum(dlightdata, lightdatasize * sizeof(dlightdata[0]));
+	dentdata_checksum = FastChecksum(dentdata, entdatasize * sizeof(dentdata[0]));
+}
+
+/*
+=============
+CloseBSPMapping
+
+Points every lump back at its storage, whatever they held is dropped
+=============
+*/
+static void CloseBSPMapping(void)
+{
+	int i;
+
+	if (!bspmapping)
+		return;
+
+#ifdef WIN32
+	UnmapViewOfFile(bspmapping);
+#else
+	munmap(bspmapping, bspmappingsize);
+#endif
+	bspmapping = NULL;
+	bspmappingsize = 0;
+
+	for (i = 0; i < HEADER_LUMPS; i++)
+		*bsplumps[i].data = bsplumps[i].storage;
+}
+
 int CopyLump(int lump, void* dest, int size)
 {
 	int length, ofs;
@@ -351,6 +469,8 @@ void LoadBSPFile(char* filename)
 {
 	int i;
 
+	CloseBSPMapping();
+
 	//
 	// load the file header
 	//
@@ -387,21 +507,147 @@ void LoadBSPFile(char* filename)
 	//
 	SwapBSPFile(false);
 
-	dmodels_checksum = FastChecksum(dmodels, nummodels * sizeof(dmodels[0]));
-	dvertexes_checksum = FastChecksum(dvertexes, numvertexes * sizeof(dvertexes[0]));
-	dplanes_checksum = FastChecksum(dplanes, numplanes * sizeof(dplanes[0]));
-	dleafs_checksum = FastChecksum(dleafs, numleafs * sizeof(dleafs[0]));
-	dnodes_checksum = FastChecksum(dnodes, numnodes * sizeof(dnodes[0]));
-	texinfo_checksum = FastChecksum(texinfo, numtexinfo * sizeof(texinfo[0]));
-	dclipnodes_checksum = FastChecksum(dclipnodes, numclipnodes * sizeof(dclipnodes[0]));
-	dfaces_checksum = FastChecksum(dfaces, numfaces * sizeof(dfaces[0]));
-	dmarksurfaces_checksum = FastChecksum(dmarksurfaces, nummarksurfaces * sizeof(dmarksurfaces[0]));
-	dsurfedges_checksum = FastChecksum(dsurfedges, numsurfedges * sizeof(dsurfedges[0]));
-	dedges_checksum = FastChecksum(dedges, numedges * sizeof(dedges[0]));
-	dtexdata_checksum = FastChecksum(dtexdata, numedges * sizeof(dtexdata[0]));
-	dvisdata_checksum = FastChecksum(dvisdata, visdatasize * sizeof(dvisdata[0]));
-	dlightdata_checksum = FastChecksum(dlightdata, lightdatasize * sizeof(dlightdata[0]));
-	dentdata_checksum = FastChecksum(dentdata, entdatasize * sizeof(dentdata[0]));
+	ChecksumBSPFile();
+}
+
+/*
+=============
+MapBSPFile
+
+Maps the file copy-on-write and points the lumps into it instead of
+copying them, so only pages that are written to become private.  Lumps
+that will grow past their size in the file must go through
+CopyLumpForWrite first.
+=============
+*/
+void MapBSPFile(char* filename)
+{
+	int i, ofs, length;
+	dheader_t* mapheader;
+	bsplump_t* l;
+
+	// the lumps are used in place, so they have to be in our byte order
+	if (LittleLong(1) != 1)
+	{
+		LoadBSPFile(filename);
+		return;
+	}
+
+	CloseBSPMapping();
+
+#ifdef WIN32
+	HANDLE file, mapping;
+
+	file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		Error("Error opening %s", filename);
+
+	bspmappingsize = GetFileSize(file, NULL);
+	mapping = CreateFileMapping(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if (mapping)
+	{
+		bspmapping = (byte*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+
+	if (!bspmapping)
+		Error("Error mapping %s", filename);
+#else
+	int fd;
+	struct stat st;
+	void* base;
+
+	fd = open(filename, O_RDONLY);
+	if (fd == -1)
+		Error("Error opening %s: %s", filename, strerror(errno));
+
+	if (fstat(fd, &st) == -1)
+		Error("Error reading %s: %s", filename, strerror(errno));
+
+	bspmappingsize = st.st_size;
+	base = mmap(NULL, bspmappingsize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (base == MAP_FAILED)
+		Error("Error mapping %s: %s", filename, strerror(errno));
+	bspmapping = (byte*)base;
+#endif
+
+	if (bspmappingsize < (int)sizeof(dheader_t))
+		Error("%s is not a bsp file", filename);
+
+	mapheader = (dheader_t*)bspmapping;
+
+	if (mapheader->version != BSPVERSION)
+		Error("%s is version %i, not %i", filename, mapheader->version, BSPVERSION);
+
+	for (i = 0, l = bsplumps; i < HEADER_LUMPS; i++, l++)
+	{
+		length = mapheader->lumps[i].filelen;
+		ofs = mapheader->lumps[i].fileofs;
+
+		if (length < 0 || ofs < 0 || ofs > bspmappingsize - length)
+			Error("MapBSPFile: lump %i is outside the file", i);
+		if (length % l->size)
+			Error("MapBSPFile: odd lump size");
+		if (length / l->size > l->maxcount)
+			Error("MapBSPFile: lump %i is too large", i);
+
+		*l->count = length / l->size;
+
+		// AddLump keeps them aligned, but don't rely on it
+		if (ofs & 3)
+		{
+			memcpy(l->storage, bspmapping + ofs, length);
+			*l->data = l->storage;
+		}
+		else
+			*l->data = bspmapping + ofs;
+	}
+
+	ChecksumBSPFile();
+}
+
+/*
+=============
+CopyLumpForWrite
+
+Moves a lump out of the mapped file into its storage, so it can grow
+=============
+*/
+void CopyLumpForWrite(int lump)
+{
+	bsplump_t* l;
+
+	l = &bsplumps[lump];
+
+	if (*l->data == l->storage)
+		return;
+
+	memcpy(l->storage, *l->data, *l->count * l->size);
+	*l->data = l->storage;
+}
+
+/*
+=============
+UnmapBSPFile
+
+Copies the lumps still in the mapped file into their storage and
+releases the file, so it can be written again
+=============
+*/
+void UnmapBSPFile(void)
+{
+	int i;
+
+	if (!bspmapping)
+		return;
+
+	for (i = 0; i < HEADER_LUMPS; i++)
+		CopyLumpForWrite(i);
+
+	CloseBSPMapping();
 }
 
 //============================================================================
@@ -429,6 +675,8 @@ Swaps the bsp file in place, so it should not be referenced again
 */
 void WriteBSPFile(char* filename)
 {
+	UnmapBSPFile();
+
 	header = &outheader;
 	memset(header, 0, sizeof(dheader_t));
 
@@ -463,9 +711,6 @@ void WriteBSPFile(char* filename)
 
 //============================================================================
 
-#define ENTRIES(a) (sizeof(a) / sizeof(*(a)))
-#define ENTRYSIZE(a) (sizeof(*(a)))
-
 int ArrayUsage(char* szItem, int items, int maxitems, int itemsize)
 {
 	float percentage = maxitems ? items * 100.0 / maxitems : 0.0;
@@ -515,22 +760,22 @@ void PrintBSPFileSizes(void)
 	printf("Object names  Objects/Maxobjs  Memory / Maxmem  Fullness\n");
 	printf("------------  ---------------  ---------------  --------\n");
 
-	totalmemory += ArrayUsage("models", nummodels, ENTRIES(dmodels), ENTRYSIZE(dmodels));
-	totalmemory += ArrayUsage("planes", numplanes, ENTRIES(dplanes), ENTRYSIZE(dplanes));
-	totalmemory += ArrayUsage("vertexes", numvertexes, ENTRIES(dvertexes), ENTRYSIZE(dvertexes));
-	totalmemory += ArrayUsage("nodes", numnodes, ENTRIES(dnodes), ENTRYSIZE(dnodes));
-	totalmemory += ArrayUsage("texinfos", numtexinfo, ENTRIES(texinfo), ENTRYSIZE(texinfo));
-	totalmemory += ArrayUsage("faces", numfaces, ENTRIES(dfaces), ENTRYSIZE(dfaces));
-	totalmemory += ArrayUsage("clipnodes", numclipnodes, ENTRIES(dclipnodes), ENTRYSIZE(dclipnodes));
-	totalmemory += ArrayUsage("leaves", numleafs, ENTRIES(dleafs), ENTRYSIZE(dleafs));
-	totalmemory += ArrayUsage("marksurfaces", nummarksurfaces, ENTRIES(dmarksurfaces), ENTRYSIZE(dmarksurfaces));
-	totalmemory += ArrayUsage("surfedges", numsurfedges, ENTRIES(dsurfedges), ENTRYSIZE(dsurfedges));
-	totalmemory += ArrayUsage("edges", numedges, ENTRIES(dedges), ENTRYSIZE(dedges));
-
-	totalmemory += GlobUsage("texdata", texdatasize, sizeof(dtexdata));
-	totalmemory += GlobUsage("lightdata", lightdatasize, sizeof(dlightdata));
-	totalmemory += GlobUsage("visdata", visdatasize, sizeof(dvisdata));
-	totalmemory += GlobUsage("entdata", entdatasize, sizeof(dentdata));
+	totalmemory += ArrayUsage("models", nummodels, MAX_MAP_MODELS, sizeof(dmodel_t));
+	totalmemory += ArrayUsage("planes", numplanes, MAX_MAP_PLANES, sizeof(dplane_t));
+	totalmemory += ArrayUsage("vertexes", numvertexes, MAX_MAP_VERTS, sizeof(dvertex_t));
+	totalmemory += ArrayUsage("nodes", numnodes, MAX_MAP_NODES, sizeof(dnode_t));
+	totalmemory += ArrayUsage("texinfos", numtexinfo, MAX_MAP_TEXINFO, sizeof(texinfo_t));
+	totalmemory += ArrayUsage("faces", numfaces, MAX_MAP_FACES, sizeof(dface_t));
+	totalmemory += ArrayUsage("clipnodes", numclipnodes, MAX_MAP_CLIPNODES, sizeof(dclipnode_t));
+	totalmemory += ArrayUsage("leaves", numleafs, MAX_MAP_LEAFS, sizeof(dleaf_t));
+	totalmemory += ArrayUsage("marksurfaces", nummarksurfaces, MAX_MAP_MARKSURFACES, sizeof(dmarksurfaces[0]));
+	totalmemory += ArrayUsage("surfedges", numsurfedges, MAX_MAP_SURFEDGES, sizeof(dsurfedges[0]));
+	totalmemory += ArrayUsage("edges", numedges, MAX_MAP_EDGES, sizeof(dedge_t));
+
+	totalmemory += GlobUsage("texdata", texdatasize, MAX_MAP_MIPTEX);
+	totalmemory += GlobUsage("lightdata", lightdatasize, MAX_MAP_LIGHTING);
+	totalmemory += GlobUsage("visdata", visdatasize, MAX_MAP_VISIBILITY);
+	totalmemory += GlobUsage("entdata", entdatasize, MAX_MAP_ENTSTRING);
 
 	printf("=== Total BSP file data space used: %d bytes ===\n", totalmemory);
 }
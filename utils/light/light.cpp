@@ -210,7 +210,8 @@ int main(int argc, char** argv)
 	StripExtension(source);
 	DefaultExtension(source, ".bsp");
 
-	LoadBSPFile(source);
+	MapBSPFile(source);
+	CopyLumpForWrite(LUMP_LIGHTING); // rebuilt from scratch
 	LoadEntities();
 
 	MakeTnodes();
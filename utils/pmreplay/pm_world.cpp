@@ -0,0 +1,965 @@
+//=========================================================
+// pm_world.cpp - the engine side of player movement for the
+// replay harness: BSP clip hulls, the brush entities the
+// player collides with and the playermove_t callbacks
+// (traces, point contents, random numbers, file loading).
+// Follows the GoldSrc player move code; studio models and
+// other players are not simulated.
+//=========================================================
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "pmreplay.h"
+#include "com_model.h"
+
+//=========================================================
+// BSP file format (version 30)
+//=========================================================
+#define BSPVERSION 30
+
+#define LUMP_ENTITIES 0
+#define LUMP_PLANES 1
+#define LUMP_NODES 5
+#define LUMP_CLIPNODES 9
+#define LUMP_LEAFS 10
+#define LUMP_MODELS 14
+#define HEADER_LUMPS 15
+
+#define PR_MAX_HULLS 4
+
+#define CONTENTS_CURRENT_0 -9
+#define CONTENTS_CURRENT_DOWN -14
+
+#define DIST_EPSILON (0.03125f)
+
+struct bsplump_t
+{
+	int fileofs, filelen;
+};
+
+struct bspheader_t
+{
+	int version;
+	bsplump_t lumps[HEADER_LUMPS];
+};
+
+struct bspplane_t
+{
+	float normal[3];
+	float dist;
+	int type;
+};
+
+struct bspnode_t
+{
+	int planenum;
+	short children[2];
+	short mins[3];
+	short maxs[3];
+	unsigned short firstface;
+	unsigned short numfaces;
+};
+
+struct bspleaf_t
+{
+	int contents;
+	int visofs;
+	short mins[3];
+	short maxs[3];
+	unsigned short firstmarksurface;
+	unsigned short nummarksurfaces;
+	byte ambient_level[4];
+};
+
+struct bspmodel_t
+{
+	float mins[3], maxs[3];
+	float origin[3];
+	int headnode[PR_MAX_HULLS];
+	int visleafs;
+	int firstface, numfaces;
+};
+
+static std::vector<mplane_t> g_Planes;
+static std::vector<dclipnode_t> g_Hull0Nodes; // hull 0 rebuilt from the drawing nodes
+static std::vector<dclipnode_t> g_ClipNodes;
+static std::vector<model_t> g_Models;
+static std::string g_EntityLump;
+
+static const Vector g_HullMins[PR_MAX_HULLS] = {Vector(0, 0, 0), Vector(-16, -16, -36), Vector(-32, -32, -32), Vector(-16, -16, -18)};
+static const Vector g_HullMaxs[PR_MAX_HULLS] = {Vector(0, 0, 0), Vector(16, 16, 36), Vector(32, 32, 32), Vector(16, 16, 18)};
+
+static playermove_t* g_pmove;
+static bool g_Verbose;
+static double g_Time;
+static std::mt19937 g_Random;
+
+static std::vector<byte> LoadFile(const char* fileName)
+{
+	std::vector<byte> data;
+	FILE* file = fopen(fileName, "rb");
+
+	if (file == nullptr)
+		return data;
+
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	if (length > 0)
+	{
+		data.resize(length);
+		if (fread(data.data(), 1, length, file) != static_cast<std::size_t>(length))
+			data.clear();
+	}
+
+	fclose(file);
+	return data;
+}
+
+template <typename T>
+static bool CopyLump(const std::vector<byte>& file, const bspheader_t* header, int lump, std::vector<T>& out)
+{
+	const bsplump_t& l = header->lumps[lump];
+
+	if (l.fileofs < 0 || l.filelen < 0 || l.fileofs + l.filelen > static_cast<int>(file.size()) || (l.filelen % sizeof(T)) != 0)
+		return false;
+
+	out.resize(l.filelen / sizeof(T));
+	memcpy(out.data(), file.data() + l.fileofs, l.filelen);
+	return true;
+}
+
+// clipnode children are shorts, large maps wrap them around
+static inline int ClipChild(const dclipnode_t* node, int side)
+{
+	int child = node->children[side];
+
+	if (child < CONTENTS_LADDER)
+		child += 65536;
+
+	return child;
+}
+
+bool PR_LoadBSP(const char* fileName)
+{
+	std::vector<byte> file = LoadFile(fileName);
+
+	if (file.size() < sizeof(bspheader_t))
+	{
+		printf("Couldn't load %s\n", fileName);
+		return false;
+	}
+
+	const bspheader_t* header = reinterpret_cast<const bspheader_t*>(file.data());
+
+	if (header->version != BSPVERSION)
+	{
+		printf("%s has version %d, expected %d\n", fileName, header->version, BSPVERSION);
+		return false;
+	}
+
+	std::vector<bspplane_t> planes;
+	std::vector<bspnode_t> nodes;
+	std::vector<bspleaf_t> leafs;
+	std::vector<bspmodel_t> models;
+	std::vector<char> entities;
+
+	if (!CopyLump(file, header, LUMP_PLANES, planes) || !CopyLump(file, header, LUMP_NODES, nodes) || !CopyLump(file, header, LUMP_CLIPNODES, g_ClipNodes) || !CopyLump(file, header, LUMP_LEAFS, leafs) || !CopyLump(file, header, LUMP_MODELS, models) || !CopyLump(file, header, LUMP_ENTITIES, entities) || models.empty())
+	{
+		printf("%s is corrupt\n", fileName);
+		return false;
+	}
+
+	g_EntityLump.assign(entities.begin(), entities.end());
+
+	g_Planes.resize(planes.size());
+	for (std::size_t i = 0; i < planes.size(); i++)
+	{
+		mplane_t& plane = g_Planes[i];
+		memset(&plane, 0, sizeof(plane));
+
+		plane.normal = Vector(planes[i].normal[0], planes[i].normal[1], planes[i].normal[2]);
+		plane.dist = planes[i].dist;
+		plane.type = planes[i].type;
+
+		for (int j = 0; j < 3; j++)
+		{
+			if (plane.normal[j] < 0)
+				plane.signbits |= 1 << j;
+		}
+	}
+
+	// hull 0 collides against the drawing nodes, leafs become their contents
+	g_Hull0Nodes.resize(nodes.size());
+	for (std::size_t i = 0; i < nodes.size(); i++)
+	{
+		g_Hull0Nodes[i].planenum = nodes[i].planenum;
+
+		for (int j = 0; j < 2; j++)
+		{
+			int child = nodes[i].children[j];
+			g_Hull0Nodes[i].children[j] = (child >= 0) ? child : leafs[-1 - child].contents;
+		}
+	}
+
+	g_Models.resize(models.size());
+	for (std::size_t i = 0; i < models.size(); i++)
+	{
+		model_t& model = g_Models[i];
+		memset(&model, 0, sizeof(model));
+
+		snprintf(model.name, sizeof(model.name), "*%d", static_cast<int>(i));
+		model.type = mod_brush;
+		model.mins = Vector(models[i].mins[0], models[i].mins[1], models[i].mins[2]);
+		model.maxs = Vector(models[i].maxs[0], models[i].maxs[1], models[i].maxs[2]);
+
+		for (int j = 0; j < PR_MAX_HULLS; j++)
+		{
+			hull_t& hull = model.hulls[j];
+			hull.clipnodes = (j == 0) ? g_Hull0Nodes.data() : g_ClipNodes.data();
+			hull.planes = g_Planes.data();
+			hull.firstclipnode = models[i].headnode[j];
+			hull.lastclipnode = static_cast<int>((j == 0) ? g_Hull0Nodes.size() : g_ClipNodes.size()) - 1;
+			hull.clip_mins = g_HullMins[j];
+			hull.clip_maxs = g_HullMaxs[j];
+		}
+	}
+
+	return true;
+}
+
+const char* PR_EntityLump()
+{
+	return g_EntityLump.c_str();
+}
+
+//=========================================================
+// Entity lump
+//=========================================================
+typedef std::vector<std::pair<std::string, std::string>> prkeys_t;
+
+static const char* ParseToken(const char* data, std::string& token)
+{
+	token.clear();
+
+	while (*data != '\0' && *data <= ' ')
+		data++;
+
+	if (*data == '\0')
+		return nullptr;
+
+	if (*data == '"')
+	{
+		data++;
+		while (*data != '\0' && *data != '"')
+			token += *data++;
+
+		return (*data == '"') ? data + 1 : data;
+	}
+
+	if (*data == '{' || *data == '}')
+	{
+		token = *data;
+		return data + 1;
+	}
+
+	while (*data > ' ')
+		token += *data++;
+
+	return data;
+}
+
+static std::vector<prkeys_t> ParseEntities()
+{
+	std::vector<prkeys_t> entities;
+	const char* data = g_EntityLump.c_str();
+	std::string token, key;
+
+	while ((data = ParseToken(data, token)) != nullptr)
+	{
+		if (token != "{")
+			break;
+
+		prkeys_t keys;
+
+		while ((data = ParseToken(data, key)) != nullptr && key != "}")
+		{
+			if ((data = ParseToken(data, token)) == nullptr)
+				break;
+
+			keys.push_back(std::make_pair(key, token));
+		}
+
+		entities.push_back(keys);
+
+		if (data == nullptr)
+			break;
+	}
+
+	return entities;
+}
+
+static const char* ValueForKey(const prkeys_t& keys, const char* key)
+{
+	for (const auto& kv : keys)
+	{
+		if (kv.first == key)
+			return kv.second.c_str();
+	}
+
+	return "";
+}
+
+bool PR_FindPlayerStart(Vector& origin, Vector& angles)
+{
+	for (const auto& keys : ParseEntities())
+	{
+		if (strcmp(ValueForKey(keys, "classname"), "info_player_start") != 0)
+			continue;
+
+		origin = angles = Vector(0, 0, 0);
+		sscanf(ValueForKey(keys, "origin"), "%f %f %f", &origin.x, &origin.y, &origin.z);
+		sscanf(ValueForKey(keys, "angles"), "%f %f %f", &angles.x, &angles.y, &angles.z);
+
+		if (*ValueForKey(keys, "angle") != '\0')
+			angles.y = atof(ValueForKey(keys, "angle"));
+
+		return true;
+	}
+
+	return false;
+}
+
+//=========================================================
+// Physents: the world, brush entities standing where they
+// spawn, water brushes and ladders
+//=========================================================
+static const char* g_SolidClasses[] = {"func_wall", "func_breakable", "func_door", "func_door_rotating", "func_pushable", "func_rotating", "func_wall_toggle", "momentary_door"};
+
+static void InitPhysEnt(physent_t* pe, int info, const char* name, model_t* model, const Vector& origin)
+{
+	memset(pe, 0, sizeof(physent_t));
+	strncpy(pe->name, name, sizeof(pe->name) - 1);
+	pe->info = info;
+	pe->model = model;
+	pe->origin = origin;
+	pe->solid = SOLID_BSP;
+	pe->movetype = MOVETYPE_PUSH;
+}
+
+void PR_SetupPhysEnts(playermove_t* ppmove)
+{
+	ppmove->numphysent = 0;
+	ppmove->nummoveent = 0;
+	ppmove->numvisent = 0;
+
+	InitPhysEnt(&ppmove->physents[ppmove->numphysent++], 0, "world", &g_Models[0], Vector(0, 0, 0));
+
+	int info = 0;
+	for (const auto& keys : ParseEntities())
+	{
+		info++;
+
+		const char* className = ValueForKey(keys, "classname");
+		const char* model = ValueForKey(keys, "model");
+
+		if (model[0] != '*')
+			continue;
+
+		int modelIndex = atoi(model + 1);
+		if (modelIndex <= 0 || modelIndex >= static_cast<int>(g_Models.size()))
+			continue;
+
+		Vector origin(0, 0, 0);
+		sscanf(ValueForKey(keys, "origin"), "%f %f %f", &origin.x, &origin.y, &origin.z);
+
+		if (strcmp(className, "func_ladder") == 0)
+		{
+			if (ppmove->nummoveent == MAX_MOVEENTS)
+				continue;
+
+			physent_t* pe = &ppmove->moveents[ppmove->nummoveent++];
+			InitPhysEnt(pe, info, className, &g_Models[modelIndex], origin);
+			pe->solid = SOLID_NOT;
+			pe->skin = CONTENTS_LADDER;
+			continue;
+		}
+
+		if (ppmove->numphysent == MAX_PHYSENTS)
+			continue;
+
+		int skin = atoi(ValueForKey(keys, "skin"));
+
+		// func_water and friends: not solid, but carry contents
+		if (strcmp(className, "func_water") == 0 || (strcmp(className, "func_illusionary") == 0 && skin != 0))
+		{
+			physent_t* pe = &ppmove->physents[ppmove->numphysent++];
+			InitPhysEnt(pe, info, className, &g_Models[modelIndex], origin);
+			pe->solid = SOLID_NOT;
+			pe->skin = (skin != 0) ? skin : CONTENTS_WATER;
+			continue;
+		}
+
+		for (const char* solidClass : g_SolidClasses)
+		{
+			if (strcmp(className, solidClass) == 0)
+			{
+				InitPhysEnt(&ppmove->physents[ppmove->numphysent++], info, className, &g_Models[modelIndex], origin);
+				break;
+			}
+		}
+	}
+}
+
+//=========================================================
+// Hull tracing
+//=========================================================
+static inline float PlaneDiff(const mplane_t* plane, const Vector& p)
+{
+	if (plane->type < 3)
+		return p[plane->type] - plane->dist;
+
+	return DotProduct(plane->normal, p) - plane->dist;
+}
+
+static int HullPointContents(hull_t* hull, int num, const Vector& p)
+{
+	while (num >= 0)
+	{
+		const dclipnode_t* node = &hull->clipnodes[num];
+		num = ClipChild(node, PlaneDiff(&hull->planes[node->planenum], p) < 0 ? 1 : 0);
+	}
+
+	return num;
+}
+
+static bool RecursiveHullCheck(hull_t* hull, int num, float p1f, float p2f, const Vector& p1, const Vector& p2, pmtrace_t* trace)
+{
+	if (num < 0)
+	{
+		if (num != CONTENTS_SOLID)
+		{
+			trace->allsolid = 0;
+			if (num == CONTENTS_EMPTY)
+				trace->inopen = 1;
+			else
+				trace->inwater = 1;
+		}
+		else
+			trace->startsolid = 1;
+
+		return true;
+	}
+
+	const dclipnode_t* node = &hull->clipnodes[num];
+	const mplane_t* plane = &hull->planes[node->planenum];
+
+	float t1 = PlaneDiff(plane, p1);
+	float t2 = PlaneDiff(plane, p2);
+
+	if (t1 >= 0 && t2 >= 0)
+		return RecursiveHullCheck(hull, ClipChild(node, 0), p1f, p2f, p1, p2, trace);
+	if (t1 < 0 && t2 < 0)
+		return RecursiveHullCheck(hull, ClipChild(node, 1), p1f, p2f, p1, p2, trace);
+
+	// put the crosspoint DIST_EPSILON pixels on the near side
+	float frac = (t1 < 0) ? (t1 + DIST_EPSILON) / (t1 - t2) : (t1 - DIST_EPSILON) / (t1 - t2);
+	frac = std::fmax(0.0f, std::fmin(1.0f, frac));
+
+	float midf = p1f + (p2f - p1f) * frac;
+	Vector mid = p1 + (p2 - p1) * frac;
+	int side = (t1 < 0) ? 1 : 0;
+
+	// move up to the node
+	if (!RecursiveHullCheck(hull, ClipChild(node, side), p1f, midf, p1, mid, trace))
+		return false;
+
+	// go past the node
+	if (HullPointContents(hull, ClipChild(node, side ^ 1), mid) != CONTENTS_SOLID)
+		return RecursiveHullCheck(hull, ClipChild(node, side ^ 1), midf, p2f, mid, p2, trace);
+
+	// never got out of the solid area
+	if (0 != trace->allsolid)
+		return false;
+
+	// the other side of the node is solid, this is the impact point
+	if (0 == side)
+	{
+		trace->plane.normal = plane->normal;
+		trace->plane.dist = plane->dist;
+	}
+	else
+	{
+		trace->plane.normal = -plane->normal;
+		trace->plane.dist = -plane->dist;
+	}
+
+	while (HullPointContents(hull, hull->firstclipnode, mid) == CONTENTS_SOLID)
+	{
+		// shouldn't really happen, but does occasionally
+		frac -= 0.1f;
+		if (frac < 0)
+		{
+			trace->fraction = midf;
+			trace->endpos = mid;
+			return false;
+		}
+
+		midf = p1f + (p2f - p1f) * frac;
+		mid = p1 + (p2 - p1) * frac;
+	}
+
+	trace->fraction = midf;
+	trace->endpos = mid;
+	return false;
+}
+
+// player move hulls are standing, ducked, point and large, the bsp stores point, standing, large and ducked
+static const int g_BspHull[PR_MAX_HULLS] = {1, 3, 0, 2};
+
+static hull_t* HullForBsp(physent_t* pe, int hullNum, Vector& offset)
+{
+	hull_t* hull = &pe->model->hulls[g_BspHull[hullNum & 3]];
+
+	offset = hull->clip_mins - g_pmove->player_mins[hullNum] + pe->origin;
+	return hull;
+}
+
+static pmtrace_t TraceHull(physent_t* pe, int hullNum, const Vector& start, const Vector& end)
+{
+	pmtrace_t trace;
+	Vector offset;
+	hull_t* hull = HullForBsp(pe, hullNum, offset);
+
+	memset(&trace, 0, sizeof(trace));
+	trace.fraction = 1;
+	trace.allsolid = 1;
+	trace.endpos = end;
+
+	RecursiveHullCheck(hull, hull->firstclipnode, 0, 1, start - offset, end - offset, &trace);
+
+	if (0 != trace.allsolid)
+		trace.startsolid = 1;
+	if (0 != trace.startsolid)
+		trace.fraction = 0;
+
+	trace.endpos = trace.endpos + offset;
+	return trace;
+}
+
+static pmtrace_t PlayerTrace(const Vector& start, const Vector& end, int traceFlags, int hullNum, int ignore_pe, int (*pfnIgnore)(physent_t* pe))
+{
+	pmtrace_t total;
+
+	memset(&total, 0, sizeof(total));
+	total.fraction = 1;
+	total.endpos = end;
+	total.ent = -1;
+
+	for (int i = 0; i < g_pmove->numphysent; i++)
+	{
+		physent_t* pe = &g_pmove->physents[i];
+
+		if (i > 0 && (traceFlags & PM_WORLD_ONLY) != 0)
+			break;
+
+		if (i == ignore_pe || pe->solid == SOLID_NOT || (pfnIgnore != nullptr && 0 != pfnIgnore(pe)))
+			continue;
+
+		if ((traceFlags & PM_GLASS_IGNORE) != 0 && pe->rendermode != kRenderNormal)
+			continue;
+
+		pmtrace_t trace = TraceHull(pe, hullNum, start, end);
+
+		if (0 != trace.allsolid)
+			total.allsolid = 1;
+		if (0 != trace.startsolid)
+			total.startsolid = 1;
+
+		// did we clip the move?
+		if (trace.fraction < total.fraction)
+		{
+			total.fraction = trace.fraction;
+			total.endpos = trace.endpos;
+			total.plane = trace.plane;
+			total.inopen = trace.inopen;
+			total.inwater = trace.inwater;
+			total.ent = i;
+		}
+	}
+
+	return total;
+}
+
+//=========================================================
+// playermove_t callbacks
+//=========================================================
+static const char* PR_Info_ValueForKey(const char* s, const char* key)
+{
+	static char value[2][MAX_PHYSINFO_STRING];
+	static int which = 0;
+	char pkey[MAX_PHYSINFO_STRING];
+
+	which ^= 1;
+
+	if (*s == '\\')
+		s++;
+
+	while (true)
+	{
+		char* o = pkey;
+		while (*s != '\0' && *s != '\\' && o - pkey < MAX_PHYSINFO_STRING - 1)
+			*o++ = *s++;
+		*o = '\0';
+
+		if (*s == '\0')
+			return "";
+		s++;
+
+		o = value[which];
+		while (*s != '\0' && *s != '\\' && o - value[which] < MAX_PHYSINFO_STRING - 1)
+			*o++ = *s++;
+		*o = '\0';
+
+		if (strcmp(key, pkey) == 0)
+			return value[which];
+
+		if (*s == '\0')
+			return "";
+		s++;
+	}
+}
+
+static void PR_Particle(float* origin, int color, float life, int zpos, int zvel)
+{
+}
+
+static int PR_TestPlayerPositionEx(float* pos, pmtrace_t* ptrace, int (*pfnIgnore)(physent_t* pe))
+{
+	Vector point(pos[0], pos[1], pos[2]);
+
+	if (ptrace != nullptr)
+		*ptrace = PlayerTrace(point, point, PM_NORMAL, g_pmove->usehull, -1, pfnIgnore);
+
+	for (int i = 0; i < g_pmove->numphysent; i++)
+	{
+		physent_t* pe = &g_pmove->physents[i];
+
+		if (pe->solid == SOLID_NOT || (pfnIgnore != nullptr && 0 != pfnIgnore(pe)))
+			continue;
+
+		Vector offset;
+		hull_t* hull = HullForBsp(pe, g_pmove->usehull, offset);
+
+		if (HullPointContents(hull, hull->firstclipnode, point - offset) == CONTENTS_SOLID)
+			return i;
+	}
+
+	return -1;
+}
+
+static int PR_TestPlayerPosition(float* pos, pmtrace_t* ptrace)
+{
+	return PR_TestPlayerPositionEx(pos, ptrace, nullptr);
+}
+
+static void PR_Con_NPrintf(int idx, const char* fmt, ...)
+{
+}
+
+static void PR_Con_Printf(const char* fmt, ...)
+{
+	if (!g_Verbose)
+		return;
+
+	va_list args;
+	va_start(args, fmt);
+	vprintf(fmt, args);
+	va_end(args);
+}
+
+// the stuck check throttles itself with this, keep it on the replay clock
+static double PR_Sys_FloatTime()
+{
+	return g_Time;
+}
+
+static void PR_StuckTouch(int hitent, pmtrace_t* ptraceresult)
+{
+}
+
+static int PR_PointContentsImpl(const Vector& p, int* truecontents)
+{
+	hull_t* hull = &g_pmove->physents[0].model->hulls[0];
+	int contents = HullPointContents(hull, hull->firstclipnode, p);
+
+	if (truecontents != nullptr)
+		*truecontents = contents;
+
+	if (contents <= CONTENTS_CURRENT_0 && contents >= CONTENTS_CURRENT_DOWN)
+		contents = CONTENTS_WATER;
+
+	if (contents == CONTENTS_SOLID)
+		return CONTENTS_SOLID;
+
+	// water brushes
+	for (int i = 1; i < g_pmove->numphysent; i++)
+	{
+		physent_t* pe = &g_pmove->physents[i];
+
+		if (pe->solid != SOLID_NOT || pe->model == nullptr)
+			continue;
+
+		hull_t* phull = &pe->model->hulls[0];
+
+		if (HullPointContents(phull, phull->firstclipnode, p - pe->origin) != CONTENTS_EMPTY)
+			return pe->skin;
+	}
+
+	return contents;
+}
+
+static int PR_PointContents(float* p, int* truecontents)
+{
+	return PR_PointContentsImpl(Vector(p[0], p[1], p[2]), truecontents);
+}
+
+static int PR_TruePointContents(float* p)
+{
+	hull_t* hull = &g_pmove->physents[0].model->hulls[0];
+	return HullPointContents(hull, hull->firstclipnode, Vector(p[0], p[1], p[2]));
+}
+
+static int PR_HullPointContents(struct hull_s* hull, int num, float* p)
+{
+	return HullPointContents(hull, num, Vector(p[0], p[1], p[2]));
+}
+
+static pmtrace_t PR_PlayerTraceEx(float* start, float* end, int traceFlags, int (*pfnIgnore)(physent_t* pe))
+{
+	return PlayerTrace(Vector(start[0], start[1], start[2]), Vector(end[0], end[1], end[2]), traceFlags, g_pmove->usehull, -1, pfnIgnore);
+}
+
+static pmtrace_t PR_PlayerTrace(float* start, float* end, int traceFlags, int ignore_pe)
+{
+	return PlayerTrace(Vector(start[0], start[1], start[2]), Vector(end[0], end[1], end[2]), traceFlags, g_pmove->usehull, ignore_pe, nullptr);
+}
+
+static pmtrace_t* PR_TraceLineEx(float* start, float* end, int flags, int usehull, int (*pfnIgnore)(physent_t* pe))
+{
+	static pmtrace_t trace;
+
+	trace = PlayerTrace(Vector(start[0], start[1], start[2]), Vector(end[0], end[1], end[2]), flags, usehull, -1, pfnIgnore);
+	return &trace;
+}
+
+static pmtrace_t* PR_TraceLine(float* start, float* end, int flags, int usehull, int ignore_pe)
+{
+	static pmtrace_t trace;
+
+	trace = PlayerTrace(Vector(start[0], start[1], start[2]), Vector(end[0], end[1], end[2]), flags, usehull, ignore_pe, nullptr);
+	return &trace;
+}
+
+static int32 PR_RandomLong(int32 lLow, int32 lHigh)
+{
+	if (lHigh <= lLow)
+		return lLow;
+
+	return std::uniform_int_distribution<int32>(lLow, lHigh)(g_Random);
+}
+
+static float PR_RandomFloat(float flLow, float flHigh)
+{
+	if (flHigh <= flLow)
+		return flLow;
+
+	return std::uniform_real_distribution<float>(flLow, flHigh)(g_Random);
+}
+
+static int PR_GetModelType(model_t* mod)
+{
+	return mod->type;
+}
+
+static void PR_GetModelBounds(model_t* mod, float* mins, float* maxs)
+{
+	VectorCopy(mod->mins, mins);
+	VectorCopy(mod->maxs, maxs);
+}
+
+static void* PR_HullForBsp(physent_t* pe, float* offset)
+{
+	Vector vecOffset;
+	hull_t* hull = HullForBsp(pe, g_pmove->usehull, vecOffset);
+
+	VectorCopy(vecOffset, offset);
+	return hull;
+}
+
+static float PR_TraceModel(physent_t* pEnt, const float* start, const float* end, trace_t* trace)
+{
+	pmtrace_t tr = TraceHull(pEnt, g_pmove->usehull, Vector(start[0], start[1], start[2]), Vector(end[0], end[1], end[2]));
+
+	trace->allsolid = tr.allsolid;
+	trace->startsolid = tr.startsolid;
+	trace->inopen = tr.inopen;
+	trace->inwater = tr.inwater;
+	trace->fraction = tr.fraction;
+	trace->endpos = tr.endpos;
+	trace->plane.normal = tr.plane.normal;
+	trace->plane.dist = tr.plane.dist;
+	trace->ent = nullptr;
+	trace->hitgroup = 0;
+
+	return tr.fraction;
+}
+
+static std::vector<std::vector<byte>> g_LoadedFiles;
+
+static int PR_COM_FileSize(const char* fileName)
+{
+	FILE* file = fopen(fileName, "rb");
+
+	if (file == nullptr)
+		return -1;
+
+	fseek(file, 0, SEEK_END);
+	int length = static_cast<int>(ftell(file));
+	fclose(file);
+	return length;
+}
+
+static byte* PR_COM_LoadFile(const char* path, int usehunk, int* pLength)
+{
+	std::vector<byte> data = LoadFile(path);
+
+	if (data.empty())
+		return nullptr;
+
+	if (pLength != nullptr)
+		*pLength = static_cast<int>(data.size());
+
+	data.push_back(0);
+	g_LoadedFiles.push_back(std::move(data));
+	return g_LoadedFiles.back().data();
+}
+
+static void PR_COM_FreeFile(void* buffer)
+{
+	for (auto it = g_LoadedFiles.begin(); it != g_LoadedFiles.end(); ++it)
+	{
+		if (it->data() == buffer)
+		{
+			g_LoadedFiles.erase(it);
+			return;
+		}
+	}
+}
+
+static char* PR_memfgets(byte* pMemFile, int fileSize, int* pFilePos, char* pBuffer, int bufferSize)
+{
+	if (pMemFile == nullptr || pBuffer == nullptr || pFilePos == nullptr)
+		return nullptr;
+
+	if (*pFilePos >= fileSize)
+		return nullptr;
+
+	int i = *pFilePos;
+	int last = fileSize;
+
+	// fgets always NULL terminates, so only read bufferSize-1 characters
+	if (last - *pFilePos > (bufferSize - 1))
+		last = *pFilePos + (bufferSize - 1);
+
+	bool stop = false;
+
+	// Stop at the next newline (inclusive) or end of buffer
+	while (i < last && !stop)
+	{
+		if (pMemFile[i] == '\n')
+			stop = true;
+		i++;
+	}
+
+	// If we actually advanced the pointer, copy it over
+	if (i != *pFilePos)
+	{
+		int size = i - *pFilePos;
+		memcpy(pBuffer, pMemFile + *pFilePos, size);
+
+		// null terminate
+		if (size < bufferSize)
+			pBuffer[size] = 0;
+
+		*pFilePos = i;
+		return pBuffer;
+	}
+
+	return nullptr;
+}
+
+static void PR_PlaySound(int channel, const char* sample, float volume, float attenuation, int fFlags, int pitch)
+{
+}
+
+// no texture data is loaded, footsteps default to concrete
+static const char* PR_TraceTexture(int ground, float* vstart, float* vend)
+{
+	return nullptr;
+}
+
+static void PR_PlaybackEventFull(int flags, int clientindex, unsigned short eventindex, float delay, float* origin, float* angles, float fparam1, float fparam2, int iparam1, int iparam2, int bparam1, int bparam2)
+{
+}
+
+void PR_InitPlayerMove(playermove_t* ppmove, bool verbose)
+{
+	g_pmove = ppmove;
+	g_Verbose = verbose;
+
+	ppmove->PM_Info_ValueForKey = PR_Info_ValueForKey;
+	ppmove->PM_Particle = PR_Particle;
+	ppmove->PM_TestPlayerPosition = PR_TestPlayerPosition;
+	ppmove->Con_NPrintf = PR_Con_NPrintf;
+	ppmove->Con_DPrintf = PR_Con_Printf;
+	ppmove->Con_Printf = PR_Con_Printf;
+	ppmove->Sys_FloatTime = PR_Sys_FloatTime;
+	ppmove->PM_StuckTouch = PR_StuckTouch;
+	ppmove->PM_PointContents = PR_PointContents;
+	ppmove->PM_TruePointContents = PR_TruePointContents;
+	ppmove->PM_HullPointContents = PR_HullPointContents;
+	ppmove->PM_PlayerTrace = PR_PlayerTrace;
+	ppmove->PM_TraceLine = PR_TraceLine;
+	ppmove->RandomLong = PR_RandomLong;
+	ppmove->RandomFloat = PR_RandomFloat;
+	ppmove->PM_GetModelType = PR_GetModelType;
+	ppmove->PM_GetModelBounds = PR_GetModelBounds;
+	ppmove->PM_HullForBsp = PR_HullForBsp;
+	ppmove->PM_TraceModel = PR_TraceModel;
+	ppmove->COM_FileSize = PR_COM_FileSize;
+	ppmove->COM_LoadFile = PR_COM_LoadFile;
+	ppmove->COM_FreeFile = PR_COM_FreeFile;
+	ppmove->memfgets = PR_memfgets;
+	ppmove->PM_PlaySound = PR_PlaySound;
+	ppmove->PM_TraceTexture = PR_TraceTexture;
+	ppmove->PM_PlaybackEventFull = PR_PlaybackEventFull;
+	ppmove->PM_PlayerTraceEx = PR_PlayerTraceEx;
+	ppmove->PM_TestPlayerPositionEx = PR_TestPlayerPositionEx;
+	ppmove->PM_TraceLineEx = PR_TraceLineEx;
+}
+
+void PR_SetTime(double time)
+{
+	g_Time = time;
+}
+
+void PR_SeedRandom(unsigned int seed)
+{
+	g_Random.seed(seed);
+}
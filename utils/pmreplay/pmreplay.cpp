@@ -0,0 +1,609 @@
+//=========================================================
+// pmreplay.cpp - player movement replay harness.
+//
+// usage: pmreplay -bsp <file> [-stream <file> | -generate <n>] [options]
+//
+// Replays a usercmd stream (recorded on the server with
+// sv_pmrecord, or generated from a seed) through PM_Move,
+// times every command and prints a checksum of the player
+// state so physics changes can be checked for regressions.
+//=========================================================
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "pmreplay.h"
+#include "pm_shared.h"
+
+struct prmovevar_t
+{
+	const char* name;
+	std::size_t offset;
+};
+
+// the skyname and colors don't affect movement and aren't stored
+static const prmovevar_t g_MoveVars[] =
+	{
+		{"gravity", offsetof(movevars_t, gravity)},
+		{"stopspeed", offsetof(movevars_t, stopspeed)},
+		{"maxspeed", offsetof(movevars_t, maxspeed)},
+		{"spectatormaxspeed", offsetof(movevars_t, spectatormaxspeed)},
+		{"accelerate", offsetof(movevars_t, accelerate)},
+		{"airaccelerate", offsetof(movevars_t, airaccelerate)},
+		{"wateraccelerate", offsetof(movevars_t, wateraccelerate)},
+		{"friction", offsetof(movevars_t, friction)},
+		{"edgefriction", offsetof(movevars_t, edgefriction)},
+		{"waterfriction", offsetof(movevars_t, waterfriction)},
+		{"entgravity", offsetof(movevars_t, entgravity)},
+		{"bounce", offsetof(movevars_t, bounce)},
+		{"stepsize", offsetof(movevars_t, stepsize)},
+		{"maxvelocity", offsetof(movevars_t, maxvelocity)},
+		{"zmax", offsetof(movevars_t, zmax)},
+		{"waveHeight", offsetof(movevars_t, waveHeight)},
+		{"rollangle", offsetof(movevars_t, rollangle)},
+		{"rollspeed", offsetof(movevars_t, rollspeed)},
+};
+
+struct prscenario_t
+{
+	const char* bspName = nullptr;
+	const char* streamName = nullptr;
+	const char* writeName = nullptr;
+	const char* csvName = nullptr;
+	const char* expected = nullptr;
+	int generate = 0;
+	int iterations = 1;
+	unsigned int seed = 0;
+	bool verbose = false;
+};
+
+static void Usage()
+{
+	printf("usage: pmreplay -bsp <file> [-stream <file> | -generate <n>] [options]\n"
+		   "  -bsp <file>          map to move in\n"
+		   "  -stream <file>       usercmd stream to replay\n"
+		   "  -generate <n>        make up n commands starting at info_player_start\n"
+		   "  -seed <n>            random seed for -generate and the movement code (default 0)\n"
+		   "  -write <file>        save the replayed stream, with the resulting origins\n"
+		   "  -iterations <n>      replay the stream n times for timing (default 1)\n"
+		   "  -expect <checksum>   exit with an error if the checksum differs\n"
+		   "  -csv <file>          write per-command timings\n"
+		   "  -v                   print movement code console output\n");
+}
+
+//=========================================================
+// Streams
+//=========================================================
+static void DefaultStream(pmstream_t& stream)
+{
+	memset(&stream.movevars, 0, sizeof(stream.movevars));
+	stream.movevars.gravity = 800;
+	stream.movevars.stopspeed = 100;
+	stream.movevars.maxspeed = 320;
+	stream.movevars.spectatormaxspeed = 500;
+	stream.movevars.accelerate = 10;
+	stream.movevars.airaccelerate = 10;
+	stream.movevars.wateraccelerate = 10;
+	stream.movevars.friction = 4;
+	stream.movevars.edgefriction = 2;
+	stream.movevars.waterfriction = 1;
+	stream.movevars.entgravity = 1;
+	stream.movevars.bounce = 1;
+	stream.movevars.stepsize = 18;
+	stream.movevars.maxvelocity = 2000;
+	stream.movevars.zmax = 4096;
+	stream.movevars.footsteps = 1;
+
+	stream.origin = stream.velocity = stream.basevelocity = stream.punchangle = Vector(0, 0, 0);
+	stream.view_ofs = Vector(0, 0, 28);
+	stream.flDuckTime = 0;
+	stream.bInDuck = 0;
+	stream.flTimeStepSound = 0;
+	stream.iStepLeft = 0;
+	stream.flFallVelocity = 0;
+	stream.flSwimTime = 0;
+	stream.flags = FL_CLIENT;
+	stream.usehull = 0;
+	stream.gravity = 1;
+	stream.friction = 1;
+	stream.oldbuttons = 0;
+	stream.waterjumptime = 0;
+	stream.movetype = MOVETYPE_WALK;
+	stream.waterlevel = 0;
+	stream.watertype = CONTENTS_EMPTY;
+	stream.clientmaxspeed = 0;
+}
+
+static bool ParseState(pmstream_t& stream, const char* name, const char* values)
+{
+	struct
+	{
+		const char* name;
+		Vector* value;
+	} vectors[] = {{"origin", &stream.origin}, {"velocity", &stream.velocity}, {"basevelocity", &stream.basevelocity}, {"view_ofs", &stream.view_ofs}, {"punchangle", &stream.punchangle}};
+
+	struct
+	{
+		const char* name;
+		float* value;
+	} floats[] = {{"duck_time", &stream.flDuckTime}, {"fall_velocity", &stream.flFallVelocity}, {"swim_time", &stream.flSwimTime}, {"gravity", &stream.gravity}, {"friction", &stream.friction}, {"waterjump_time", &stream.waterjumptime}, {"clientmaxspeed", &stream.clientmaxspeed}};
+
+	struct
+	{
+		const char* name;
+		int* value;
+	} ints[] = {{"in_duck", &stream.bInDuck}, {"step_sound_time", &stream.flTimeStepSound}, {"step_left", &stream.iStepLeft}, {"flags", &stream.flags}, {"usehull", &stream.usehull}, {"oldbuttons", &stream.oldbuttons}, {"movetype", &stream.movetype}, {"waterlevel", &stream.waterlevel}, {"watertype", &stream.watertype}};
+
+	for (const auto& v : vectors)
+	{
+		if (0 == strcmp(name, v.name))
+			return 3 == sscanf(values, "%f %f %f", &v.value->x, &v.value->y, &v.value->z);
+	}
+
+	for (const auto& f : floats)
+	{
+		if (0 == strcmp(name, f.name))
+			return 1 == sscanf(values, "%f", f.value);
+	}
+
+	for (const auto& i : ints)
+	{
+		if (0 == strcmp(name, i.name))
+			return 1 == sscanf(values, "%d", i.value);
+	}
+
+	return false;
+}
+
+bool PR_LoadStream(const char* fileName, pmstream_t& stream)
+{
+	FILE* file = fopen(fileName, "r");
+
+	if (file == nullptr)
+	{
+		printf("Couldn't open %s\n", fileName);
+		return false;
+	}
+
+	DefaultStream(stream);
+	stream.commands.clear();
+
+	char line[1024];
+	int lineNum = 0;
+	bool ok = true;
+
+	while (ok && fgets(line, sizeof(line), file))
+	{
+		lineNum++;
+		line[strcspn(line, "\r\n")] = '\0';
+
+		char keyword[64], name[64];
+		int consumed = 0;
+
+		if (1 != sscanf(line, "%63s %n", keyword, &consumed))
+			continue;
+
+		const char* rest = line + consumed;
+
+		if (0 == strcmp(keyword, "pmreplay"))
+		{
+			if (atoi(rest) != PMREPLAY_VERSION)
+			{
+				printf("%s has version %d, expected %d\n", fileName, atoi(rest), PMREPLAY_VERSION);
+				ok = false;
+			}
+		}
+		else if (0 == strcmp(keyword, "map"))
+			stream.mapName = rest;
+		else if (0 == strcmp(keyword, "physinfo"))
+			stream.physinfo = rest;
+		else if (0 == strcmp(keyword, "movevar"))
+		{
+			float value;
+			ok = 2 == sscanf(rest, "%63s %f", name, &value);
+
+			if (ok && 0 == strcmp(name, "footsteps"))
+				stream.movevars.footsteps = static_cast<qboolean>(value);
+			else if (ok)
+			{
+				const prmovevar_t* var = std::find_if(std::begin(g_MoveVars), std::end(g_MoveVars), [&](const prmovevar_t& v)
+					{ return 0 == strcmp(v.name, name); });
+
+				if (var != std::end(g_MoveVars))
+					*reinterpret_cast<float*>(reinterpret_cast<byte*>(&stream.movevars) + var->offset) = value;
+			}
+		}
+		else if (0 == strcmp(keyword, "state"))
+		{
+			ok = 1 == sscanf(rest, "%63s %n", name, &consumed) && ParseState(stream, name, rest + consumed);
+		}
+		else if (0 == strcmp(keyword, "cmd"))
+		{
+			pmcommand_t command;
+			int msec, buttons, impulse;
+
+			memset(&command, 0, sizeof(command));
+			ok = 9 == sscanf(rest, "%d %f %f %f %f %f %f %d %d", &msec, &command.cmd.viewangles.x, &command.cmd.viewangles.y, &command.cmd.viewangles.z, &command.cmd.forwardmove, &command.cmd.sidemove, &command.cmd.upmove, &buttons, &impulse);
+
+			command.cmd.msec = static_cast<byte>(std::clamp(msec, 0, 255));
+			command.cmd.buttons = static_cast<unsigned short>(buttons);
+			command.cmd.impulse = static_cast<byte>(impulse);
+
+			if (ok)
+				stream.commands.push_back(command);
+		}
+		else if (0 == strcmp(keyword, "pos"))
+		{
+			ok = !stream.commands.empty() && 3 == sscanf(rest, "%f %f %f", &stream.commands.back().pos.x, &stream.commands.back().pos.y, &stream.commands.back().pos.z);
+
+			if (ok)
+				stream.commands.back().hasPos = true;
+		}
+		else
+			ok = false;
+
+		if (!ok)
+			printf("%s(%d): bad line \"%s\"\n", fileName, lineNum, line);
+	}
+
+	fclose(file);
+	return ok;
+}
+
+bool PR_WriteStream(const char* fileName, const pmstream_t& stream)
+{
+	FILE* file = fopen(fileName, "w");
+
+	if (file == nullptr)
+	{
+		printf("Couldn't write %s\n", fileName);
+		return false;
+	}
+
+	fprintf(file, "pmreplay %d\n", PMREPLAY_VERSION);
+	fprintf(file, "map %s\n", stream.mapName.c_str());
+
+	for (const prmovevar_t& var : g_MoveVars)
+		fprintf(file, "movevar %s %.9g\n", var.name, *reinterpret_cast<const float*>(reinterpret_cast<const byte*>(&stream.movevars) + var.offset));
+	fprintf(file, "movevar footsteps %d\n", stream.movevars.footsteps);
+
+	if (!stream.physinfo.empty())
+		fprintf(file, "physinfo %s\n", stream.physinfo.c_str());
+
+	// %.9g round-trips floats exactly
+	fprintf(file, "state origin %.9g %.9g %.9g\n", stream.origin.x, stream.origin.y, stream.origin.z);
+	fprintf(file, "state velocity %.9g %.9g %.9g\n", stream.velocity.x, stream.velocity.y, stream.velocity.z);
+	fprintf(file, "state basevelocity %.9g %.9g %.9g\n", stream.basevelocity.x, stream.basevelocity.y, stream.basevelocity.z);
+	fprintf(file, "state view_ofs %.9g %.9g %.9g\n", stream.view_ofs.x, stream.view_ofs.y, stream.view_ofs.z);
+	fprintf(file, "state punchangle %.9g %.9g %.9g\n", stream.punchangle.x, stream.punchangle.y, stream.punchangle.z);
+	fprintf(file, "state duck_time %.9g\n", stream.flDuckTime);
+	fprintf(file, "state in_duck %d\n", stream.bInDuck);
+	fprintf(file, "state step_sound_time %d\n", stream.flTimeStepSound);
+	fprintf(file, "state step_left %d\n", stream.iStepLeft);
+	fprintf(file, "state fall_velocity %.9g\n", stream.flFallVelocity);
+	fprintf(file, "state swim_time %.9g\n", stream.flSwimTime);
+	fprintf(file, "state flags %d\n", stream.flags);
+	fprintf(file, "state usehull %d\n", stream.usehull);
+	fprintf(file, "state gravity %.9g\n", stream.gravity);
+	fprintf(file, "state friction %.9g\n", stream.friction);
+	fprintf(file, "state oldbuttons %d\n", stream.oldbuttons);
+	fprintf(file, "state waterjump_time %.9g\n", stream.waterjumptime);
+	fprintf(file, "state movetype %d\n", stream.movetype);
+	fprintf(file, "state waterlevel %d\n", stream.waterlevel);
+	fprintf(file, "state watertype %d\n", stream.watertype);
+	fprintf(file, "state clientmaxspeed %.9g\n", stream.clientmaxspeed);
+
+	for (const pmcommand_t& command : stream.commands)
+	{
+		const usercmd_t& cmd = command.cmd;
+
+		fprintf(file, "cmd %d %.9g %.9g %.9g %.9g %.9g %.9g %d %d\n", cmd.msec, cmd.viewangles.x, cmd.viewangles.y, cmd.viewangles.z, cmd.forwardmove, cmd.sidemove, cmd.upmove, cmd.buttons, cmd.impulse);
+
+		if (command.hasPos)
+			fprintf(file, "pos %.9g %.9g %.9g\n", command.pos.x, command.pos.y, command.pos.z);
+	}
+
+	fclose(file);
+	return true;
+}
+
+// wanders around: runs, turns, strafes, jumps and ducks now and then
+static void GenerateStream(pmstream_t& stream, int count, unsigned int seed)
+{
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> turn(-4, 4);
+	std::uniform_int_distribution<int> chance(0, 99);
+
+	Vector angles(0, 0, 0);
+	PR_FindPlayerStart(stream.origin, angles);
+
+	float yawSpeed = 0;
+	float side = 0;
+	int buttons = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		pmcommand_t command;
+		memset(&command, 0, sizeof(command));
+
+		if (chance(random) < 5)
+			yawSpeed = turn(random);
+		if (chance(random) < 3)
+			side = (chance(random) < 50) ? -400.0f : (chance(random) < 50 ? 0.0f : 400.0f);
+
+		buttons &= ~IN_JUMP;
+		if (chance(random) < 4)
+			buttons |= IN_JUMP;
+		if (chance(random) < 2)
+			buttons ^= IN_DUCK;
+
+		angles.y = fmodf(angles.y + yawSpeed, 360.0f);
+		angles.x = 10.0f * sinf(i * 0.05f);
+
+		command.cmd.msec = 10;
+		command.cmd.viewangles = angles;
+		command.cmd.forwardmove = 400;
+		command.cmd.sidemove = side;
+		command.cmd.buttons = static_cast<unsigned short>(buttons | IN_FORWARD);
+
+		stream.commands.push_back(command);
+	}
+}
+
+//=========================================================
+// Replay
+//=========================================================
+static playermove_t g_pmove;
+
+static void ResetPlayer(const pmstream_t& stream)
+{
+	g_pmove.player_index = 0;
+	g_pmove.server = 1;
+	g_pmove.multiplayer = 0;
+	g_pmove.origin = stream.origin;
+	g_pmove.velocity = stream.velocity;
+	g_pmove.basevelocity = stream.basevelocity;
+	g_pmove.view_ofs = stream.view_ofs;
+	g_pmove.punchangle = stream.punchangle;
+	g_pmove.movedir = Vector(0, 0, 0);
+	g_pmove.flDuckTime = stream.flDuckTime;
+	g_pmove.bInDuck = stream.bInDuck;
+	g_pmove.flTimeStepSound = stream.flTimeStepSound;
+	g_pmove.iStepLeft = stream.iStepLeft;
+	g_pmove.flFallVelocity = stream.flFallVelocity;
+	g_pmove.flSwimTime = stream.flSwimTime;
+	g_pmove.flags = stream.flags;
+	g_pmove.usehull = stream.usehull;
+	g_pmove.gravity = stream.gravity;
+	g_pmove.friction = stream.friction;
+	g_pmove.oldbuttons = stream.oldbuttons;
+	g_pmove.waterjumptime = stream.waterjumptime;
+	g_pmove.movetype = stream.movetype;
+	g_pmove.waterlevel = stream.waterlevel;
+	g_pmove.watertype = stream.watertype;
+	g_pmove.clientmaxspeed = stream.clientmaxspeed;
+	g_pmove.maxspeed = stream.movevars.maxspeed;
+	g_pmove.dead = 0;
+	g_pmove.deadflag = DEAD_NO;
+	g_pmove.spectator = 0;
+	g_pmove.onground = -1;
+	g_pmove.runfuncs = 1;
+	g_pmove.time = 0;
+	g_pmove.movevars = const_cast<movevars_t*>(&stream.movevars);
+
+	strncpy(g_pmove.physinfo, stream.physinfo.c_str(), sizeof(g_pmove.physinfo) - 1);
+	g_pmove.physinfo[sizeof(g_pmove.physinfo) - 1] = '\0';
+
+	PR_SetupPhysEnts(&g_pmove);
+}
+
+static inline void Checksum(unsigned int& hash, const void* data, std::size_t size)
+{
+	const byte* bytes = static_cast<const byte*>(data);
+
+	// FNV-1a
+	for (std::size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * 16777619u;
+}
+
+// runs every command once, returns the checksum of the player states
+static unsigned int Replay(pmstream_t& stream, double* cmdTimes, bool storePos, int& divergence)
+{
+	unsigned int hash = 2166136261u;
+	double time = 0;
+
+	ResetPlayer(stream);
+	divergence = -1;
+
+	for (std::size_t i = 0; i < stream.commands.size(); i++)
+	{
+		pmcommand_t& command = stream.commands[i];
+
+		g_pmove.cmd = command.cmd;
+		g_pmove.oldangles = g_pmove.angles;
+		g_pmove.angles = command.cmd.viewangles;
+		g_pmove.frametime = command.cmd.msec / 1000.0f;
+		g_pmove.time = static_cast<float>(time * 1000.0);
+		g_pmove.numtouch = 0;
+		PR_SetTime(time);
+
+		auto start = std::chrono::steady_clock::now();
+		PM_Move(&g_pmove, true);
+		auto end = std::chrono::steady_clock::now();
+
+		cmdTimes[i] += std::chrono::duration<double, std::milli>(end - start).count();
+
+		// the engine keeps the buttons for the next command
+		g_pmove.oldbuttons = command.cmd.buttons;
+		time += command.cmd.msec / 1000.0;
+
+		Checksum(hash, &g_pmove.origin, sizeof(g_pmove.origin));
+		Checksum(hash, &g_pmove.velocity, sizeof(g_pmove.velocity));
+		Checksum(hash, &g_pmove.flags, sizeof(g_pmove.flags));
+
+		if (storePos)
+		{
+			command.hasPos = true;
+			command.pos = g_pmove.origin;
+		}
+		else if (command.hasPos && divergence < 0 && (command.pos - g_pmove.origin).Length() > 0.1f)
+			divergence = static_cast<int>(i);
+	}
+
+	return hash;
+}
+
+int main(int argc, char** argv)
+{
+	prscenario_t scenario;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* next = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+		if (0 == strcmp(arg, "-v"))
+			scenario.verbose = true;
+		else if (!next)
+		{
+			Usage();
+			return 1;
+		}
+		else if (0 == strcmp(arg, "-bsp"))
+			scenario.bspName = argv[++i];
+		else if (0 == strcmp(arg, "-stream"))
+			scenario.streamName = argv[++i];
+		else if (0 == strcmp(arg, "-generate"))
+			scenario.generate = std::max(1, atoi(argv[++i]));
+		else if (0 == strcmp(arg, "-seed"))
+			scenario.seed = strtoul(argv[++i], nullptr, 10);
+		else if (0 == strcmp(arg, "-write"))
+			scenario.writeName = argv[++i];
+		else if (0 == strcmp(arg, "-iterations"))
+			scenario.iterations = std::max(1, atoi(argv[++i]));
+		else if (0 == strcmp(arg, "-expect"))
+			scenario.expected = argv[++i];
+		else if (0 == strcmp(arg, "-csv"))
+			scenario.csvName = argv[++i];
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	if (!scenario.bspName || (!scenario.streamName && 0 == scenario.generate))
+	{
+		Usage();
+		return 1;
+	}
+
+	if (!PR_LoadBSP(scenario.bspName))
+		return 1;
+
+	pmstream_t stream;
+
+	if (scenario.streamName)
+	{
+		if (!PR_LoadStream(scenario.streamName, stream))
+			return 1;
+	}
+	else
+	{
+		DefaultStream(stream);
+		stream.mapName = scenario.bspName;
+		GenerateStream(stream, scenario.generate, scenario.seed);
+	}
+
+	if (stream.commands.empty())
+	{
+		printf("No commands to replay\n");
+		return 1;
+	}
+
+	memset(&g_pmove, 0, sizeof(g_pmove));
+	PR_InitPlayerMove(&g_pmove, scenario.verbose);
+	PM_Init(&g_pmove);
+
+	std::vector<double> cmdTimes(stream.commands.size());
+	unsigned int checksum = 0;
+	int divergence = -1;
+
+	for (int i = 0; i < scenario.iterations; i++)
+	{
+		// every pass has to see the same random numbers
+		PR_SeedRandom(scenario.seed);
+
+		unsigned int hash = Replay(stream, cmdTimes.data(), false, divergence);
+
+		if (i > 0 && hash != checksum)
+			printf("Iteration %d has checksum %08x, expected %08x: movement isn't deterministic\n", i, hash, checksum);
+
+		checksum = hash;
+	}
+
+	const Vector finalOrigin = g_pmove.origin;
+
+	if (scenario.writeName)
+	{
+		PR_SeedRandom(scenario.seed);
+		std::vector<double> unused(stream.commands.size());
+		Replay(stream, unused.data(), true, divergence);
+
+		if (!PR_WriteStream(scenario.writeName, stream))
+			return 1;
+	}
+
+	for (double& cmdTime : cmdTimes)
+		cmdTime /= scenario.iterations;
+
+	if (scenario.csvName)
+	{
+		FILE* csv = fopen(scenario.csvName, "w");
+		if (csv)
+		{
+			fprintf(csv, "cmd,ms\n");
+			for (std::size_t i = 0; i < cmdTimes.size(); i++)
+				fprintf(csv, "%d,%.6f\n", static_cast<int>(i), cmdTimes[i]);
+			fclose(csv);
+		}
+		else
+			printf("Couldn't write %s\n", scenario.csvName);
+	}
+
+	double total = 0;
+	for (double cmdTime : cmdTimes)
+		total += cmdTime;
+
+	std::vector<double> sorted = cmdTimes;
+	std::sort(sorted.begin(), sorted.end());
+
+	printf("%s: %d commands, %d physents, %d iterations\n", stream.mapName.c_str(), static_cast<int>(cmdTimes.size()), g_pmove.numphysent, scenario.iterations);
+	printf("mean %.4f us  p50 %.4f us  p95 %.4f us  max %.4f us\n",
+		1000.0 * total / cmdTimes.size(),
+		1000.0 * sorted[sorted.size() / 2],
+		1000.0 * sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)],
+		1000.0 * sorted.back());
+	printf("final origin %.3f %.3f %.3f  checksum %08x\n", finalOrigin.x, finalOrigin.y, finalOrigin.z, checksum);
+
+	int result = 0;
+
+	if (divergence >= 0)
+	{
+		const pmcommand_t& command = stream.commands[divergence];
+		printf("Diverged from the recording at command %d (recorded %.3f %.3f %.3f)\n", divergence, command.pos.x, command.pos.y, command.pos.z);
+		result = 2;
+	}
+
+	if (scenario.expected && strtoul(scenario.expected, nullptr, 16) != checksum)
+	{
+		printf("Checksum mismatch: expected %s\n", scenario.expected);
+		result = 2;
+	}
+
+	return result;
+}
@@ -0,0 +1,85 @@
+//=========================================================
+// pmreplay.h - player movement replay harness.
+//
+// Runs the shared player movement code (pm_shared) outside
+// the engine. A playermove_t is filled with trace and point
+// contents functions working on the clip hulls of a .bsp,
+// then a recorded usercmd stream is fed through PM_Move and
+// the cost of every command and a checksum of the resulting
+// origins are reported.
+//
+// Streams are text, one record per line:
+//   pmreplay <version>
+//   map <name>
+//   movevar <name> <value>        one per movevars_t field
+//   physinfo <info string>
+//   state <name> <value...>       player state before the first command
+//   cmd <msec> <pitch> <yaw> <roll> <forward> <side> <up> <buttons> <impulse>
+//   pos <x> <y> <z>               origin the server ended up at, optional
+//=========================================================
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Platform.h"
+#include "mathlib.h"
+#include "const.h"
+#include "usercmd.h"
+#include "pm_defs.h"
+#include "pm_movevars.h"
+
+#define PMREPLAY_VERSION 1
+
+struct pmcommand_t
+{
+	usercmd_t cmd;
+	bool hasPos;
+	Vector pos; // recorded result, for divergence checks
+};
+
+struct pmstream_t
+{
+	std::string mapName;
+	movevars_t movevars;
+	std::string physinfo;
+
+	// player state before the first command
+	Vector origin;
+	Vector velocity;
+	Vector basevelocity;
+	Vector view_ofs;
+	Vector punchangle;
+	float flDuckTime;
+	int bInDuck;
+	int flTimeStepSound;
+	int iStepLeft;
+	float flFallVelocity;
+	float flSwimTime;
+	int flags;
+	int usehull;
+	float gravity;
+	float friction;
+	int oldbuttons;
+	float waterjumptime;
+	int movetype;
+	int waterlevel;
+	int watertype;
+	float clientmaxspeed;
+
+	std::vector<pmcommand_t> commands;
+};
+
+// pmreplay.cpp
+bool PR_LoadStream(const char* fileName, pmstream_t& stream);
+bool PR_WriteStream(const char* fileName, const pmstream_t& stream);
+
+// pm_world.cpp
+bool PR_LoadBSP(const char* fileName);
+const char* PR_EntityLump();
+bool PR_FindPlayerStart(Vector& origin, Vector& angles);
+void PR_InitPlayerMove(playermove_t* ppmove, bool verbose);
+void PR_SetupPhysEnts(playermove_t* ppmove);
+void PR_SetTime(double time);
+void PR_SeedRandom(unsigned int seed);
@@ -10,11 +10,12 @@
 
 #include "bsp5.h"
 
-int outleafs;
-int valid;
-int c_falsenodes;
-int c_free_faces;
-int c_keep_faces;
+// hulls can be filled in parallel, see ProcessModel
+thread_local int outleafs;
+thread_local int valid;
+thread_local int c_falsenodes;
+thread_local int c_free_faces;
+thread_local int c_keep_faces;
 
 /*
 ===========
@@ -76,7 +77,7 @@ void WindingCenter(winding_t* w, vec3_t center)
 MarkLeakTrail
 ==============
 */
-portal_t* prevleaknode;
+thread_local portal_t* prevleaknode;
 FILE *pointfile, *linefile;
 void MarkLeakTrail(portal_t* n2)
 {
@@ -120,8 +121,8 @@ If fill is false, just check, don't fill
 Returns true if an occupied leaf is reached
 ==================
 */
-int hit_occupied;
-int backdraw;
+thread_local int hit_occupied;
+thread_local int backdraw;
 qboolean RecursiveFillOutside(node_t* l, qboolean fill)
 {
 	portal_t* p;
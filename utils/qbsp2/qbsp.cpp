@@ -10,6 +10,8 @@
 
 // qbsp.c
 
+#include <atomic>
+
 #include "bsp5.h"
 
 //
@@ -32,7 +34,7 @@ char portfilename[1024];
 
 FILE* polyfiles[NUM_HULLS];
 
-int hullnum;
+thread_local int hullnum;
 
 //===========================================================================
 
@@ -547,17 +549,27 @@ void SplitFace(face_t* in, dplane_t* split, face_t** front, face_t** back)
 
 //===========================================================================
 
-int c_activefaces, c_peakfaces;
-int c_activesurfaces, c_peaksurfaces;
-int c_activewindings, c_peakwindings;
-int c_activeportals, c_peakportals;
+// the hulls are built on several threads
+std::atomic<int> c_activefaces, c_peakfaces;
+std::atomic<int> c_activesurfaces, c_peaksurfaces;
+std::atomic<int> c_activewindings, c_peakwindings;
+std::atomic<int> c_activeportals, c_peakportals;
 
 void PrintMemory(void)
 {
-	printf("faces   : %6i (%6i)\n", c_activefaces, c_peakfaces);
-	printf("surfaces: %6i (%6i)\n", c_activesurfaces, c_peaksurfaces);
-	printf("windings: %6i (%6i)\n", c_activewindings, c_peakwindings);
-	printf("portals : %6i (%6i)\n", c_activeportals, c_peakportals);
+	printf("faces   : %6i (%6i)\n", c_activefaces.load(), c_peakfaces.load());
+	printf("surfaces: %6i (%6i)\n", c_activesurfaces.load(), c_peaksurfaces.load());
+	printf("windings: %6i (%6i)\n", c_activewindings.load(), c_peakwindings.load());
+	printf("portals : %6i (%6i)\n", c_activeportals.load(), c_peakportals.load());
+}
+
+static void CountAlloc(std::atomic<int>& active, std::atomic<int>& peak)
+{
+	int count = ++active;
+	int oldpeak = peak;
+
+	while (count > oldpeak && !peak.compare_exchange_weak(oldpeak, count))
+		;
 }
 
 /*
@@ -573,9 +585,7 @@ winding_t* NewWinding(int points)
 	if (points > MAX_POINTS_ON_WINDING)
 		Error("NewWinding: %i points", points);
 
-	c_activewindings++;
-	if (c_activewindings > c_peakwindings)
-		c_peakwindings = c_activewindings;
+	CountAlloc(c_activewindings, c_peakwindings);
 
 	size = (int)((winding_t*)0)->points[points];
 	w = reinterpret_cast<winding_t*>(malloc(size));
@@ -602,9 +612,7 @@ face_t* AllocFace(void)
 {
 	face_t* f;
 
-	c_activefaces++;
-	if (c_activefaces > c_peakfaces)
-		c_peakfaces = c_activefaces;
+	CountAlloc(c_activefaces, c_peakfaces);
 
 	f = reinterpret_cast<face_t*>(malloc(sizeof(face_t)));
 	memset(f, 0, sizeof(face_t));
@@ -633,9 +641,7 @@ surface_t* AllocSurface(void)
 	s = reinterpret_cast<surface_t*>(malloc(sizeof(surface_t)));
 	memset(s, 0, sizeof(surface_t));
 
-	c_activesurfaces++;
-	if (c_activesurfaces > c_peaksurfaces)
-		c_peaksurfaces = c_activesurfaces;
+	CountAlloc(c_activesurfaces, c_peaksurfaces);
 
 	return s;
 }
@@ -655,9 +661,7 @@ portal_t* AllocPortal(void)
 {
 	portal_t* p;
 
-	c_activeportals++;
-	if (c_activeportals > c_peakportals)
-		c_peakportals = c_activeportals;
+	CountAlloc(c_activeportals, c_peakportals);
 
 	p = reinterpret_cast<portal_t*>(malloc(sizeof(portal_t)));
 	memset(p, 0, sizeof(portal_t));
@@ -690,7 +694,7 @@ node_t* AllocNode(void)
 
 //===========================================================================
 
-face_t* validfaces[MAX_MAP_PLANES];
+thread_local face_t* validfaces[MAX_MAP_PLANES];
 
 
 
@@ -812,6 +816,44 @@ surfchain_t* ReadSurfs(FILE* file)
 }
 
 
+surfchain_t* hullsurfs[NUM_HULLS];
+node_t* hullnodes[NUM_HULLS];
+
+/*
+===============
+BuildHull
+
+Builds the bsp tree for one hull of the current model.  Nothing
+is emitted to the bsp tables here, so the hulls can be built in
+parallel and written out in order afterwards.
+===============
+*/
+void BuildHull(int hull)
+{
+	node_t* nodes;
+
+	hullnum = hull;
+
+	if (hull != 0)
+		hullsurfs[hull] = ReadSurfs(polyfiles[hull]);
+
+	//
+	// SolidBSP generates a node tree
+	//
+	nodes = SolidBSP(hullsurfs[hull]);
+
+	//
+	// build all the portals in the bsp tree
+	// some portals are solid polygons, and some are paths to other leafs
+	//
+	if (nummodels == 1 && !nofill)			   // assume non-world bmodels are simple
+		nodes = FillOutside(nodes, hull == 0); // make a leakfile if bad
+
+	FreePortals(nodes);
+
+	hullnodes[hull] = nodes;
+}
+
 /*
 ===============
 ProcessModel
@@ -823,6 +865,7 @@ qboolean ProcessModel(void)
 	node_t* nodes;
 	dmodel_t* model;
 	int startleafs;
+	int i;
 
 	surfs = ReadSurfs(polyfiles[0]);
 
@@ -842,19 +885,23 @@ qboolean ProcessModel(void)
 	VectorCopy(surfs->mins, model->mins);
 	VectorCopy(surfs->maxs, model->maxs);
 
-	//
-	// SolidBSP generates a node tree
-	//
-	nodes = SolidBSP(surfs);
+	hullsurfs[0] = surfs;
 
 	//
-	// build all the portals in the bsp tree
-	// some portals are solid polygons, and some are paths to other leafs
+	// the hulls are independent until they are written, the drawing
+	// window can only be used from this thread though
 	//
-	if (nummodels == 1 && !nofill)		  // assume non-world bmodels are simple
-		nodes = FillOutside(nodes, true); // make a leakfile if bad
+	if (noclip)
+		BuildHull(0);
+	else if (drawflag)
+	{
+		for (i = 0; i < NUM_HULLS; i++)
+			BuildHull(i);
+	}
+	else
+		RunThreadsOnIndividual(NUM_HULLS, false, BuildHull);
 
-	FreePortals(nodes);
+	nodes = hullnodes[0];
 
 	// fix tjunctions
 	tjunc(nodes);
@@ -873,17 +920,13 @@ qboolean ProcessModel(void)
 		return true;
 
 	//
-	// the clipping hulls are simpler
+	// the clipping hulls are simpler, write them in order so the
+	// clipnodes come out the same however the threads ran
 	//
-	for (hullnum = 1; hullnum < NUM_HULLS; hullnum++)
+	for (i = 1; i < NUM_HULLS; i++)
 	{
-		surfs = ReadSurfs(polyfiles[hullnum]);
-		nodes = SolidBSP(surfs);
-		if (nummodels == 1 && !nofill) // assume non-world bmodels are simple
-			nodes = FillOutside(nodes, false);
-		FreePortals(nodes);
-		model->headnode[hullnum] = numclipnodes;
-		WriteClipNodes(nodes);
+		model->headnode[i] = numclipnodes;
+		WriteClipNodes(hullnodes[i]);
 	}
 
 	return true;
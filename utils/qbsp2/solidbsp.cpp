@@ -10,6 +10,13 @@
 
 // solidbsp.c
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "bsp5.h"
 
 /*
@@ -19,9 +26,9 @@
 
 */
 
-int c_leaffaces;
-int c_nodefaces;
-int c_splitnodes;
+thread_local int c_leaffaces;
+thread_local int c_nodefaces;
+thread_local int c_splitnodes;
 
 //============================================================================
 
@@ -160,6 +167,336 @@ surface_t* ChooseMidPlaneFromList(surface_t* surfaces, vec3_t mins, vec3_t maxs)
 
 
 
+/*
+  ChoosePlaneFromList counts, for every candidate plane, the faces of the
+  other surfaces that it would split.  The faces are gathered into flat
+  arrays with their bounds once per node, so most FaceSide calls can be
+  rejected from the bounds of a surface or face, and the ones against axial
+  planes are answered by the bounds alone.
+
+  Nodes with a lot of candidates count them up front, on the thread that
+  builds the node together with a set of helper threads.  The helpers are
+  shared by all the hulls, since RunThreadsOn is already busy building the
+  hulls and can't be nested.
+*/
+
+#define CHOOSE_THREAD_SURFACES 256 // fewer candidates aren't worth handing to the helpers
+#define BOUNDS_EPSILON 0.001	   // rounding slack for the sloping plane bounds test
+
+typedef struct
+{
+	int surface; // index of the split surface in choose_t
+	int count;	 // number of its faces that would be split
+} splitcount_t;
+
+typedef struct
+{
+	surface_t* surface;
+	vec3_t mins, maxs; // of its faces
+	int firstface;
+	int numfaces;
+} choosesurf_t;
+
+typedef struct
+{
+	int numsurfaces;
+	choosesurf_t* surfaces; // the surfaces not on a node yet, in list order
+	face_t** faces;
+	vec3_t* facemins;
+	vec3_t* facemaxs;
+	std::vector<splitcount_t>* splits; // for each candidate when counted up front
+} choose_t;
+
+typedef struct
+{
+	choose_t* choose;
+	int next; // next candidate to hand out
+	int done; // candidates counted
+} choosebatch_t;
+
+typedef struct
+{
+	std::mutex lock;
+	std::condition_variable work; // a batch was queued
+	std::condition_variable done; // a candidate of some batch was counted
+	std::deque<choosebatch_t*> batches;
+} choosepool_t;
+
+static choosepool_t* choosepool; // never freed, the helpers wait on it until the process exits
+
+/*
+==================
+BoundsOnPlane
+
+False if nothing inside the bounds can be SIDE_ON for FaceSide.
+This is exact for axial planes.
+==================
+*/
+static qboolean BoundsOnPlane(vec3_t mins, vec3_t maxs, dplane_t* split)
+{
+	int i;
+	vec_t front, back;
+
+	if (split->type < 3)
+		return maxs[split->type] > split->dist + ON_EPSILON && mins[split->type] < split->dist - ON_EPSILON;
+
+	front = back = -split->dist;
+
+	for (i = 0; i < 3; i++)
+	{
+		if (split->normal[i] > 0)
+		{
+			front += split->normal[i] * maxs[i];
+			back += split->normal[i] * mins[i];
+		}
+		else
+		{
+			front += split->normal[i] * mins[i];
+			back += split->normal[i] * maxs[i];
+		}
+	}
+
+	return front > ON_EPSILON - BOUNDS_EPSILON && back < -ON_EPSILON + BOUNDS_EPSILON;
+}
+
+/*
+==================
+SurfaceSplits
+
+Returns the number of faces of s that FaceSide puts on the plane
+==================
+*/
+static int SurfaceSplits(choose_t* choose, choosesurf_t* s, dplane_t* plane)
+{
+	int i, count;
+
+	if (!BoundsOnPlane(s->mins, s->maxs, plane))
+		return 0;
+
+	count = 0;
+
+	for (i = s->firstface; i < s->firstface + s->numfaces; i++)
+	{
+		if (!BoundsOnPlane(choose->facemins[i], choose->facemaxs[i], plane))
+			continue;
+		if (plane->type < 3 || FaceSide(choose->faces[i], plane) == SIDE_ON)
+			count++;
+	}
+
+	return count;
+}
+
+/*
+==================
+AddSplits
+
+Adds the splits of one more surface to k the way walking its faces
+and stopping at the best count does, which can cut a surface short
+==================
+*/
+static int AddSplits(int k, int count, vec_t bestvalue)
+{
+	if (k >= bestvalue)
+		return k + 1;
+	if (k + count >= bestvalue)
+		return (int)bestvalue;
+	return k + count;
+}
+
+/*
+==================
+CountSplits
+
+Records the split count of every other surface for a candidate
+==================
+*/
+static void CountSplits(choose_t* choose, int candidate)
+{
+	int i, count;
+	dplane_t* plane;
+	splitcount_t split;
+
+	plane = &dplanes[choose->surfaces[candidate].surface->planenum];
+
+	for (i = 0; i < choose->numsurfaces; i++)
+	{
+		if (i == candidate)
+			continue;
+
+		count = SurfaceSplits(choose, &choose->surfaces[i], plane);
+
+		if (count)
+		{
+			split.surface = i;
+			split.count = count;
+			choose->splits[candidate].push_back(split);
+		}
+	}
+}
+
+/*
+==================
+ClaimCandidate
+
+Hands out the next candidate of batch, taking the batch off the
+queue once all of them are handed out.  Called with the pool locked.
+==================
+*/
+static qboolean ClaimCandidate(choosebatch_t* batch, int* candidate)
+{
+	if (batch->next < batch->choose->numsurfaces)
+	{
+		*candidate = batch->next++;
+		return true;
+	}
+
+	auto it = std::find(choosepool->batches.begin(), choosepool->batches.end(), batch);
+	if (it != choosepool->batches.end())
+		choosepool->batches.erase(it);
+
+	return false;
+}
+
+/*
+==================
+ChooseHelperThread
+
+Counts candidates of whatever batch is queued first
+==================
+*/
+static void ChooseHelperThread()
+{
+	choosebatch_t* batch;
+	int candidate;
+	std::unique_lock<std::mutex> lock(choosepool->lock);
+
+	while (1)
+	{
+		choosepool->work.wait(lock, [] { return !choosepool->batches.empty(); });
+
+		batch = choosepool->batches.front();
+		if (!ClaimCandidate(batch, &candidate))
+			continue;
+
+		lock.unlock();
+		CountSplits(batch->choose, candidate);
+		lock.lock();
+
+		// the batch can go away as soon as done is bumped
+		batch->done++;
+		choosepool->done.notify_all();
+	}
+}
+
+/*
+==================
+CountAllSplits
+
+Counts the splits of every candidate, on this thread and the helpers
+==================
+*/
+static void CountAllSplits(choose_t* choose)
+{
+	int i, candidate;
+	choosebatch_t batch;
+
+	choose->splits = new std::vector<splitcount_t>[choose->numsurfaces];
+
+	ThreadLock();
+	if (!choosepool)
+	{
+		choosepool = new choosepool_t;
+		for (i = 1; i < numthreads; i++)
+			std::thread(ChooseHelperThread).detach();
+	}
+	ThreadUnlock();
+
+	batch.choose = choose;
+	batch.next = 0;
+	batch.done = 0;
+
+	std::unique_lock<std::mutex> lock(choosepool->lock);
+
+	choosepool->batches.push_back(&batch);
+	choosepool->work.notify_all();
+
+	while (ClaimCandidate(&batch, &candidate))
+	{
+		lock.unlock();
+		CountSplits(choose, candidate);
+		lock.lock();
+		batch.done++;
+	}
+
+	// the helpers may still be counting the last candidates they took
+	choosepool->done.wait(lock, [&] { return batch.done == choose->numsurfaces; });
+}
+
+/*
+==================
+GatherChooseSurfaces
+
+Copies the faces of the surfaces that can still be chosen into
+the flat arrays of choose
+==================
+*/
+static void GatherChooseSurfaces(choose_t* choose, surface_t* surfaces)
+{
+	int i, j, numsurfaces, numfaces;
+	surface_t* p;
+	face_t* f;
+	choosesurf_t* s;
+
+	numsurfaces = numfaces = 0;
+
+	for (p = surfaces; p; p = p->next)
+	{
+		if (p->onnode)
+			continue;
+		numsurfaces++;
+		for (f = p->faces; f; f = f->next)
+			numfaces++;
+	}
+
+	choose->numsurfaces = numsurfaces;
+	choose->surfaces = (choosesurf_t*)malloc(numsurfaces * sizeof(choosesurf_t));
+	choose->faces = (face_t**)malloc(numfaces * sizeof(face_t*));
+	choose->facemins = (vec3_t*)malloc(numfaces * sizeof(vec3_t));
+	choose->facemaxs = (vec3_t*)malloc(numfaces * sizeof(vec3_t));
+	choose->splits = NULL;
+
+	numfaces = 0;
+	s = choose->surfaces;
+
+	for (p = surfaces; p; p = p->next)
+	{
+		if (p->onnode)
+			continue;
+
+		s->surface = p;
+		s->firstface = numfaces;
+		ClearBounds(s->mins, s->maxs);
+
+		for (f = p->faces; f; f = f->next, numfaces++)
+		{
+			choose->faces[numfaces] = f;
+			ClearBounds(choose->facemins[numfaces], choose->facemaxs[numfaces]);
+			for (i = 0; i < f->numpoints; i++)
+				AddPointToBounds(f->pts[i], choose->facemins[numfaces], choose->facemaxs[numfaces]);
+			for (j = 0; j < 3; j++)
+			{
+				if (choose->facemins[numfaces][j] < s->mins[j])
+					s->mins[j] = choose->facemins[numfaces][j];
+				if (choose->facemaxs[numfaces][j] > s->maxs[j])
+					s->maxs[j] = choose->facemaxs[numfaces][j];
+			}
+		}
+
+		s->numfaces = numfaces - s->firstface;
+		s++;
+	}
+}
+
 /*
 ==================
 ChoosePlaneFromList
@@ -169,11 +506,20 @@ Choose the plane that splits the least faces
 */
 surface_t* ChoosePlaneFromList(surface_t* surfaces, vec3_t mins, vec3_t maxs)
 {
-	int j, k, l;
-	surface_t *p, *p2, *bestsurface;
+	int i, j, k, l;
+	surface_t *p, *bestsurface;
 	vec_t bestvalue, bestdistribution, value, dist;
 	dplane_t* plane;
-	face_t* f;
+	choose_t choose;
+
+	GatherChooseSurfaces(&choose, surfaces);
+
+	//
+	// with a lot of candidates, count all their splits up front
+	// with the help of the other threads
+	//
+	if (choose.numsurfaces >= CHOOSE_THREAD_SURFACES && numthreads > 1)
+		CountAllSplits(&choose);
 
 	//
 	// pick the plane that splits the least
@@ -182,32 +528,37 @@ surface_t* ChoosePlaneFromList(surface_t* surfaces, vec3_t mins, vec3_t maxs)
 	bestsurface = NULL;
 	bestdistribution = 9e30;
 
-	for (p = surfaces; p; p = p->next)
+	for (i = 0; i < choose.numsurfaces; i++)
 	{
-		if (p->onnode)
-			continue;
-
+		p = choose.surfaces[i].surface;
 		plane = &dplanes[p->planenum];
 		k = 0;
 
-		for (p2 = surfaces; p2; p2 = p2->next)
+		if (choose.splits)
 		{
-			if (p2 == p)
-				continue;
-			if (p2->onnode)
-				continue;
-
-			for (f = p2->faces; f; f = f->next)
+			for (const splitcount_t& split : choose.splits[i])
 			{
-				if (FaceSide(f, plane) == SIDE_ON)
+				k = AddSplits(k, split.count, bestvalue);
+				if (k > bestvalue)
+					break;
+			}
+		}
+		else
+		{
+			for (j = 0; j < choose.numsurfaces; j++)
+			{
+				if (j == i)
+					continue;
+
+				l = SurfaceSplits(&choose, &choose.surfaces[j], plane);
+
+				if (l)
 				{
-					k++;
-					if (k >= bestvalue)
+					k = AddSplits(k, l, bestvalue);
+					if (k > bestvalue)
 						break;
 				}
 			}
-			if (k > bestvalue)
-				break;
 		}
 
 		if (k > bestvalue)
@@ -251,6 +602,11 @@ surface_t* ChoosePlaneFromList(surface_t* surfaces, vec3_t mins, vec3_t maxs)
 		}
 	}
 
+	free(choose.surfaces);
+	free(choose.faces);
+	free(choose.facemins);
+	free(choose.facemaxs);
+	delete[] choose.splits;
 
 	return bestsurface;
 }
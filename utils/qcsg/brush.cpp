@@ -10,11 +10,21 @@
 
 // brush.c
 
+#include <atomic>
+
 #include "csg.h"
 
 plane_t mapplanes[MAX_MAP_PLANES];
 int nummapplanes;
 
+// planes are hashed on their reduced integer normal and distance.  Lookups
+// don't lock, new planes are linked in under ThreadLock once filled in.
+// The chains hold plane numbers + 1 so 0 ends them.
+#define PLANE_HASHES 8192
+
+static std::atomic<int> planehash[PLANE_HASHES];
+static int planehashnext[MAX_MAP_PLANES];
+
 /*
 =============================================================================
 
@@ -80,6 +90,73 @@ int PlaneTypeForNormal(vec3_t normal)
 	return PLANE_ANYZ;
 }
 
+/*
+=============
+IntPlaneDist
+
+The distance of the integer plane times the length of the normal,
+wrapping the way the old linear search did when comparing origins
+=============
+*/
+static unsigned int IntPlaneDist(int* inormal, int* iorigin)
+{
+	return (unsigned int)inormal[0] * (unsigned int)iorigin[0] + (unsigned int)inormal[1] * (unsigned int)iorigin[1] + (unsigned int)inormal[2] * (unsigned int)iorigin[2];
+}
+
+static int IntPlaneHash(int* inormal, unsigned int dist)
+{
+	unsigned int hash;
+
+	hash = (unsigned int)inormal[0] * 73856093u;
+	hash ^= (unsigned int)inormal[1] * 19349663u;
+	hash ^= (unsigned int)inormal[2] * 83492791u;
+	hash ^= dist * 2654435761u;
+
+	return (hash ^ (hash >> 16)) & (PLANE_HASHES - 1);
+}
+
+/*
+=============
+HashIntPlane
+
+Links a filled in plane into the hash, the caller must hold ThreadLock
+=============
+*/
+static void HashIntPlane(int planenum)
+{
+	plane_t* p;
+	int hash;
+
+	p = &mapplanes[planenum];
+	hash = IntPlaneHash(p->inormal, IntPlaneDist(p->inormal, p->iorigin));
+
+	planehashnext[planenum] = planehash[hash].load(std::memory_order_relaxed);
+	planehash[hash].store(planenum + 1, std::memory_order_release);
+}
+
+/*
+=============
+LookupIntPlane
+
+Returns the plane number for a reduced integer plane, or -1
+=============
+*/
+static int LookupIntPlane(int* inormal, int hash, unsigned int dist)
+{
+	int i;
+	plane_t* p;
+
+	for (i = planehash[hash].load(std::memory_order_acquire); i; i = planehashnext[i - 1])
+	{
+		p = &mapplanes[i - 1];
+
+		if (p->inormal[0] == inormal[0] && p->inormal[1] == inormal[1] && p->inormal[2] == inormal[2] && IntPlaneDist(p->inormal, p->iorigin) == dist)
+			return i - 1;
+	}
+
+	return -1;
+}
+
 /*
 =============
 FindIntPlane
@@ -92,56 +169,35 @@ int FindIntPlane(int* inormal, int* iorigin)
 {
 	int i, j;
 	plane_t *p, temp;
-	int t;
+	int hash;
+	unsigned int dist;
 	vec3_t origin;
-	qboolean locked;
 
 	FindGCD(inormal);
 
-	p = mapplanes;
-	locked = false;
-	i = 0;
+	dist = IntPlaneDist(inormal, iorigin);
+	hash = IntPlaneHash(inormal, dist);
 
-	while (1)
-	{
-		if (i == nummapplanes)
-		{
-			if (!locked)
-			{
-				locked = true;
-				ThreadLock(); // make sure we don't race
-			}
-			if (i == nummapplanes)
-				break; // we didn't race
-		}
+	i = LookupIntPlane(inormal, hash, dist);
+	if (i != -1)
+		return i;
 
-		// see if origin is on plane
-		t = 0;
-		for (j = 0; j < 3; j++)
-			t += (iorigin[j] - p->iorigin[j]) * inormal[j];
-		if (!t)
-		{ // on plane
-
-			// see if the normal is forward, backwards, or off
-			for (j = 0; j < 3; j++)
-				if (inormal[j] != p->inormal[j])
-					break;
-			if (j == 3)
-			{
-				if (locked)
-					ThreadUnlock();
-				return i;
-			}
-		}
+	ThreadLock(); // make sure we don't race
 
-		i++;
-		p++;
+	i = LookupIntPlane(inormal, hash, dist);
+	if (i != -1)
+	{
+		ThreadUnlock();
+		return i;
 	}
 
-	if (!locked)
-		Error("not locked");
-
 	// create a new plane
+	i = nummapplanes;
+	p = &mapplanes[i];
+
+	if (nummapplanes >= MAX_MAP_PLANES)
+		Error("MAX_MAP_PLANES");
+
 	for (j = 0; j < 3; j++)
 	{
 		p->inormal[j] = inormal[j];
@@ -153,9 +209,6 @@ int FindIntPlane(int* inormal, int* iorigin)
 		origin[j] = iorigin[j];
 	}
 
-	if (nummapplanes >= MAX_MAP_PLANES)
-		Error("MAX_MAP_PLANES");
-
 	VectorNormalize(p->normal);
 
 	p->type = (p + 1)->type = PlaneTypeForNormal(p->normal);
@@ -173,13 +226,13 @@ int FindIntPlane(int* inormal, int* iorigin)
 			temp = *p;
 			*p = *(p + 1);
 			*(p + 1) = temp;
-			nummapplanes += 2;
-			ThreadUnlock();
-			return i + 1;
+			i++;
 		}
 	}
 
 	nummapplanes += 2;
+	HashIntPlane(nummapplanes - 2);
+	HashIntPlane(nummapplanes - 1);
 	ThreadUnlock();
 	return i;
 }
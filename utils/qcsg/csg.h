@@ -133,7 +133,9 @@ int BrushContents(brush_t* b);
 // csg.c
 
 bface_t* NewFaceFromFace(bface_t* in);
+void WriteFace(int hull, bface_t* f);
 extern qboolean onlyents;
+extern int c_outfaces;
 
 //=============================================================================
 
@@ -156,3 +158,16 @@ void TextureAxisFromPlane(plane_t* pln, vec3_t xv, vec3_t yv);
 // hullfile.c
 
 void CheckHullFile(qboolean hullfile, char* filename);
+
+//=============================================================================
+
+// csgcache.c
+
+extern qboolean incremental;
+
+void LoadCSGCache(char* source);
+void SaveCSGCache(void);
+void FindCachedBrushes(int entitynum);
+qboolean BrushIsCached(int brushnum);
+void AddBrushFragment(brush_t* b, int hull, bface_t* f);
+void WriteBrushFragments(int brushnum);
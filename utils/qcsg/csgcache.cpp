@@ -0,0 +1,483 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+****/
+
+// csgcache.c
+
+#include <unordered_map>
+#include <vector>
+
+#include "csg.h"
+
+/*
+
+INCREMENTAL CSG
+---------------
+
+The fragments a brush leaves after CSG only depend on its own hull faces
+and contents, and on the brushes of the same entity whose hull bounds
+overlap it, in the order they are clipped against it.  Each brush gets a
+signature covering all of that, and the fragments of every brush are kept
+in <map>.csg keyed by it.  On the next run a brush with a signature that
+is already in the cache reuses its fragments instead of being clipped
+again, so only the brushes that changed and the ones touching them are
+redone.
+
+Fragments refer to the face of the brush they came from by its position
+in the hull's face list, so plane and texinfo numbers are taken from the
+current run.
+
+*/
+
+#define CSGCACHE_IDENT (('C' << 24) + ('G' << 16) + ('S' << 8) + 'Q')
+#define CSGCACHE_VERSION 1
+
+extern vec3_t hull_size[NUM_HULLS][2];
+
+qboolean incremental;
+
+typedef unsigned long long csghash_t;
+
+typedef struct
+{
+	std::vector<int> frags;		// face, contents, numpoints for each fragment
+	std::vector<vec_t> points;
+} csghull_t;
+
+typedef struct
+{
+	csghull_t hulls[NUM_HULLS];
+} csgbrush_t;
+
+static char cachefile[1024];
+
+static std::unordered_map<csghash_t, csgbrush_t> oldcache;
+
+static csghash_t brushhash[MAX_MAP_BRUSHES];
+static csghash_t brushsignature[MAX_MAP_BRUSHES];
+static const csgbrush_t* cachedbrush[MAX_MAP_BRUSHES];
+static csgbrush_t newbrush[MAX_MAP_BRUSHES];
+
+static int c_cachedbrushes;
+
+#define HASH_BASIS 14695981039346656037ull
+
+static csghash_t HashInt(csghash_t hash, int i)
+{
+	unsigned int v;
+	int b;
+
+	// FNV-1a
+	v = (unsigned int)i;
+	for (b = 0; b < 4; b++, v >>= 8)
+	{
+		hash ^= v & 255;
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+/*
+============
+HashBrush
+
+Hashes everything CSGBrush uses of a brush: its contents and the
+planes of its hull faces, in order.  Planes are hashed on their integer
+definition, their numbers can change from run to run.
+============
+*/
+static csghash_t HashBrush(brush_t* b)
+{
+	csghash_t hash;
+	int hull, numfaces;
+	bface_t* f;
+	plane_t* p;
+	unsigned int dist;
+
+	hash = HashInt(HASH_BASIS, b->contents);
+
+	for (hull = 0; hull < NUM_HULLS; hull++)
+	{
+		numfaces = 0;
+		for (f = b->hulls[hull].faces; f; f = f->next)
+			numfaces++;
+
+		hash = HashInt(hash, numfaces);
+
+		for (f = b->hulls[hull].faces; f; f = f->next)
+		{
+			p = &mapplanes[f->planenum];
+			hash = HashInt(hash, p->inormal[0]);
+			hash = HashInt(hash, p->inormal[1]);
+			hash = HashInt(hash, p->inormal[2]);
+
+			// same wrap around as FindIntPlane
+			dist = (unsigned int)p->inormal[0] * (unsigned int)p->iorigin[0] + (unsigned int)p->inormal[1] * (unsigned int)p->iorigin[1] + (unsigned int)p->inormal[2] * (unsigned int)p->iorigin[2];
+			hash = HashInt(hash, (int)dist);
+		}
+	}
+
+	return hash;
+}
+
+/*
+============
+BrushSignature
+
+Walks the brushes of the entity the same way CSGBrush does and hashes
+each one that would get to clip brushnum, along with the spot where
+later brushes start to overwrite it
+============
+*/
+static csghash_t BrushSignature(int brushnum)
+{
+	csghash_t hash;
+	brush_t *b1, *b2;
+	brushhull_t *bh1, *bh2;
+	entity_t* e;
+	int hull, bn, i;
+
+	b1 = &mapbrushes[brushnum];
+	e = &entities[b1->entitynum];
+
+	hash = brushhash[brushnum];
+
+	for (hull = 0; hull < NUM_HULLS; hull++)
+	{
+		bh1 = &b1->hulls[hull];
+
+		hash = HashInt(hash, -1);
+
+		if (!bh1->faces)
+			continue;
+
+		for (bn = 0; bn < e->numbrushes; bn++)
+		{
+			if (bn == brushnum)
+			{
+				hash = HashInt(hash, -2);
+				continue;
+			}
+
+			b2 = &mapbrushes[e->firstbrush + bn];
+			bh2 = &b2->hulls[hull];
+
+			if (!bh2->faces)
+				continue;
+
+			for (i = 0; i < 3; i++)
+				if (bh1->mins[i] > bh2->maxs[i] || bh1->maxs[i] < bh2->mins[i])
+					break;
+			if (i < 3)
+				continue;
+
+			hash ^= brushhash[e->firstbrush + bn];
+			hash *= 1099511628211ull;
+		}
+	}
+
+	return hash;
+}
+
+//======================================================================
+
+static qboolean ReadCache(byte** data, byte* end, void* buffer, int count)
+{
+	if (end - *data < count)
+		return false;
+
+	memcpy(buffer, *data, count);
+	*data += count;
+	return true;
+}
+
+/*
+============
+ParseCSGCache
+============
+*/
+static qboolean ParseCSGCache(byte* data, byte* end)
+{
+	int header[4];
+	vec3_t hulls[NUM_HULLS][2];
+	int numbrushes, numfrags, numpoints;
+	int i, j, hull;
+	csghash_t signature;
+	csgbrush_t brush;
+	csghull_t* ch;
+
+	if (!ReadCache(&data, end, header, sizeof(header)))
+		return false;
+
+	if (header[0] != CSGCACHE_IDENT || header[1] != CSGCACHE_VERSION || header[2] != (int)sizeof(vec_t) || header[3] != noclip)
+		return false;
+
+	// expanded hulls depend on the hull sizes
+	if (!ReadCache(&data, end, hulls, sizeof(hulls)) || memcmp(hulls, hull_size, sizeof(hulls)))
+		return false;
+
+	if (!ReadCache(&data, end, &numbrushes, sizeof(numbrushes)))
+		return false;
+
+	for (i = 0; i < numbrushes; i++)
+	{
+		if (!ReadCache(&data, end, &signature, sizeof(signature)))
+			return false;
+
+		for (hull = 0; hull < NUM_HULLS; hull++)
+		{
+			ch = &brush.hulls[hull];
+
+			if (!ReadCache(&data, end, &numfrags, sizeof(numfrags)) || numfrags < 0 || numfrags > (end - data) / 12)
+				return false;
+			ch->frags.resize(numfrags * 3);
+			if (!ReadCache(&data, end, ch->frags.data(), numfrags * 3 * sizeof(int)))
+				return false;
+
+			numpoints = 0;
+			for (j = 0; j < numfrags; j++)
+			{
+				if (ch->frags[j * 3 + 2] < 3 || ch->frags[j * 3 + 2] > MAX_POINTS_ON_WINDING)
+					return false;
+				numpoints += ch->frags[j * 3 + 2];
+			}
+
+			if (numpoints > (end - data) / (int)(3 * sizeof(vec_t)))
+				return false;
+			ch->points.resize(numpoints * 3);
+			if (!ReadCache(&data, end, ch->points.data(), numpoints * 3 * sizeof(vec_t)))
+				return false;
+		}
+
+		oldcache[signature] = brush;
+	}
+
+	return data == end;
+}
+
+/*
+============
+LoadCSGCache
+
+Reads the fragments the last incremental run left for this map, if any
+============
+*/
+void LoadCSGCache(char* source)
+{
+	void* buffer;
+	int length;
+
+	sprintf(cachefile, "%s.csg", source);
+
+	if (FileTime(cachefile) == -1)
+	{
+		printf("No csg cache, building all brushes\n");
+		return;
+	}
+
+	length = LoadFile(cachefile, &buffer);
+
+	if (!ParseCSGCache((byte*)buffer, (byte*)buffer + length))
+	{
+		printf("WARNING: %s is out of date or corrupt, building all brushes\n", cachefile);
+		oldcache.clear();
+	}
+
+	free(buffer);
+
+	qprintf("%5i cached brushes\n", (int)oldcache.size());
+}
+
+/*
+============
+SaveCSGCache
+
+Writes the fragments of every brush for the next incremental run
+============
+*/
+void SaveCSGCache(void)
+{
+	FILE* f;
+	int header[4];
+	int i, hull, numfrags;
+	csghash_t signature;
+	const csgbrush_t* brush;
+	const csghull_t* ch;
+
+	printf("%5i of %i brushes reused from %s\n", c_cachedbrushes, nummapbrushes, cachefile);
+
+	f = SafeOpenWrite(cachefile);
+
+	header[0] = CSGCACHE_IDENT;
+	header[1] = CSGCACHE_VERSION;
+	header[2] = sizeof(vec_t);
+	header[3] = noclip;
+	SafeWrite(f, header, sizeof(header));
+	SafeWrite(f, hull_size, sizeof(hull_size));
+	SafeWrite(f, &nummapbrushes, sizeof(nummapbrushes));
+
+	for (i = 0; i < nummapbrushes; i++)
+	{
+		signature = brushsignature[i];
+		brush = cachedbrush[i] ? cachedbrush[i] : &newbrush[i];
+
+		SafeWrite(f, &signature, sizeof(signature));
+
+		for (hull = 0; hull < NUM_HULLS; hull++)
+		{
+			ch = &brush->hulls[hull];
+
+			numfrags = (int)ch->frags.size() / 3;
+			SafeWrite(f, &numfrags, sizeof(numfrags));
+			SafeWrite(f, (void*)ch->frags.data(), ch->frags.size() * sizeof(int));
+			SafeWrite(f, (void*)ch->points.data(), ch->points.size() * sizeof(vec_t));
+		}
+	}
+
+	fclose(f);
+}
+
+/*
+============
+FindCachedBrushes
+
+Signs the brushes of an entity once they are sorted and picks up
+the ones that can be reused
+============
+*/
+void FindCachedBrushes(int entitynum)
+{
+	entity_t* e;
+	int i, brushnum;
+
+	e = &entities[entitynum];
+
+	for (i = 0; i < e->numbrushes; i++)
+		brushhash[e->firstbrush + i] = HashBrush(&mapbrushes[e->firstbrush + i]);
+
+	for (i = 0; i < e->numbrushes; i++)
+	{
+		brushnum = e->firstbrush + i;
+		brushsignature[brushnum] = BrushSignature(brushnum);
+
+		auto it = oldcache.find(brushsignature[brushnum]);
+		if (it != oldcache.end())
+		{
+			cachedbrush[brushnum] = &it->second;
+			c_cachedbrushes++;
+		}
+	}
+}
+
+qboolean BrushIsCached(int brushnum)
+{
+	return cachedbrush[brushnum] != NULL;
+}
+
+/*
+============
+AddBrushFragment
+
+Keeps a final fragment of a brush to be written by WriteBrushFragments.
+Only touches the brush's own record, so it doesn't need ThreadLock.
+============
+*/
+void AddBrushFragment(brush_t* b, int hull, bface_t* f)
+{
+	csghull_t* ch;
+	bface_t* f2;
+	int face, i;
+
+	face = 0;
+	for (f2 = b->hulls[hull].faces; f2; f2 = f2->next, face++)
+		if (f2->planenum == f->planenum)
+			break;
+
+	if (!f2)
+		Error("AddBrushFragment: fragment not on a brush face");
+
+	ch = &newbrush[b - mapbrushes].hulls[hull];
+
+	ch->frags.push_back(face);
+	ch->frags.push_back(f->contents);
+	ch->frags.push_back(f->w->numpoints);
+
+	for (i = 0; i < f->w->numpoints; i++)
+	{
+		ch->points.push_back(f->w->p[i][0]);
+		ch->points.push_back(f->w->p[i][1]);
+		ch->points.push_back(f->w->p[i][2]);
+	}
+}
+
+/*
+============
+WriteBrushFragments
+
+Writes the fragments of a brush, clipped this run or reused, the way
+SaveOutside would have: each face and then its mirror
+============
+*/
+void WriteBrushFragments(int brushnum)
+{
+	brush_t* b;
+	const csgbrush_t* brush;
+	const csghull_t* ch;
+	const vec_t* p;
+	bface_t *f2, face;
+	int hull, i, j, numpoints;
+
+	b = &mapbrushes[brushnum];
+	brush = cachedbrush[brushnum] ? cachedbrush[brushnum] : &newbrush[brushnum];
+
+	for (hull = 0; hull < NUM_HULLS; hull++)
+	{
+		ch = &brush->hulls[hull];
+		p = ch->points.data();
+
+		for (i = 0; i < (int)ch->frags.size(); i += 3)
+		{
+			for (f2 = b->hulls[hull].faces, j = ch->frags[i]; f2 && j; f2 = f2->next, j--)
+				;
+			if (!f2)
+				Error("Entity %i, Brush %i: csg cache doesn't match the brush", b->entitynum, b->brushnum);
+
+			numpoints = ch->frags[i + 2];
+
+			memset(&face, 0, sizeof(face));
+			face.planenum = f2->planenum;
+			face.plane = &mapplanes[face.planenum];
+			face.texinfo = f2->texinfo;
+			face.contents = ch->frags[i + 1];
+			face.w = AllocWinding(numpoints);
+			face.w->numpoints = numpoints;
+			for (j = 0; j < numpoints; j++, p += 3)
+				VectorCopy(p, face.w->p[j]);
+
+			// count unique faces
+			if (!hull && !f2->used)
+			{
+				f2->used = true;
+				c_outfaces++;
+			}
+
+			WriteFace(hull, &face);
+
+			face.planenum ^= 1;
+			face.plane = &mapplanes[face.planenum];
+			face.contents = b->contents;
+			for (j = 0; j < numpoints; j++)
+				VectorCopy(p - (j + 1) * 3, face.w->p[j]);
+			WriteFace(hull, &face);
+
+			FreeWinding(face.w);
+		}
+	}
+}
@@ -246,6 +246,14 @@ void SaveOutside(brush_t* b, int hull, bface_t* outside, int mirrorcontents)
 			continue;
 		}
 
+		// incremental builds write all fragments in brush order later
+		if (incremental)
+		{
+			AddBrushFragment(b, hull, f);
+			FreeFace(f);
+			continue;
+		}
+
 		// count unique faces
 		if (!hull)
 		{
@@ -380,6 +388,9 @@ void CSGBrush(int brushnum)
 
 	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL);
 
+	if (incremental && BrushIsCached(brushnum))
+		return; // fragments are reused from the last run
+
 	b1 = &mapbrushes[brushnum];
 
 	e = &entities[b1->entitynum];
@@ -653,6 +664,9 @@ void ProcessModels(void)
 		//
 		// csg them in order
 		//
+		if (incremental)
+			FindCachedBrushes(i);
+
 		if (i == 0)
 		{
 			RunThreadsOnIndividual(entities[i].numbrushes, 1, CSGBrush);
@@ -663,6 +677,12 @@ void ProcessModels(void)
 				CSGBrush(first + j);
 		}
 
+		if (incremental)
+		{
+			for (j = 0; j < entities[i].numbrushes; j++)
+				WriteBrushFragments(first + j);
+		}
+
 		// write end of model marker
 		if (!glview)
 		{
@@ -768,6 +788,11 @@ int main(int argc, char** argv)
 			strcpy(qproject, argv[i + 1]);
 			i++;
 		}
+		else if (!strcmp(argv[i], "-incremental"))
+		{
+			printf("incremental = true\n");
+			incremental = true;
+		}
 		else if (!strcmp(argv[i], "-hullfile"))
 		{
 			hullfile = true;
@@ -781,7 +806,7 @@ int main(int argc, char** argv)
 	}
 
 	if (i != argc - 1)
-		Error("usage: qcsg [-nowadtextures] [-wadinclude <name>] [-draw] [-glview] [-noclip] [-onlyents] [-proj <name>] [-threads #] [-v] [-hullfile <name>] mapfile");
+		Error("usage: qcsg [-nowadtextures] [-wadinclude <name>] [-draw] [-glview] [-noclip] [-onlyents] [-proj <name>] [-threads #] [-v] [-hullfile <name>] [-incremental] mapfile");
 
 	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL);
 	start = I_FloatTime();
@@ -829,6 +854,9 @@ int main(int argc, char** argv)
 
 	qprintf("%5i map planes\n", nummapplanes);
 
+	if (incremental)
+		LoadCSGCache(source);
+
 	for (i = 0; i < NUM_HULLS; i++)
 	{
 		char hullName[1024];
@@ -852,6 +880,9 @@ int main(int argc, char** argv)
 	for (i = 0; i < NUM_HULLS; i++)
 		fclose(out[i]);
 
+	if (incremental)
+		SaveCSGCache();
+
 	if (!glview)
 	{
 		EmitPlanes();
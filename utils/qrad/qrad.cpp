@@ -1513,7 +1513,8 @@ int main(int argc, char** argv)
 	DefaultExtension(incrementfile, ".r0");
 	DefaultExtension(source, ".bsp");
 
-	LoadBSPFile(source);
+	MapBSPFile(source);
+	CopyLumpForWrite(LUMP_LIGHTING); // rebuilt from scratch
 	ParseEntities();
 
 	if (!visdatasize)
@@ -0,0 +1,640 @@
+//=========================================================
+// serverbench.cpp - headless server harness.
+//
+// usage: serverbench -map <name> [options]
+//
+// Lives next to the engine executable, where the game dll looks
+// for the mod directory. Gives itself and the game dll a stdio
+// filesystem over the mod and valve directories, loads the mod's
+// server dll, spawns the map plus a scripted scenario and
+// reports how long the server frames take.
+//
+// With -statelog it also writes the state of every entity after
+// each frame, so two runs with a different cvar set can be diffed
+// to check that an optional code path behaves like the default.
+//=========================================================
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include "serverbench.h"
+#include "FileSystem.h"
+#include "entity_state.h"
+
+struct sbscenario_t
+{
+	const char* gameDir = "valve";
+	const char* mapName = nullptr;
+	const char* dllName = nullptr;
+	const char* monsterClass = "monster_zombie";
+	const char* csvName = nullptr;
+	const char* stateLogName = nullptr;
+	std::vector<const char*> commands;
+
+	int frames = 1000;
+	int warmup = 100;
+	float frametime = 0.01f;
+	int monsters = 0;
+	int triggers = 0;
+	bool player = false;
+};
+
+static void Usage()
+{
+	printf("usage: serverbench -map <name> [options]\n"
+		   "  -game <dir>          mod directory (default valve)\n"
+		   "  -dll <path>          server dll relative to the mod directory (default from liblist.gam)\n"
+		   "  -frames <n>          frames to measure (default 1000)\n"
+		   "  -warmup <n>          frames to run before measuring (default 100)\n"
+		   "  -frametime <s>       simulated frame length (default 0.01)\n"
+		   "  -monsters <n>        spawn n monsters around the player start\n"
+		   "  -monsterclass <name> class of the spawned monsters (default monster_zombie)\n"
+		   "  -triggers <n>        chain n trigger_relays and fire the chain every frame\n"
+		   "  -player              put a client in the server\n"
+		   "  -cmd <text>          run a server command after spawning, can be repeated\n"
+		   "  -seed <n>            random seed (default 0)\n"
+		   "  -csv <file>          write per-frame timings\n"
+		   "  -statelog <file>     write every entity's state after each frame\n"
+		   "  -v                   print game dll console output\n");
+}
+
+//=========================================================
+// Startup
+//=========================================================
+static bool LoadFileSystem(const std::string& exeDir)
+{
+	sv.fileSystem = SB_StdioFileSystem();
+
+	sv.fileSystem->Mount();
+	sv.fileSystem->AddSearchPath(exeDir.c_str(), "ROOT");
+	sv.fileSystem->AddSearchPath(sv.gameDir.c_str(), "GAMECONFIG");
+	sv.fileSystem->AddSearchPath(sv.gameDir.c_str(), "GAME");
+
+	if (sv.gameDirName != "valve")
+		sv.fileSystem->AddSearchPath((exeDir + "/valve").c_str(), "GAME");
+
+	return true;
+}
+
+static std::string GameDllFromLiblist()
+{
+	std::vector<byte> data = SB_LoadFile("liblist.gam");
+	std::string text(data.begin(), data.end());
+
+	std::size_t key = text.find("gamedll_linux");
+	if (key == std::string::npos)
+		return "dlls/hl.so";
+
+	std::size_t start = text.find('"', key);
+	std::size_t end = (start != std::string::npos) ? text.find('"', start + 1) : std::string::npos;
+
+	if (end == std::string::npos)
+		return "dlls/hl.so";
+
+	return text.substr(start + 1, end - start - 1);
+}
+
+static bool LoadGameDll(const char* dllName)
+{
+	std::string path = sv.gameDir + "/" + (dllName ? dllName : GameDllFromLiblist());
+	sv.gameDll = dlopen(path.c_str(), RTLD_NOW);
+
+	if (!sv.gameDll)
+	{
+		printf("Couldn't load %s: %s\n", path.c_str(), dlerror());
+		return false;
+	}
+
+	typedef void (*GIVEFNPTRSTODLL)(enginefuncs_t*, globalvars_t*);
+	typedef int (*APIFUNCTION2)(DLL_FUNCTIONS*, int*);
+	typedef int (*NEWAPIFUNCTION)(NEW_DLL_FUNCTIONS*, int*);
+
+	GIVEFNPTRSTODLL giveFnptrs = reinterpret_cast<GIVEFNPTRSTODLL>(dlsym(sv.gameDll, "GiveFnptrsToDll"));
+	APIFUNCTION2 getEntityAPI2 = reinterpret_cast<APIFUNCTION2>(dlsym(sv.gameDll, "GetEntityAPI2"));
+	NEWAPIFUNCTION getNewDLLFunctions = reinterpret_cast<NEWAPIFUNCTION>(dlsym(sv.gameDll, "GetNewDLLFunctions"));
+
+	if (!giveFnptrs || !getEntityAPI2)
+	{
+		printf("%s is not a server dll\n", path.c_str());
+		return false;
+	}
+
+	// Hand over our filesystem so the dll doesn't load the engine's
+	IFileSystem** gameFileSystem = reinterpret_cast<IFileSystem**>(dlsym(sv.gameDll, "g_pFileSystem"));
+
+	if (!gameFileSystem)
+	{
+		printf("%s doesn't export g_pFileSystem\n", path.c_str());
+		return false;
+	}
+
+	*gameFileSystem = sv.fileSystem;
+
+	giveFnptrs(&gEngfuncs, &gGlobals);
+
+	int version = INTERFACE_VERSION;
+	if (0 == getEntityAPI2(&gEntityInterface, &version))
+	{
+		printf("%s has interface version %d, expected %d\n", path.c_str(), version, INTERFACE_VERSION);
+		return false;
+	}
+
+	version = NEW_DLL_FUNCTIONS_VERSION;
+	if (getNewDLLFunctions)
+		getNewDLLFunctions(&gNewDLLFunctions, &version);
+
+	return true;
+}
+
+//=========================================================
+// Map loading
+//=========================================================
+static const char* ParseToken(const char* data, std::string& token)
+{
+	token.clear();
+
+	while (*data && isspace(static_cast<unsigned char>(*data)))
+		data++;
+
+	if (!*data)
+		return nullptr;
+
+	if (*data == '"')
+	{
+		for (data++; *data && *data != '"'; data++)
+			token += *data;
+		return *data ? data + 1 : data;
+	}
+
+	if (*data == '{' || *data == '}')
+	{
+		token = *data;
+		return data + 1;
+	}
+
+	while (*data && !isspace(static_cast<unsigned char>(*data)) && *data != '"')
+		token += *data++;
+
+	return data;
+}
+
+static void DispatchKeyValue(edict_t* ed, const char* className, const char* key, const char* value)
+{
+	KeyValueData kvd;
+	kvd.szClassName = const_cast<char*>(className);
+	kvd.szKeyName = const_cast<char*>(key);
+	kvd.szValue = const_cast<char*>(value);
+	kvd.fHandled = 0;
+	gEntityInterface.pfnKeyValue(ed, &kvd);
+}
+
+static edict_t* SpawnEntity(const std::vector<std::pair<std::string, std::string>>& keys)
+{
+	std::string className;
+	for (const auto& kv : keys)
+	{
+		if (kv.first == "classname")
+			className = kv.second;
+	}
+
+	if (className.empty())
+		return nullptr;
+
+	edict_t* ed;
+	if (className == "worldspawn")
+	{
+		ed = sv.edicts;
+		typedef void (*LINK_ENTITY_FUNC)(entvars_t*);
+		LINK_ENTITY_FUNC func = reinterpret_cast<LINK_ENTITY_FUNC>(dlsym(sv.gameDll, "worldspawn"));
+		if (func)
+			func(&ed->v);
+	}
+	else if (nullptr == (ed = SB_CreateNamedEntity(className.c_str())))
+		return nullptr;
+
+	for (const auto& kv : keys)
+	{
+		// "angle" is shorthand for a yaw, -1 and -2 point straight up and down
+		if (kv.first == "angle")
+		{
+			float yaw = atof(kv.second.c_str());
+			char angles[64];
+
+			if (yaw == -1)
+				strcpy(angles, "-90 0 0");
+			else if (yaw == -2)
+				strcpy(angles, "90 0 0");
+			else
+				snprintf(angles, sizeof(angles), "0 %g 0", yaw);
+
+			DispatchKeyValue(ed, className.c_str(), "angles", angles);
+		}
+		else
+			DispatchKeyValue(ed, className.c_str(), kv.first.c_str(), kv.second.c_str());
+	}
+
+	if (gEntityInterface.pfnSpawn(ed) < 0 && ed != sv.edicts)
+	{
+		SB_FreeEdict(ed);
+		return nullptr;
+	}
+
+	return ed;
+}
+
+static bool LoadMap(const char* mapName)
+{
+	sv.mapName = mapName;
+	sv.time = 1.0f;
+	sv.numEdicts = gGlobals.maxClients + 1;
+
+	std::string worldModel = std::string("maps/") + mapName + ".bsp";
+	if (!SB_LoadBSP(worldModel.c_str()))
+		return false;
+
+	SB_AllocString(mapName, &gGlobals.mapname);
+	gGlobals.time = sv.time;
+	gGlobals.deathmatch = SB_CvarValue("deathmatch");
+	gGlobals.coop = SB_CvarValue("coop");
+
+	// world is model 1, brush entities follow as *1, *2 ...
+	gEngfuncs.pfnPrecacheModel(SB_AllocString(worldModel.c_str(), nullptr));
+	for (int i = 1; i < SB_NumSubModels(); i++)
+	{
+		char name[16];
+		snprintf(name, sizeof(name), "*%d", i);
+		gEngfuncs.pfnPrecacheModel(SB_AllocString(name, nullptr));
+	}
+
+	edict_t* world = sv.edicts;
+	world->free = 0;
+	world->v.pContainingEntity = world;
+	SB_AllocString(worldModel.c_str(), &world->v.model);
+	world->v.modelindex = 1;
+	world->v.solid = SOLID_BSP;
+	world->v.movetype = MOVETYPE_PUSH;
+
+	std::vector<std::pair<std::string, std::string>> keys;
+	std::string token, key;
+	const char* data = SB_EntityLump();
+
+	while (nullptr != (data = ParseToken(data, token)))
+	{
+		if (token != "{")
+			break;
+
+		keys.clear();
+		while (nullptr != (data = ParseToken(data, key)) && key != "}")
+		{
+			if (nullptr == (data = ParseToken(data, token)))
+				break;
+			keys.emplace_back(key, token);
+		}
+
+		SpawnEntity(keys);
+
+		if (!data)
+			break;
+	}
+
+	gEntityInterface.pfnServerActivate(sv.edicts, sv.numEdicts, gGlobals.maxClients);
+	return true;
+}
+
+//=========================================================
+// Scenario
+//=========================================================
+static edict_t* g_pFirstRelay;
+
+static void SpawnMonsters(const sbscenario_t& scenario)
+{
+	edict_t* start = gEngfuncs.pfnFindEntityByString(nullptr, "classname", "info_player_start");
+	Vector center = (start && start != sv.edicts) ? start->v.origin : Vector(0, 0, 0);
+
+	int side = 1;
+	while (side * side < scenario.monsters * 2)
+		side++;
+
+	Vector mins, maxs;
+	SB_HullBounds(SB_HULL_HUMAN, mins, maxs);
+
+	int spawned = 0;
+	for (int i = 0; i < side * side && spawned < scenario.monsters; i++)
+	{
+		Vector origin = center + Vector((i % side - side / 2) * 64.0f, (i / side - side / 2) * 64.0f, 0);
+
+		// skip spots inside walls
+		TraceResult tr;
+		SB_Move(origin, mins, maxs, origin, SB_MOVE_NORMAL, nullptr, &tr);
+		if (0 != tr.fStartSolid)
+			continue;
+
+		edict_t* ed = SB_CreateNamedEntity(scenario.monsterClass);
+		if (!ed)
+		{
+			printf("Unknown monster class %s\n", scenario.monsterClass);
+			return;
+		}
+
+		ed->v.origin = origin;
+		ed->v.angles.y = gEngfuncs.pfnRandomFloat(0, 360);
+
+		if (gEntityInterface.pfnSpawn(ed) < 0)
+			SB_FreeEdict(ed);
+		else
+			spawned++;
+	}
+
+	printf("Spawned %d %s\n", spawned, scenario.monsterClass);
+}
+
+static void SpawnTriggers(const sbscenario_t& scenario)
+{
+	for (int i = 0; i < scenario.triggers; i++)
+	{
+		char name[32], target[32];
+		snprintf(name, sizeof(name), "sb_relay%d", i);
+		snprintf(target, sizeof(target), "sb_relay%d", i + 1);
+
+		std::vector<std::pair<std::string, std::string>> keys;
+		keys.emplace_back("classname", "trigger_relay");
+		keys.emplace_back("targetname", name);
+		keys.emplace_back("triggerstate", "2");
+		if (i + 1 < scenario.triggers)
+			keys.emplace_back("target", target);
+
+		edict_t* ed = SpawnEntity(keys);
+		if (0 == i)
+			g_pFirstRelay = ed;
+	}
+}
+
+static void SpawnPlayer()
+{
+	edict_t* ed = &sv.edicts[1];
+	char rejectReason[128];
+
+	ed->free = 0;
+	memset(&ed->v, 0, sizeof(ed->v));
+	ed->v.pContainingEntity = ed;
+
+	if (0 == gEntityInterface.pfnClientConnect(ed, "player", "loopback", rejectReason))
+	{
+		printf("Client rejected: %s\n", rejectReason);
+		ed->free = 1;
+		return;
+	}
+
+	gGlobals.time = sv.time;
+	gEntityInterface.pfnClientPutInServer(ed);
+}
+
+//=========================================================
+// Frames
+//=========================================================
+static void RunFrame(const sbscenario_t& scenario)
+{
+	gGlobals.time = sv.time;
+	gGlobals.frametime = sv.frametime;
+
+	SB_ServerExecute();
+
+	edict_t* player = &sv.edicts[1];
+	if (scenario.player && player->pvPrivateData)
+	{
+		gEntityInterface.pfnPlayerPreThink(player);
+		gEntityInterface.pfnPlayerPostThink(player);
+	}
+
+	if (g_pFirstRelay && 0 == g_pFirstRelay->free)
+		gEntityInterface.pfnUse(g_pFirstRelay, sv.edicts);
+
+	gGlobals.time = sv.time;
+	gEntityInterface.pfnStartFrame();
+
+	SB_RunPhysics();
+
+	sv.time += sv.frametime;
+}
+
+//=========================================================
+// State log
+//=========================================================
+static void LogVector(FILE* log, const char* name, const float* v)
+{
+	fprintf(log, " %s %.9g %.9g %.9g", name, v[0], v[1], v[2]);
+}
+
+static void LogEntityStates(FILE* log, int frame)
+{
+	fprintf(log, "frame %d time %.9g\n", frame, sv.time);
+
+	for (int e = 0; e < sv.numEdicts; e++)
+	{
+		const edict_t* ed = &sv.edicts[e];
+		if (0 != ed->free)
+			continue;
+
+		const entvars_t& v = ed->v;
+
+		fprintf(log, "%d %s", e, SB_STRING(v.classname));
+		LogVector(log, "origin", v.origin);
+		LogVector(log, "angles", v.angles);
+		LogVector(log, "velocity", v.velocity);
+		fprintf(log, " health %.9g takedamage %.9g flags %d effects %d solid %d movetype %d model %d seq %d frame %.9g nextthink %.9g\n",
+			v.health, v.takedamage, v.flags, v.effects, v.solid, v.movetype, v.modelindex, v.sequence, v.frame, v.nextthink);
+	}
+
+	// pack the entities for the client the way the engine does between frames
+	edict_t* player = &sv.edicts[1];
+	if (0 != player->free || !player->pvPrivateData)
+		return;
+
+	unsigned char *pvs = nullptr, *pas = nullptr;
+	gEntityInterface.pfnSetupVisibility(nullptr, player, &pvs, &pas);
+
+	for (int e = 1; e < sv.numEdicts; e++)
+	{
+		edict_t* ed = &sv.edicts[e];
+		if (0 != ed->free)
+			continue;
+
+		entity_state_t state;
+		memset(&state, 0, sizeof(state));
+
+		if (0 == gEntityInterface.pfnAddToFullPack(&state, e, ed, player, 0, e <= gGlobals.maxClients ? 1 : 0, pvs))
+			continue;
+
+		fprintf(log, "pack %d", state.number);
+		LogVector(log, "origin", state.origin);
+		LogVector(log, "angles", state.angles);
+		fprintf(log, " model %d seq %d frame %.9g body %d skin %d effects %d render %d %d %d solid %d movetype %d\n",
+			state.modelindex, state.sequence, state.frame, state.body, state.skin, state.effects,
+			state.rendermode, state.renderamt, state.renderfx, state.solid, state.movetype);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	sbscenario_t scenario;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* next = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+		if (0 == strcmp(arg, "-v"))
+			sv.verbose = true;
+		else if (0 == strcmp(arg, "-player"))
+			scenario.player = true;
+		else if (!next)
+		{
+			Usage();
+			return 1;
+		}
+		else if (0 == strcmp(arg, "-game"))
+			scenario.gameDir = argv[++i];
+		else if (0 == strcmp(arg, "-map"))
+			scenario.mapName = argv[++i];
+		else if (0 == strcmp(arg, "-dll"))
+			scenario.dllName = argv[++i];
+		else if (0 == strcmp(arg, "-frames"))
+			scenario.frames = std::max(1, atoi(argv[++i]));
+		else if (0 == strcmp(arg, "-warmup"))
+			scenario.warmup = std::max(0, atoi(argv[++i]));
+		else if (0 == strcmp(arg, "-frametime"))
+			scenario.frametime = std::max(0.001f, static_cast<float>(atof(argv[++i])));
+		else if (0 == strcmp(arg, "-monsters"))
+			scenario.monsters = std::max(0, atoi(argv[++i]));
+		else if (0 == strcmp(arg, "-monsterclass"))
+			scenario.monsterClass = argv[++i];
+		else if (0 == strcmp(arg, "-triggers"))
+			scenario.triggers = std::max(0, atoi(argv[++i]));
+		else if (0 == strcmp(arg, "-cmd"))
+			scenario.commands.push_back(argv[++i]);
+		else if (0 == strcmp(arg, "-seed"))
+			sv.randomSeed = strtoul(argv[++i], nullptr, 10);
+		else if (0 == strcmp(arg, "-csv"))
+			scenario.csvName = argv[++i];
+		else if (0 == strcmp(arg, "-statelog"))
+			scenario.stateLogName = argv[++i];
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	if (!scenario.mapName)
+	{
+		Usage();
+		return 1;
+	}
+
+	sv.argc = argc;
+	sv.argv = argv;
+
+	// run from the install directory, where the engine would be
+	char exePath[PATH_MAX + 1];
+	ssize_t length = readlink("/proc/self/exe", exePath, PATH_MAX);
+	if (length <= 0)
+		return 1;
+	exePath[length] = '\0';
+	*strrchr(exePath, '/') = '\0';
+
+	std::string exeDir = exePath;
+	if (0 != chdir(exeDir.c_str()))
+		return 1;
+
+	sv.gameDirName = scenario.gameDir;
+	sv.gameDir = exeDir + "/" + scenario.gameDir;
+	sv.frametime = scenario.frametime;
+
+	SB_InitEngineFuncs();
+	SB_InitCvars();
+
+	if (!LoadFileSystem(exeDir) || !LoadGameDll(scenario.dllName))
+		return 1;
+
+	gGlobals.maxClients = 1;
+	gEntityInterface.pfnGameInit();
+
+	if (!LoadMap(scenario.mapName))
+		return 1;
+
+	SpawnMonsters(scenario);
+	SpawnTriggers(scenario);
+
+	if (scenario.player)
+		SpawnPlayer();
+
+	for (const char* command : scenario.commands)
+	{
+		SB_ExecuteCommand(command);
+		SB_ServerExecute();
+	}
+
+	FILE* stateLog = nullptr;
+	if (scenario.stateLogName && nullptr == (stateLog = fopen(scenario.stateLogName, "w")))
+		printf("Couldn't write %s\n", scenario.stateLogName);
+
+	for (int i = 0; i < scenario.warmup; i++)
+	{
+		RunFrame(scenario);
+
+		if (stateLog)
+			LogEntityStates(stateLog, i - scenario.warmup);
+	}
+
+	std::vector<double> frameTimes(scenario.frames);
+
+	for (int i = 0; i < scenario.frames; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		RunFrame(scenario);
+		auto end = std::chrono::steady_clock::now();
+
+		frameTimes[i] = std::chrono::duration<double, std::milli>(end - start).count();
+
+		if (stateLog)
+			LogEntityStates(stateLog, i);
+	}
+
+	if (stateLog)
+		fclose(stateLog);
+
+	if (scenario.csvName)
+	{
+		FILE* csv = fopen(scenario.csvName, "w");
+		if (csv)
+		{
+			fprintf(csv, "frame,ms\n");
+			for (int i = 0; i < scenario.frames; i++)
+				fprintf(csv, "%d,%.4f\n", i, frameTimes[i]);
+			fclose(csv);
+		}
+		else
+			printf("Couldn't write %s\n", scenario.csvName);
+	}
+
+	double total = 0;
+	for (double frameTime : frameTimes)
+		total += frameTime;
+
+	std::vector<double> sorted = frameTimes;
+	std::sort(sorted.begin(), sorted.end());
+
+	printf("%s: %d frames, %d entities\n", scenario.mapName, scenario.frames, gEngfuncs.pfnNumberOfEntities());
+	printf("mean %.4f ms  p50 %.4f ms  p95 %.4f ms  max %.4f ms\n",
+		total / scenario.frames,
+		sorted[sorted.size() / 2],
+		sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)],
+		sorted.back());
+
+	gEntityInterface.pfnServerDeactivate();
+	return 0;
+}
@@ -0,0 +1,100 @@
+//=========================================================
+// serverbench.h - headless server harness.
+//
+// Loads the game dll with a stand-in for the engine: an edict
+// table, a string pool, cvars and BSP hull tracing, enough to
+// spawn a map plus scripted monsters and triggers and time the
+// server frames without a running engine.
+//=========================================================
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "extdll.h"
+
+class IFileSystem;
+
+#define SB_MAX_EDICTS 1024
+#define SB_STRING_POOL (8 * 1024 * 1024)
+
+// hull sizes, same as the engine
+#define SB_HULL_POINT 0
+#define SB_HULL_HUMAN 1
+#define SB_HULL_LARGE 2
+#define SB_HULL_HEAD 3
+#define SB_MAX_HULLS 4
+
+// fNoMonsters values passed to the trace functions
+#define SB_MOVE_NORMAL 0
+#define SB_MOVE_NOMONSTERS 1
+#define SB_MOVE_MISSILE 2
+#define SB_MOVE_IGNOREGLASS 0x100
+
+#define SB_STRING(offset) ((const char*)(gGlobals.pStringBase + (unsigned int)(offset)))
+
+//=========================================================
+// Server state shared by the harness modules
+//=========================================================
+struct sbserver_t
+{
+	edict_t* edicts;
+	int numEdicts; // highest used slot + 1
+	int maxEdicts;
+
+	float time;
+	float frametime;
+
+	std::string gameDir;	 // absolute path of the mod directory
+	std::string gameDirName; // what pfnGetGameDir reports
+	std::string mapName;
+
+	std::vector<std::string> models; // precache list, index 0 unused
+	std::vector<std::string> sounds;
+
+	void* gameDll;
+	IFileSystem* fileSystem;
+
+	unsigned int randomSeed;
+	bool verbose;
+
+	int argc;
+	char** argv;
+};
+
+extern sbserver_t sv;
+extern globalvars_t gGlobals;
+extern enginefuncs_t gEngfuncs;
+extern DLL_FUNCTIONS gEntityInterface;
+extern NEW_DLL_FUNCTIONS gNewDLLFunctions;
+
+// sv_engine.cpp
+void SB_InitEngineFuncs();
+void SB_InitCvars();
+bool SB_SetCvar(const char* name, const char* value);
+float SB_CvarValue(const char* name);
+void SB_ServerExecute();
+void SB_ExecuteCommand(const char* text);
+edict_t* SB_CreateNamedEntity(const char* classname);
+void SB_FreeEdict(edict_t* ed);
+const char* SB_AllocString(const char* value, string_t* offset);
+std::vector<byte> SB_LoadFile(const char* fileName);
+
+// sv_filesystem.cpp
+IFileSystem* SB_StdioFileSystem();
+
+// sv_world.cpp
+bool SB_LoadBSP(const char* fileName);
+const char* SB_EntityLump();
+int SB_NumSubModels();
+void SB_SubModelBounds(int index, float* mins, float* maxs);
+void SB_LinkEdict(edict_t* ed, bool touchTriggers);
+int SB_PointContents(const float* point);
+void SB_ClipMoveToEntity(edict_t* ed, const Vector& start, const Vector& mins, const Vector& maxs, const Vector& end, TraceResult* tr);
+void SB_Move(const float* start, const float* mins, const float* maxs, const float* end, int noMonsters, edict_t* passEdict, TraceResult* tr);
+int SB_HullForSize(const float* mins, const float* maxs);
+void SB_HullBounds(int hullNum, Vector& mins, Vector& maxs);
+int SB_WalkMove(edict_t* ed, float yaw, float dist, int mode);
+int SB_DropToFloor(edict_t* ed);
+void SB_RunPhysics();
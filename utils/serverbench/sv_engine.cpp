@@ -0,0 +1,1427 @@
+//=========================================================
+// sv_engine.cpp - the engine function table handed to the
+// game dll. Every entry gets a type-correct stub first, the
+// ones the game logic depends on are then replaced with
+// working versions below.
+//=========================================================
+
+#include <cmath>
+#include <cstdarg>
+#include <cstring>
+#include <dlfcn.h>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+#include "serverbench.h"
+#include "FileSystem.h"
+#include "studio.h"
+
+sbserver_t sv;
+globalvars_t gGlobals;
+enginefuncs_t gEngfuncs;
+DLL_FUNCTIONS gEntityInterface;
+NEW_DLL_FUNCTIONS gNewDLLFunctions;
+
+//=========================================================
+// Default stubs. Return a zeroed value of the right type so
+// that unimplemented calls are harmless.
+//=========================================================
+template <typename T>
+struct StubFn;
+
+template <typename R, typename... Args>
+struct StubFn<R (*)(Args...)>
+{
+	static R Call(Args...)
+	{
+		if constexpr (!std::is_void_v<R>)
+			return R{};
+	}
+};
+
+template <typename R, typename... Args>
+struct StubFn<R (*)(Args..., ...)>
+{
+	static R Call(Args..., ...)
+	{
+		if constexpr (!std::is_void_v<R>)
+			return R{};
+	}
+};
+
+#define SB_STUB(name) gEngfuncs.name = StubFn<decltype(gEngfuncs.name)>::Call
+
+//=========================================================
+// Strings
+//=========================================================
+static char* g_StringPool;
+static std::size_t g_StringPoolUsed;
+
+const char* SB_AllocString(const char* value, string_t* offset)
+{
+	std::size_t length = strlen(value) + 1;
+
+	if (g_StringPoolUsed + length > SB_STRING_POOL)
+	{
+		printf("String pool exhausted\n");
+		exit(1);
+	}
+
+	// same escape handling as the engine, "\n" becomes a newline
+	char* out = g_StringPool + g_StringPoolUsed;
+	char* start = out;
+
+	for (const char* in = value; *in; in++)
+	{
+		if (in[0] == '\\' && in[1] == 'n')
+		{
+			*out++ = '\n';
+			in++;
+		}
+		else
+			*out++ = *in;
+	}
+	*out++ = '\0';
+
+	g_StringPoolUsed += out - start;
+
+	if (offset)
+		*offset = static_cast<string_t>(start - g_StringPool);
+
+	return start;
+}
+
+static int AllocString(const char* szValue)
+{
+	string_t offset;
+	SB_AllocString(szValue, &offset);
+	return offset;
+}
+
+static const char* SzFromIndex(int iString)
+{
+	return SB_STRING(iString);
+}
+
+//=========================================================
+// Edicts
+//=========================================================
+static edict_t* CreateEntity()
+{
+	int i;
+
+	// reuse slots that have been free for a while, like the engine does
+	for (i = gGlobals.maxClients + 1; i < sv.numEdicts; i++)
+	{
+		edict_t* ed = &sv.edicts[i];
+		if (0 != ed->free && (ed->freetime < 2 || sv.time - ed->freetime > 0.5f))
+			break;
+	}
+
+	if (i == sv.numEdicts)
+	{
+		if (sv.numEdicts == sv.maxEdicts)
+		{
+			printf("No free edicts\n");
+			exit(1);
+		}
+		sv.numEdicts++;
+	}
+
+	edict_t* ed = &sv.edicts[i];
+	memset(&ed->v, 0, sizeof(ed->v));
+	ed->free = 0;
+	ed->v.pContainingEntity = ed;
+	return ed;
+}
+
+static void FreeEntPrivateData(edict_t* pEdict)
+{
+	if (pEdict->pvPrivateData)
+	{
+		if (gNewDLLFunctions.pfnOnFreeEntPrivateData)
+			gNewDLLFunctions.pfnOnFreeEntPrivateData(pEdict);
+
+		free(pEdict->pvPrivateData);
+	}
+
+	pEdict->pvPrivateData = nullptr;
+}
+
+void SB_FreeEdict(edict_t* ed)
+{
+	if (0 != ed->free)
+		return;
+
+	FreeEntPrivateData(ed);
+
+	ed->serialnumber++;
+	ed->free = 1;
+	ed->freetime = sv.time;
+	memset(&ed->v, 0, sizeof(ed->v));
+}
+
+static void* PvAllocEntPrivateData(edict_t* pEdict, int32 cb)
+{
+	FreeEntPrivateData(pEdict);
+
+	if (cb <= 0)
+		return nullptr;
+
+	pEdict->pvPrivateData = calloc(1, cb);
+	return pEdict->pvPrivateData;
+}
+
+static void* PvEntPrivateData(edict_t* pEdict)
+{
+	return pEdict ? pEdict->pvPrivateData : nullptr;
+}
+
+edict_t* SB_CreateNamedEntity(const char* classname)
+{
+	typedef void (*LINK_ENTITY_FUNC)(entvars_t*);
+	LINK_ENTITY_FUNC func = reinterpret_cast<LINK_ENTITY_FUNC>(dlsym(sv.gameDll, classname));
+
+	if (!func)
+	{
+		if (sv.verbose)
+			printf("Can't init %s\n", classname);
+		return nullptr;
+	}
+
+	edict_t* ed = CreateEntity();
+	SB_AllocString(classname, &ed->v.classname);
+	func(&ed->v);
+	return ed;
+}
+
+static edict_t* CreateNamedEntity(int className)
+{
+	return SB_CreateNamedEntity(SB_STRING(className));
+}
+
+static void RemoveEntity(edict_t* e)
+{
+	SB_FreeEdict(e);
+}
+
+static void MakeStatic(edict_t* ent)
+{
+	// static entities only exist on the client
+	SB_FreeEdict(ent);
+}
+
+static entvars_t* GetVarsOfEnt(edict_t* pEdict)
+{
+	return &pEdict->v;
+}
+
+static edict_t* PEntityOfEntOffset(int iEntOffset)
+{
+	return reinterpret_cast<edict_t*>(reinterpret_cast<byte*>(sv.edicts) + iEntOffset);
+}
+
+static int EntOffsetOfPEntity(const edict_t* pEdict)
+{
+	return static_cast<int>(reinterpret_cast<const byte*>(pEdict) - reinterpret_cast<const byte*>(sv.edicts));
+}
+
+static int IndexOfEdict(const edict_t* pEdict)
+{
+	return pEdict ? static_cast<int>(pEdict - sv.edicts) : 0;
+}
+
+static edict_t* PEntityOfEntIndexAllEntities(int iEntIndex)
+{
+	if (iEntIndex < 0 || iEntIndex >= sv.maxEdicts)
+		return nullptr;
+
+	edict_t* ed = &sv.edicts[iEntIndex];
+	return (0 != ed->free) ? nullptr : ed;
+}
+
+static edict_t* PEntityOfEntIndex(int iEntIndex)
+{
+	edict_t* ed = PEntityOfEntIndexAllEntities(iEntIndex);
+
+	// client slots only count once someone is in them
+	if (ed && iEntIndex > 0 && iEntIndex <= gGlobals.maxClients && !ed->pvPrivateData)
+		return nullptr;
+
+	return ed;
+}
+
+static edict_t* FindEntityByVars(entvars_t* pvars)
+{
+	return pvars->pContainingEntity;
+}
+
+static int NumberOfEntities()
+{
+	int count = 0;
+
+	for (int i = 0; i < sv.numEdicts; i++)
+	{
+		if (0 == sv.edicts[i].free)
+			count++;
+	}
+
+	return count;
+}
+
+//=========================================================
+// Models and precaching
+//=========================================================
+struct sbmodel_t
+{
+	std::vector<byte> data; // studio models only
+	int frames;
+};
+
+static std::vector<sbmodel_t> g_ModelData;
+static int g_NumUserMessages;
+static int g_NumEvents;
+
+static int PrecacheModel(const char* s)
+{
+	for (std::size_t i = 1; i < sv.models.size(); i++)
+	{
+		if (0 == strcasecmp(sv.models[i].c_str(), s))
+			return static_cast<int>(i);
+	}
+
+	sbmodel_t model;
+	model.frames = 1;
+
+	if (s[0] != '*')
+	{
+		std::vector<byte> data = SB_LoadFile(s);
+		const char* ext = strrchr(s, '.');
+
+		if (ext && 0 == strcasecmp(ext, ".mdl") && data.size() >= sizeof(studiohdr_t))
+			model.data = std::move(data);
+		else if (ext && 0 == strcasecmp(ext, ".spr") && data.size() >= 32)
+			memcpy(&model.frames, data.data() + 28, sizeof(int)); // dsprite_t::numframes
+		else if (data.empty() && sv.verbose)
+			printf("Couldn't precache %s\n", s);
+	}
+
+	if (sv.models.empty())
+	{
+		sv.models.emplace_back();
+		g_ModelData.emplace_back();
+	}
+
+	sv.models.emplace_back(s);
+	g_ModelData.push_back(std::move(model));
+	return static_cast<int>(sv.models.size()) - 1;
+}
+
+static int ModelIndex(const char* m)
+{
+	for (std::size_t i = 1; i < sv.models.size(); i++)
+	{
+		if (0 == strcasecmp(sv.models[i].c_str(), m))
+			return static_cast<int>(i);
+	}
+
+	printf("Model %s not precached\n", m);
+	return 0;
+}
+
+static int ModelFrames(int modelIndex)
+{
+	if (modelIndex <= 0 || modelIndex >= static_cast<int>(g_ModelData.size()))
+		return 1;
+
+	return g_ModelData[modelIndex].frames;
+}
+
+static void SetMinMaxSize(edict_t* e, const float* min, const float* max)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		e->v.mins[i] = min[i];
+		e->v.maxs[i] = max[i];
+		e->v.size[i] = max[i] - min[i];
+	}
+
+	SB_LinkEdict(e, false);
+}
+
+static void SetModel(edict_t* e, const char* m)
+{
+	e->v.model = static_cast<string_t>(m - gGlobals.pStringBase);
+	e->v.modelindex = ModelIndex(m);
+
+	float mins[3] = {0, 0, 0};
+	float maxs[3] = {0, 0, 0};
+
+	if (m[0] == '*')
+		SB_SubModelBounds(atoi(m + 1), mins, maxs);
+
+	SetMinMaxSize(e, mins, maxs);
+}
+
+static void SetSize(edict_t* e, const float* rgflMin, const float* rgflMax)
+{
+	SetMinMaxSize(e, rgflMin, rgflMax);
+}
+
+static void SetOrigin(edict_t* e, const float* rgflOrigin)
+{
+	e->v.origin = rgflOrigin;
+	SB_LinkEdict(e, false);
+}
+
+static void* GetModelPtr(edict_t* pEdict)
+{
+	if (!pEdict || pEdict->v.modelindex <= 0 || pEdict->v.modelindex >= static_cast<int>(g_ModelData.size()))
+		return nullptr;
+
+	std::vector<byte>& data = g_ModelData[pEdict->v.modelindex].data;
+	return data.empty() ? nullptr : data.data();
+}
+
+static int PrecacheSound(const char* s)
+{
+	for (std::size_t i = 0; i < sv.sounds.size(); i++)
+	{
+		if (0 == strcasecmp(sv.sounds[i].c_str(), s))
+			return static_cast<int>(i);
+	}
+
+	sv.sounds.emplace_back(s);
+	return static_cast<int>(sv.sounds.size()) - 1;
+}
+
+static int RegUserMsg(const char* pszName, int iSize)
+{
+	return 64 + g_NumUserMessages++;
+}
+
+static unsigned short PrecacheEvent(int type, const char* psz)
+{
+	return static_cast<unsigned short>(++g_NumEvents);
+}
+
+static void GetBonePosition(const edict_t* pEdict, int iBone, float* rgflOrigin, float* rgflAngles)
+{
+	// no animation here, everything happens at the entity origin
+	for (int i = 0; i < 3; i++)
+	{
+		if (rgflOrigin)
+			rgflOrigin[i] = pEdict->v.origin[i];
+		if (rgflAngles)
+			rgflAngles[i] = pEdict->v.angles[i];
+	}
+}
+
+static void GetAttachment(const edict_t* pEdict, int iAttachment, float* rgflOrigin, float* rgflAngles)
+{
+	GetBonePosition(pEdict, iAttachment, rgflOrigin, rgflAngles);
+}
+
+//=========================================================
+// Math
+//=========================================================
+static float VecToYaw(const float* rgflVector)
+{
+	if (rgflVector[1] == 0 && rgflVector[0] == 0)
+		return 0;
+
+	float yaw = static_cast<int>(atan2(rgflVector[1], rgflVector[0]) * 180 / M_PI);
+	if (yaw < 0)
+		yaw += 360;
+
+	return yaw;
+}
+
+static void VecToAngles(const float* rgflVectorIn, float* rgflVectorOut)
+{
+	float yaw, pitch;
+
+	if (rgflVectorIn[1] == 0 && rgflVectorIn[0] == 0)
+	{
+		yaw = 0;
+		pitch = (rgflVectorIn[2] > 0) ? 90 : 270;
+	}
+	else
+	{
+		yaw = static_cast<int>(atan2(rgflVectorIn[1], rgflVectorIn[0]) * 180 / M_PI);
+		if (yaw < 0)
+			yaw += 360;
+
+		float forward = sqrt(rgflVectorIn[0] * rgflVectorIn[0] + rgflVectorIn[1] * rgflVectorIn[1]);
+		pitch = static_cast<int>(atan2(rgflVectorIn[2], forward) * 180 / M_PI);
+		if (pitch < 0)
+			pitch += 360;
+	}
+
+	rgflVectorOut[0] = pitch;
+	rgflVectorOut[1] = yaw;
+	rgflVectorOut[2] = 0;
+}
+
+static void AngleVectors(const float* rgflVector, float* forward, float* right, float* up)
+{
+	float angle = rgflVector[1] * (M_PI * 2 / 360);
+	float sy = sin(angle), cy = cos(angle);
+	angle = rgflVector[0] * (M_PI * 2 / 360);
+	float sp = sin(angle), cp = cos(angle);
+	angle = rgflVector[2] * (M_PI * 2 / 360);
+	float sr = sin(angle), cr = cos(angle);
+
+	if (forward)
+	{
+		forward[0] = cp * cy;
+		forward[1] = cp * sy;
+		forward[2] = -sp;
+	}
+	if (right)
+	{
+		right[0] = (-1 * sr * sp * cy + -1 * cr * -sy);
+		right[1] = (-1 * sr * sp * sy + -1 * cr * cy);
+		right[2] = -1 * sr * cp;
+	}
+	if (up)
+	{
+		up[0] = (cr * sp * cy + -sr * -sy);
+		up[1] = (cr * sp * sy + -sr * cy);
+		up[2] = cr * cp;
+	}
+}
+
+static void MakeVectors(const float* rgflVector)
+{
+	AngleVectors(rgflVector, gGlobals.v_forward, gGlobals.v_right, gGlobals.v_up);
+}
+
+static float AngleMod(float a)
+{
+	return (360.0f / 65536) * (static_cast<int>(a * (65536 / 360.0f)) & 65535);
+}
+
+static float ApproachAngle(float current, float ideal, float speed)
+{
+	current = AngleMod(current);
+
+	if (current == ideal)
+		return current;
+
+	float move = ideal - current;
+	if (ideal > current)
+	{
+		if (move >= 180)
+			move -= 360;
+	}
+	else
+	{
+		if (move <= -180)
+			move += 360;
+	}
+
+	if (move > 0)
+		move = std::fmin(move, speed);
+	else
+		move = std::fmax(move, -speed);
+
+	return AngleMod(current + move);
+}
+
+static void ChangeYaw(edict_t* ent)
+{
+	ent->v.angles.y = ApproachAngle(ent->v.angles.y, ent->v.ideal_yaw, ent->v.yaw_speed);
+}
+
+static void ChangePitch(edict_t* ent)
+{
+	ent->v.angles.x = ApproachAngle(ent->v.angles.x, ent->v.idealpitch, ent->v.pitch_speed);
+}
+
+//=========================================================
+// Searching
+//=========================================================
+static edict_t* FindEntityByString(edict_t* pEdictStartSearchAfter, const char* pszField, const char* pszValue)
+{
+	static const struct
+	{
+		const char* name;
+		std::size_t offset;
+	} fields[] = {
+		{"classname", offsetof(entvars_t, classname)},
+		{"model", offsetof(entvars_t, model)},
+		{"viewmodel", offsetof(entvars_t, viewmodel)},
+		{"weaponmodel", offsetof(entvars_t, weaponmodel)},
+		{"netname", offsetof(entvars_t, netname)},
+		{"target", offsetof(entvars_t, target)},
+		{"targetname", offsetof(entvars_t, targetname)},
+		{"message", offsetof(entvars_t, message)},
+		{"noise", offsetof(entvars_t, noise)},
+		{"noise1", offsetof(entvars_t, noise1)},
+		{"noise2", offsetof(entvars_t, noise2)},
+		{"noise3", offsetof(entvars_t, noise3)},
+		{"globalname", offsetof(entvars_t, globalname)},
+	};
+
+	std::size_t offset = 0;
+	bool found = false;
+
+	for (const auto& field : fields)
+	{
+		if (0 == strcmp(field.name, pszField))
+		{
+			offset = field.offset;
+			found = true;
+			break;
+		}
+	}
+
+	if (!found)
+		return sv.edicts;
+
+	for (int i = IndexOfEdict(pEdictStartSearchAfter) + 1; i < sv.numEdicts; i++)
+	{
+		edict_t* ed = &sv.edicts[i];
+
+		if (0 != ed->free)
+			continue;
+
+		string_t value = *reinterpret_cast<const string_t*>(reinterpret_cast<const byte*>(&ed->v) + offset);
+		if (0 != value && 0 == strcmp(SB_STRING(value), pszValue))
+			return ed;
+	}
+
+	return sv.edicts;
+}
+
+static edict_t* FindEntityInSphere(edict_t* pEdictStartSearchAfter, const float* org, float rad)
+{
+	float radSquared = rad * rad;
+
+	for (int i = IndexOfEdict(pEdictStartSearchAfter) + 1; i < sv.numEdicts; i++)
+	{
+		edict_t* ed = &sv.edicts[i];
+
+		if (0 != ed->free || 0 == ed->v.classname)
+			continue;
+
+		float distSquared = 0;
+		for (int j = 0; j < 3 && distSquared <= radSquared; j++)
+		{
+			float eorg = org[j] - (ed->v.origin[j] + (ed->v.mins[j] + ed->v.maxs[j]) * 0.5f);
+			distSquared += eorg * eorg;
+		}
+
+		if (distSquared <= radSquared)
+			return ed;
+	}
+
+	return sv.edicts;
+}
+
+static edict_t* FindClientInPVS(edict_t* pEdict)
+{
+	// there is no vis data loaded, any live client counts as visible
+	for (int i = 1; i <= gGlobals.maxClients; i++)
+	{
+		edict_t* client = &sv.edicts[i];
+
+		if (0 == client->free && client->pvPrivateData && client->v.health > 0 && (client->v.flags & FL_NOTARGET) == 0)
+			return client;
+	}
+
+	return sv.edicts;
+}
+
+static edict_t* EntitiesInPVS(edict_t* pplayer)
+{
+	edict_t* chain = sv.edicts;
+
+	for (int i = 1; i < sv.numEdicts; i++)
+	{
+		edict_t* ed = &sv.edicts[i];
+
+		if (0 != ed->free)
+			continue;
+
+		ed->v.chain = chain;
+		chain = ed;
+	}
+
+	return chain;
+}
+
+//=========================================================
+// Movement and tracing
+//=========================================================
+static int DropToFloor(edict_t* e)
+{
+	return SB_DropToFloor(e);
+}
+
+static int WalkMove(edict_t* ent, float yaw, float dist, int iMode)
+{
+	return SB_WalkMove(ent, yaw, dist, iMode);
+}
+
+static void MoveToOrigin(edict_t* ent, const float* pflGoal, float dist, int iMoveType)
+{
+	if ((ent->v.flags & (FL_ONGROUND | FL_SWIM | FL_FLY)) == 0)
+		return;
+
+	Vector dir = Vector(pflGoal) - ent->v.origin;
+
+	if (iMoveType != 0) // MOVE_STRAFE
+	{
+		// strafing, move straight at the goal
+		if ((ent->v.flags & (FL_SWIM | FL_FLY)) == 0)
+			dir.z = 0;
+
+		SB_WalkMove(ent, VecToYaw(dir), dist, WALKMOVE_NORMAL);
+		return;
+	}
+
+	// turn towards the ideal yaw, then step; try nearby directions when blocked
+	ent->v.ideal_yaw = VecToYaw(dir);
+	ChangeYaw(ent);
+
+	static const float offsets[] = {0, 45, -45, 90, -90};
+
+	for (float offset : offsets)
+	{
+		if (0 != SB_WalkMove(ent, ent->v.ideal_yaw + offset, dist, WALKMOVE_NORMAL))
+			return;
+	}
+}
+
+static int EntIsOnFloor(edict_t* e)
+{
+	TraceResult tr;
+	Vector end = e->v.origin;
+	end.z -= 1;
+
+	SB_Move(e->v.origin, e->v.mins, e->v.maxs, end, SB_MOVE_NORMAL, e, &tr);
+	return (0 == tr.fAllSolid && tr.flFraction < 1) ? 1 : 0;
+}
+
+static void TraceLine(const float* v1, const float* v2, int fNoMonsters, edict_t* pentToSkip, TraceResult* ptr)
+{
+	const float zero[3] = {0, 0, 0};
+	SB_Move(v1, zero, zero, v2, fNoMonsters, pentToSkip, ptr);
+}
+
+static void TraceHull(const float* v1, const float* v2, int fNoMonsters, int hullNumber, edict_t* pentToSkip, TraceResult* ptr)
+{
+	Vector mins, maxs;
+	SB_HullBounds((hullNumber >= 0 && hullNumber < SB_MAX_HULLS) ? hullNumber : SB_HULL_POINT, mins, maxs);
+	SB_Move(v1, mins, maxs, v2, fNoMonsters, pentToSkip, ptr);
+}
+
+static int TraceMonsterHull(edict_t* pEdict, const float* v1, const float* v2, int fNoMonsters, edict_t* pentToSkip, TraceResult* ptr)
+{
+	SB_Move(v1, pEdict->v.mins, pEdict->v.maxs, v2, fNoMonsters, pentToSkip, ptr);
+	return (0 != ptr->fAllSolid || ptr->flFraction != 1) ? 1 : 0;
+}
+
+static void TraceModel(const float* v1, const float* v2, int hullNumber, edict_t* pent, TraceResult* ptr)
+{
+	Vector mins, maxs;
+	SB_HullBounds((hullNumber >= 0 && hullNumber < SB_MAX_HULLS) ? hullNumber : SB_HULL_POINT, mins, maxs);
+	SB_ClipMoveToEntity(pent, v1, mins, maxs, v2, ptr);
+}
+
+static void TraceToss(edict_t* pent, edict_t* pentToIgnore, TraceResult* ptr)
+{
+	Vector origin = pent->v.origin;
+	Vector velocity = pent->v.velocity;
+	float gravity = ((pent->v.gravity != 0) ? pent->v.gravity : 1.0f) * SB_CvarValue("sv_gravity");
+
+	memset(ptr, 0, sizeof(TraceResult));
+	ptr->flFraction = 1;
+	ptr->vecEndPos = origin;
+
+	for (int i = 0; i < 200; i++)
+	{
+		velocity.z -= gravity * 0.05f;
+		Vector end = origin + velocity * 0.05f;
+
+		SB_Move(origin, pent->v.mins, pent->v.maxs, end, SB_MOVE_NORMAL, pentToIgnore, ptr);
+
+		if (0 != ptr->fAllSolid || ptr->flFraction != 1)
+			return;
+
+		origin = ptr->vecEndPos;
+	}
+}
+
+static int PointContents(const float* rgflVector)
+{
+	return SB_PointContents(rgflVector);
+}
+
+static void GetAimVector(edict_t* ent, float speed, float* rgflReturn)
+{
+	float forward[3];
+	AngleVectors(ent->v.v_angle, forward, nullptr, nullptr);
+
+	for (int i = 0; i < 3; i++)
+		rgflReturn[i] = forward[i];
+}
+
+//=========================================================
+// Cvars and commands
+//=========================================================
+static std::unordered_map<std::string, cvar_t*> g_Cvars;
+static std::unordered_map<std::string, void (*)()> g_Commands;
+static std::vector<std::string> g_CmdArgv;
+static std::string g_CmdArgs;
+static std::string g_CommandBuffer;
+
+static std::string LowerCase(const char* text)
+{
+	std::string result = text;
+	for (char& c : result)
+		c = tolower(c);
+	return result;
+}
+
+static cvar_t* CVarGetPointer(const char* szVarName)
+{
+	auto it = g_Cvars.find(LowerCase(szVarName));
+	return (it != g_Cvars.end()) ? it->second : nullptr;
+}
+
+static void CvarDirectSet(cvar_t* var, const char* value)
+{
+	// every cvar string is owned by the harness once registered
+	char* string = strdup(value);
+	free(var->string);
+	var->string = string;
+	var->value = atof(string);
+}
+
+static void CVarRegister(cvar_t* pCvar)
+{
+	if (CVarGetPointer(pCvar->name))
+		return;
+
+	pCvar->string = strdup(pCvar->string);
+	pCvar->value = atof(pCvar->string);
+	g_Cvars[LowerCase(pCvar->name)] = pCvar;
+}
+
+bool SB_SetCvar(const char* name, const char* value)
+{
+	cvar_t* var = CVarGetPointer(name);
+
+	if (!var)
+		return false;
+
+	CvarDirectSet(var, value);
+	return true;
+}
+
+float SB_CvarValue(const char* name)
+{
+	cvar_t* var = CVarGetPointer(name);
+	return var ? var->value : 0;
+}
+
+static float CVarGetFloat(const char* szVarName)
+{
+	return SB_CvarValue(szVarName);
+}
+
+static const char* CVarGetString(const char* szVarName)
+{
+	cvar_t* var = CVarGetPointer(szVarName);
+	return var ? var->string : "";
+}
+
+static void CVarSetFloat(const char* szVarName, float flValue)
+{
+	char value[32];
+	snprintf(value, sizeof(value), "%g", flValue);
+	SB_SetCvar(szVarName, value);
+}
+
+static void CVarSetString(const char* szVarName, const char* szValue)
+{
+	SB_SetCvar(szVarName, szValue);
+}
+
+void SB_InitCvars()
+{
+	// the cvars the engine itself owns that game code reads
+	static const char* engineCvars[][2] = {
+		{"sv_gravity", "800"},
+		{"sv_maxspeed", "320"},
+		{"sv_stepsize", "18"},
+		{"sv_friction", "4"},
+		{"edgefriction", "2"},
+		{"sv_stopspeed", "100"},
+		{"sv_accelerate", "10"},
+		{"sv_airaccelerate", "10"},
+		{"sv_wateraccelerate", "10"},
+		{"sv_waterfriction", "1"},
+		{"sv_bounce", "1"},
+		{"sv_maxvelocity", "2000"},
+		{"sv_zmax", "4096"},
+		{"sv_aim", "0"},
+		{"sv_allow_autoaim", "1"},
+		{"sv_cheats", "0"},
+		{"sv_skyname", "desert"},
+		{"skill", "1"},
+		{"deathmatch", "0"},
+		{"coop", "0"},
+		{"teamplay", "0"},
+		{"maxplayers", "1"},
+		{"developer", "0"},
+		{"hostname", "serverbench"},
+	};
+
+	for (const auto& engineCvar : engineCvars)
+	{
+		cvar_t* var = static_cast<cvar_t*>(calloc(1, sizeof(cvar_t)));
+		var->name = strdup(engineCvar[0]);
+		var->string = const_cast<char*>(engineCvar[1]);
+		var->flags = FCVAR_SERVER;
+		CVarRegister(var);
+	}
+}
+
+static void AddServerCommand(const char* cmd_name, void (*function)())
+{
+	g_Commands[LowerCase(cmd_name)] = function;
+}
+
+static void TokenizeCommand(const std::string& text)
+{
+	g_CmdArgv.clear();
+	g_CmdArgs.clear();
+
+	std::size_t i = 0;
+	while (i < text.size())
+	{
+		while (i < text.size() && isspace(static_cast<unsigned char>(text[i])))
+			i++;
+
+		if (i == text.size())
+			break;
+
+		// everything after the command name, as Cmd_Args reports it
+		if (g_CmdArgv.size() == 1)
+			g_CmdArgs = text.substr(i);
+
+		std::string token;
+		if (text[i] == '"')
+		{
+			for (i++; i < text.size() && text[i] != '"'; i++)
+				token += text[i];
+			i++;
+		}
+		else
+		{
+			for (; i < text.size() && !isspace(static_cast<unsigned char>(text[i])); i++)
+				token += text[i];
+		}
+
+		g_CmdArgv.push_back(token);
+	}
+}
+
+void SB_ExecuteCommand(const char* text)
+{
+	std::string line;
+	bool quoted = false;
+
+	for (const char* p = text;; p++)
+	{
+		if (*p == '"')
+			quoted = !quoted;
+
+		if (*p != '\0' && (quoted || (*p != ';' && *p != '\n')))
+		{
+			line += *p;
+			continue;
+		}
+
+		TokenizeCommand(line);
+		line.clear();
+
+		if (!g_CmdArgv.empty())
+		{
+			auto command = g_Commands.find(LowerCase(g_CmdArgv[0].c_str()));
+			cvar_t* var = CVarGetPointer(g_CmdArgv[0].c_str());
+
+			if (command != g_Commands.end())
+				command->second();
+			else if (var && g_CmdArgv.size() > 1)
+				CvarDirectSet(var, g_CmdArgv[1].c_str());
+			else if (var)
+				printf("\"%s\" is \"%s\"\n", var->name, var->string);
+			else
+				printf("Unknown command: %s\n", g_CmdArgv[0].c_str());
+		}
+
+		if (*p == '\0')
+			break;
+	}
+}
+
+static void ServerCommand(const char* str)
+{
+	g_CommandBuffer += str;
+}
+
+void SB_ServerExecute()
+{
+	// commands can queue more commands
+	while (!g_CommandBuffer.empty())
+	{
+		std::string text;
+		text.swap(g_CommandBuffer);
+		SB_ExecuteCommand(text.c_str());
+	}
+}
+
+static const char* Cmd_Args()
+{
+	return g_CmdArgs.c_str();
+}
+
+static const char* Cmd_Argv(int argc)
+{
+	return (argc >= 0 && argc < static_cast<int>(g_CmdArgv.size())) ? g_CmdArgv[argc].c_str() : "";
+}
+
+static int Cmd_Argc()
+{
+	return static_cast<int>(g_CmdArgv.size());
+}
+
+//=========================================================
+// Output
+//=========================================================
+static void AlertMessage(ALERT_TYPE atype, const char* szFmt, ...)
+{
+	if (!sv.verbose && atype != at_warning && atype != at_error)
+		return;
+
+	va_list args;
+	va_start(args, szFmt);
+	vprintf(szFmt, args);
+	va_end(args);
+}
+
+static void EngineFprintf(void* pfile, const char* szFmt, ...)
+{
+	va_list args;
+	va_start(args, szFmt);
+	vfprintf(static_cast<FILE*>(pfile), szFmt, args);
+	va_end(args);
+}
+
+static void ServerPrint(const char* szMsg)
+{
+	fputs(szMsg, stdout);
+}
+
+static void ClientPrintf(edict_t* pEdict, PRINT_TYPE ptype, const char* szMsg)
+{
+	if (sv.verbose)
+		fputs(szMsg, stdout);
+}
+
+//=========================================================
+// Files
+//=========================================================
+std::vector<byte> SB_LoadFile(const char* fileName)
+{
+	std::vector<byte> data;
+	FileHandle_t file = sv.fileSystem->Open(fileName, "rb");
+
+	if (FILESYSTEM_INVALID_HANDLE == file)
+		return data;
+
+	data.resize(sv.fileSystem->Size(file));
+
+	if (sv.fileSystem->Read(data.data(), data.size(), file) != static_cast<int>(data.size()))
+		data.clear();
+
+	sv.fileSystem->Close(file);
+	return data;
+}
+
+static byte* LoadFileForMe(const char* filename, int* pLength)
+{
+	std::vector<byte> data = SB_LoadFile(filename);
+
+	if (pLength)
+		*pLength = static_cast<int>(data.size());
+
+	if (data.empty())
+		return nullptr;
+
+	byte* buffer = static_cast<byte*>(malloc(data.size() + 1));
+	memcpy(buffer, data.data(), data.size());
+	buffer[data.size()] = '\0';
+	return buffer;
+}
+
+static void FreeFile(void* buffer)
+{
+	free(buffer);
+}
+
+static int GetFileSize(const char* filename)
+{
+	if (!sv.fileSystem->FileExists(filename))
+		return -1;
+
+	return static_cast<int>(sv.fileSystem->Size(filename));
+}
+
+static int CompareFileTime(const char* filename1, const char* filename2, int* iCompare)
+{
+	*iCompare = 0;
+	return 1;
+}
+
+static int IsMapValid(const char* filename)
+{
+	std::string path = std::string("maps/") + filename + ".bsp";
+	return sv.fileSystem->FileExists(path.c_str()) ? 1 : 0;
+}
+
+static void GetGameDir(char* szGetGameDir)
+{
+	strcpy(szGetGameDir, sv.gameDirName.c_str());
+}
+
+//=========================================================
+// Misc
+//=========================================================
+static std::mt19937 g_Random;
+
+static int32 RandomLong(int32 lLow, int32 lHigh)
+{
+	if (lLow >= lHigh)
+		return lLow;
+
+	uint32 range = static_cast<uint32>(lHigh - lLow) + 1;
+	return lLow + static_cast<int32>((0 != range) ? g_Random() % range : g_Random());
+}
+
+static float RandomFloat(float flLow, float flHigh)
+{
+	return flLow + (flHigh - flLow) * (g_Random() / 4294967296.0f);
+}
+
+static float Time()
+{
+	return sv.time;
+}
+
+static uint32 FunctionFromName(const char* pName)
+{
+	return static_cast<uint32>(reinterpret_cast<std::uintptr_t>(dlsym(sv.gameDll, pName)));
+}
+
+static const char* NameForFunction(uint32 function)
+{
+	Dl_info info;
+
+	if (0 != dladdr(reinterpret_cast<void*>(static_cast<std::uintptr_t>(function)), &info) && info.dli_sname)
+		return info.dli_sname;
+
+	printf("Can't find address: %08x\n", function);
+	return nullptr;
+}
+
+static void CRC32_Init(CRC32_t* pulCRC)
+{
+	*pulCRC = 0xFFFFFFFF;
+}
+
+static void CRC32_ProcessByte(CRC32_t* pulCRC, unsigned char ch)
+{
+	CRC32_t crc = *pulCRC ^ ch;
+
+	for (int i = 0; i < 8; i++)
+		crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+
+	*pulCRC = crc;
+}
+
+static void CRC32_ProcessBuffer(CRC32_t* pulCRC, void* p, int len)
+{
+	for (int i = 0; i < len; i++)
+		CRC32_ProcessByte(pulCRC, static_cast<unsigned char*>(p)[i]);
+}
+
+static CRC32_t CRC32_Final(CRC32_t pulCRC)
+{
+	return ~pulCRC;
+}
+
+static char* GetInfoKeyBuffer(edict_t* e)
+{
+	static char infoBuffer[256];
+	return infoBuffer;
+}
+
+static char* InfoKeyValue(char* infobuffer, const char* key)
+{
+	static char empty[1];
+	return empty;
+}
+
+static const char* GetPhysicsKeyValue(const edict_t* pClient, const char* key)
+{
+	return "";
+}
+
+static const char* GetPhysicsInfoString(const edict_t* pClient)
+{
+	return "";
+}
+
+static const char* GetPlayerAuthId(edict_t* e)
+{
+	return "STEAM_ID_LAN";
+}
+
+static int GetPlayerUserId(edict_t* e)
+{
+	return IndexOfEdict(e);
+}
+
+static unsigned char* SetFatPVS(float* org)
+{
+	// no vis data, everything is potentially visible
+	static unsigned char allVisible[SB_MAX_EDICTS / 8 + 1024];
+	memset(allVisible, 0xFF, sizeof(allVisible));
+	return allVisible;
+}
+
+static int CheckVisibility(const edict_t* entity, unsigned char* pset)
+{
+	return 1;
+}
+
+static int IsDedicatedServer()
+{
+	return 1;
+}
+
+static int GetEntityIllum(edict_t* pEnt)
+{
+	return 128;
+}
+
+static void SetClientMaxspeed(const edict_t* pEdict, float fNewMaxspeed)
+{
+	const_cast<edict_t*>(pEdict)->v.maxspeed = fNewMaxspeed;
+}
+
+static int CheckParm(const char* pchCmdLineToken, const char** ppnext)
+{
+	for (int i = 1; i < sv.argc; i++)
+	{
+		if (0 == strcasecmp(sv.argv[i], pchCmdLineToken))
+		{
+			if (ppnext)
+				*ppnext = (i + 1 < sv.argc) ? sv.argv[i + 1] : nullptr;
+			return i;
+		}
+	}
+
+	if (ppnext)
+		*ppnext = nullptr;
+	return 0;
+}
+
+static qboolean Voice_SetClientListening(int iReceiver, int iSender, qboolean bListen)
+{
+	return 1;
+}
+
+static int DeltaFindField(struct delta_s* pFields, const char* fieldname)
+{
+	return -1;
+}
+
+//=========================================================
+// SB_InitEngineFuncs
+//=========================================================
+void SB_InitEngineFuncs()
+{
+	memset(&gGlobals, 0, sizeof(gGlobals));
+	memset(&gEntityInterface, 0, sizeof(gEntityInterface));
+	memset(&gNewDLLFunctions, 0, sizeof(gNewDLLFunctions));
+
+	g_StringPool = static_cast<char*>(calloc(1, SB_STRING_POOL));
+	g_StringPoolUsed = 1; // offset 0 is the empty string
+	gGlobals.pStringBase = g_StringPool;
+
+	sv.maxEdicts = SB_MAX_EDICTS;
+	gGlobals.maxEntities = sv.maxEdicts;
+	sv.edicts = static_cast<edict_t*>(calloc(sv.maxEdicts, sizeof(edict_t)));
+	for (int i = 0; i < sv.maxEdicts; i++)
+	{
+		sv.edicts[i].free = 1;
+		sv.edicts[i].v.pContainingEntity = &sv.edicts[i];
+	}
+
+	g_Random.seed(sv.randomSeed);
+
+	SB_STUB(pfnPrecacheModel); SB_STUB(pfnPrecacheSound); SB_STUB(pfnSetModel); SB_STUB(pfnModelIndex);
+	SB_STUB(pfnModelFrames); SB_STUB(pfnSetSize); SB_STUB(pfnChangeLevel); SB_STUB(pfnGetSpawnParms);
+	SB_STUB(pfnSaveSpawnParms); SB_STUB(pfnVecToYaw); SB_STUB(pfnVecToAngles); SB_STUB(pfnMoveToOrigin);
+	SB_STUB(pfnChangeYaw); SB_STUB(pfnChangePitch); SB_STUB(pfnFindEntityByString); SB_STUB(pfnGetEntityIllum);
+	SB_STUB(pfnFindEntityInSphere); SB_STUB(pfnFindClientInPVS); SB_STUB(pfnEntitiesInPVS);
+	SB_STUB(pfnMakeVectors); SB_STUB(pfnAngleVectors); SB_STUB(pfnCreateEntity); SB_STUB(pfnRemoveEntity);
+	SB_STUB(pfnCreateNamedEntity); SB_STUB(pfnMakeStatic); SB_STUB(pfnEntIsOnFloor); SB_STUB(pfnDropToFloor);
+	SB_STUB(pfnWalkMove); SB_STUB(pfnSetOrigin); SB_STUB(pfnEmitSound); SB_STUB(pfnEmitAmbientSound);
+	SB_STUB(pfnTraceLine); SB_STUB(pfnTraceToss); SB_STUB(pfnTraceMonsterHull); SB_STUB(pfnTraceHull);
+	SB_STUB(pfnTraceModel); SB_STUB(pfnTraceTexture); SB_STUB(pfnTraceSphere); SB_STUB(pfnGetAimVector);
+	SB_STUB(pfnServerCommand); SB_STUB(pfnServerExecute); SB_STUB(pfnClientCommand); SB_STUB(pfnParticleEffect);
+	SB_STUB(pfnLightStyle); SB_STUB(pfnDecalIndex); SB_STUB(pfnPointContents); SB_STUB(pfnMessageBegin);
+	SB_STUB(pfnMessageEnd); SB_STUB(pfnWriteByte); SB_STUB(pfnWriteChar); SB_STUB(pfnWriteShort);
+	SB_STUB(pfnWriteLong); SB_STUB(pfnWriteAngle); SB_STUB(pfnWriteCoord); SB_STUB(pfnWriteString);
+	SB_STUB(pfnWriteEntity); SB_STUB(pfnCVarRegister); SB_STUB(pfnCVarGetFloat); SB_STUB(pfnCVarGetString);
+	SB_STUB(pfnCVarSetFloat); SB_STUB(pfnCVarSetString); SB_STUB(pfnAlertMessage); SB_STUB(pfnEngineFprintf);
+	SB_STUB(pfnPvAllocEntPrivateData); SB_STUB(pfnPvEntPrivateData); SB_STUB(pfnFreeEntPrivateData);
+	SB_STUB(pfnSzFromIndex); SB_STUB(pfnAllocString); SB_STUB(pfnGetVarsOfEnt); SB_STUB(pfnPEntityOfEntOffset);
+	SB_STUB(pfnEntOffsetOfPEntity); SB_STUB(pfnIndexOfEdict); SB_STUB(pfnPEntityOfEntIndex);
+	SB_STUB(pfnFindEntityByVars); SB_STUB(pfnGetModelPtr); SB_STUB(pfnRegUserMsg); SB_STUB(pfnAnimationAutomove);
+	SB_STUB(pfnGetBonePosition); SB_STUB(pfnFunctionFromName); SB_STUB(pfnNameForFunction);
+	SB_STUB(pfnClientPrintf); SB_STUB(pfnServerPrint); SB_STUB(pfnCmd_Args); SB_STUB(pfnCmd_Argv);
+	SB_STUB(pfnCmd_Argc); SB_STUB(pfnGetAttachment); SB_STUB(pfnCRC32_Init); SB_STUB(pfnCRC32_ProcessBuffer);
+	SB_STUB(pfnCRC32_ProcessByte); SB_STUB(pfnCRC32_Final); SB_STUB(pfnRandomLong); SB_STUB(pfnRandomFloat);
+	SB_STUB(pfnSetView); SB_STUB(pfnTime); SB_STUB(pfnCrosshairAngle); SB_STUB(pfnLoadFileForMe);
+	SB_STUB(pfnFreeFile); SB_STUB(pfnEndSection); SB_STUB(pfnCompareFileTime); SB_STUB(pfnGetGameDir);
+	SB_STUB(pfnCvar_RegisterVariable); SB_STUB(pfnFadeClientVolume); SB_STUB(pfnSetClientMaxspeed);
+	SB_STUB(pfnCreateFakeClient); SB_STUB(pfnRunPlayerMove); SB_STUB(pfnNumberOfEntities);
+	SB_STUB(pfnGetInfoKeyBuffer); SB_STUB(pfnInfoKeyValue); SB_STUB(pfnSetKeyValue);
+	SB_STUB(pfnSetClientKeyValue); SB_STUB(pfnIsMapValid); SB_STUB(pfnStaticDecal); SB_STUB(pfnPrecacheGeneric);
+	SB_STUB(pfnGetPlayerUserId); SB_STUB(pfnBuildSoundMsg); SB_STUB(pfnIsDedicatedServer);
+	SB_STUB(pfnCVarGetPointer); SB_STUB(pfnGetPlayerWONId); SB_STUB(pfnInfo_RemoveKey);
+	SB_STUB(pfnGetPhysicsKeyValue); SB_STUB(pfnSetPhysicsKeyValue); SB_STUB(pfnGetPhysicsInfoString);
+	SB_STUB(pfnPrecacheEvent); SB_STUB(pfnPlaybackEvent); SB_STUB(pfnSetFatPVS); SB_STUB(pfnSetFatPAS);
+	SB_STUB(pfnCheckVisibility); SB_STUB(pfnDeltaSetField); SB_STUB(pfnDeltaUnsetField);
+	SB_STUB(pfnDeltaAddEncoder); SB_STUB(pfnGetCurrentPlayer); SB_STUB(pfnCanSkipPlayer);
+	SB_STUB(pfnDeltaFindField); SB_STUB(pfnDeltaSetFieldByIndex); SB_STUB(pfnDeltaUnsetFieldByIndex);
+	SB_STUB(pfnSetGroupMask); SB_STUB(pfnCreateInstancedBaseline); SB_STUB(pfnCvar_DirectSet);
+	SB_STUB(pfnForceUnmodified); SB_STUB(pfnGetPlayerStats); SB_STUB(pfnAddServerCommand);
+	SB_STUB(pfnVoice_GetClientListening); SB_STUB(pfnVoice_SetClientListening); SB_STUB(pfnGetPlayerAuthId);
+	SB_STUB(pfnSequenceGet); SB_STUB(pfnSequencePickSentence); SB_STUB(pfnGetFileSize);
+	SB_STUB(pfnGetApproxWavePlayLen); SB_STUB(pfnIsCareerMatch); SB_STUB(pfnGetLocalizedStringLength);
+	SB_STUB(pfnRegisterTutorMessageShown); SB_STUB(pfnGetTimesTutorMessageShown);
+	SB_STUB(ProcessTutorMessageDecayBuffer); SB_STUB(ConstructTutorMessageDecayBuffer);
+	SB_STUB(ResetTutorMessageDecayData); SB_STUB(pfnQueryClientCvarValue); SB_STUB(pfnQueryClientCvarValue2);
+	SB_STUB(pfnCheckParm); SB_STUB(pfnPEntityOfEntIndexAllEntities);
+
+	gEngfuncs.pfnPrecacheModel = PrecacheModel;
+	gEngfuncs.pfnPrecacheSound = PrecacheSound;
+	gEngfuncs.pfnSetModel = SetModel;
+	gEngfuncs.pfnModelIndex = ModelIndex;
+	gEngfuncs.pfnModelFrames = ModelFrames;
+	gEngfuncs.pfnSetSize = SetSize;
+	gEngfuncs.pfnVecToYaw = VecToYaw;
+	gEngfuncs.pfnVecToAngles = VecToAngles;
+	gEngfuncs.pfnMoveToOrigin = MoveToOrigin;
+	gEngfuncs.pfnChangeYaw = ChangeYaw;
+	gEngfuncs.pfnChangePitch = ChangePitch;
+	gEngfuncs.pfnFindEntityByString = FindEntityByString;
+	gEngfuncs.pfnGetEntityIllum = GetEntityIllum;
+	gEngfuncs.pfnFindEntityInSphere = FindEntityInSphere;
+	gEngfuncs.pfnFindClientInPVS = FindClientInPVS;
+	gEngfuncs.pfnEntitiesInPVS = EntitiesInPVS;
+	gEngfuncs.pfnMakeVectors = MakeVectors;
+	gEngfuncs.pfnAngleVectors = AngleVectors;
+	gEngfuncs.pfnCreateEntity = CreateEntity;
+	gEngfuncs.pfnRemoveEntity = RemoveEntity;
+	gEngfuncs.pfnCreateNamedEntity = CreateNamedEntity;
+	gEngfuncs.pfnMakeStatic = MakeStatic;
+	gEngfuncs.pfnEntIsOnFloor = EntIsOnFloor;
+	gEngfuncs.pfnDropToFloor = DropToFloor;
+	gEngfuncs.pfnWalkMove = WalkMove;
+	gEngfuncs.pfnSetOrigin = SetOrigin;
+	gEngfuncs.pfnTraceLine = TraceLine;
+	gEngfuncs.pfnTraceToss = TraceToss;
+	gEngfuncs.pfnTraceMonsterHull = TraceMonsterHull;
+	gEngfuncs.pfnTraceHull = TraceHull;
+	gEngfuncs.pfnTraceModel = TraceModel;
+	gEngfuncs.pfnGetAimVector = GetAimVector;
+	gEngfuncs.pfnServerCommand = ServerCommand;
+	gEngfuncs.pfnServerExecute = SB_ServerExecute;
+	gEngfuncs.pfnPointContents = PointContents;
+	gEngfuncs.pfnCVarRegister = CVarRegister;
+	gEngfuncs.pfnCVarGetFloat = CVarGetFloat;
+	gEngfuncs.pfnCVarGetString = CVarGetString;
+	gEngfuncs.pfnCVarSetFloat = CVarSetFloat;
+	gEngfuncs.pfnCVarSetString = CVarSetString;
+	gEngfuncs.pfnAlertMessage = AlertMessage;
+	gEngfuncs.pfnEngineFprintf = EngineFprintf;
+	gEngfuncs.pfnPvAllocEntPrivateData = PvAllocEntPrivateData;
+	gEngfuncs.pfnPvEntPrivateData = PvEntPrivateData;
+	gEngfuncs.pfnFreeEntPrivateData = FreeEntPrivateData;
+	gEngfuncs.pfnSzFromIndex = SzFromIndex;
+	gEngfuncs.pfnAllocString = AllocString;
+	gEngfuncs.pfnGetVarsOfEnt = GetVarsOfEnt;
+	gEngfuncs.pfnPEntityOfEntOffset = PEntityOfEntOffset;
+	gEngfuncs.pfnEntOffsetOfPEntity = EntOffsetOfPEntity;
+	gEngfuncs.pfnIndexOfEdict = IndexOfEdict;
+	gEngfuncs.pfnPEntityOfEntIndex = PEntityOfEntIndex;
+	gEngfuncs.pfnFindEntityByVars = FindEntityByVars;
+	gEngfuncs.pfnGetModelPtr = GetModelPtr;
+	gEngfuncs.pfnRegUserMsg = RegUserMsg;
+	gEngfuncs.pfnGetBonePosition = GetBonePosition;
+	gEngfuncs.pfnFunctionFromName = FunctionFromName;
+	gEngfuncs.pfnNameForFunction = NameForFunction;
+	gEngfuncs.pfnClientPrintf = ClientPrintf;
+	gEngfuncs.pfnServerPrint = ServerPrint;
+	gEngfuncs.pfnCmd_Args = Cmd_Args;
+	gEngfuncs.pfnCmd_Argv = Cmd_Argv;
+	gEngfuncs.pfnCmd_Argc = Cmd_Argc;
+	gEngfuncs.pfnGetAttachment = GetAttachment;
+	gEngfuncs.pfnCRC32_Init = CRC32_Init;
+	gEngfuncs.pfnCRC32_ProcessBuffer = CRC32_ProcessBuffer;
+	gEngfuncs.pfnCRC32_ProcessByte = CRC32_ProcessByte;
+	gEngfuncs.pfnCRC32_Final = CRC32_Final;
+	gEngfuncs.pfnRandomLong = RandomLong;
+	gEngfuncs.pfnRandomFloat = RandomFloat;
+	gEngfuncs.pfnTime = Time;
+	gEngfuncs.pfnLoadFileForMe = LoadFileForMe;
+	gEngfuncs.pfnFreeFile = FreeFile;
+	gEngfuncs.pfnCompareFileTime = CompareFileTime;
+	gEngfuncs.pfnGetGameDir = GetGameDir;
+	gEngfuncs.pfnCvar_RegisterVariable = CVarRegister;
+	gEngfuncs.pfnSetClientMaxspeed = SetClientMaxspeed;
+	gEngfuncs.pfnNumberOfEntities = NumberOfEntities;
+	gEngfuncs.pfnGetInfoKeyBuffer = GetInfoKeyBuffer;
+	gEngfuncs.pfnInfoKeyValue = InfoKeyValue;
+	gEngfuncs.pfnIsMapValid = IsMapValid;
+	gEngfuncs.pfnGetPlayerUserId = GetPlayerUserId;
+	gEngfuncs.pfnIsDedicatedServer = IsDedicatedServer;
+	gEngfuncs.pfnCVarGetPointer = CVarGetPointer;
+	gEngfuncs.pfnGetPhysicsKeyValue = GetPhysicsKeyValue;
+	gEngfuncs.pfnGetPhysicsInfoString = GetPhysicsInfoString;
+	gEngfuncs.pfnPrecacheEvent = PrecacheEvent;
+	gEngfuncs.pfnSetFatPVS = SetFatPVS;
+	gEngfuncs.pfnSetFatPAS = SetFatPVS;
+	gEngfuncs.pfnCheckVisibility = CheckVisibility;
+	gEngfuncs.pfnDeltaFindField = DeltaFindField;
+	gEngfuncs.pfnCvar_DirectSet = CvarDirectSet;
+	gEngfuncs.pfnAddServerCommand = AddServerCommand;
+	gEngfuncs.pfnVoice_SetClientListening = Voice_SetClientListening;
+	gEngfuncs.pfnGetPlayerAuthId = GetPlayerAuthId;
+	gEngfuncs.pfnGetFileSize = GetFileSize;
+	gEngfuncs.pfnCheckParm = CheckParm;
+	gEngfuncs.pfnPEntityOfEntIndexAllEntities = PEntityOfEntIndexAllEntities;
+}
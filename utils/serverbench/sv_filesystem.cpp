@@ -0,0 +1,468 @@
+//=========================================================
+// sv_filesystem.cpp - stdio filesystem for the headless
+// server harness. Implements the engine's IFileSystem over
+// plain directories so neither the harness nor the game dll
+// needs the install's filesystem_stdio.so. Pack files and
+// the Steam cache are not supported, and names are case
+// sensitive like the rest of the Linux filesystem.
+//=========================================================
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstring>
+#include <ctime>
+#include <glob.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "serverbench.h"
+#include "FileSystem.h"
+
+class CStdioFileSystem : public IFileSystem
+{
+public:
+	void Mount() override {}
+	void Unmount() override {}
+
+	void RemoveAllSearchPaths() override
+	{
+		m_SearchPaths.clear();
+	}
+
+	void AddSearchPath(const char* pPath, const char* pathID) override
+	{
+		AddPath(pPath, pathID, true);
+	}
+
+	bool RemoveSearchPath(const char* pPath) override
+	{
+		std::string path = FixPath(pPath);
+		bool removed = false;
+
+		for (auto it = m_SearchPaths.begin(); it != m_SearchPaths.end();)
+		{
+			if (it->path == path)
+			{
+				it = m_SearchPaths.erase(it);
+				removed = true;
+			}
+			else
+				++it;
+		}
+
+		return removed;
+	}
+
+	void RemoveFile(const char* pRelativePath, const char* pathID) override
+	{
+		std::string path;
+		if (WritePath(pRelativePath, pathID, path))
+			remove(path.c_str());
+	}
+
+	void CreateDirHierarchy(const char* path, const char* pathID) override
+	{
+		std::string full;
+		if (!WritePath(path, pathID, full))
+			return;
+
+		for (std::size_t slash = full.find('/', 1); slash != std::string::npos; slash = full.find('/', slash + 1))
+			mkdir(full.substr(0, slash).c_str(), 0755);
+
+		mkdir(full.c_str(), 0755);
+	}
+
+	bool FileExists(const char* pFileName) override
+	{
+		std::string path;
+		return FindPath(pFileName, nullptr, path);
+	}
+
+	bool IsDirectory(const char* pFileName) override
+	{
+		std::string path;
+		struct stat buf;
+		return FindPath(pFileName, nullptr, path) && 0 == stat(path.c_str(), &buf) && S_ISDIR(buf.st_mode);
+	}
+
+	FileHandle_t Open(const char* pFileName, const char* pOptions, const char* pathID = nullptr) override
+	{
+		const bool write = nullptr != strpbrk(pOptions, "wa+");
+		std::string path;
+
+		// New files go to the write path, reads and updates use the first path that has the file
+		if (write && nullptr == strchr(pOptions, 'r'))
+		{
+			if (!WritePath(pFileName, pathID, path))
+				return FILESYSTEM_INVALID_HANDLE;
+		}
+		else if (!FindPath(pFileName, pathID, path))
+			return FILESYSTEM_INVALID_HANDLE;
+
+		return fopen(path.c_str(), pOptions);
+	}
+
+	void Close(FileHandle_t file) override
+	{
+		if (file)
+			fclose(AsFile(file));
+	}
+
+	void Seek(FileHandle_t file, int pos, FileSystemSeek_t seekType) override
+	{
+		static const int whence[] = {SEEK_SET, SEEK_CUR, SEEK_END};
+		fseek(AsFile(file), pos, whence[seekType]);
+	}
+
+	unsigned int Tell(FileHandle_t file) override
+	{
+		return static_cast<unsigned int>(ftell(AsFile(file)));
+	}
+
+	unsigned int Size(FileHandle_t file) override
+	{
+		struct stat buf;
+		return 0 == fstat(fileno(AsFile(file)), &buf) ? static_cast<unsigned int>(buf.st_size) : 0;
+	}
+
+	unsigned int Size(const char* pFileName) override
+	{
+		std::string path;
+		struct stat buf;
+		return FindPath(pFileName, nullptr, path) && 0 == stat(path.c_str(), &buf) ? static_cast<unsigned int>(buf.st_size) : 0;
+	}
+
+	long GetFileTime(const char* pFileName) override
+	{
+		std::string path;
+		struct stat buf;
+		return FindPath(pFileName, nullptr, path) && 0 == stat(path.c_str(), &buf) ? static_cast<long>(buf.st_mtime) : 0;
+	}
+
+	void FileTimeToString(char* pStrip, int maxCharsIncludingTerminator, long fileTime) override
+	{
+		time_t time = fileTime;
+		struct tm local;
+		localtime_r(&time, &local);
+		strftime(pStrip, maxCharsIncludingTerminator, "%c", &local);
+	}
+
+	bool IsOk(FileHandle_t file) override
+	{
+		return file && 0 == ferror(AsFile(file));
+	}
+
+	void Flush(FileHandle_t file) override
+	{
+		fflush(AsFile(file));
+	}
+
+	bool EndOfFile(FileHandle_t file) override
+	{
+		return 0 != feof(AsFile(file));
+	}
+
+	int Read(void* pOutput, int size, FileHandle_t file) override
+	{
+		return static_cast<int>(fread(pOutput, 1, size, AsFile(file)));
+	}
+
+	int Write(void const* pInput, int size, FileHandle_t file) override
+	{
+		return static_cast<int>(fwrite(pInput, 1, size, AsFile(file)));
+	}
+
+	char* ReadLine(char* pOutput, int maxChars, FileHandle_t file) override
+	{
+		return fgets(pOutput, maxChars, AsFile(file));
+	}
+
+	int FPrintf(FileHandle_t file, const char* pFormat, ...) override
+	{
+		va_list args;
+		va_start(args, pFormat);
+		int result = vfprintf(AsFile(file), pFormat, args);
+		va_end(args);
+		return result;
+	}
+
+	void* GetReadBuffer(FileHandle_t file, int* outBufferSize, bool failIfNotInCache) override
+	{
+		*outBufferSize = 0;
+		return nullptr;
+	}
+
+	void ReleaseReadBuffer(FileHandle_t file, void* readBuffer) override {}
+
+	const char* FindFirst(const char* pWildCard, FileFindHandle_t* pHandle, const char* pathID = nullptr) override
+	{
+		sbfind_t find;
+		std::string wildCard = FixPath(pWildCard);
+
+		// Names from earlier search paths hide the same name further down
+		for (const sbsearchpath_t& searchPath : m_SearchPaths)
+		{
+			if (!MatchesID(searchPath, pathID))
+				continue;
+
+			std::string pattern = searchPath.path + "/" + wildCard;
+			glob_t results;
+
+			if (0 != glob(pattern.c_str(), GLOB_MARK, nullptr, &results))
+				continue;
+
+			for (std::size_t i = 0; i < results.gl_pathc; i++)
+			{
+				std::string name = results.gl_pathv[i];
+				const bool directory = !name.empty() && name.back() == '/';
+
+				if (directory)
+					name.pop_back();
+
+				name = name.substr(name.find_last_of('/') + 1);
+
+				if (std::find(find.names.begin(), find.names.end(), name) == find.names.end())
+				{
+					find.names.push_back(name);
+					find.directories.push_back(directory);
+				}
+			}
+
+			globfree(&results);
+		}
+
+		if (find.names.empty())
+		{
+			*pHandle = FILESYSTEM_INVALID_FIND_HANDLE;
+			return nullptr;
+		}
+
+		*pHandle = static_cast<FileFindHandle_t>(m_Finds.size());
+		m_Finds.push_back(std::move(find));
+		return m_Finds.back().names[0].c_str();
+	}
+
+	const char* FindNext(FileFindHandle_t handle) override
+	{
+		sbfind_t* find = GetFind(handle);
+		if (!find || ++find->current >= find->names.size())
+			return nullptr;
+
+		return find->names[find->current].c_str();
+	}
+
+	bool FindIsDirectory(FileFindHandle_t handle) override
+	{
+		sbfind_t* find = GetFind(handle);
+		return find && find->current < find->names.size() && find->directories[find->current];
+	}
+
+	void FindClose(FileFindHandle_t handle) override
+	{
+		sbfind_t* find = GetFind(handle);
+		if (!find)
+			return;
+
+		find->names.clear();
+		find->directories.clear();
+
+		while (!m_Finds.empty() && m_Finds.back().names.empty())
+			m_Finds.pop_back();
+	}
+
+	void GetLocalCopy(const char* pFileName) override {}
+
+	const char* GetLocalPath(const char* pFileName, char* pLocalPath, int localPathBufferSize) override
+	{
+		std::string path;
+		if (!FindPath(pFileName, nullptr, path))
+			return nullptr;
+
+		snprintf(pLocalPath, localPathBufferSize, "%s", path.c_str());
+		return pLocalPath;
+	}
+
+	char* ParseFile(char* pFileBytes, char* pToken, bool* pWasQuoted) override
+	{
+		return nullptr;
+	}
+
+	bool FullPathToRelativePath(const char* pFullpath, char* pRelative) override
+	{
+		std::string full = FixPath(pFullpath);
+
+		for (const sbsearchpath_t& searchPath : m_SearchPaths)
+		{
+			if (0 == full.compare(0, searchPath.path.size(), searchPath.path) && full.size() > searchPath.path.size() && full[searchPath.path.size()] == '/')
+			{
+				strcpy(pRelative, full.c_str() + searchPath.path.size() + 1);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool GetCurrentDirectory(char* pDirectory, int maxlen) override
+	{
+		return nullptr != getcwd(pDirectory, maxlen);
+	}
+
+	void PrintOpenedFiles() override {}
+	void SetWarningFunc(void (*pfnWarning)(const char* fmt, ...)) override {}
+	void SetWarningLevel(FileWarningLevel_t level) override {}
+	void LogLevelLoadStarted(const char* name) override {}
+	void LogLevelLoadFinished(const char* name) override {}
+	int HintResourceNeed(const char* hintlist, int forgetEverything) override { return 0; }
+	int PauseResourcePreloading() override { return 0; }
+	int ResumeResourcePreloading() override { return 0; }
+
+	int SetVBuf(FileHandle_t stream, char* buffer, int mode, long size) override
+	{
+		return setvbuf(AsFile(stream), buffer, mode, size);
+	}
+
+	void GetInterfaceVersion(char* p, int maxlen) override
+	{
+		snprintf(p, maxlen, "%s", FILESYSTEM_INTERFACE_VERSION);
+	}
+
+	bool IsFileImmediatelyAvailable(const char* pFileName) override { return true; }
+	WaitForResourcesHandle_t WaitForResources(const char* resourcelist) override { return 0; }
+
+	bool GetWaitForResourcesProgress(WaitForResourcesHandle_t handle, float* progress, bool* complete) override
+	{
+		*progress = 1.0f;
+		*complete = true;
+		return true;
+	}
+
+	void CancelWaitForResources(WaitForResourcesHandle_t handle) override {}
+	bool IsAppReadyForOfflinePlay(int appID) override { return true; }
+	bool AddPackFile(const char* fullpath, const char* pathID) override { return false; }
+
+	FileHandle_t OpenFromCacheForRead(const char* pFileName, const char* pOptions, const char* pathID = nullptr) override
+	{
+		return Open(pFileName, pOptions, pathID);
+	}
+
+	void AddSearchPathNoWrite(const char* pPath, const char* pathID) override
+	{
+		AddPath(pPath, pathID, false);
+	}
+
+	long GetFileModificationTime(const char* pFileName) override
+	{
+		return GetFileTime(pFileName);
+	}
+
+private:
+	struct sbsearchpath_t
+	{
+		std::string path;
+		std::string id;
+		bool writable;
+	};
+
+	struct sbfind_t
+	{
+		std::vector<std::string> names;
+		std::vector<bool> directories;
+		std::size_t current = 0;
+	};
+
+	static FILE* AsFile(FileHandle_t file)
+	{
+		return static_cast<FILE*>(file);
+	}
+
+	static std::string FixPath(const char* pPath)
+	{
+		std::string path = pPath;
+		std::replace(path.begin(), path.end(), '\\', '/');
+
+		while (path.size() > 1 && path.back() == '/')
+			path.pop_back();
+
+		return path;
+	}
+
+	static bool MatchesID(const sbsearchpath_t& searchPath, const char* pathID)
+	{
+		return !pathID || 0 == strcasecmp(searchPath.id.c_str(), pathID);
+	}
+
+	void AddPath(const char* pPath, const char* pathID, bool writable)
+	{
+		m_SearchPaths.push_back({FixPath(pPath), pathID ? pathID : "", writable});
+	}
+
+	// Full path of the first existing file in the search paths
+	bool FindPath(const char* pFileName, const char* pathID, std::string& path) const
+	{
+		std::string name = FixPath(pFileName);
+		struct stat buf;
+
+		if (name.empty())
+			return false;
+
+		if (name[0] == '/')
+		{
+			path = name;
+			return 0 == stat(path.c_str(), &buf);
+		}
+
+		for (const sbsearchpath_t& searchPath : m_SearchPaths)
+		{
+			if (!MatchesID(searchPath, pathID))
+				continue;
+
+			path = searchPath.path + "/" + name;
+			if (0 == stat(path.c_str(), &buf))
+				return true;
+		}
+
+		return false;
+	}
+
+	// Full path in the first writable search path, the mod directory when no ID is given
+	bool WritePath(const char* pFileName, const char* pathID, std::string& path) const
+	{
+		std::string name = FixPath(pFileName);
+
+		if (!name.empty() && name[0] == '/')
+		{
+			path = name;
+			return true;
+		}
+
+		for (const sbsearchpath_t& searchPath : m_SearchPaths)
+		{
+			if (searchPath.writable && MatchesID(searchPath, pathID ? pathID : "GAME"))
+			{
+				path = searchPath.path + "/" + name;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	sbfind_t* GetFind(FileFindHandle_t handle)
+	{
+		if (handle < 0 || handle >= static_cast<FileFindHandle_t>(m_Finds.size()))
+			return nullptr;
+
+		return &m_Finds[handle];
+	}
+
+	std::vector<sbsearchpath_t> m_SearchPaths;
+	std::vector<sbfind_t> m_Finds;
+};
+
+static CStdioFileSystem g_StdioFileSystem;
+
+IFileSystem* SB_StdioFileSystem()
+{
+	return &g_StdioFileSystem;
+}
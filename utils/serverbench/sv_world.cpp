@@ -0,0 +1,824 @@
+//=========================================================
+// sv_world.cpp - BSP collision, movement and physics for
+// the headless server harness. Follows the Quake/GoldSrc
+// server code closely enough for monster movement, trigger
+// touches and brush entity motion to behave the same way;
+// it is not a replacement for the real engine.
+//=========================================================
+
+#include <cmath>
+#include <cstring>
+
+#include "serverbench.h"
+
+//=========================================================
+// BSP file format (version 30)
+//=========================================================
+#define BSPVERSION 30
+
+#define LUMP_ENTITIES 0
+#define LUMP_PLANES 1
+#define LUMP_NODES 5
+#define LUMP_CLIPNODES 9
+#define LUMP_LEAFS 10
+#define LUMP_MODELS 14
+#define HEADER_LUMPS 15
+
+#define CONTENTS_CURRENT_0 -9
+#define CONTENTS_CURRENT_DOWN -14
+
+#define DIST_EPSILON (0.03125f)
+#define STEPSIZE 18.0f
+
+struct dlump_t
+{
+	int fileofs, filelen;
+};
+
+struct dheader_t
+{
+	int version;
+	dlump_t lumps[HEADER_LUMPS];
+};
+
+struct dplane_t
+{
+	float normal[3];
+	float dist;
+	int type;
+};
+
+struct dnode_t
+{
+	int planenum;
+	short children[2];
+	short mins[3];
+	short maxs[3];
+	unsigned short firstface;
+	unsigned short numfaces;
+};
+
+struct dclipnode_t
+{
+	int planenum;
+	short children[2];
+};
+
+struct dleaf_t
+{
+	int contents;
+	int visofs;
+	short mins[3];
+	short maxs[3];
+	unsigned short firstmarksurface;
+	unsigned short nummarksurfaces;
+	byte ambient_level[4];
+};
+
+struct dmodel_t
+{
+	float mins[3], maxs[3];
+	float origin[3];
+	int headnode[SB_MAX_HULLS];
+	int visleafs;
+	int firstface, numfaces;
+};
+
+struct sbclipnode_t
+{
+	int planenum;
+	int children[2];
+};
+
+struct sbhull_t
+{
+	const sbclipnode_t* clipnodes;
+	const dplane_t* planes;
+	int firstclipnode;
+	Vector clip_mins;
+	Vector clip_maxs;
+};
+
+static std::vector<dplane_t> g_Planes;
+static std::vector<sbclipnode_t> g_Hull0Nodes; // hull 0 rebuilt from the drawing nodes
+static std::vector<sbclipnode_t> g_ClipNodes;
+static std::vector<dmodel_t> g_Models;
+static std::string g_EntityLump;
+
+static const Vector g_HullMins[SB_MAX_HULLS] = {Vector(0, 0, 0), Vector(-16, -16, -36), Vector(-32, -32, -32), Vector(-16, -16, -18)};
+static const Vector g_HullMaxs[SB_MAX_HULLS] = {Vector(0, 0, 0), Vector(16, 16, 36), Vector(32, 32, 32), Vector(16, 16, 18)};
+
+// box hull used to clip against non-bsp entities
+static dplane_t g_BoxPlanes[6];
+static sbclipnode_t g_BoxNodes[6];
+
+template <typename T>
+static bool CopyLump(const std::vector<byte>& file, const dheader_t* header, int lump, std::vector<T>& out)
+{
+	const dlump_t& l = header->lumps[lump];
+
+	if (l.fileofs < 0 || l.filelen < 0 || l.fileofs + l.filelen > static_cast<int>(file.size()) || (l.filelen % sizeof(T)) != 0)
+		return false;
+
+	out.resize(l.filelen / sizeof(T));
+	memcpy(out.data(), file.data() + l.fileofs, l.filelen);
+	return true;
+}
+
+static void InitBoxHull()
+{
+	for (int i = 0; i < 6; i++)
+	{
+		int side = i & 1;
+
+		g_BoxNodes[i].planenum = i;
+		g_BoxNodes[i].children[side] = CONTENTS_EMPTY;
+		g_BoxNodes[i].children[side ^ 1] = (i != 5) ? i + 1 : CONTENTS_SOLID;
+
+		memset(&g_BoxPlanes[i], 0, sizeof(dplane_t));
+		g_BoxPlanes[i].type = i >> 1;
+		g_BoxPlanes[i].normal[i >> 1] = 1;
+	}
+}
+
+bool SB_LoadBSP(const char* fileName)
+{
+	std::vector<byte> file = SB_LoadFile(fileName);
+
+	if (file.size() < sizeof(dheader_t))
+	{
+		printf("Couldn't load %s\n", fileName);
+		return false;
+	}
+
+	const dheader_t* header = reinterpret_cast<const dheader_t*>(file.data());
+
+	if (header->version != BSPVERSION)
+	{
+		printf("%s has version %d, expected %d\n", fileName, header->version, BSPVERSION);
+		return false;
+	}
+
+	std::vector<dnode_t> nodes;
+	std::vector<dclipnode_t> clipnodes;
+	std::vector<dleaf_t> leafs;
+	std::vector<char> entities;
+
+	if (!CopyLump(file, header, LUMP_PLANES, g_Planes) || !CopyLump(file, header, LUMP_NODES, nodes) || !CopyLump(file, header, LUMP_CLIPNODES, clipnodes) || !CopyLump(file, header, LUMP_LEAFS, leafs) || !CopyLump(file, header, LUMP_MODELS, g_Models) || !CopyLump(file, header, LUMP_ENTITIES, entities))
+	{
+		printf("%s is corrupt\n", fileName);
+		return false;
+	}
+
+	g_EntityLump.assign(entities.begin(), entities.end());
+
+	// hull 0 collides against the drawing nodes, leafs become their contents
+	g_Hull0Nodes.resize(nodes.size());
+	for (std::size_t i = 0; i < nodes.size(); i++)
+	{
+		g_Hull0Nodes[i].planenum = nodes[i].planenum;
+
+		for (int j = 0; j < 2; j++)
+		{
+			int child = nodes[i].children[j];
+			g_Hull0Nodes[i].children[j] = (child >= 0) ? child : leafs[-1 - child].contents;
+		}
+	}
+
+	// clipnode children are shorts, large maps wrap them around
+	g_ClipNodes.resize(clipnodes.size());
+	for (std::size_t i = 0; i < clipnodes.size(); i++)
+	{
+		g_ClipNodes[i].planenum = clipnodes[i].planenum;
+
+		for (int j = 0; j < 2; j++)
+		{
+			int child = clipnodes[i].children[j];
+			if (child >= static_cast<int>(clipnodes.size()))
+				child -= 65536;
+			g_ClipNodes[i].children[j] = child;
+		}
+	}
+
+	InitBoxHull();
+	return true;
+}
+
+const char* SB_EntityLump()
+{
+	return g_EntityLump.c_str();
+}
+
+int SB_NumSubModels()
+{
+	return static_cast<int>(g_Models.size());
+}
+
+void SB_SubModelBounds(int index, float* mins, float* maxs)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		mins[i] = g_Models[index].mins[i];
+		maxs[i] = g_Models[index].maxs[i];
+	}
+}
+
+//=========================================================
+// Hull tracing
+//=========================================================
+int SB_HullForSize(const float* mins, const float* maxs)
+{
+	float size[3];
+
+	for (int i = 0; i < 3; i++)
+		size[i] = maxs[i] - mins[i];
+
+	if (size[0] <= 8)
+		return SB_HULL_POINT;
+
+	if (size[0] <= 36)
+		return (size[2] <= 36) ? SB_HULL_HEAD : SB_HULL_HUMAN;
+
+	return SB_HULL_LARGE;
+}
+
+void SB_HullBounds(int hullNum, Vector& mins, Vector& maxs)
+{
+	mins = g_HullMins[hullNum];
+	maxs = g_HullMaxs[hullNum];
+}
+
+static bool GetBrushHull(int modelIndex, int hullNum, sbhull_t& hull)
+{
+	if (modelIndex < 0 || modelIndex >= static_cast<int>(g_Models.size()))
+		return false;
+
+	hull.planes = g_Planes.data();
+	hull.firstclipnode = g_Models[modelIndex].headnode[hullNum];
+	hull.clipnodes = (hullNum == SB_HULL_POINT) ? g_Hull0Nodes.data() : g_ClipNodes.data();
+	hull.clip_mins = g_HullMins[hullNum];
+	hull.clip_maxs = g_HullMaxs[hullNum];
+	return true;
+}
+
+static void GetBoxHull(const Vector& mins, const Vector& maxs, sbhull_t& hull)
+{
+	g_BoxPlanes[0].dist = maxs.x;
+	g_BoxPlanes[1].dist = mins.x;
+	g_BoxPlanes[2].dist = maxs.y;
+	g_BoxPlanes[3].dist = mins.y;
+	g_BoxPlanes[4].dist = maxs.z;
+	g_BoxPlanes[5].dist = mins.z;
+
+	hull.planes = g_BoxPlanes;
+	hull.clipnodes = g_BoxNodes;
+	hull.firstclipnode = 0;
+	hull.clip_mins = hull.clip_maxs = Vector(0, 0, 0);
+}
+
+static inline float PlaneDiff(const dplane_t* plane, const Vector& p)
+{
+	if (plane->type < 3)
+		return p[plane->type] - plane->dist;
+
+	return plane->normal[0] * p.x + plane->normal[1] * p.y + plane->normal[2] * p.z - plane->dist;
+}
+
+static int HullPointContents(const sbhull_t& hull, int num, const Vector& p)
+{
+	while (num >= 0)
+	{
+		const sbclipnode_t* node = &hull.clipnodes[num];
+		num = node->children[PlaneDiff(&hull.planes[node->planenum], p) < 0 ? 1 : 0];
+	}
+
+	return num;
+}
+
+static bool RecursiveHullCheck(const sbhull_t& hull, int num, float p1f, float p2f, const Vector& p1, const Vector& p2, TraceResult* trace)
+{
+	if (num < 0)
+	{
+		if (num != CONTENTS_SOLID)
+		{
+			trace->fAllSolid = 0;
+			if (num == CONTENTS_EMPTY)
+				trace->fInOpen = 1;
+			else
+				trace->fInWater = 1;
+		}
+		else
+			trace->fStartSolid = 1;
+
+		return true;
+	}
+
+	const sbclipnode_t* node = &hull.clipnodes[num];
+	const dplane_t* plane = &hull.planes[node->planenum];
+
+	float t1 = PlaneDiff(plane, p1);
+	float t2 = PlaneDiff(plane, p2);
+
+	if (t1 >= 0 && t2 >= 0)
+		return RecursiveHullCheck(hull, node->children[0], p1f, p2f, p1, p2, trace);
+	if (t1 < 0 && t2 < 0)
+		return RecursiveHullCheck(hull, node->children[1], p1f, p2f, p1, p2, trace);
+
+	// put the crosspoint DIST_EPSILON pixels on the near side
+	float frac = (t1 < 0) ? (t1 + DIST_EPSILON) / (t1 - t2) : (t1 - DIST_EPSILON) / (t1 - t2);
+	frac = std::fmax(0.0f, std::fmin(1.0f, frac));
+
+	float midf = p1f + (p2f - p1f) * frac;
+	Vector mid = p1 + (p2 - p1) * frac;
+	int side = (t1 < 0) ? 1 : 0;
+
+	// move up to the node
+	if (!RecursiveHullCheck(hull, node->children[side], p1f, midf, p1, mid, trace))
+		return false;
+
+	// go past the node
+	if (HullPointContents(hull, node->children[side ^ 1], mid) != CONTENTS_SOLID)
+		return RecursiveHullCheck(hull, node->children[side ^ 1], midf, p2f, mid, p2, trace);
+
+	// never got out of the solid area
+	if (0 != trace->fAllSolid)
+		return false;
+
+	// the other side of the node is solid, this is the impact point
+	if (0 == side)
+	{
+		trace->vecPlaneNormal = Vector(plane->normal[0], plane->normal[1], plane->normal[2]);
+		trace->flPlaneDist = plane->dist;
+	}
+	else
+	{
+		trace->vecPlaneNormal = Vector(-plane->normal[0], -plane->normal[1], -plane->normal[2]);
+		trace->flPlaneDist = -plane->dist;
+	}
+
+	while (HullPointContents(hull, hull.firstclipnode, mid) == CONTENTS_SOLID)
+	{
+		// shouldn't really happen, but does occasionally
+		frac -= 0.1f;
+		if (frac < 0)
+		{
+			trace->flFraction = midf;
+			trace->vecEndPos = mid;
+			return false;
+		}
+
+		midf = p1f + (p2f - p1f) * frac;
+		mid = p1 + (p2 - p1) * frac;
+	}
+
+	trace->flFraction = midf;
+	trace->vecEndPos = mid;
+	return false;
+}
+
+static void ClipToHull(const sbhull_t& hull, const Vector& offset, const Vector& start, const Vector& end, TraceResult* trace)
+{
+	memset(trace, 0, sizeof(TraceResult));
+	trace->flFraction = 1;
+	trace->fAllSolid = 1;
+	trace->vecEndPos = end;
+
+	Vector startLocal = start - offset;
+	Vector endLocal = end - offset;
+
+	RecursiveHullCheck(hull, hull.firstclipnode, 0, 1, startLocal, endLocal, trace);
+
+	if (trace->flFraction != 1)
+		trace->vecEndPos = trace->vecEndPos + offset;
+
+	if (0 != trace->fAllSolid)
+		trace->fStartSolid = 1;
+}
+
+static int BrushModelIndex(const edict_t* ed)
+{
+	const char* model = SB_STRING(ed->v.model);
+
+	if (ed->v.modelindex <= 0 || model[0] != '*')
+		return -1;
+
+	return atoi(model + 1);
+}
+
+void SB_ClipMoveToEntity(edict_t* ed, const Vector& start, const Vector& mins, const Vector& maxs, const Vector& end, TraceResult* trace)
+{
+	sbhull_t hull;
+	Vector offset;
+	int model = (ed->v.solid == SOLID_BSP) ? BrushModelIndex(ed) : -1;
+
+	if (model >= 0)
+	{
+		int hullNum = SB_HullForSize(mins, maxs);
+		GetBrushHull(model, hullNum, hull);
+		offset = hull.clip_mins - mins + ed->v.origin;
+	}
+	else
+	{
+		GetBoxHull(ed->v.mins - maxs, ed->v.maxs - mins, hull);
+		offset = ed->v.origin;
+	}
+
+	ClipToHull(hull, offset, start, end, trace);
+	trace->pHit = ed;
+}
+
+void SB_Move(const float* start, const float* mins, const float* maxs, const float* end, int noMonsters, edict_t* passEdict, TraceResult* tr)
+{
+	const Vector vecStart(start), vecEnd(end), vecMins(mins), vecMaxs(maxs);
+	const bool ignoreGlass = (noMonsters & SB_MOVE_IGNOREGLASS) != 0;
+	const int moveType = noMonsters & 0xFF;
+
+	// the world first
+	sbhull_t hull;
+	int hullNum = SB_HullForSize(mins, maxs);
+	GetBrushHull(0, hullNum, hull);
+	ClipToHull(hull, hull.clip_mins - vecMins, vecStart, vecEnd, tr);
+	tr->pHit = sv.edicts;
+
+	if (0 != tr->fAllSolid)
+		return;
+
+	// bounds of the whole move
+	Vector boxMins, boxMaxs;
+	for (int i = 0; i < 3; i++)
+	{
+		boxMins[i] = std::fmin(vecStart[i], vecEnd[i]) + vecMins[i] - 1;
+		boxMaxs[i] = std::fmax(vecStart[i], vecEnd[i]) + vecMaxs[i] + 1;
+	}
+
+	for (int i = 1; i < sv.numEdicts; i++)
+	{
+		edict_t* touch = &sv.edicts[i];
+
+		if (0 != touch->free || touch->v.solid == SOLID_NOT || touch->v.solid == SOLID_TRIGGER)
+			continue;
+		if (touch == passEdict)
+			continue;
+		if (moveType == SB_MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP)
+			continue;
+		if (ignoreGlass && touch->v.rendermode != kRenderNormal)
+			continue;
+		if (passEdict && (touch->v.owner == passEdict || passEdict->v.owner == touch))
+			continue;
+
+		if (boxMins.x > touch->v.absmax.x || boxMins.y > touch->v.absmax.y || boxMins.z > touch->v.absmax.z || boxMaxs.x < touch->v.absmin.x || boxMaxs.y < touch->v.absmin.y || boxMaxs.z < touch->v.absmin.z)
+			continue;
+
+		TraceResult entTrace;
+		SB_ClipMoveToEntity(touch, vecStart, vecMins, vecMaxs, vecEnd, &entTrace);
+
+		if (0 != entTrace.fAllSolid || 0 != entTrace.fStartSolid || entTrace.flFraction < tr->flFraction)
+		{
+			if (0 != tr->fStartSolid)
+			{
+				*tr = entTrace;
+				tr->fStartSolid = 1;
+			}
+			else
+				*tr = entTrace;
+		}
+
+		if (0 != tr->fAllSolid)
+			return;
+	}
+}
+
+int SB_PointContents(const float* point)
+{
+	sbhull_t hull;
+	GetBrushHull(0, SB_HULL_POINT, hull);
+
+	int contents = HullPointContents(hull, hull.firstclipnode, Vector(point));
+
+	// currents are just water as far as the game is concerned
+	if (contents <= CONTENTS_CURRENT_0 && contents >= CONTENTS_CURRENT_DOWN)
+		contents = CONTENTS_WATER;
+
+	return contents;
+}
+
+//=========================================================
+// Linking and trigger touches
+//=========================================================
+void SB_LinkEdict(edict_t* ed, bool touchTriggers)
+{
+	if (ed == sv.edicts || 0 != ed->free)
+		return;
+
+	if (gEntityInterface.pfnSetAbsBox)
+		gEntityInterface.pfnSetAbsBox(ed);
+
+	if (!touchTriggers || ed->v.solid == SOLID_NOT)
+		return;
+
+	for (int i = 1; i < sv.numEdicts; i++)
+	{
+		edict_t* touch = &sv.edicts[i];
+
+		if (touch == ed || 0 != touch->free || touch->v.solid != SOLID_TRIGGER)
+			continue;
+
+		if (ed->v.absmin.x > touch->v.absmax.x || ed->v.absmin.y > touch->v.absmax.y || ed->v.absmin.z > touch->v.absmax.z || ed->v.absmax.x < touch->v.absmin.x || ed->v.absmax.y < touch->v.absmin.y || ed->v.absmax.z < touch->v.absmin.z)
+			continue;
+
+		gGlobals.time = sv.time;
+		gEntityInterface.pfnTouch(touch, ed);
+
+		if (0 != ed->free)
+			return;
+	}
+}
+
+//=========================================================
+// Monster movement
+//=========================================================
+static bool MoveStep(edict_t* ed, const Vector& move, bool relink, bool noMonsters)
+{
+	TraceResult tr;
+	Vector neworg = ed->v.origin + move;
+
+	// flying and swimming monsters just move
+	if ((ed->v.flags & (FL_SWIM | FL_FLY)) != 0)
+	{
+		SB_Move(ed->v.origin, ed->v.mins, ed->v.maxs, neworg, noMonsters ? SB_MOVE_NOMONSTERS : SB_MOVE_NORMAL, ed, &tr);
+		if (tr.flFraction != 1)
+			return false;
+
+		if (relink)
+		{
+			ed->v.origin = tr.vecEndPos;
+			SB_LinkEdict(ed, true);
+		}
+		return true;
+	}
+
+	// push down from a step height above the wished position
+	neworg.z += STEPSIZE;
+	Vector end = neworg;
+	end.z -= STEPSIZE * 2;
+
+	SB_Move(neworg, ed->v.mins, ed->v.maxs, end, noMonsters ? SB_MOVE_NOMONSTERS : SB_MOVE_NORMAL, ed, &tr);
+
+	if (0 != tr.fAllSolid)
+		return false;
+
+	if (0 != tr.fStartSolid)
+	{
+		neworg.z -= STEPSIZE;
+		SB_Move(neworg, ed->v.mins, ed->v.maxs, end, noMonsters ? SB_MOVE_NOMONSTERS : SB_MOVE_NORMAL, ed, &tr);
+		if (0 != tr.fAllSolid || 0 != tr.fStartSolid)
+			return false;
+	}
+
+	if (tr.flFraction == 1)
+	{
+		// if monster had the ground pulled out, go ahead and fall
+		if ((ed->v.flags & FL_PARTIALGROUND) != 0)
+		{
+			if (relink)
+			{
+				ed->v.origin = ed->v.origin + move;
+				SB_LinkEdict(ed, true);
+			}
+			ed->v.flags &= ~FL_ONGROUND;
+			return true;
+		}
+
+		// walked off an edge
+		return false;
+	}
+
+	if (!relink)
+		return true;
+
+	ed->v.origin = tr.vecEndPos;
+	ed->v.flags &= ~FL_PARTIALGROUND;
+	ed->v.groundentity = tr.pHit;
+	SB_LinkEdict(ed, true);
+	return true;
+}
+
+int SB_WalkMove(edict_t* ed, float yaw, float dist, int mode)
+{
+	if ((ed->v.flags & (FL_ONGROUND | FL_FLY | FL_SWIM)) == 0)
+		return 0;
+
+	yaw = yaw * M_PI * 2 / 360;
+	Vector move(cos(yaw) * dist, sin(yaw) * dist, 0);
+
+	return MoveStep(ed, move, mode != WALKMOVE_CHECKONLY, mode == WALKMOVE_WORLDONLY) ? 1 : 0;
+}
+
+int SB_DropToFloor(edict_t* ed)
+{
+	TraceResult tr;
+	Vector end = ed->v.origin;
+	end.z -= 256;
+
+	SB_Move(ed->v.origin, ed->v.mins, ed->v.maxs, end, SB_MOVE_NORMAL, ed, &tr);
+
+	if (0 != tr.fAllSolid)
+		return -1;
+
+	if (tr.flFraction == 1)
+		return 0;
+
+	ed->v.origin = tr.vecEndPos;
+	SB_LinkEdict(ed, false);
+	ed->v.flags |= FL_ONGROUND;
+	ed->v.groundentity = tr.pHit;
+	return 1;
+}
+
+//=========================================================
+// Physics
+//=========================================================
+static bool RunThink(edict_t* ed)
+{
+	float thinktime = ed->v.nextthink;
+
+	if (thinktime <= 0 || thinktime > sv.time + sv.frametime)
+		return true;
+
+	if (thinktime < sv.time)
+		thinktime = sv.time;
+
+	ed->v.nextthink = 0;
+	gGlobals.time = thinktime;
+	gEntityInterface.pfnThink(ed);
+
+	return 0 == ed->free;
+}
+
+static void Physics_Pusher(edict_t* ed)
+{
+	float oldltime = ed->v.ltime;
+	float thinktime = ed->v.nextthink;
+	float movetime;
+
+	if (thinktime < ed->v.ltime + sv.frametime)
+		movetime = std::fmax(thinktime - ed->v.ltime, 0.0f);
+	else
+		movetime = sv.frametime;
+
+	if (movetime > 0)
+	{
+		// no blocking checks, pushers go through whatever is in the way
+		if (ed->v.velocity != Vector(0, 0, 0) || ed->v.avelocity != Vector(0, 0, 0))
+		{
+			ed->v.origin = ed->v.origin + ed->v.velocity * movetime;
+			ed->v.angles = ed->v.angles + ed->v.avelocity * movetime;
+			SB_LinkEdict(ed, false);
+		}
+
+		ed->v.ltime += movetime;
+	}
+
+	if (thinktime > oldltime && thinktime <= ed->v.ltime)
+	{
+		ed->v.nextthink = 0;
+		gGlobals.time = sv.time;
+		gEntityInterface.pfnThink(ed);
+	}
+}
+
+static void Physics_Toss(edict_t* ed)
+{
+	if (!RunThink(ed))
+		return;
+
+	if ((ed->v.flags & FL_ONGROUND) != 0 && ed->v.velocity == Vector(0, 0, 0))
+		return;
+
+	if (ed->v.movetype != MOVETYPE_FLY && ed->v.movetype != MOVETYPE_FLYMISSILE && (ed->v.flags & (FL_FLY | FL_SWIM)) == 0)
+	{
+		float gravity = (ed->v.gravity != 0) ? ed->v.gravity : 1.0f;
+		ed->v.velocity.z -= gravity * SB_CvarValue("sv_gravity") * sv.frametime;
+	}
+
+	ed->v.angles = ed->v.angles + ed->v.avelocity * sv.frametime;
+
+	TraceResult tr;
+	Vector end = ed->v.origin + ed->v.velocity * sv.frametime;
+	SB_Move(ed->v.origin, ed->v.mins, ed->v.maxs, end, ed->v.movetype == MOVETYPE_FLYMISSILE ? SB_MOVE_MISSILE : SB_MOVE_NORMAL, ed, &tr);
+
+	ed->v.origin = tr.vecEndPos;
+	SB_LinkEdict(ed, true);
+
+	if (0 != ed->free || tr.flFraction == 1)
+		return;
+
+	// impact, both sides get a touch
+	gGlobals.time = sv.time;
+	if (tr.pHit && tr.pHit != ed)
+	{
+		gEntityInterface.pfnTouch(ed, tr.pHit);
+		if (0 == tr.pHit->free && 0 == ed->free)
+			gEntityInterface.pfnTouch(tr.pHit, ed);
+	}
+
+	if (0 != ed->free)
+		return;
+
+	float backoff = (ed->v.movetype == MOVETYPE_BOUNCE) ? 1.5f : 1.0f;
+	ed->v.velocity = ed->v.velocity - tr.vecPlaneNormal * (DotProduct(ed->v.velocity, tr.vecPlaneNormal) * backoff);
+
+	if (tr.vecPlaneNormal.z > 0.7f)
+	{
+		ed->v.flags |= FL_ONGROUND;
+		ed->v.groundentity = tr.pHit;
+		if (ed->v.movetype != MOVETYPE_BOUNCE || ed->v.velocity.z < 60)
+		{
+			ed->v.velocity = Vector(0, 0, 0);
+			ed->v.avelocity = Vector(0, 0, 0);
+		}
+	}
+}
+
+static void Physics_Step(edict_t* ed)
+{
+	// monsters stay put unless something knocked them off the floor
+	if ((ed->v.flags & (FL_ONGROUND | FL_FLY | FL_SWIM)) == 0 || ed->v.velocity != Vector(0, 0, 0))
+	{
+		if ((ed->v.flags & (FL_FLY | FL_SWIM)) == 0)
+			ed->v.velocity.z -= SB_CvarValue("sv_gravity") * sv.frametime;
+
+		TraceResult tr;
+		Vector end = ed->v.origin + ed->v.velocity * sv.frametime;
+		SB_Move(ed->v.origin, ed->v.mins, ed->v.maxs, end, SB_MOVE_NORMAL, ed, &tr);
+
+		ed->v.origin = tr.vecEndPos;
+		if (tr.flFraction != 1 && tr.vecPlaneNormal.z > 0.7f)
+		{
+			ed->v.flags |= FL_ONGROUND;
+			ed->v.groundentity = tr.pHit;
+			ed->v.velocity = Vector(0, 0, 0);
+		}
+
+		SB_LinkEdict(ed, true);
+	}
+
+	RunThink(ed);
+}
+
+void SB_RunPhysics()
+{
+	for (int i = 0; i < sv.numEdicts; i++)
+	{
+		edict_t* ed = &sv.edicts[i];
+
+		if (0 != ed->free)
+			continue;
+
+		// clients are moved by their usercmds, there are none here
+		if (i > 0 && i <= gGlobals.maxClients)
+			continue;
+
+		switch (ed->v.movetype)
+		{
+		case MOVETYPE_PUSH:
+			Physics_Pusher(ed);
+			break;
+
+		case MOVETYPE_NONE:
+			RunThink(ed);
+			break;
+
+		case MOVETYPE_FOLLOW:
+			if (RunThink(ed) && ed->v.aiment)
+			{
+				ed->v.origin = ed->v.aiment->v.origin;
+				SB_LinkEdict(ed, false);
+			}
+			break;
+
+		case MOVETYPE_NOCLIP:
+			if (RunThink(ed))
+			{
+				ed->v.origin = ed->v.origin + ed->v.velocity * sv.frametime;
+				ed->v.angles = ed->v.angles + ed->v.avelocity * sv.frametime;
+				SB_LinkEdict(ed, false);
+			}
+			break;
+
+		case MOVETYPE_STEP:
+		case MOVETYPE_PUSHSTEP:
+			Physics_Step(ed);
+			break;
+
+		default:
+			Physics_Toss(ed);
+			break;
+		}
+
+		if (0 == ed->free && (ed->v.flags & FL_KILLME) != 0)
+			SB_FreeEdict(ed);
+	}
+
+	gGlobals.force_retouch = std::fmax(gGlobals.force_retouch - 1, 0.0f);
+}
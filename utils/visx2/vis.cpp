@@ -488,7 +488,8 @@ int main(int argc, char** argv)
 	StripExtension(source);
 	DefaultExtension(source, ".bsp");
 
-	LoadBSPFile(source);
+	MapBSPFile(source);
+	CopyLumpForWrite(LUMP_VISIBILITY); // rebuilt from scratch
 
 	strcpy(portalfile, argv[i]);
 	StripExtension(portalfile);